@@ -0,0 +1,1348 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// needed for RTLD_NEXT
+#define _GNU_SOURCE
+
+#include "parsebgp.h"
+#include "parsebgp_bgp_update_impl.h"
+#include "config.h"
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#define NAME "parsebgp-bench"
+
+// Default minimum time (in ms) to spend running each benchmark
+#define MIN_TIME_MS 500
+
+// Default maximum number of samples collected per benchmark and corpus
+#define MAX_SAMPLES 100000
+
+// Default number of (untimed) warm-up passes over the samples
+#define WARMUP_PASSES 1
+
+// Default number of timed runs (the best result of each metric is reported)
+#define RUNS 1
+
+// Size of the buffer used to build samples
+#define SAMPLE_BUFLEN (1024 * 1024)
+
+static const char *type_strs[] = {
+  NULL,  // PARSEBGP_MSG_TYPE_INVALID
+  "bgp", // PARSEBGP_MSG_TYPE_BGP
+  "bmp", // PARSEBGP_MSG_TYPE_BMP
+  "mrt", // PARSEBGP_MSG_TYPE_MRT
+};
+
+/** How the samples of a benchmark are decoded */
+typedef enum {
+  DECODE_MSG,        // parsebgp_decode (of the corpus type)
+  DECODE_UPDATE,     // parsebgp_bgp_update_decode
+  DECODE_PATH_ATTRS, // parsebgp_bgp_update_path_attrs_decode
+} bench_decoder_t;
+
+typedef enum {
+  BENCH_NLRI,
+  BENCH_AS_PATH,
+  BENCH_COMMUNITIES,
+  BENCH_MP_REACH,
+  BENCH_EXT_COMMUNITIES,
+  BENCH_RIB_ENTRIES,
+  BENCH_BMP_PEER_HDR,
+  BENCH_DECODE,
+  BENCH_CNT,
+} bench_id_t;
+
+/** Static description of a benchmark */
+typedef struct bench_info {
+
+  /** Name used on the command line and in the output */
+  const char *name;
+
+  /** How the samples are decoded */
+  bench_decoder_t decoder;
+
+  /** Path Attribute type (only used for DECODE_PATH_ATTRS benchmarks) */
+  uint8_t attr_type;
+
+} bench_info_t;
+
+static const bench_info_t bench_infos[] = {
+  // BENCH_NLRI: UPDATEs with (only) IPv4 withdrawn and announced NLRIs
+  {"nlri", DECODE_UPDATE, 0},
+  // BENCH_AS_PATH
+  {"as_path", DECODE_PATH_ATTRS, PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH},
+  // BENCH_COMMUNITIES
+  {"communities", DECODE_PATH_ATTRS, PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES},
+  // BENCH_MP_REACH
+  {"mp_reach", DECODE_PATH_ATTRS, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI},
+  // BENCH_EXT_COMMUNITIES
+  {"ext_communities", DECODE_PATH_ATTRS,
+   PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES},
+  // BENCH_RIB_ENTRIES: TABLE_DUMP_V2 RIB records (i.e., the RIB entry loop)
+  {"rib_entries", DECODE_MSG, 0},
+  // BENCH_BMP_PEER_HDR: BMP messages parsed with parse_headers_only
+  {"bmp_peer_hdr", DECODE_MSG, 0},
+  // BENCH_DECODE: whole messages
+  {"decode", DECODE_MSG, 0},
+};
+
+/** The samples of one benchmark (for one corpus) */
+typedef struct bench_samples {
+
+  /** Concatenated sample data */
+  uint8_t *buf;
+
+  /** Number of bytes used in buf */
+  size_t len;
+
+  /** Number of bytes allocated for buf */
+  size_t alloc_len;
+
+  /** Array of (cnt) sample lengths */
+  size_t *lens;
+
+  /** Number of samples */
+  int cnt;
+
+  /** Number of sample lengths allocated */
+  int alloc_cnt;
+
+} bench_samples_t;
+
+typedef enum {
+  METRIC_NS,
+  METRIC_ALLOCS,
+  METRIC_CYCLES,
+  METRIC_INSTRUCTIONS,
+  METRIC_CACHE_MISSES,
+  METRIC_CNT,
+} bench_metric_t;
+
+/** A per-message metric that can be compared against a baseline */
+typedef struct bench_metric_info {
+
+  /** Name used on the command line and in the output */
+  const char *name;
+
+  /** Maximum allowed increase over the baseline (in percent), or a negative
+      value to not compare this metric */
+  double threshold;
+
+} bench_metric_info_t;
+
+// the thresholds may be changed on the command line
+static bench_metric_info_t metric_infos[] = {
+  {"ns_per_msg", 10},           // METRIC_NS
+  {"allocs_per_msg", 0},        // METRIC_ALLOCS
+  {"cycles_per_msg", 10},       // METRIC_CYCLES
+  {"instructions_per_msg", 5},  // METRIC_INSTRUCTIONS
+  {"cache_misses_per_msg", 25}, // METRIC_CACHE_MISSES
+};
+
+/** The result of one benchmark */
+typedef struct bench_result {
+
+  /** Number of passes over the samples (in the fastest run) */
+  uint64_t passes;
+
+  /** Number of messages decoded (in the fastest run) */
+  uint64_t msgs;
+
+  /** Number of bytes decoded (in the fastest run) */
+  uint64_t bytes;
+
+  /** Time spent decoding (in the fastest run) */
+  uint64_t ns;
+
+  /** Per-message metrics (the best of all runs) */
+  double metrics[METRIC_CNT];
+
+  /** Which of the metrics could be measured */
+  int metrics_valid[METRIC_CNT];
+
+} bench_result_t;
+
+// minimum time (in ns) to spend running each benchmark
+static uint64_t min_time_ns = MIN_TIME_MS * 1000000ULL;
+
+// number of warm-up passes
+static int warmup_passes = WARMUP_PASSES;
+
+// number of timed runs
+static int runs = RUNS;
+
+// maximum number of samples collected per benchmark and corpus
+static int max_samples = MAX_SAMPLES;
+
+// which benchmarks should be run
+static int bench_enabled[BENCH_CNT];
+
+// scratch buffer used to encode samples
+static uint8_t sample_buf[SAMPLE_BUFLEN];
+
+/* -------------------- Allocation Counting -------------------- */
+
+#if defined(HAVE_DLFCN_H) && defined(RTLD_NEXT)
+
+#define ALLOC_COUNTING 1
+
+// The benchmark counts allocations by interposing the allocator: since the
+// program defines malloc and friends, they are also used by the library, and
+// calls are forwarded to the next definition (i.e., the C library).
+
+static void *(*real_malloc)(size_t) = NULL;
+static void *(*real_calloc)(size_t, size_t) = NULL;
+static void *(*real_realloc)(void *, size_t) = NULL;
+static void (*real_free)(void *) = NULL;
+
+// dlsym may itself allocate before the real allocator has been found, so
+// these (few, small) requests are served from a static buffer
+static union {
+  uint8_t bytes[4096];
+  long double align;
+} alloc_bootstrap;
+static size_t alloc_bootstrap_used = 0;
+static int alloc_initializing = 0;
+
+#define IS_BOOTSTRAP(ptr)                                                      \
+  ((uint8_t *)(ptr) >= alloc_bootstrap.bytes &&                               \
+   (uint8_t *)(ptr) < alloc_bootstrap.bytes + sizeof(alloc_bootstrap.bytes))
+
+// number of allocations made while counting is enabled
+static uint64_t allocs_cnt = 0;
+static int allocs_counting = 0;
+
+static void alloc_init(void)
+{
+  alloc_initializing = 1;
+  *(void **)&real_malloc = dlsym(RTLD_NEXT, "malloc");
+  *(void **)&real_calloc = dlsym(RTLD_NEXT, "calloc");
+  *(void **)&real_realloc = dlsym(RTLD_NEXT, "realloc");
+  *(void **)&real_free = dlsym(RTLD_NEXT, "free");
+  alloc_initializing = 0;
+  if (real_malloc == NULL || real_calloc == NULL || real_realloc == NULL ||
+      real_free == NULL) {
+    abort();
+  }
+}
+
+static void *bootstrap_alloc(size_t size)
+{
+  void *ptr;
+  // keep the alignment malloc would give
+  size = (size + sizeof(long double) - 1) & ~(sizeof(long double) - 1);
+  if (alloc_bootstrap_used + size > sizeof(alloc_bootstrap.bytes)) {
+    return NULL;
+  }
+  ptr = alloc_bootstrap.bytes + alloc_bootstrap_used;
+  alloc_bootstrap_used += size;
+  return ptr;
+}
+
+void *malloc(size_t size)
+{
+  if (real_malloc == NULL) {
+    if (alloc_initializing) {
+      return bootstrap_alloc(size);
+    }
+    alloc_init();
+  }
+  allocs_cnt += allocs_counting;
+  return real_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+  if (real_calloc == NULL) {
+    if (alloc_initializing) {
+      // the bootstrap buffer is static, and therefore zeroed
+      return bootstrap_alloc(nmemb * size);
+    }
+    alloc_init();
+  }
+  allocs_cnt += allocs_counting;
+  return real_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  void *new_ptr;
+  size_t avail;
+  if (real_realloc == NULL) {
+    if (alloc_initializing) {
+      return ptr == NULL ? bootstrap_alloc(size) : NULL;
+    }
+    alloc_init();
+  }
+  if (IS_BOOTSTRAP(ptr)) {
+    // we don't know the original size, but it can't extend past the end of
+    // the bootstrap buffer
+    avail = alloc_bootstrap.bytes + sizeof(alloc_bootstrap.bytes) -
+            (uint8_t *)ptr;
+    if ((new_ptr = real_malloc(size)) != NULL) {
+      memcpy(new_ptr, ptr, avail < size ? avail : size);
+    }
+    return new_ptr;
+  }
+  allocs_cnt += allocs_counting;
+  return real_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+  if (ptr == NULL || IS_BOOTSTRAP(ptr)) {
+    return;
+  }
+  if (real_free == NULL) {
+    alloc_init();
+  }
+  real_free(ptr);
+}
+
+#else
+
+#define ALLOC_COUNTING 0
+
+static uint64_t allocs_cnt = 0;
+static int allocs_counting = 0;
+
+#endif
+
+/* -------------------- Samples -------------------- */
+
+static int samples_add(bench_samples_t *s, const uint8_t *buf, size_t len)
+{
+  uint8_t *new_buf;
+  size_t *new_lens;
+  size_t new_len;
+
+  if (s->cnt >= max_samples) {
+    return 0;
+  }
+
+  if (s->len + len > s->alloc_len) {
+    new_len = s->alloc_len == 0 ? SAMPLE_BUFLEN : s->alloc_len * 2;
+    while (new_len < s->len + len) {
+      new_len *= 2;
+    }
+    if ((new_buf = realloc(s->buf, new_len)) == NULL) {
+      return -1;
+    }
+    s->buf = new_buf;
+    s->alloc_len = new_len;
+  }
+  if (s->cnt == s->alloc_cnt) {
+    if ((new_lens = realloc(s->lens, sizeof(*s->lens) *
+                                       (s->alloc_cnt * 2 + 1024))) == NULL) {
+      return -1;
+    }
+    s->lens = new_lens;
+    s->alloc_cnt = s->alloc_cnt * 2 + 1024;
+  }
+
+  memcpy(s->buf + s->len, buf, len);
+  s->len += len;
+  s->lens[s->cnt++] = len;
+  return 0;
+}
+
+static void samples_destroy(bench_samples_t *s)
+{
+  free(s->buf);
+  free(s->lens);
+  memset(s, 0, sizeof(*s));
+}
+
+/** Options used to encode and decode the BGP-level samples */
+static void sample_opts_init(parsebgp_opts_t *opts)
+{
+  parsebgp_opts_init(opts);
+  opts->bgp.asn_4_byte = 1;
+}
+
+/** Add each of the interesting attributes as a single-attribute sample */
+static int add_path_attrs_samples(bench_samples_t *samples,
+                                  const parsebgp_bgp_update_path_attrs_t *pa)
+{
+  parsebgp_opts_t opts;
+  parsebgp_bgp_update_path_attrs_t attrs;
+  uint8_t type;
+  size_t len;
+  int i;
+
+  sample_opts_init(&opts);
+  for (i = 0; i < BENCH_CNT; i++) {
+    if (!bench_enabled[i] || bench_infos[i].decoder != DECODE_PATH_ATTRS) {
+      continue;
+    }
+    type = bench_infos[i].attr_type;
+    if (pa->attrs[type].type != type) {
+      continue;
+    }
+    // the attribute might have been among the attributes of the message, but
+    // not present in this set (attrs is not cleared between messages)
+    if (pa->attrs_used == NULL ||
+        memchr(pa->attrs_used, type, pa->attrs_cnt) == NULL) {
+      continue;
+    }
+    attrs = *pa;
+    attrs.raw = NULL;
+    attrs.attrs_used = &type;
+    attrs.attrs_cnt = 1;
+    len = sizeof(sample_buf);
+    if (parsebgp_bgp_update_path_attrs_encode(&opts, &attrs, sample_buf,
+                                              &len) != PARSEBGP_OK) {
+      continue;
+    }
+    if (samples_add(&samples[i], sample_buf, len) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/** Add the attributes and the NLRIs of an UPDATE message */
+static int add_update_samples(bench_samples_t *samples,
+                              const parsebgp_bgp_update_t *update)
+{
+  parsebgp_opts_t opts;
+  parsebgp_bgp_update_t nlri_update;
+  size_t len;
+
+  if (bench_enabled[BENCH_NLRI] && (update->withdrawn_nlris.prefixes_cnt > 0 ||
+                                    update->announced_nlris.prefixes_cnt > 0)) {
+    sample_opts_init(&opts);
+    nlri_update = *update;
+    memset(&nlri_update.path_attrs, 0, sizeof(nlri_update.path_attrs));
+    len = sizeof(sample_buf);
+    if (parsebgp_bgp_update_encode(&opts, &nlri_update, sample_buf, &len) ==
+          PARSEBGP_OK &&
+        samples_add(&samples[BENCH_NLRI], sample_buf, len) != 0) {
+      return -1;
+    }
+  }
+
+  return add_path_attrs_samples(samples, &update->path_attrs);
+}
+
+static int add_bgp_samples(bench_samples_t *samples,
+                           const parsebgp_bgp_msg_t *bgp)
+{
+  if (bgp == NULL || bgp->type != PARSEBGP_BGP_TYPE_UPDATE) {
+    return 0;
+  }
+  return add_update_samples(samples, bgp->types.update);
+}
+
+static int add_mrt_samples(bench_samples_t *samples,
+                           const parsebgp_mrt_msg_t *mrt, const uint8_t *buf,
+                           size_t len)
+{
+  parsebgp_mrt_table_dump_v2_t *td2;
+  int i;
+
+  switch (mrt->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    if (mrt->subtype == PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE) {
+      break;
+    }
+    if (bench_enabled[BENCH_RIB_ENTRIES] &&
+        samples_add(&samples[BENCH_RIB_ENTRIES], buf, len) != 0) {
+      return -1;
+    }
+    td2 = mrt->types.table_dump_v2;
+    for (i = 0; i < td2->afi_safi_rib.entry_count; i++) {
+      if (add_path_attrs_samples(
+            samples, td2->afi_safi_rib.entries[i].path_attrs_ptr) != 0) {
+        return -1;
+      }
+    }
+    break;
+
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    switch (mrt->subtype) {
+    case PARSEBGP_MRT_BGP4MP_MESSAGE:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+      return add_bgp_samples(samples, mrt->types.bgp4mp->data.bgp_msg);
+
+    default:
+      break;
+    }
+    break;
+
+  default:
+    break;
+  }
+  return 0;
+}
+
+static int add_bmp_samples(bench_samples_t *samples,
+                           const parsebgp_bmp_msg_t *bmp, const uint8_t *buf,
+                           size_t len)
+{
+  switch (bmp->type) {
+  case PARSEBGP_BMP_TYPE_ROUTE_MON:
+  case PARSEBGP_BMP_TYPE_STATS_REPORT:
+  case PARSEBGP_BMP_TYPE_PEER_DOWN:
+  case PARSEBGP_BMP_TYPE_PEER_UP:
+  case PARSEBGP_BMP_TYPE_ROUTE_MIRROR_MSG:
+    if (bench_enabled[BENCH_BMP_PEER_HDR] &&
+        samples_add(&samples[BENCH_BMP_PEER_HDR], buf, len) != 0) {
+      return -1;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  if (bmp->type == PARSEBGP_BMP_TYPE_ROUTE_MON && bmp->types_valid) {
+    return add_bgp_samples(samples, bmp->types.route_mon);
+  }
+  return 0;
+}
+
+/**
+ * Decode every message of a corpus once, and split it into per-benchmark
+ * samples
+ *
+ * Messages that fail to decode end the corpus (like they would for a real
+ * consumer).
+ */
+static int collect_samples(bench_samples_t *samples, parsebgp_msg_type_t type,
+                           const uint8_t *buf, size_t len)
+{
+  parsebgp_opts_t opts;
+  parsebgp_msg_t *msg;
+  parsebgp_error_t err;
+  size_t off = 0, slen;
+  int ret = -1;
+
+  parsebgp_opts_init(&opts);
+  if ((msg = parsebgp_create_msg()) == NULL) {
+    return -1;
+  }
+
+  while (off < len) {
+    slen = len - off;
+    if ((err = parsebgp_decode(opts, type, msg, buf + off, &slen)) !=
+        PARSEBGP_OK) {
+      fprintf(stderr, "WARNING: Stopping at offset %zu (%s)\n", off,
+              parsebgp_strerror(err));
+      break;
+    }
+
+    if (bench_enabled[BENCH_DECODE] &&
+        samples_add(&samples[BENCH_DECODE], buf + off, slen) != 0) {
+      goto out;
+    }
+    switch (type) {
+    case PARSEBGP_MSG_TYPE_BGP:
+      if (add_bgp_samples(samples, msg->types.bgp) != 0) {
+        goto out;
+      }
+      break;
+
+    case PARSEBGP_MSG_TYPE_BMP:
+      if (add_bmp_samples(samples, msg->types.bmp, buf + off, slen) != 0) {
+        goto out;
+      }
+      break;
+
+    case PARSEBGP_MSG_TYPE_MRT:
+      if (add_mrt_samples(samples, msg->types.mrt, buf + off, slen) != 0) {
+        goto out;
+      }
+      break;
+
+    default:
+      break;
+    }
+
+    parsebgp_clear_msg(msg);
+    off += slen;
+  }
+
+  ret = 0;
+
+out:
+  parsebgp_destroy_msg(msg);
+  return ret;
+}
+
+/* -------------------- Hardware Counters -------------------- */
+
+// number of hardware counters (METRIC_CYCLES to METRIC_CACHE_MISSES)
+#define PERF_CNT 3
+
+// file descriptors of the counters (-1 if the counter is not available)
+static int perf_fds[PERF_CNT] = {-1, -1, -1};
+
+/** Open the counters for this thread, returns the number of counters that are
+    available */
+static int perf_open(void)
+{
+  int opened = 0;
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  static const uint64_t configs[PERF_CNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,   // METRIC_CYCLES
+    PERF_COUNT_HW_INSTRUCTIONS, // METRIC_INSTRUCTIONS
+    PERF_COUNT_HW_CACHE_MISSES, // METRIC_CACHE_MISSES
+  };
+  struct perf_event_attr attr;
+  int i;
+
+  for (i = 0; i < PERF_CNT; i++) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // the counters are opened separately, and may therefore be multiplexed
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    if ((perf_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)) >=
+        0) {
+      opened++;
+    }
+  }
+#endif
+  return opened;
+}
+
+static void perf_start(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  int i;
+  for (i = 0; i < PERF_CNT; i++) {
+    if (perf_fds[i] >= 0) {
+      ioctl(perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+/** Stop the counters and read them (scaled up if they were multiplexed) */
+static void perf_stop(double *vals, int *valid)
+{
+  int i;
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  uint64_t data[3]; // value, time enabled, time running
+#endif
+
+  for (i = 0; i < PERF_CNT; i++) {
+    valid[i] = 0;
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    if (perf_fds[i] < 0) {
+      continue;
+    }
+    ioctl(perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    if (read(perf_fds[i], data, sizeof(data)) != sizeof(data) ||
+        data[2] == 0) {
+      continue;
+    }
+    vals[i] = (double)data[0] * data[1] / data[2];
+    valid[i] = 1;
+#endif
+  }
+}
+
+static void perf_close(void)
+{
+  int i;
+  for (i = 0; i < PERF_CNT; i++) {
+    if (perf_fds[i] >= 0) {
+      close(perf_fds[i]);
+      perf_fds[i] = -1;
+    }
+  }
+}
+
+/* -------------------- Baseline Comparison -------------------- */
+
+// baseline results (i.e., the output of a previous run), one per line
+static char *baseline = NULL;
+static size_t baseline_len = 0;
+
+static int compared_cnt = 0;
+static int regressions_cnt = 0;
+
+/** Find the (string) value of the given key in a line of our own output */
+static int json_get_str(const char *line, const char *key, char *buf,
+                        size_t len)
+{
+  char pattern[64];
+  const char *start, *end;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+  if ((start = strstr(line, pattern)) == NULL) {
+    return -1;
+  }
+  start += strlen(pattern);
+  if ((end = strchr(start, '"')) == NULL || (size_t)(end - start) >= len) {
+    return -1;
+  }
+  memcpy(buf, start, end - start);
+  buf[end - start] = '\0';
+  return 0;
+}
+
+/** Find the (numeric) value of the given key in a line of our own output
+    (returns -1 if the value is missing or null) */
+static int json_get_num(const char *line, const char *key, double *val)
+{
+  char pattern[64];
+  const char *start;
+  char *end;
+
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  if ((start = strstr(line, pattern)) == NULL) {
+    return -1;
+  }
+  start += strlen(pattern);
+  *val = strtod(start, &end);
+  return end == start ? -1 : 0;
+}
+
+static const char *baseline_find(const char *corpus, const char *bench)
+{
+  const char *line = baseline;
+  char buf[1024];
+
+  while (line < baseline + baseline_len) {
+    if (json_get_str(line, "corpus", buf, sizeof(buf)) == 0 &&
+        strcmp(buf, corpus) == 0 &&
+        json_get_str(line, "bench", buf, sizeof(buf)) == 0 &&
+        strcmp(buf, bench) == 0) {
+      return line;
+    }
+    line += strlen(line) + 1;
+  }
+  return NULL;
+}
+
+/** Compare a result against the baseline and report any regressions */
+static void compare_result(const char *corpus, bench_id_t id,
+                           const bench_result_t *res)
+{
+  const char *line;
+  double base, change;
+  int i;
+
+  if ((line = baseline_find(corpus, bench_infos[id].name)) == NULL) {
+    fprintf(stderr, "WARNING: No baseline for %s in %s\n",
+            bench_infos[id].name, corpus);
+    return;
+  }
+
+  for (i = 0; i < METRIC_CNT; i++) {
+    if (metric_infos[i].threshold < 0 || !res->metrics_valid[i] ||
+        json_get_num(line, metric_infos[i].name, &base) != 0) {
+      continue;
+    }
+    compared_cnt++;
+    // metrics that were zero (e.g., allocations) must stay (close to) zero
+    change = base > 0 ? (res->metrics[i] - base) * 100 / base
+                      : (res->metrics[i] > 0.0005 ? 100 : 0);
+    if (change > metric_infos[i].threshold) {
+      fprintf(stderr,
+              "REGRESSION: %s in %s: %s %.3f -> %.3f (%+.1f%%, "
+              "threshold %.1f%%)\n",
+              bench_infos[id].name, corpus, metric_infos[i].name, base,
+              res->metrics[i], change, metric_infos[i].threshold);
+      regressions_cnt++;
+    }
+  }
+}
+
+/* -------------------- Benchmarks -------------------- */
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** Decode every sample once, returns the number of samples decoded */
+static int run_pass(bench_id_t id, parsebgp_opts_t *opts,
+                    parsebgp_msg_type_t type, parsebgp_msg_t *msg,
+                    parsebgp_bgp_update_t *update, const bench_samples_t *s)
+{
+  parsebgp_opts_t o;
+  const uint8_t *buf = s->buf;
+  size_t len;
+  int i;
+
+  for (i = 0; i < s->cnt; i++) {
+    len = s->lens[i];
+    switch (bench_infos[id].decoder) {
+    case DECODE_MSG:
+      if (parsebgp_decode(*opts, type, msg, buf, &len) != PARSEBGP_OK) {
+        return -1;
+      }
+      parsebgp_clear_msg(msg);
+      break;
+
+    case DECODE_UPDATE:
+      // the decoders may change the options
+      o = *opts;
+      if (parsebgp_bgp_update_decode(&o, update, buf, &len, len) !=
+          PARSEBGP_OK) {
+        return -1;
+      }
+      parsebgp_bgp_update_clear(update);
+      break;
+
+    case DECODE_PATH_ATTRS:
+      o = *opts;
+      if (parsebgp_bgp_update_path_attrs_decode(&o, &update->path_attrs, buf,
+                                                &len, len) != PARSEBGP_OK) {
+        return -1;
+      }
+      parsebgp_bgp_update_path_attrs_clear(&update->path_attrs);
+      break;
+    }
+    buf += s->lens[i];
+  }
+  return s->cnt;
+}
+
+static void print_result(const char *corpus, bench_id_t id,
+                         const bench_samples_t *s, const bench_result_t *res)
+{
+  int i;
+
+  fprintf(stdout,
+          "{\"corpus\":\"%s\",\"bench\":\"%s\",\"samples\":%d,"
+          "\"passes\":%" PRIu64 ",\"msgs\":%" PRIu64 ",\"bytes\":%" PRIu64
+          ",\"ns\":%" PRIu64 ",\"msgs_per_sec\":%.1f,\"bytes_per_sec\":%.1f",
+          corpus, bench_infos[id].name, s->cnt, res->passes, res->msgs,
+          res->bytes, res->ns, res->msgs * 1e9 / res->ns,
+          res->bytes * 1e9 / res->ns);
+  for (i = 0; i < METRIC_CNT; i++) {
+    if (res->metrics_valid[i]) {
+      fprintf(stdout, ",\"%s\":%.3f", metric_infos[i].name, res->metrics[i]);
+    } else {
+      fprintf(stdout, ",\"%s\":null", metric_infos[i].name);
+    }
+  }
+  fprintf(stdout, "}\n");
+  fflush(stdout);
+}
+
+/**
+ * Run a benchmark, print the results as a JSON object on one line, and
+ * compare them against the baseline (if any)
+ */
+static int run_bench(bench_id_t id, const char *corpus,
+                     parsebgp_msg_type_t type, const bench_samples_t *s)
+{
+  parsebgp_opts_t opts;
+  parsebgp_msg_t *msg = NULL;
+  parsebgp_bgp_update_t *update = NULL;
+  bench_result_t res;
+  double metrics[METRIC_CNT];
+  int metrics_valid[METRIC_CNT];
+  uint64_t start, ns, msgs, bytes, passes;
+  int i, run, ret = -1;
+
+  memset(&res, 0, sizeof(res));
+  if (bench_infos[id].decoder == DECODE_MSG) {
+    parsebgp_opts_init(&opts);
+  } else {
+    sample_opts_init(&opts);
+  }
+  if (id == BENCH_BMP_PEER_HDR) {
+    opts.bmp.parse_headers_only = 1;
+  }
+
+  if ((msg = parsebgp_create_msg()) == NULL ||
+      (update = calloc(1, sizeof(*update))) == NULL) {
+    fprintf(stderr, "ERROR: Could not allocate benchmark state\n");
+    goto out;
+  }
+
+  // warm up (caches, branch predictors, and the buffers of msg/update)
+  for (i = 0; i < warmup_passes || i == 0; i++) {
+    if (run_pass(id, &opts, type, msg, update, s) < 0) {
+      fprintf(stderr, "ERROR: Failed to decode %s sample from %s\n",
+              bench_infos[id].name, corpus);
+      goto out;
+    }
+  }
+
+  for (run = 0; run < runs; run++) {
+    ns = msgs = bytes = passes = 0;
+    allocs_cnt = 0;
+    allocs_counting = 1;
+    perf_start();
+    do {
+      start = now_ns();
+      msgs += run_pass(id, &opts, type, msg, update, s);
+      ns += now_ns() - start;
+      bytes += s->len;
+      passes++;
+    } while (ns < min_time_ns);
+    perf_stop(&metrics[METRIC_CYCLES], &metrics_valid[METRIC_CYCLES]);
+    allocs_counting = 0;
+
+    metrics[METRIC_NS] = (double)ns;
+    metrics_valid[METRIC_NS] = 1;
+    metrics[METRIC_ALLOCS] = (double)allocs_cnt;
+    metrics_valid[METRIC_ALLOCS] = ALLOC_COUNTING;
+
+    if (run == 0 || (double)ns / msgs < res.metrics[METRIC_NS]) {
+      res.passes = passes;
+      res.msgs = msgs;
+      res.bytes = bytes;
+      res.ns = ns;
+    }
+    // keep the best value of each metric
+    for (i = 0; i < METRIC_CNT; i++) {
+      if (!metrics_valid[i]) {
+        continue;
+      }
+      metrics[i] /= msgs;
+      if (!res.metrics_valid[i] || metrics[i] < res.metrics[i]) {
+        res.metrics[i] = metrics[i];
+        res.metrics_valid[i] = 1;
+      }
+    }
+  }
+
+  print_result(corpus, id, s, &res);
+  if (baseline != NULL) {
+    compare_result(corpus, id, &res);
+  }
+  ret = 0;
+
+out:
+  parsebgp_destroy_msg(msg);
+  parsebgp_bgp_update_destroy(update);
+  return ret;
+}
+
+/* -------------------- Main -------------------- */
+
+static uint8_t *read_file(const char *fname, size_t *lenp)
+{
+  FILE *fp;
+  uint8_t *buf = NULL, *new_buf;
+  size_t len = 0, alloc_len = 0, nread;
+
+  if ((fp = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "ERROR: Could not open %s (%s)\n", fname,
+            strerror(errno));
+    return NULL;
+  }
+  do {
+    if (len == alloc_len) {
+      alloc_len = alloc_len == 0 ? SAMPLE_BUFLEN : alloc_len * 2;
+      if ((new_buf = realloc(buf, alloc_len)) == NULL) {
+        fprintf(stderr, "ERROR: Could not allocate buffer for %s\n", fname);
+        free(buf);
+        fclose(fp);
+        return NULL;
+      }
+      buf = new_buf;
+    }
+    nread = fread(buf + len, 1, alloc_len - len, fp);
+    len += nread;
+  } while (nread > 0);
+
+  if (ferror(fp)) {
+    fprintf(stderr, "ERROR: Failed to read %s\n", fname);
+    free(buf);
+    fclose(fp);
+    return NULL;
+  }
+  fclose(fp);
+  *lenp = len;
+  return buf;
+}
+
+static int bench_corpus(parsebgp_msg_type_t type, const char *fname)
+{
+  bench_samples_t samples[BENCH_CNT];
+  uint8_t *buf;
+  size_t len;
+  int i, ret = -1;
+
+  memset(samples, 0, sizeof(samples));
+  if ((buf = read_file(fname, &len)) == NULL) {
+    return -1;
+  }
+
+  fprintf(stderr, "INFO: Collecting samples from %s (Type: %s)\n", fname,
+          type_strs[type]);
+  if (collect_samples(samples, type, buf, len) != 0) {
+    fprintf(stderr, "ERROR: Could not allocate samples\n");
+    goto out;
+  }
+
+  for (i = 0; i < BENCH_CNT; i++) {
+    if (samples[i].cnt == 0) {
+      continue;
+    }
+    if (run_bench(i, fname, type, &samples[i]) != 0) {
+      goto out;
+    }
+  }
+
+  ret = 0;
+
+out:
+  for (i = 0; i < BENCH_CNT; i++) {
+    samples_destroy(&samples[i]);
+  }
+  free(buf);
+  return ret;
+}
+
+static int load_baseline(const char *fname)
+{
+  uint8_t *buf;
+  size_t len, i;
+
+  if ((buf = read_file(fname, &len)) == NULL) {
+    return -1;
+  }
+  if ((baseline = realloc(buf, len + 1)) == NULL) {
+    fprintf(stderr, "ERROR: Could not allocate baseline buffer\n");
+    free(buf);
+    return -1;
+  }
+  // split into lines
+  baseline[len] = '\0';
+  for (i = 0; i < len; i++) {
+    if (baseline[i] == '\n') {
+      baseline[i] = '\0';
+    }
+  }
+  baseline_len = len;
+  return 0;
+}
+
+/** Parse a "<metric>=<pct>|off" option argument */
+static int parse_threshold(const char *arg)
+{
+  const char *val;
+  char *end;
+  double threshold;
+  int i;
+
+  if ((val = strchr(arg, '=')) == NULL) {
+    return -1;
+  }
+  val++;
+  if (strcmp(val, "off") == 0) {
+    threshold = -1;
+  } else {
+    threshold = strtod(val, &end);
+    if (end == val || *end != '\0' || threshold < 0) {
+      return -1;
+    }
+  }
+  for (i = 0; i < METRIC_CNT; i++) {
+    if (strncmp(arg, metric_infos[i].name, val - 1 - arg) == 0 &&
+        strlen(metric_infos[i].name) == (size_t)(val - 1 - arg)) {
+      metric_infos[i].threshold = threshold;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static int pin_cpu(int cpu)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    fprintf(stderr, "ERROR: Could not pin to CPU %d (%s)\n", cpu,
+            strerror(errno));
+    return -1;
+  }
+  return 0;
+#else
+  fprintf(stderr, "WARNING: CPU pinning is not supported on this platform\n");
+  return 0;
+#endif
+}
+
+static void usage(void)
+{
+  int i;
+  fprintf(
+    stderr,
+    "usage: %s [options] [type:]file [[type:]file...]\n"
+    "         where 'type' is one of 'bmp', 'bgp', or 'mrt'\n"
+    "         (only required if using non-standard file extensions)\n"
+    "       -b <bench>         Only run the given benchmark (repeatable)\n"
+    "       -B <file>          Compare the results against a baseline (the\n"
+    "                            output of a previous run)\n"
+    "       -c <cpu>           Pin to the given CPU\n"
+    "       -n <count>         Max samples per benchmark and file "
+    "(default: %d)\n"
+    "       -r <runs>          Number of timed runs, the best result of each\n"
+    "                            metric is reported (default: %d)\n"
+    "       -t <ms>            Min time to run each benchmark for "
+    "(default: %d)\n"
+    "       -T <metric>=<pct>  Max increase of a metric over the baseline,\n"
+    "                            or 'off' to not compare it (repeatable)\n"
+    "       -w <passes>        Number of warm-up passes (default: %d)\n"
+    "       -h                 Show this help message\n"
+    "\n"
+    "Results are written to stdout as one JSON object per benchmark and file.\n"
+    "When comparing against a baseline, regressions are reported on stderr,\n"
+    "and the exit status is 1 if there were any.\n"
+    "Benchmarks:",
+    NAME, MAX_SAMPLES, RUNS, MIN_TIME_MS, WARMUP_PASSES);
+  for (i = 0; i < BENCH_CNT; i++) {
+    fprintf(stderr, " %s", bench_infos[i].name);
+  }
+  fprintf(stderr, "\nMetrics (and default thresholds):");
+  for (i = 0; i < METRIC_CNT; i++) {
+    fprintf(stderr, " %s (%.0f%%)", metric_infos[i].name,
+            metric_infos[i].threshold);
+  }
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  int prevoptind;
+  int i, j, type, len;
+  int bench_selected = 0;
+  char *fname, *tname, *freeme;
+  const char *baseline_file = NULL;
+  int cpu = -1;
+  int ret = -1;
+
+  opterr = 0;
+
+  while (prevoptind = optind,
+         (opt = getopt(argc, argv, ":b:B:c:n:r:t:T:w:h?")) >= 0) {
+    if (optind == prevoptind + 2 && (optarg == NULL || *optarg == '-')) {
+      opt = ':';
+      --optind;
+    }
+    switch (opt) {
+    case 'b':
+      for (i = 0; i < BENCH_CNT; i++) {
+        if (strcmp(optarg, bench_infos[i].name) == 0) {
+          break;
+        }
+      }
+      if (i == BENCH_CNT) {
+        fprintf(stderr, "ERROR: Unknown benchmark '%s'\n", optarg);
+        usage();
+        return -1;
+      }
+      bench_enabled[i] = 1;
+      bench_selected = 1;
+      break;
+
+    case 'B':
+      baseline_file = optarg;
+      break;
+
+    case 'c':
+      cpu = atoi(optarg);
+      if (cpu < 0) {
+        fprintf(stderr, "ERROR: Invalid CPU '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'n':
+      max_samples = atoi(optarg);
+      if (max_samples <= 0) {
+        fprintf(stderr, "ERROR: Invalid sample count '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'r':
+      runs = atoi(optarg);
+      if (runs <= 0) {
+        fprintf(stderr, "ERROR: Invalid number of runs '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 't':
+      min_time_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+      break;
+
+    case 'T':
+      if (parse_threshold(optarg) != 0) {
+        fprintf(stderr, "ERROR: Invalid threshold '%s'\n", optarg);
+        usage();
+        return -1;
+      }
+      break;
+
+    case 'w':
+      warmup_passes = atoi(optarg);
+      if (warmup_passes < 0) {
+        fprintf(stderr, "ERROR: Invalid number of warm-up passes '%s'\n",
+                optarg);
+        return -1;
+      }
+      break;
+
+    case ':':
+      fprintf(stderr, "ERROR: Missing option argument for -%c\n", optopt);
+      usage();
+      return -1;
+      break;
+
+    case 'h':
+    case '?':
+      usage();
+      return 0;
+      break;
+
+    default:
+      usage();
+      return -1;
+      break;
+    }
+  }
+
+  if (optind >= argc) {
+    usage();
+    return -1;
+  }
+
+  if (!bench_selected) {
+    for (i = 0; i < BENCH_CNT; i++) {
+      bench_enabled[i] = 1;
+    }
+  }
+  if (!ALLOC_COUNTING) {
+    fprintf(stderr, "WARNING: Allocation counting is not supported on this "
+                    "platform\n");
+  }
+  if (cpu >= 0 && pin_cpu(cpu) != 0) {
+    return -1;
+  }
+  // (after pinning, so that the counters follow the thread)
+  if (perf_open() < PERF_CNT) {
+    fprintf(stderr, "WARNING: Some hardware counters are not available "
+                    "(perf_event_open failed)\n");
+  }
+  if (baseline_file != NULL && load_baseline(baseline_file) != 0) {
+    goto out;
+  }
+
+  for (i = optind; i < argc; i++) {
+    type = 0; // undefined type
+    fname = tname = freeme = strdup(argv[i]);
+    assert(fname != NULL);
+
+    if ((fname = strchr(fname, ':')) == NULL) {
+      fname = tname;
+      len = strlen(fname);
+      PARSEBGP_FOREACH_MSG_TYPE(j)
+      {
+        if (len >= (int)strlen(type_strs[j]) &&
+            strcmp(fname + len - strlen(type_strs[j]), type_strs[j]) == 0) {
+          type = j;
+          break;
+        }
+      }
+    } else {
+      *(fname++) = '\0';
+      PARSEBGP_FOREACH_MSG_TYPE(j)
+      {
+        if (strcmp(tname, type_strs[j]) == 0) {
+          type = j;
+          break;
+        }
+      }
+    }
+
+    if (type == 0) {
+      fprintf(stderr,
+              "ERROR: Could not identify type of %s, "
+              "consider explicitly specifying type using type:file syntax\n",
+              argv[i]);
+      free(freeme);
+      goto out;
+    }
+
+    if (bench_corpus(type, fname) != 0) {
+      free(freeme);
+      goto out;
+    }
+    free(freeme);
+  }
+
+  ret = 0;
+  if (baseline != NULL) {
+    fprintf(stderr, "INFO: Compared %d metrics against %s, %d regression(s)\n",
+            compared_cnt, baseline_file, regressions_cnt);
+    if (regressions_cnt > 0) {
+      ret = 1;
+    }
+  }
+
+out:
+  perf_close();
+  free(baseline);
+  return ret;
+}
@@ -66,10 +66,9 @@ static parsebgp_error_t parse_common_hdr(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
-parsebgp_error_t parsebgp_bgp_decode_ext(parsebgp_opts_t *opts,
-                                         parsebgp_bgp_msg_t *msg,
-                                         const uint8_t *buf,
-                                         size_t *len, int allow_truncation)
+static parsebgp_error_t decode_msg(parsebgp_opts_t *opts,
+                                   parsebgp_bgp_msg_t *msg, const uint8_t *buf,
+                                   size_t *len, int allow_truncation)
 {
   parsebgp_error_t err;
   size_t slen = 0, nread = 0, remain = 0;
@@ -139,6 +138,30 @@ parsebgp_error_t parsebgp_bgp_decode_ext(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
+parsebgp_error_t parsebgp_bgp_decode_ext(parsebgp_opts_t *opts,
+                                         parsebgp_bgp_msg_t *msg,
+                                         const uint8_t *buf,
+                                         size_t *len, int allow_truncation)
+{
+#ifdef PARSEBGP_STATS
+  parsebgp_error_t err;
+  uint64_t start;
+
+  if (opts->stats == NULL) {
+    return decode_msg(opts, msg, buf, len, allow_truncation);
+  }
+  start = parsebgp_stats_now();
+  err = decode_msg(opts, msg, buf, len, allow_truncation);
+  if ((err == PARSEBGP_OK || err == PARSEBGP_TRUNCATED_MSG) &&
+      msg->type < PARSEBGP_STATS_BGP_TYPES) {
+    PARSEBGP_STATS_MSG(opts, bgp[msg->type], *len, start);
+  }
+  return err;
+#else
+  return decode_msg(opts, msg, buf, len, allow_truncation);
+#endif
+}
+
 parsebgp_error_t parsebgp_bgp_decode(parsebgp_opts_t *opts,
                                      parsebgp_bgp_msg_t *msg,
                                      const uint8_t *buf,
@@ -160,7 +183,7 @@ void parsebgp_bgp_destroy_msg(parsebgp_bgp_msg_t *msg)
   parsebgp_bgp_notification_destroy(msg->types.notification);
   parsebgp_bgp_route_refresh_destroy(msg->types.route_refresh);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_clear_msg(parsebgp_bgp_msg_t *msg)
@@ -198,35 +221,48 @@ void parsebgp_bgp_clear_msg(parsebgp_bgp_msg_t *msg)
   }
 }
 
-void parsebgp_bgp_dump_msg(const parsebgp_bgp_msg_t *msg, int depth)
+size_t parsebgp_bgp_msg_memory_usage(const parsebgp_bgp_msg_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+
+  return sizeof(*msg) + parsebgp_bgp_open_memory_usage(msg->types.open) +
+         parsebgp_bgp_update_memory_usage(msg->types.update) +
+         parsebgp_bgp_notification_memory_usage(msg->types.notification) +
+         parsebgp_bgp_route_refresh_memory_usage(msg->types.route_refresh);
+}
+
+void parsebgp_bgp_dump_msg(parsebgp_sink_t *sink, const parsebgp_bgp_msg_t *msg,
+                           int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_msg_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_msg_t, depth);
 
-  PARSEBGP_DUMP_DATA(depth, "Marker", msg->marker, sizeof(msg->marker));
-  PARSEBGP_DUMP_INT(depth, "Length", msg->len);
-  PARSEBGP_DUMP_INT(depth, "Type", msg->type);
+  PARSEBGP_DUMP_DATA(sink, depth, "Marker", msg->marker, sizeof(msg->marker));
+  PARSEBGP_DUMP_INT(sink, depth, "Length", msg->len);
+  PARSEBGP_DUMP_INT(sink, depth, "Type", msg->type);
 
   depth++;
 
   switch (msg->type) {
   case PARSEBGP_BGP_TYPE_OPEN:
-    parsebgp_bgp_open_dump(msg->types.open, depth);
+    parsebgp_bgp_open_dump(sink, msg->types.open, depth);
     break;
 
   case PARSEBGP_BGP_TYPE_UPDATE:
-    parsebgp_bgp_update_dump(msg->types.update, depth);
+    parsebgp_bgp_update_dump(sink, msg->types.update, depth);
     break;
 
   case PARSEBGP_BGP_TYPE_NOTIFICATION:
-    parsebgp_bgp_notification_dump(msg->types.notification, depth);
+    parsebgp_bgp_notification_dump(sink, msg->types.notification, depth);
     break;
 
   case PARSEBGP_BGP_TYPE_KEEPALIVE:
-    PARSEBGP_DUMP_INFO(depth, "KEEPALIVE\n");
+    PARSEBGP_DUMP_INFO(sink, depth, "KEEPALIVE\n");
     break;
 
   case PARSEBGP_BGP_TYPE_ROUTE_REFRESH:
-    parsebgp_bgp_route_refresh_dump(msg->types.route_refresh, depth);
+    parsebgp_bgp_route_refresh_dump(sink, msg->types.route_refresh, depth);
     break;
 
   default:
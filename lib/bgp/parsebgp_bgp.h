@@ -31,8 +31,10 @@
 #include "parsebgp_bgp_open.h"
 #include "parsebgp_bgp_route_refresh.h"
 #include "parsebgp_bgp_update.h"
+#include "parsebgp_bgp_update_community_filter.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <inttypes.h>
 #include <stddef.h>
 
@@ -144,8 +146,18 @@ void parsebgp_bgp_destroy_msg(parsebgp_bgp_msg_t *msg);
 void parsebgp_bgp_clear_msg(parsebgp_bgp_msg_t *msg);
 
 /**
- * Dump a human-readable version of the message to stdout
+ * Get the amount of memory allocated for the given BGP message structure
  *
+ * @param msg           Pointer to the message structure
+ * @return the number of bytes allocated (including memory retained for reuse
+ * after the message was cleared)
+ */
+size_t parsebgp_bgp_msg_memory_usage(const parsebgp_bgp_msg_t *msg);
+
+/**
+ * Dump a human-readable version of the message to a sink
+ *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -154,6 +166,7 @@ void parsebgp_bgp_clear_msg(parsebgp_bgp_msg_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bgp_dump_msg(const parsebgp_bgp_msg_t *msg, int depth);
+void parsebgp_bgp_dump_msg(parsebgp_sink_t *sink, const parsebgp_bgp_msg_t *msg,
+                           int depth);
 
 #endif /* __PARSEBGP_BGP_H */
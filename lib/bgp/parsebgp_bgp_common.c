@@ -27,7 +27,8 @@
 #include "parsebgp_bgp_common_impl.h"
 #include "parsebgp_utils.h"
 
-void parsebgp_bgp_prefixes_dump(parsebgp_bgp_prefix_t *prefixes,
+void parsebgp_bgp_prefixes_dump(parsebgp_sink_t *sink,
+                                parsebgp_bgp_prefix_t *prefixes,
                                 int prefixes_cnt, int depth)
 {
   int i;
@@ -35,11 +36,12 @@ void parsebgp_bgp_prefixes_dump(parsebgp_bgp_prefix_t *prefixes,
   for (i = 0; i < prefixes_cnt; i++) {
     tuple = &prefixes[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_prefix_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_prefix_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", tuple->type);
-    PARSEBGP_DUMP_INT(depth, "AFI", tuple->afi);
-    PARSEBGP_DUMP_INT(depth, "SAFI", tuple->safi);
-    PARSEBGP_DUMP_PFX(depth, "Prefix", tuple->afi, tuple->addr, tuple->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", tuple->type);
+    PARSEBGP_DUMP_INT(sink, depth, "AFI", tuple->afi);
+    PARSEBGP_DUMP_INT(sink, depth, "SAFI", tuple->safi);
+    PARSEBGP_DUMP_PFX(sink, depth, "Prefix", tuple->afi, tuple->addr,
+                      tuple->len);
   }
 }
@@ -28,15 +28,18 @@
 #define __PARSEBGP_BGP_COMMON_IMPL_H
 
 #include "parsebgp_bgp_common.h"
+#include "parsebgp_sink.h"
 
 /**
- * Dump a human-readable version of the given array of prefixes to stdout
+ * Dump a human-readable version of the given array of prefixes to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param prefixes      Array of prefixes to dump
  * @param prefixes_cnt  Number of prefixes to dump
  * @param depth         Depth of the message within the overall message
  */
-void parsebgp_bgp_prefixes_dump(parsebgp_bgp_prefix_t *prefixes,
+void parsebgp_bgp_prefixes_dump(parsebgp_sink_t *sink,
+                                parsebgp_bgp_prefix_t *prefixes,
                                 int prefixes_cnt, int depth);
 
 #endif /* __PARSEBGP_BGP_COMMON_IMPL_H */
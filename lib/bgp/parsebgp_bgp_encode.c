@@ -0,0 +1,921 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_bgp_encode.h"
+#include "parsebgp_error.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BGP_HDR_LEN 19
+
+/** Length of a (non-extended) path attribute header */
+#define ATTR_HDR_LEN 3
+
+/** Length of a Large Community */
+#define LARGE_COMM_LEN 12
+
+#define RAW(opts, attr)                                                        \
+  (opts->bgp.path_attr_raw_enabled && opts->bgp.path_attr_raw[attr->type])
+
+/** Get the maximum prefix length for the given AFI (or 0 if unsupported) */
+static size_t afi_max_pfx_len(uint16_t afi)
+{
+  switch (afi) {
+  case PARSEBGP_BGP_AFI_IPV4:
+    return 32;
+
+  case PARSEBGP_BGP_AFI_IPV6:
+    return 128;
+
+  default:
+    return 0;
+  }
+}
+
+static parsebgp_error_t encode_prefixes(const parsebgp_bgp_prefix_t *prefixes,
+                                        int prefixes_cnt, size_t max_pfx,
+                                        uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+  int i;
+
+  for (i = 0; i < prefixes_cnt; i++) {
+    // Prefix Length
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, prefixes[i].len);
+
+    // Prefix
+    slen = len - nwrite;
+    if ((err = parsebgp_encode_prefix(prefixes[i].len, prefixes[i].addr, buf,
+                                      &slen, max_pfx)) != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- Path Attributes -------------------- */
+
+static parsebgp_error_t encode_as_path(int asn_4_byte,
+                                       const parsebgp_bgp_update_as_path_t *msg,
+                                       uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  parsebgp_bgp_update_as_path_seg_t *seg;
+  int i, j;
+
+  for (i = 0; i < msg->segs_cnt; i++) {
+    seg = &msg->segs[i];
+
+    // Segment Type
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, seg->type);
+
+    // Segment Length (# ASNs)
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, seg->asns_cnt);
+
+    // Segment ASNs
+    for (j = 0; j < seg->asns_cnt; j++) {
+      if (asn_4_byte) {
+        PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, seg->asns[j]);
+      } else if (seg->asns[j] > UINT16_MAX) {
+        // an OLD speaker can't represent this ASN (RFC6793)
+        PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, PARSEBGP_BGP_AS_TRANS);
+      } else {
+        PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, seg->asns[j]);
+      }
+    }
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_aggregator(int asn_4_byte,
+                  const parsebgp_bgp_update_aggregator_t *aggregator,
+                  uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // Aggregator ASN
+  if (asn_4_byte) {
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, aggregator->asn);
+  } else if (aggregator->asn > UINT16_MAX) {
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, PARSEBGP_BGP_AS_TRANS);
+  } else {
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, aggregator->asn);
+  }
+
+  // Aggregator IP Address (IPv4-only)
+  PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, aggregator->addr);
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_communities(const parsebgp_bgp_update_communities_t *msg, uint8_t *buf,
+                   size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  int i;
+
+  if (msg->raw_len > 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->raw, (size_t)msg->raw_len);
+    *lenp = nwrite;
+    return PARSEBGP_OK;
+  }
+
+  for (i = 0; i < msg->communities_cnt; i++) {
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->communities[i]);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_cluster_list(const parsebgp_bgp_update_cluster_list_t *msg,
+                    uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  int i;
+
+  for (i = 0; i < msg->cluster_ids_cnt; i++) {
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->cluster_ids[i]);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_mp_next_hop(const parsebgp_bgp_update_mp_reach_t *msg, uint8_t *buf,
+                   size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // same sanity-check as the decoder
+  if ((msg->afi == PARSEBGP_BGP_AFI_IPV4 && msg->next_hop_len != 4) ||
+      (msg->afi == PARSEBGP_BGP_AFI_IPV6 &&
+       (msg->next_hop_len != 16 && msg->next_hop_len != 32))) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  // Next-Hop Length
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->next_hop_len);
+
+  // Next-Hop Address (and optional v6 link-local address)
+  if (msg->next_hop_len == 32) {
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, msg->next_hop);
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, msg->next_hop_ll);
+  } else {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->next_hop,
+                             msg->next_hop_len);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_mp_reach(parsebgp_opts_t *opts,
+                const parsebgp_bgp_update_mp_reach_t *msg, uint8_t *buf,
+                size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  size_t max_pfx = afi_max_pfx_len(msg->afi);
+  parsebgp_error_t err;
+
+  if (max_pfx == 0 || (msg->safi != PARSEBGP_BGP_SAFI_UNICAST &&
+                       msg->safi != PARSEBGP_BGP_SAFI_MULTICAST)) {
+    // the decoder doesn't parse these either
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  // MRT TABLE_DUMP_V2 "compresses" the header to just the next-hop (RFC6396
+  // section 4.3.4)
+  if (!opts->bgp.mp_reach_no_afi_safi_reserved) {
+    // AFI
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->afi);
+
+    // SAFI
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->safi);
+  }
+
+  // Next-Hop Length and Address
+  slen = len - nwrite;
+  if ((err = encode_mp_next_hop(msg, buf, &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  if (!opts->bgp.mp_reach_no_afi_safi_reserved) {
+    // Reserved
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->reserved);
+  }
+
+  // NLRIs
+  slen = len - nwrite;
+  if ((err = encode_prefixes(msg->nlris, msg->nlris_cnt, max_pfx, buf,
+                             &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_mp_unreach(const parsebgp_bgp_update_mp_unreach_t *msg, uint8_t *buf,
+                  size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  size_t max_pfx = afi_max_pfx_len(msg->afi);
+  parsebgp_error_t err;
+
+  if (max_pfx == 0 || (msg->safi != PARSEBGP_BGP_SAFI_UNICAST &&
+                       msg->safi != PARSEBGP_BGP_SAFI_MULTICAST)) {
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  // AFI
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->afi);
+
+  // SAFI
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->safi);
+
+  // Withdrawn NLRIs
+  slen = len - nwrite;
+  if ((err = encode_prefixes(msg->withdrawn_nlris, msg->withdrawn_nlris_cnt,
+                             max_pfx, buf, &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/** Encode an 8-byte Extended Community (the inverse of the decoder) */
+static parsebgp_error_t
+encode_ext_community(const parsebgp_bgp_update_ext_community_t *comm,
+                     uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // Type (High)
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->type);
+
+  switch (comm->type) {
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_TWO_OCTET_AS:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_TWO_OCTET_AS:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->subtype);
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              comm->types.two_octet.global_admin);
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite,
+                              comm->types.two_octet.local_admin);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV4:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV4:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->subtype);
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite,
+                             comm->types.ip_addr.global_admin_ip, 4);
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              comm->types.ip_addr.local_admin);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_FOUR_OCTET_AS:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_FOUR_OCTET_AS:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->subtype);
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite,
+                              comm->types.four_octet.global_admin);
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              comm->types.four_octet.local_admin);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_OPAQUE:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_OPAQUE:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->subtype);
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, comm->types.opaque);
+    break;
+
+  default:
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, comm->types.unknown);
+    break;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/** Encode a 20-byte IPv6 Extended Community */
+static parsebgp_error_t
+encode_ext_community_ipv6(const parsebgp_bgp_update_ext_community_t *comm,
+                          uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  switch (comm->type) {
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV6:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV6:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->type);
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, comm->subtype);
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite,
+                           comm->types.ip_addr.global_admin_ip);
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              comm->types.ip_addr.local_admin);
+    break;
+
+  default:
+    // unknown types are not parsed by the decoder, so there is nothing to
+    // write
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_ext_communities(const parsebgp_bgp_update_ext_communities_t *msg,
+                       int ipv6, uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+  int i;
+
+  // compact communities are already in wire format
+  if (msg->compact_size != 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->compact,
+                             (size_t)msg->communities_cnt * msg->compact_size);
+    *lenp = nwrite;
+    return PARSEBGP_OK;
+  }
+
+  for (i = 0; i < msg->communities_cnt; i++) {
+    slen = len - nwrite;
+    if (ipv6) {
+      err = encode_ext_community_ipv6(&msg->communities[i], buf, &slen);
+    } else {
+      err = encode_ext_community(&msg->communities[i], buf, &slen);
+    }
+    if (err != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_large_communities(const parsebgp_bgp_update_large_communities_t *msg,
+                         uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  parsebgp_bgp_update_large_community_t *comm;
+  int i;
+
+  if (msg->raw_len > 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->raw, (size_t)msg->raw_len);
+    *lenp = nwrite;
+    return PARSEBGP_OK;
+  }
+
+  for (i = 0; i < msg->communities_cnt; i++) {
+    comm = &msg->communities[i];
+
+    // Global Admin
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, comm->global_admin);
+
+    // Local Data Part 1
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, comm->local_1);
+
+    // Local Data Part 2
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, comm->local_2);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/** Encode the data of a single Path Attribute (without the header) */
+static parsebgp_error_t
+encode_path_attr_data(parsebgp_opts_t *opts,
+                      const parsebgp_bgp_update_path_attr_t *attr,
+                      uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  int asn_4_byte;
+
+  switch (attr->type) {
+
+  // Type 1:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, attr->data.origin);
+    break;
+
+  // Types 2 and 17:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH:
+    if (RAW(opts, attr)) {
+      // the raw copy is exactly attr->len bytes long
+      PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, attr->data.as_path->raw,
+                               attr->len);
+      break;
+    }
+    if (opts->bgp.as_path_summary) {
+      // only the summary of the path was decoded
+      return PARSEBGP_NOT_IMPLEMENTED;
+    }
+    asn_4_byte = attr->type == PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH ||
+                 opts->bgp.asn_4_byte;
+    return encode_as_path(asn_4_byte, attr->data.as_path, buf, lenp);
+
+  // Type 3:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP:
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, attr->data.next_hop);
+    break;
+
+  // Type 4:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_MED:
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, attr->data.med);
+    break;
+
+  // Type 5:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF:
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, attr->data.local_pref);
+    break;
+
+  // Type 6:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_ATOMIC_AGGREGATE:
+    // zero-length attr
+    break;
+
+  // Type 7:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR:
+    // the decoder infers the ASN size from the attribute length, so keep the
+    // original size if we know it
+    asn_4_byte = attr->len == 8 || (attr->len != 6 && opts->bgp.asn_4_byte);
+    return encode_aggregator(asn_4_byte, &attr->data.aggregator, buf, lenp);
+
+  // Type 8:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES:
+    return encode_communities(attr->data.communities, buf, lenp);
+
+  // Type 9:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGINATOR_ID:
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, attr->data.originator_id);
+    break;
+
+  // Type 10:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_CLUSTER_LIST:
+    return encode_cluster_list(attr->data.cluster_list, buf, lenp);
+
+  // Type 14:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI:
+    return encode_mp_reach(opts, attr->data.mp_reach, buf, lenp);
+
+  // Type 15:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI:
+    return encode_mp_unreach(attr->data.mp_unreach, buf, lenp);
+
+  // Type 16:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES:
+    return encode_ext_communities(attr->data.ext_communities, 0, buf, lenp);
+
+  // Type 18:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR:
+    // same as AGGREGATOR, but always 4-byte
+    return encode_aggregator(1, &attr->data.aggregator, buf, lenp);
+
+  // Type 21:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATHLIMIT:
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite,
+                             attr->data.as_pathlimit.max_asns);
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, attr->data.as_pathlimit.asn);
+    break;
+
+  // Type 25:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_IPV6_EXT_COMMUNITIES:
+    return encode_ext_communities(attr->data.ext_communities, 1, buf, lenp);
+
+  // Type 32:
+  case PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES:
+    return encode_large_communities(attr->data.large_communities, buf, lenp);
+
+  default:
+    // the decoder skips over the data of these attributes, so we have nothing
+    // to write
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_path_attr(parsebgp_opts_t *opts,
+                 const parsebgp_bgp_update_path_attr_t *attr, uint8_t *buf,
+                 size_t *lenp)
+{
+  size_t len = *lenp, slen;
+  uint8_t flags = attr->flags;
+  parsebgp_error_t err;
+
+  if (len < ATTR_HDR_LEN) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+
+  // Attribute Data
+  //
+  // optimistically assume a 1-byte length, and shift the data up a byte if it
+  // turns out that we need an extended length
+  slen = len - ATTR_HDR_LEN;
+  if ((err = encode_path_attr_data(opts, attr, buf + ATTR_HDR_LEN, &slen)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  if (slen > UINT16_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  if (slen > UINT8_MAX) {
+    flags |= PARSEBGP_BGP_PATH_ATTR_FLAG_EXTENDED;
+  }
+
+  // Attribute Flags
+  buf[0] = flags;
+
+  // Attribute Type
+  buf[1] = attr->type;
+
+  // Attribute Length
+  if (flags & PARSEBGP_BGP_PATH_ATTR_FLAG_EXTENDED) {
+    if (len - ATTR_HDR_LEN - slen < 1) {
+      return PARSEBGP_PARTIAL_MSG;
+    }
+    memmove(buf + ATTR_HDR_LEN + 1, buf + ATTR_HDR_LEN, slen);
+    buf[2] = (uint8_t)(slen >> 8);
+    buf[3] = (uint8_t)slen;
+    *lenp = ATTR_HDR_LEN + 1 + slen;
+  } else {
+    buf[2] = (uint8_t)slen;
+    *lenp = ATTR_HDR_LEN + slen;
+  }
+
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t parsebgp_bgp_update_path_attrs_encode(
+  parsebgp_opts_t *opts, const parsebgp_bgp_update_path_attrs_t *msg,
+  uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  uint8_t *len_buf = buf;
+  parsebgp_error_t err;
+  int i;
+
+  // reserve space for the Path Attributes Length
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 0);
+
+  if (opts->bgp.path_attrs_encode_raw && msg->raw != NULL) {
+    // fast path: the caller says the attributes haven't been changed since
+    // they were decoded (and that the decode buffer is still around)
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->raw, msg->len);
+  } else {
+    for (i = 0; i < msg->attrs_cnt; i++) {
+      slen = len - nwrite;
+      if ((err = encode_path_attr(opts, &msg->attrs[msg->attrs_used[i]], buf,
+                                  &slen)) != PARSEBGP_OK) {
+        return err;
+      }
+      nwrite += slen;
+      buf += slen;
+    }
+  }
+
+  // Path Attributes Length
+  slen = nwrite - sizeof(uint16_t);
+  if (slen > UINT16_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  len_buf[0] = (uint8_t)(slen >> 8);
+  len_buf[1] = (uint8_t)slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- UPDATE -------------------- */
+
+static parsebgp_error_t encode_nlris(const parsebgp_bgp_update_nlris_t *msg,
+                                     uint8_t *buf, size_t *lenp)
+{
+  // UPDATE NLRIs are always IPv4
+  return encode_prefixes(msg->prefixes, msg->prefixes_cnt, 32, buf, lenp);
+}
+
+parsebgp_error_t parsebgp_bgp_update_encode(parsebgp_opts_t *opts,
+                                            const parsebgp_bgp_update_t *msg,
+                                            uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  uint8_t *len_buf = buf;
+  parsebgp_error_t err;
+
+  // Withdrawn Routes Length (filled in below)
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 0);
+
+  // Withdrawn Routes
+  slen = len - nwrite;
+  if ((err = encode_nlris(&msg->withdrawn_nlris, buf, &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  if (slen > UINT16_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  len_buf[0] = (uint8_t)(slen >> 8);
+  len_buf[1] = (uint8_t)slen;
+  nwrite += slen;
+  buf += slen;
+
+  // Path Attributes
+  slen = len - nwrite;
+  if ((err = parsebgp_bgp_update_path_attrs_encode(opts, &msg->path_attrs, buf,
+                                                   &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // Announced NLRIs
+  slen = len - nwrite;
+  if ((err = encode_nlris(&msg->announced_nlris, buf, &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- OPEN -------------------- */
+
+static parsebgp_error_t
+encode_capability(const parsebgp_bgp_open_capability_t *cap, uint8_t *buf,
+                  size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // Capability Code
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, cap->code);
+
+  // Capability Length
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, cap->len);
+
+  // Capability Value
+  switch (cap->code) {
+  case PARSEBGP_BGP_OPEN_CAPABILITY_MPBGP:
+    PARSEBGP_ASSERT(cap->len == 4);
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, cap->values.mpbgp.afi);
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, cap->values.mpbgp.reserved);
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, cap->values.mpbgp.safi);
+    break;
+
+  case PARSEBGP_BGP_OPEN_CAPABILITY_AS4:
+    PARSEBGP_ASSERT(cap->len == 4);
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, cap->values.asn);
+    break;
+
+  default:
+    // short values are stored inline (see BGPSTREAM_OPEN_CAPABILITY_RAW_DATA)
+    if (cap->len > sizeof(cap->values.databuf)) {
+      PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, cap->values.datap, cap->len);
+    } else if (cap->len > 0) {
+      PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, cap->values.databuf,
+                               cap->len);
+    }
+    break;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t encode_open(const parsebgp_bgp_open_t *msg,
+                                    uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen, params_len;
+  uint8_t *params_len_buf;
+  parsebgp_error_t err;
+  int i;
+
+  // Version
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->version);
+
+  // My Autonomous System
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->asn);
+
+  // Hold Time
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->hold_time);
+
+  // BGP Identifier
+  PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, msg->bgp_id);
+
+  // Optional Parameters Length (filled in below)
+  params_len_buf = buf;
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, 0);
+  params_len = nwrite;
+
+  // Optional Parameters
+  //
+  // each capability is written in its own Capabilities parameter, which is
+  // what most implementations do
+  for (i = 0; i < msg->capabilities_cnt; i++) {
+    // Parameter Type
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, 2);
+
+    // Parameter Length
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite,
+                             2 + msg->capabilities[i].len);
+
+    // Parameter Value (the Capability)
+    slen = len - nwrite;
+    if ((err = encode_capability(&msg->capabilities[i], buf, &slen)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+  }
+
+  params_len = nwrite - params_len;
+  if (params_len > UINT8_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  *params_len_buf = (uint8_t)params_len;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- NOTIFICATION -------------------- */
+
+static parsebgp_error_t
+encode_notification(const parsebgp_bgp_notification_t *msg, uint8_t *buf,
+                    size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // Error Code
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->code);
+
+  // Error Subcode
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->subcode);
+
+  // Data
+  if (msg->data_len > 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->data,
+                             (size_t)msg->data_len);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- ROUTE-REFRESH -------------------- */
+
+static parsebgp_error_t
+encode_route_refresh(const parsebgp_bgp_route_refresh_t *msg, uint8_t *buf,
+                     size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+
+  // AFI
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->afi);
+
+  // Subtype (Reserved)
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->subtype);
+
+  // SAFI
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->safi);
+
+  // Data
+  if (msg->data_len > 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->data,
+                             (size_t)msg->data_len);
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+/* -------------------- BGP Message -------------------- */
+
+parsebgp_error_t parsebgp_bgp_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_bgp_msg_t *msg,
+                                     uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  uint8_t *hdr_buf;
+  parsebgp_error_t err;
+
+  // Marker
+  if (opts->bgp.marker_omitted == 0) {
+    if (len < sizeof(msg->marker)) {
+      return PARSEBGP_PARTIAL_MSG;
+    }
+    // the marker is always all ones (RFC4271 section 4.1)
+    memset(buf, 0xFF, sizeof(msg->marker));
+    nwrite += sizeof(msg->marker);
+    buf += sizeof(msg->marker);
+  }
+
+  // Length (filled in below)
+  hdr_buf = buf;
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 0);
+
+  // Type
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->type);
+
+  slen = len - nwrite;
+  switch (msg->type) {
+  case PARSEBGP_BGP_TYPE_OPEN:
+    err = encode_open(msg->types.open, buf, &slen);
+    break;
+
+  case PARSEBGP_BGP_TYPE_UPDATE:
+    err = parsebgp_bgp_update_encode(opts, msg->types.update, buf, &slen);
+    break;
+
+  case PARSEBGP_BGP_TYPE_NOTIFICATION:
+    err = encode_notification(msg->types.notification, buf, &slen);
+    break;
+
+  case PARSEBGP_BGP_TYPE_KEEPALIVE:
+    // no data
+    err = PARSEBGP_OK;
+    slen = 0;
+    break;
+
+  case PARSEBGP_BGP_TYPE_ROUTE_REFRESH:
+    err = encode_route_refresh(msg->types.route_refresh, buf, &slen);
+    break;
+
+  default:
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  if (err != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+
+  // the length includes the header (as it was written)
+  if (nwrite > UINT16_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  hdr_buf[0] = (uint8_t)(nwrite >> 8);
+  hdr_buf[1] = (uint8_t)nwrite;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_BGP_ENCODE_H
+#define __PARSEBGP_BGP_ENCODE_H
+
+#include "parsebgp_bgp.h"
+#include "parsebgp_bgp_update.h"
+#include "parsebgp_error.h"
+#include "parsebgp_opts.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * BGP Message Encoder
+ *
+ * The encoder is the inverse of the decoder: it serializes the same message
+ * structures that the decoder fills back into wire format, so that decoded
+ * messages can be filtered or modified and then written out again (e.g., to
+ * produce subsetted MRT files, replay traffic, or build benchmark corpora).
+ *
+ * Encoding is driven by the same options as decoding. In particular,
+ * bgp.asn_4_byte selects the AS_PATH and AGGREGATOR encoding,
+ * bgp.marker_omitted suppresses the marker, bgp.mp_reach_no_afi_safi_reserved
+ * selects the compressed MP_REACH_NLRI form used by MRT TABLE_DUMP_V2, and
+ * attributes enabled in bgp.path_attr_raw are written from their raw copies.
+ *
+ * Path Attributes are encoded from the parsed structure, so changes made to a
+ * decoded message (e.g., dropping COMMUNITIES or rewriting the MED) are
+ * reflected in the output. Callers that re-emit messages unchanged can set
+ * bgp.path_attrs_encode_raw to copy the attributes verbatim from the raw
+ * field of the Path Attributes structure instead (it is set by the decoder
+ * and points into the decode buffer, which must still be valid). This is both
+ * faster and more faithful, since attributes that the decoder skipped or does
+ * not parse (e.g., BGP-LS) are preserved.
+ *
+ * All encoders take the size of the output buffer in *len and, on success,
+ * update it with the number of bytes written. If the buffer is too small,
+ * PARSEBGP_PARTIAL_MSG is returned (and the contents of the buffer are
+ * undefined), so the caller may retry with a larger buffer.
+ */
+
+/**
+ * Encode a BGP message (including the common header)
+ *
+ * @param [in] opts     Options for the encoder
+ * @param [in] msg      Pointer to the BGP message to encode
+ * @param [in] buf      Buffer to write the message into
+ * @param [in,out] len  Length of the buffer. Updated with the number of bytes
+ *                      written to the buffer.
+ * @return PARSEBGP_OK (0) if the message was encoded successfully, or an error
+ * code otherwise
+ *
+ * The length field of the header is computed, the len field of the message is
+ * ignored.
+ */
+parsebgp_error_t parsebgp_bgp_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_bgp_msg_t *msg,
+                                     uint8_t *buf, size_t *len);
+
+/**
+ * Encode the body of a BGP UPDATE message (i.e., without the common header)
+ *
+ * @param [in] opts     Options for the encoder
+ * @param [in] msg      Pointer to the UPDATE message to encode
+ * @param [in] buf      Buffer to write the message into
+ * @param [in,out] len  Length of the buffer. Updated with the number of bytes
+ *                      written to the buffer.
+ * @return PARSEBGP_OK (0) if the message was encoded successfully, or an error
+ * code otherwise
+ *
+ * Withdrawn and announced NLRIs are encoded from their prefixes arrays (the
+ * len fields are computed).
+ */
+parsebgp_error_t parsebgp_bgp_update_encode(parsebgp_opts_t *opts,
+                                            const parsebgp_bgp_update_t *msg,
+                                            uint8_t *buf, size_t *len);
+
+/**
+ * Encode a set of Path Attributes (including the 2-byte total length)
+ *
+ * @param [in] opts     Options for the encoder
+ * @param [in] msg      Pointer to the Path Attributes to encode
+ * @param [in] buf      Buffer to write the attributes into
+ * @param [in,out] len  Length of the buffer. Updated with the number of bytes
+ *                      written to the buffer.
+ * @return PARSEBGP_OK (0) if the attributes were encoded successfully, or an
+ * error code otherwise
+ *
+ * Unless bgp.path_attrs_encode_raw is set and the raw field is set (in which
+ * case the raw data is copied verbatim), attributes are written in attrs_used
+ * order. The attribute flags are taken from the structure, and the Extended
+ * Length flag is added if the attribute data is longer than 255 bytes.
+ */
+parsebgp_error_t parsebgp_bgp_update_path_attrs_encode(
+  parsebgp_opts_t *opts, const parsebgp_bgp_update_path_attrs_t *msg,
+  uint8_t *buf, size_t *len);
+
+#endif /* __PARSEBGP_BGP_ENCODE_H */
@@ -59,9 +59,9 @@ void parsebgp_bgp_notification_destroy(parsebgp_bgp_notification_t *msg)
     return;
   }
 
-  free(msg->data);
+  PARSEBGP_FREE(msg->data);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_notification_clear(parsebgp_bgp_notification_t *msg)
@@ -73,13 +73,23 @@ void parsebgp_bgp_notification_clear(parsebgp_bgp_notification_t *msg)
   msg->data_len = 0;
 }
 
-void parsebgp_bgp_notification_dump(const parsebgp_bgp_notification_t *msg,
-    int depth)
+size_t
+parsebgp_bgp_notification_memory_usage(const parsebgp_bgp_notification_t *msg)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_notification_t, depth);
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + msg->_data_alloc_len;
+}
+
+void parsebgp_bgp_notification_dump(parsebgp_sink_t *sink,
+                                    const parsebgp_bgp_notification_t *msg,
+                                    int depth)
+{
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_notification_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Error Code", msg->code);
-  PARSEBGP_DUMP_INT(depth, "Error Subcode", msg->subcode);
-  PARSEBGP_DUMP_INT(depth, "Data Length", msg->data_len);
-  PARSEBGP_DUMP_DATA(depth, "Data", msg->data, msg->data_len);
+  PARSEBGP_DUMP_INT(sink, depth, "Error Code", msg->code);
+  PARSEBGP_DUMP_INT(sink, depth, "Error Subcode", msg->subcode);
+  PARSEBGP_DUMP_INT(sink, depth, "Data Length", msg->data_len);
+  PARSEBGP_DUMP_DATA(sink, depth, "Data", msg->data, msg->data_len);
 }
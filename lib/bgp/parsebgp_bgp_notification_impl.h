@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_notification.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode a NOTIFICATION message */
@@ -44,9 +45,14 @@ void parsebgp_bgp_notification_destroy(parsebgp_bgp_notification_t *msg);
 /** Clear a NOTIFICATION message */
 void parsebgp_bgp_notification_clear(parsebgp_bgp_notification_t *msg);
 
+/** Get the number of bytes allocated for a NOTIFICATION message */
+size_t
+parsebgp_bgp_notification_memory_usage(const parsebgp_bgp_notification_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed NOTIFICATION message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -55,7 +61,8 @@ void parsebgp_bgp_notification_clear(parsebgp_bgp_notification_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bgp_notification_dump(const parsebgp_bgp_notification_t *msg,
+void parsebgp_bgp_notification_dump(parsebgp_sink_t *sink,
+                                    const parsebgp_bgp_notification_t *msg,
                                     int depth);
 
 #endif /* __PARSEBGP_BGP_NOTIFICATION_IMPL_H */
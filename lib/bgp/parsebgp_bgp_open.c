@@ -199,7 +199,8 @@ parsebgp_error_t parsebgp_bgp_open_decode(parsebgp_opts_t *opts,
   buf += slen;
 
   if (nread != remain) {
-    fprintf(stderr, "ERROR: Trailing data after OPEN Capabilities.\n");
+    PARSEBGP_DIAG(opts, PARSEBGP_DIAG_INVALID_MSG, 1, 0, buf, "%s",
+                  "Trailing data after OPEN Capabilities");
     PARSEBGP_RETURN_INVALID_MSG_ERR;
   }
 
@@ -218,12 +219,12 @@ void parsebgp_bgp_open_destroy(parsebgp_bgp_open_t *msg)
     if (BGPSTREAM_OPEN_CAPABILITY_IS_RAW(cap) &&
       (cap)->len > sizeof(cap->values.databuf) && (cap)->values.datap)
     {
-      free(cap->values.datap);
+      PARSEBGP_FREE(cap->values.datap);
     }
   }
-  free(msg->capabilities);
+  PARSEBGP_FREE(msg->capabilities);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_open_clear(parsebgp_bgp_open_t *msg)
@@ -239,52 +240,75 @@ void parsebgp_bgp_open_clear(parsebgp_bgp_open_t *msg)
     if (BGPSTREAM_OPEN_CAPABILITY_IS_RAW(cap) &&
       (cap)->len > sizeof(cap->values.databuf) && (cap)->values.datap)
     {
-      free(cap->values.datap);
+      PARSEBGP_FREE(cap->values.datap);
       cap->values.datap = NULL;
     }
   }
   msg->capabilities_cnt = 0;
 }
 
-void parsebgp_bgp_open_dump(const parsebgp_bgp_open_t *msg, int depth)
+size_t parsebgp_bgp_open_memory_usage(const parsebgp_bgp_open_t *msg)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_open_t, depth);
-
-  PARSEBGP_DUMP_INT(depth, "Version", msg->version);
-  PARSEBGP_DUMP_INT(depth, "ASN", msg->asn);
-  PARSEBGP_DUMP_INT(depth, "Hold Time", msg->hold_time);
-  PARSEBGP_DUMP_IP(depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4, msg->bgp_id);
-  PARSEBGP_DUMP_INT(depth, "Parameters Length", msg->param_len);
-  PARSEBGP_DUMP_INT(depth, "Capabilities Count", msg->capabilities_cnt);
+  size_t usage;
+
+  if (msg == NULL) {
+    return 0;
+  }
+
+  usage = sizeof(*msg) +
+          sizeof(*msg->capabilities) * msg->_capabilities_alloc_cnt;
+  for (int i = 0; i < msg->capabilities_cnt; i++) {
+    const parsebgp_bgp_open_capability_t *cap = &msg->capabilities[i];
+    if (BGPSTREAM_OPEN_CAPABILITY_IS_RAW(cap) &&
+      (cap)->len > sizeof(cap->values.databuf) && (cap)->values.datap)
+    {
+      usage += cap->len;
+    }
+  }
+  return usage;
+}
+
+void parsebgp_bgp_open_dump(parsebgp_sink_t *sink,
+                            const parsebgp_bgp_open_t *msg, int depth)
+{
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_open_t, depth);
+
+  PARSEBGP_DUMP_INT(sink, depth, "Version", msg->version);
+  PARSEBGP_DUMP_INT(sink, depth, "ASN", msg->asn);
+  PARSEBGP_DUMP_INT(sink, depth, "Hold Time", msg->hold_time);
+  PARSEBGP_DUMP_IP(sink, depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4, msg->bgp_id);
+  PARSEBGP_DUMP_INT(sink, depth, "Parameters Length", msg->param_len);
+  PARSEBGP_DUMP_INT(sink, depth, "Capabilities Count", msg->capabilities_cnt);
   depth++;
   parsebgp_bgp_open_capability_t *cap;
   uint8_t *data;
   for (int i = 0; i < msg->capabilities_cnt; i++) {
     cap = &msg->capabilities[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_open_capability_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_open_capability_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Code", cap->code);
-    PARSEBGP_DUMP_INT(depth, "Length", cap->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Code", cap->code);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", cap->len);
 
     depth++;
     switch (cap->code) {
     case PARSEBGP_BGP_OPEN_CAPABILITY_MPBGP:
-      PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_open_capability_mpbgp_t, depth);
+      PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_open_capability_mpbgp_t,
+                               depth);
 
-      PARSEBGP_DUMP_INT(depth, "AFI", cap->values.mpbgp.afi);
-      PARSEBGP_DUMP_INT(depth, "Reserved", cap->values.mpbgp.reserved);
-      PARSEBGP_DUMP_INT(depth, "SAFI", cap->values.mpbgp.safi);
+      PARSEBGP_DUMP_INT(sink, depth, "AFI", cap->values.mpbgp.afi);
+      PARSEBGP_DUMP_INT(sink, depth, "Reserved", cap->values.mpbgp.reserved);
+      PARSEBGP_DUMP_INT(sink, depth, "SAFI", cap->values.mpbgp.safi);
       break;
 
     case PARSEBGP_BGP_OPEN_CAPABILITY_AS4:
-      PARSEBGP_DUMP_INT(depth, "AS4 ASN", cap->values.asn);
+      PARSEBGP_DUMP_INT(sink, depth, "AS4 ASN", cap->values.asn);
       break;
 
     default:
       data = BGPSTREAM_OPEN_CAPABILITY_RAW_DATA(cap);
       if (data) {
-        PARSEBGP_DUMP_DATA(depth, "Raw data", data, cap->len);
+        PARSEBGP_DUMP_DATA(sink, depth, "Raw data", data, cap->len);
       }
       break;
     }
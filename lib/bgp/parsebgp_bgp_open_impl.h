@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_open.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode an OPEN message */
@@ -44,9 +45,13 @@ void parsebgp_bgp_open_destroy(parsebgp_bgp_open_t *msg);
 /** Clear an OPEN message */
 void parsebgp_bgp_open_clear(parsebgp_bgp_open_t *msg);
 
+/** Get the number of bytes allocated for an OPEN message */
+size_t parsebgp_bgp_open_memory_usage(const parsebgp_bgp_open_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed OPEN message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -55,6 +60,7 @@ void parsebgp_bgp_open_clear(parsebgp_bgp_open_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bgp_open_dump(const parsebgp_bgp_open_t *msg, int depth);
+void parsebgp_bgp_open_dump(parsebgp_sink_t *sink,
+                            const parsebgp_bgp_open_t *msg, int depth);
 
 #endif /* __PARSEBGP_BGP_OPEN_IMPL_H */
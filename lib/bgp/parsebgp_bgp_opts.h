@@ -112,8 +112,9 @@ typedef struct parsebgp_bgp_opts {
    * their own (optimized) parser to parse the attribute data.
    *
    * Note: currently only the PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH,
-   * PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH and
-   * PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES attributes support this
+   * PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH,
+   * PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES and
+   * PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES attributes support this
    * feature. All other attribute will be fully parsed (unless filtered out
    * using the above 'path_attr_filter').
    */
@@ -128,6 +129,52 @@ typedef struct parsebgp_bgp_opts {
    */
   uint8_t path_attr_raw[UINT8_MAX];
 
+  /**
+   * Merge AS4_PATH into AS_PATH
+   *
+   * If this is set, the AS_PATH and AS4_PATH attributes of each UPDATE are
+   * merged using the method outlined in RFC6793 section 4.2.3, and the result
+   * is made available in the as_path field of the Path Attributes structure.
+   * The merge is skipped if either attribute is raw-parsed.
+   */
+  int as_path_merge;
+
+  /**
+   * Only extract AS Path summaries
+   *
+   * If this is set, the AS_PATH and AS4_PATH parsers only scan the path data
+   * and fill the summary fields of the AS Path structure (origin_asn,
+   * first_asn, asns_cnt, has_as_set and path_hash) without allocating or
+   * populating the segments array. These fields are filled by normal parsing
+   * too, this option just skips the rest of the work. If as_path_merge is also
+   * set, the summary of the merged path is computed.
+   */
+  int as_path_summary;
+
+  /**
+   * Store Extended Communities in compact form
+   *
+   * If this is set, the EXT_COMMUNITIES and IPV6_EXT_COMMUNITIES parsers do
+   * not populate the communities array, and instead copy each community in
+   * its wire format (8 bytes, or 20 for IPv6 Extended Communities) into a
+   * flat array (the compact field of the Extended Communities structure).
+   * Use the parsebgp_bgp_update_ext_community_compact_* accessors or
+   * parsebgp_bgp_update_ext_community_expand to read them.
+   */
+  int ext_communities_compact;
+
+  /**
+   * Encode Path Attributes from their original wire data
+   *
+   * If this is set, the encoder copies the attributes of a Path Attributes
+   * structure verbatim from its raw field (when set) instead of encoding them
+   * from the parsed attributes. This is faster and preserves attributes that
+   * the decoder skipped, but changes made to the parsed attributes are
+   * ignored, and the buffer that the message was decoded from must still be
+   * valid.
+   */
+  int path_attrs_encode_raw;
+
 } parsebgp_bgp_opts_t;
 
 /**
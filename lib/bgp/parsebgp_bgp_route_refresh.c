@@ -62,9 +62,9 @@ void parsebgp_bgp_route_refresh_destroy(parsebgp_bgp_route_refresh_t *msg)
     return;
   }
 
-  free(msg->data);
+  PARSEBGP_FREE(msg->data);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_route_refresh_clear(parsebgp_bgp_route_refresh_t *msg)
@@ -76,14 +76,24 @@ void parsebgp_bgp_route_refresh_clear(parsebgp_bgp_route_refresh_t *msg)
   msg->data_len = 0;
 }
 
-void parsebgp_bgp_route_refresh_dump(const parsebgp_bgp_route_refresh_t *msg,
+size_t
+parsebgp_bgp_route_refresh_memory_usage(const parsebgp_bgp_route_refresh_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + msg->_data_alloc_len;
+}
+
+void parsebgp_bgp_route_refresh_dump(parsebgp_sink_t *sink,
+                                     const parsebgp_bgp_route_refresh_t *msg,
                                      int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_route_refresh_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_route_refresh_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "AFI", msg->afi);
-  PARSEBGP_DUMP_INT(depth, "Subtype", msg->subtype);
-  PARSEBGP_DUMP_INT(depth, "SAFI", msg->safi);
-  PARSEBGP_DUMP_INT(depth, "Data Length", msg->data_len);
-  PARSEBGP_DUMP_DATA(depth, "Data", msg->data, msg->data_len);
+  PARSEBGP_DUMP_INT(sink, depth, "AFI", msg->afi);
+  PARSEBGP_DUMP_INT(sink, depth, "Subtype", msg->subtype);
+  PARSEBGP_DUMP_INT(sink, depth, "SAFI", msg->safi);
+  PARSEBGP_DUMP_INT(sink, depth, "Data Length", msg->data_len);
+  PARSEBGP_DUMP_DATA(sink, depth, "Data", msg->data, msg->data_len);
 }
@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_route_refresh.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode a ROUTE REFRESH message */
@@ -44,9 +45,14 @@ void parsebgp_bgp_route_refresh_destroy(parsebgp_bgp_route_refresh_t *msg);
 /** Clear a ROUTE REFRESH message */
 void parsebgp_bgp_route_refresh_clear(parsebgp_bgp_route_refresh_t *msg);
 
+/** Get the number of bytes allocated for a ROUTE REFRESH message */
+size_t
+parsebgp_bgp_route_refresh_memory_usage(const parsebgp_bgp_route_refresh_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed ROUTE-REFRESH message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -55,7 +61,8 @@ void parsebgp_bgp_route_refresh_clear(parsebgp_bgp_route_refresh_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bgp_route_refresh_dump(const parsebgp_bgp_route_refresh_t *msg,
+void parsebgp_bgp_route_refresh_dump(parsebgp_sink_t *sink,
+                                     const parsebgp_bgp_route_refresh_t *msg,
                                      int depth);
 
 #endif /* __PARSEBGP_BGP_ROUTE_REFRESH_IMPL_H */
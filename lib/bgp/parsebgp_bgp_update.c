@@ -34,6 +34,12 @@
 #include <stdio.h>
 #include <string.h>
 
+/** Initial value (FNV-1a offset basis) of the AS Path hash */
+#define AS_PATH_HASH_INIT 0xCBF29CE484222325ULL
+
+/** Multiplier (FNV-1a prime) of the AS Path hash */
+#define AS_PATH_HASH_PRIME 0x100000001B3ULL
+
 static parsebgp_error_t parse_nlris(parsebgp_bgp_update_nlris_t *nlris,
                                     const uint8_t *buf, size_t *lenp, size_t remain)
 {
@@ -92,7 +98,7 @@ static parsebgp_error_t parse_nlris(parsebgp_bgp_update_nlris_t *nlris,
 
 static void destroy_nlris(parsebgp_bgp_update_nlris_t *nlris)
 {
-  free(nlris->prefixes);
+  PARSEBGP_FREE(nlris->prefixes);
   nlris->prefixes_cnt = 0;
   nlris->_prefixes_alloc_cnt = 0;
 }
@@ -102,23 +108,87 @@ static void clear_nlris(parsebgp_bgp_update_nlris_t *nlris)
   nlris->prefixes_cnt = 0;
 }
 
-static void dump_nlris(const parsebgp_bgp_update_nlris_t *nlris, int depth)
+static size_t nlris_memory_usage(const parsebgp_bgp_update_nlris_t *nlris)
+{
+  return sizeof(*nlris->prefixes) * nlris->_prefixes_alloc_cnt;
+}
+
+static void dump_nlris(parsebgp_sink_t *sink,
+                       const parsebgp_bgp_update_nlris_t *nlris, int depth)
+{
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_nlris_t, depth);
+
+  PARSEBGP_DUMP_INT(sink, depth, "Prefixes Count", nlris->prefixes_cnt);
+
+  parsebgp_bgp_prefixes_dump(sink, nlris->prefixes, nlris->prefixes_cnt,
+                             depth + 1);
+}
+
+/** Start a new AS Path summary (see as_path_summary_seg) */
+static void as_path_summary_init(parsebgp_bgp_update_as_path_t *msg)
+{
+  msg->asns_cnt = 0;
+  msg->origin_asn = 0;
+  msg->first_asn = 0;
+  msg->has_as_set = 0;
+  msg->summary_only = 0;
+  msg->path_hash = AS_PATH_HASH_INIT;
+  msg->_summary_last_type = 0;
+}
+
+/** Add a segment header to an AS Path summary */
+static inline void as_path_summary_seg(parsebgp_bgp_update_as_path_t *msg,
+                                       uint8_t type, uint8_t asns_cnt)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_nlris_t, depth);
+  if (type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ) {
+    msg->asns_cnt += asns_cnt;
+  } else if (type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SET) {
+    // as per RFC 4271
+    msg->asns_cnt++;
+    msg->has_as_set = 1;
+  } // else: don't count confederations as per RFC 5065
+
+  // consecutive AS_SEQ segments hash as though they were a single segment so
+  // that long sequences hash the same regardless of how they are split
+  if (type != PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ ||
+      msg->_summary_last_type != type) {
+    msg->path_hash = (msg->path_hash ^ (0x100 | type)) * AS_PATH_HASH_PRIME;
+  }
+  msg->_summary_last_type = type;
+}
 
-  PARSEBGP_DUMP_INT(depth, "Prefixes Count", nlris->prefixes_cnt);
+/** Add an ASN (of the most recently added segment) to an AS Path summary */
+static inline void as_path_summary_asn(parsebgp_bgp_update_as_path_t *msg,
+                                       uint32_t asn)
+{
+  if (msg->_summary_last_type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ) {
+    if (msg->first_asn == 0) {
+      msg->first_asn = asn;
+    }
+    msg->origin_asn = asn;
+  }
+  msg->path_hash = (msg->path_hash ^ asn) * AS_PATH_HASH_PRIME;
+}
 
-  parsebgp_bgp_prefixes_dump(nlris->prefixes, nlris->prefixes_cnt, depth + 1);
+/** Finish an AS Path summary */
+static void as_path_summary_finish(parsebgp_bgp_update_as_path_t *msg)
+{
+  // murmur3 finalizer
+  msg->path_hash ^= msg->path_hash >> 33;
+  msg->path_hash *= 0xFF51AFD7ED558CCDULL;
+  msg->path_hash ^= msg->path_hash >> 33;
 }
 
 static parsebgp_error_t
 parse_path_attr_as_path(int asn_4_byte, parsebgp_bgp_update_as_path_t *msg,
-                        const uint8_t *buf, size_t *lenp, size_t remain, int raw)
+                        const uint8_t *buf, size_t *lenp, size_t remain, int raw,
+                        int summary)
 {
   size_t len = *lenp, nread = 0;
-  parsebgp_bgp_update_as_path_seg_t *seg;
+  parsebgp_bgp_update_as_path_seg_t *seg = NULL;
   int i;
-  uint8_t asn_size;
+  uint8_t asn_size, seg_type, seg_asns_cnt;
+  uint32_t asn;
 
   if (asn_4_byte) {
     asn_size = sizeof(uint32_t);
@@ -128,7 +198,7 @@ parse_path_attr_as_path(int asn_4_byte, parsebgp_bgp_update_as_path_t *msg,
 
   msg->asn_4_byte = asn_4_byte;
   msg->segs_cnt = 0;
-  msg->asns_cnt = 0;
+  as_path_summary_init(msg);
 
   if (raw) {
     PARSEBGP_MAYBE_REALLOC(msg->raw, msg->_raw_alloc_len,
@@ -137,70 +207,78 @@ parse_path_attr_as_path(int asn_4_byte, parsebgp_bgp_update_as_path_t *msg,
     *lenp = remain;
     return PARSEBGP_OK;
   }
+  msg->summary_only = summary;
 
   while ((remain - nread) > 0) {
-    // create a new segment
-    PARSEBGP_MAYBE_REALLOC(msg->segs, msg->_segs_alloc_cnt, msg->segs_cnt + 1);
-    seg = &(msg->segs)[msg->segs_cnt];
-    msg->segs_cnt++;
-
     if ((len - nread) < 2) {
       return PARSEBGP_PARTIAL_MSG;
     }
 
     // Segment Type
-    seg->type = *(buf++);
+    seg_type = *(buf++);
 
     // Segment Length (# ASNs)
-    seg->asns_cnt = *(buf++);
+    seg_asns_cnt = *(buf++);
 
     nread += 2;
 
     // do one length check to avoid doing checked memcpys
-    if ((len - nread) < (asn_size * seg->asns_cnt)) {
+    if ((len - nread) < (asn_size * seg_asns_cnt)) {
       return PARSEBGP_PARTIAL_MSG;
     }
 
-    if (seg->type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ) {
-      msg->asns_cnt += seg->asns_cnt;
-    } else if (seg->type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SET) {
-      // as per RFC 4271
-      msg->asns_cnt++;
-    } // else: don't count confederations as per RFC 5065
+    as_path_summary_seg(msg, seg_type, seg_asns_cnt);
+
+    if (!summary) {
+      // create a new segment
+      PARSEBGP_MAYBE_REALLOC(msg->segs, msg->_segs_alloc_cnt,
+                             msg->segs_cnt + 1);
+      seg = &(msg->segs)[msg->segs_cnt];
+      msg->segs_cnt++;
+      seg->type = seg_type;
+      seg->asns_cnt = seg_asns_cnt;
+
+      // ensure there is enough space to store the ASNs (we store as 4-byte
+      // regardless of what the path encoding is)
+      PARSEBGP_MAYBE_REALLOC(seg->asns, seg->_asns_alloc_cnt, seg->asns_cnt);
+    }
 
-    // ensure there is enough space to store the ASNs (we store as 4-byte
-    // regardless of what the path encoding is)
-    PARSEBGP_MAYBE_REALLOC(seg->asns, seg->_asns_alloc_cnt, seg->asns_cnt);
     // Segment ASNs
-    for (i = 0; i < seg->asns_cnt; i++) {
+    for (i = 0; i < seg_asns_cnt; i++) {
       if (asn_4_byte) {
-        seg->asns[i] = nptohl(buf);
+        asn = nptohl(buf);
       } else {
-        seg->asns[i] = nptohs(buf);
+        asn = nptohs(buf);
       }
       buf += asn_size;
+      as_path_summary_asn(msg, asn);
+      if (seg != NULL) {
+        seg->asns[i] = asn;
+      }
     }
-    nread += asn_size * seg->asns_cnt;
+    nread += asn_size * seg_asns_cnt;
   }
 
   // TODO: remove:
   assert((remain - nread) == 0);
+  as_path_summary_finish(msg);
   *lenp = nread;
   return PARSEBGP_OK;
 }
 
 static parsebgp_error_t
 parse_path_attr_as_path_safe(int asn_4_byte, parsebgp_bgp_update_as_path_t *msg,
-                             const uint8_t *buf, size_t *lenp, size_t remain, int raw)
+                             const uint8_t *buf, size_t *lenp, size_t remain,
+                             int raw, int summary)
 {
   parsebgp_error_t err;
   // first we try just parsing as-is
-  if ((err = parse_path_attr_as_path(asn_4_byte, msg, buf, lenp, remain,
-                                     raw)) != PARSEBGP_OK &&
+  if ((err = parse_path_attr_as_path(asn_4_byte, msg, buf, lenp, remain, raw,
+                                     summary)) != PARSEBGP_OK &&
       asn_4_byte != 0) {
     // if we've been asked to do 4-byte parsing, then maybe the caller made a
     // mistake
-    return parse_path_attr_as_path(0, msg, buf, lenp, remain, raw);
+    return parse_path_attr_as_path(0, msg, buf, lenp, remain, raw, summary);
   }
   return err;
 }
@@ -212,14 +290,14 @@ static void destroy_attr_as_path(parsebgp_bgp_update_as_path_t *msg)
     return;
   }
 
-  free(msg->raw);
+  PARSEBGP_FREE(msg->raw);
 
   for (i = 0; i < msg->_segs_alloc_cnt; i++) {
-    free(msg->segs[i].asns);
+    PARSEBGP_FREE(msg->segs[i].asns);
   }
-  free(msg->segs);
+  PARSEBGP_FREE(msg->segs);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 static void clear_attr_as_path(parsebgp_bgp_update_as_path_t *msg)
@@ -229,15 +307,223 @@ static void clear_attr_as_path(parsebgp_bgp_update_as_path_t *msg)
     msg->segs[i].asns_cnt = 0;
   }
   msg->segs_cnt = 0;
+  as_path_summary_init(msg);
 }
 
-static void dump_attr_as_path(const parsebgp_bgp_update_as_path_t *msg,
-    int depth)
+static size_t attr_as_path_memory_usage(const parsebgp_bgp_update_as_path_t *msg)
+{
+  size_t usage;
+  int i;
+
+  if (msg == NULL) {
+    return 0;
+  }
+
+  usage = sizeof(*msg) + msg->_raw_alloc_len +
+          sizeof(*msg->segs) * msg->_segs_alloc_cnt;
+  for (i = 0; i < msg->_segs_alloc_cnt; i++) {
+    usage += sizeof(*msg->segs[i].asns) * msg->segs[i]._asns_alloc_cnt;
+  }
+  return usage;
+}
+
+/** Append an ASN to an AS Path. A new segment is started if new_seg is set
+    (unless both it and the previous segment are AS_SEQs) or if the current
+    segment is full. Returns -1 if the path is full. */
+static int as_path_append_asn(parsebgp_bgp_update_as_path_t *path,
+                              uint8_t type, int new_seg, uint32_t asn)
+{
+  parsebgp_bgp_update_as_path_seg_t *seg = NULL;
+
+  if (path->segs_cnt > 0) {
+    seg = &path->segs[path->segs_cnt - 1];
+  }
+
+  // sequences can be concatenated, but sets cannot
+  if (seg == NULL || seg->asns_cnt == UINT8_MAX ||
+      (new_seg && (type != PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ ||
+                   seg->type != type))) {
+    if (path->segs_cnt == UINT8_MAX) {
+      return -1;
+    }
+    if (path->_segs_alloc_cnt < path->segs_cnt + 1) {
+      if ((path->segs = realloc(path->segs, sizeof(*path->segs) *
+                                              (path->segs_cnt + 1))) == NULL) {
+        return -1;
+      }
+      PARSEBGP_ALLOC_PROFILE_REALLOC(
+        "path->segs", sizeof(*path->segs) * path->_segs_alloc_cnt,
+        sizeof(*path->segs) * (path->segs_cnt + 1));
+      memset(&path->segs[path->segs_cnt], 0, sizeof(*path->segs));
+      path->_segs_alloc_cnt = path->segs_cnt + 1;
+    }
+    seg = &path->segs[path->segs_cnt++];
+    seg->type = type;
+    seg->asns_cnt = 0;
+  }
+
+  if (seg->_asns_alloc_cnt < seg->asns_cnt + 1) {
+    // grow geometrically since we're adding one ASN at a time
+    int alloc = seg->asns_cnt < 8 ? 8 : seg->asns_cnt * 2;
+    if (alloc > UINT8_MAX) {
+      alloc = UINT8_MAX;
+    }
+    if ((seg->asns = realloc(seg->asns, sizeof(uint32_t) * alloc)) == NULL) {
+      return -1;
+    }
+    PARSEBGP_ALLOC_PROFILE_REALLOC("seg->asns",
+                                   sizeof(uint32_t) * seg->_asns_alloc_cnt,
+                                   sizeof(uint32_t) * alloc);
+    seg->_asns_alloc_cnt = alloc;
+  }
+  seg->asns[seg->asns_cnt++] = asn;
+
+  return 0;
+}
+
+/** Append (a prefix of) raw AS Path data to a merged AS Path.
+ *
+ * If take is non-negative, only the first take ASNs (counted as per RFC 4271)
+ * are appended. If skip_confed is set, confederation segments are skipped. If
+ * summary is set, only the summary fields of the path are updated. Returns -1
+ * if the path could not be merged.
+ */
+static int merge_as_path_raw(parsebgp_bgp_update_as_path_t *merged,
+                             const uint8_t *buf, size_t len, int asn_4_byte,
+                             int take, int skip_confed, int summary)
+{
+  size_t asn_size = asn_4_byte ? sizeof(uint32_t) : sizeof(uint16_t);
+  uint8_t type, cnt;
+  uint32_t asn;
+  int i, n;
+
+  while (len >= 2 && take != 0) {
+    type = buf[0];
+    cnt = buf[1];
+    buf += 2;
+    len -= 2;
+    if (len < asn_size * cnt) {
+      return -1;
+    }
+
+    switch (type) {
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ:
+      n = (take >= 0 && take < cnt) ? take : cnt;
+      if (take > 0) {
+        take -= n;
+      }
+      break;
+
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SET:
+      n = cnt;
+      if (take > 0) {
+        take--;
+      }
+      break;
+
+    default:
+      n = skip_confed ? 0 : cnt;
+      break;
+    }
+
+    if (n > 0) {
+      as_path_summary_seg(merged, type, n);
+    }
+    for (i = 0; i < n; i++) {
+      asn = asn_4_byte ? nptohl(buf + asn_size * i) : nptohs(buf + asn_size * i);
+      as_path_summary_asn(merged, asn);
+      if (!summary && as_path_append_asn(merged, type, i == 0, asn) != 0) {
+        return -1;
+      }
+    }
+    buf += asn_size * cnt;
+    len -= asn_size * cnt;
+  }
+
+  return 0;
+}
+
+/** Merge AS_PATH and AS4_PATH as per RFC6793 section 4.2.3, and set the
+    effective AS path */
+static parsebgp_error_t
+merge_as_path(parsebgp_opts_t *opts,
+              parsebgp_bgp_update_path_attrs_t *path_attrs,
+              const uint8_t *as_path_buf, const uint8_t *as4_path_buf)
+{
+  parsebgp_bgp_update_path_attr_t *as_path_attr =
+    &path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH];
+  parsebgp_bgp_update_path_attr_t *as4_path_attr =
+    &path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH];
+  parsebgp_bgp_update_path_attr_t *aggregator =
+    &path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR];
+  parsebgp_bgp_update_as_path_t *as_path, *as4_path, *merged;
+
+  if (as_path_attr->type == 0) {
+    path_attrs->as_path = NULL;
+    return PARSEBGP_OK;
+  }
+  as_path = path_attrs->as_path = as_path_attr->data.as_path;
+
+  if (!opts->bgp.as_path_merge || as4_path_attr->type == 0 ||
+      as_path_buf == NULL || as4_path_buf == NULL) {
+    return PARSEBGP_OK;
+  }
+  as4_path = as4_path_attr->data.as_path;
+
+  // AS4_PATH is ignored if:
+  //  - the AS_PATH already has 4-byte ASNs (i.e., we're not talking to an OLD
+  //    speaker)
+  //  - the AGGREGATOR was not set to AS_TRANS by the OLD speaker, and there
+  //    is an AS4_AGGREGATOR (RFC 6793 section 4.2.3)
+  //  - the AS4_PATH is longer than the AS_PATH
+  // and we can't merge if we don't have the segments
+  if (as_path->asn_4_byte ||
+      (aggregator->type != 0 &&
+       aggregator->data.aggregator.asn != PARSEBGP_BGP_AS_TRANS &&
+       path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR].type !=
+         0) ||
+      as_path->asns_cnt < as4_path->asns_cnt ||
+      (opts->bgp.path_attr_raw_enabled &&
+       (opts->bgp.path_attr_raw[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH] ||
+        opts->bgp.path_attr_raw[PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH]))) {
+    return PARSEBGP_OK;
+  }
+
+  PARSEBGP_MAYBE_MALLOC_ZERO(path_attrs->_as_path_merged);
+  merged = path_attrs->_as_path_merged;
+  clear_attr_as_path(merged);
+  merged->asn_4_byte = 1;
+  merged->summary_only = opts->bgp.as_path_summary;
+
+  // take the leading ASNs from AS_PATH (AS_SETs count as one ASN, and
+  // confederation segments do not count at all), and then append the
+  // AS4_PATH, ignoring any confederation segments
+  if (merge_as_path_raw(merged, as_path_buf, as_path_attr->len, 0,
+                        (int)as_path->asns_cnt - (int)as4_path->asns_cnt, 0,
+                        opts->bgp.as_path_summary) != 0 ||
+      merge_as_path_raw(merged, as4_path_buf, as4_path_attr->len, 1, -1, 1,
+                        opts->bgp.as_path_summary) != 0) {
+    // path is too long (or malformed), so just use AS_PATH
+    return PARSEBGP_OK;
+  }
+  as_path_summary_finish(merged);
+
+  path_attrs->as_path = merged;
+  return PARSEBGP_OK;
+}
+
+static void dump_attr_as_path(parsebgp_sink_t *sink,
+                              const parsebgp_bgp_update_as_path_t *msg,
+                              int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_as_path_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_as_path_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Segment Count", msg->segs_cnt);
-  PARSEBGP_DUMP_INT(depth, "ASN Count*", msg->asns_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Segment Count", msg->segs_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "ASN Count*", msg->asns_cnt);
+  PARSEBGP_DUMP_VAL(sink, depth, "First ASN", PRIu32, msg->first_asn);
+  PARSEBGP_DUMP_VAL(sink, depth, "Origin ASN", PRIu32, msg->origin_asn);
+  PARSEBGP_DUMP_INT(sink, depth, "Has AS_SET", msg->has_as_set);
+  PARSEBGP_DUMP_VAL(sink, depth, "Path Hash", PRIx64, msg->path_hash);
 
   depth++;
   int i;
@@ -245,19 +531,19 @@ static void dump_attr_as_path(const parsebgp_bgp_update_as_path_t *msg,
   for (i = 0; i < msg->segs_cnt; i++) {
     seg = &msg->segs[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_as_path_seg_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_as_path_seg_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", seg->type);
-    PARSEBGP_DUMP_INT(depth, "ASNs Count", seg->asns_cnt);
-    PARSEBGP_DUMP_INFO(depth, "ASNs: ");
+    PARSEBGP_DUMP_INT(sink, depth, "Type", seg->type);
+    PARSEBGP_DUMP_INT(sink, depth, "ASNs Count", seg->asns_cnt);
+    PARSEBGP_DUMP_INFO(sink, depth, "ASNs: ");
     int j;
     for (j = 0; j < seg->asns_cnt; j++) {
       if (j != 0) {
-        fputs(" ", stdout);
+        parsebgp_sink_puts(sink, " ");
       }
-      printf("%" PRIu32, seg->asns[j]);
+      parsebgp_sink_printf(sink, "%" PRIu32, seg->asns[j]);
     }
-    fputs("\n", stdout);
+    parsebgp_sink_puts(sink, "\n");
   }
 }
 
@@ -304,9 +590,11 @@ parse_path_attr_communities(parsebgp_bgp_update_communities_t *msg,
     // don't actually parse the communities
     PARSEBGP_MAYBE_REALLOC(msg->raw, msg->_raw_alloc_len, remain);
     memcpy(msg->raw, buf, remain);
+    msg->raw_len = remain;
     *lenp = remain;
     return PARSEBGP_OK;
   }
+  msg->raw_len = 0;
 
   PARSEBGP_MAYBE_REALLOC(msg->communities,
                          msg->_communities_alloc_cnt, msg->communities_cnt);
@@ -323,33 +611,49 @@ static void destroy_attr_communities(parsebgp_bgp_update_communities_t *msg)
   if (msg == NULL) {
     return;
   }
-  free(msg->communities);
-  free(msg->raw);
-  free(msg);
+  PARSEBGP_FREE(msg->communities);
+  PARSEBGP_FREE(msg->raw);
+  PARSEBGP_FREE(msg);
 }
 
 static void clear_attr_communities(parsebgp_bgp_update_communities_t *msg)
 {
   msg->communities_cnt = 0;
+  msg->raw_len = 0;
+}
+
+static size_t
+attr_communities_memory_usage(const parsebgp_bgp_update_communities_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         sizeof(*msg->communities) * msg->_communities_alloc_cnt +
+         msg->_raw_alloc_len;
 }
 
-static void dump_attr_communities(const parsebgp_bgp_update_communities_t *msg,
+static void dump_attr_communities(parsebgp_sink_t *sink,
+                                  const parsebgp_bgp_update_communities_t *msg,
                                   int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_communities_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_communities_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Communities Count", msg->communities_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Communities Count", msg->communities_cnt);
 
-  PARSEBGP_DUMP_INFO(depth, "Communities: ");
+  PARSEBGP_DUMP_INFO(sink, depth, "Communities: ");
   int i;
+  uint32_t comm;
   for (i = 0; i < msg->communities_cnt; i++) {
     if (i != 0) {
-      fputs(" ", stdout);
+      parsebgp_sink_puts(sink, " ");
     }
-    printf("%" PRIu16 ":%" PRIu16, (uint16_t)(msg->communities[i] >> 16),
-           (uint16_t)msg->communities[i]);
+    comm = msg->raw_len > 0 ? nptohl(msg->raw + i * sizeof(uint32_t))
+                            : msg->communities[i];
+    parsebgp_sink_printf(sink, "%" PRIu16 ":%" PRIu16, (uint16_t)(comm >> 16),
+                         (uint16_t)comm);
   }
-  fputs("\n", stdout);
+  parsebgp_sink_puts(sink, "\n");
 }
 
 static parsebgp_error_t
@@ -378,8 +682,8 @@ static void destroy_attr_cluster_list(parsebgp_bgp_update_cluster_list_t *msg)
   if (msg == NULL) {
     return;
   }
-  free(msg->cluster_ids);
-  free(msg);
+  PARSEBGP_FREE(msg->cluster_ids);
+  PARSEBGP_FREE(msg);
 }
 
 static void clear_attr_cluster_list(parsebgp_bgp_update_cluster_list_t *msg)
@@ -387,22 +691,33 @@ static void clear_attr_cluster_list(parsebgp_bgp_update_cluster_list_t *msg)
   msg->cluster_ids_cnt = 0;
 }
 
+static size_t
+attr_cluster_list_memory_usage(const parsebgp_bgp_update_cluster_list_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         sizeof(*msg->cluster_ids) * msg->_cluster_ids_alloc_cnt;
+}
+
 static void dump_attr_cluster_list(
-    const parsebgp_bgp_update_cluster_list_t *msg, int depth)
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_cluster_list_t *msg,
+    int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_cluster_list_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_cluster_list_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Cluster ID Count", msg->cluster_ids_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Cluster ID Count", msg->cluster_ids_cnt);
 
-  PARSEBGP_DUMP_INFO(depth, "Cluster IDs: ");
+  PARSEBGP_DUMP_INFO(sink, depth, "Cluster IDs: ");
   int i;
   for (i = 0; i < msg->cluster_ids_cnt; i++) {
     if (i != 0) {
-      fputs(" ", stdout);
+      parsebgp_sink_puts(sink, " ");
     }
-    printf("%" PRIu32, msg->cluster_ids[i]);
+    parsebgp_sink_printf(sink, "%" PRIu32, msg->cluster_ids[i]);
   }
-  fputs("\n", stdout);
+  parsebgp_sink_puts(sink, "\n");
 }
 
 static parsebgp_error_t
@@ -423,7 +738,8 @@ parse_path_attr_as_pathlimit(parsebgp_bgp_update_as_pathlimit_t *msg,
 
 static parsebgp_error_t
 parse_path_attr_large_communities(parsebgp_bgp_update_large_communities_t *msg,
-                                  const uint8_t *buf, size_t *lenp, size_t remain)
+                                  const uint8_t *buf, size_t *lenp, size_t remain,
+                                  int raw)
 {
   size_t len = *lenp, nread = 0;
   int i;
@@ -434,6 +750,16 @@ parse_path_attr_large_communities(parsebgp_bgp_update_large_communities_t *msg,
 
   msg->communities_cnt = remain / LARGE_COMM_LEN;
 
+  if (raw) {
+    // don't actually parse the communities
+    PARSEBGP_MAYBE_REALLOC(msg->raw, msg->_raw_alloc_len, remain);
+    memcpy(msg->raw, buf, remain);
+    msg->raw_len = remain;
+    *lenp = remain;
+    return PARSEBGP_OK;
+  }
+  msg->raw_len = 0;
+
   PARSEBGP_MAYBE_REALLOC(msg->communities,
                          msg->_communities_alloc_cnt, msg->communities_cnt);
 
@@ -460,36 +786,58 @@ destroy_attr_large_communities(parsebgp_bgp_update_large_communities_t *msg)
   if (msg == NULL) {
     return;
   }
-  free(msg->communities);
-  free(msg);
+  PARSEBGP_FREE(msg->communities);
+  PARSEBGP_FREE(msg->raw);
+  PARSEBGP_FREE(msg);
 }
 
 static void
 clear_attr_large_communities(parsebgp_bgp_update_large_communities_t *msg)
 {
   msg->communities_cnt = 0;
+  msg->raw_len = 0;
+}
+
+static size_t attr_large_communities_memory_usage(
+  const parsebgp_bgp_update_large_communities_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         sizeof(*msg->communities) * msg->_communities_alloc_cnt +
+         msg->_raw_alloc_len;
 }
 
 static void
-dump_attr_large_communities(const parsebgp_bgp_update_large_communities_t *msg,
+dump_attr_large_communities(parsebgp_sink_t *sink,
+                            const parsebgp_bgp_update_large_communities_t *msg,
                             int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_large_communities_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_large_communities_t,
+                           depth);
 
-  PARSEBGP_DUMP_INT(depth, "Communities Count", msg->communities_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Communities Count", msg->communities_cnt);
 
-  PARSEBGP_DUMP_INFO(depth, "Communities: ");
+  PARSEBGP_DUMP_INFO(sink, depth, "Communities: ");
   int i;
-  parsebgp_bgp_update_large_community_t *comm;
+  parsebgp_bgp_update_large_community_t *comm, raw_comm;
   for (i = 0; i < msg->communities_cnt; i++) {
-    comm = &msg->communities[i];
+    if (msg->raw_len > 0) {
+      raw_comm.global_admin = nptohl(msg->raw + i * LARGE_COMM_LEN);
+      raw_comm.local_1 = nptohl(msg->raw + i * LARGE_COMM_LEN + 4);
+      raw_comm.local_2 = nptohl(msg->raw + i * LARGE_COMM_LEN + 8);
+      comm = &raw_comm;
+    } else {
+      comm = &msg->communities[i];
+    }
     if (i != 0) {
-      fputs(" ", stdout);
+      parsebgp_sink_puts(sink, " ");
     }
-    printf("%" PRIu32 ":%" PRIu32 ":%" PRIu32 " ", comm->global_admin,
-           comm->local_1, comm->local_2);
+    parsebgp_sink_printf(sink, "%" PRIu32 ":%" PRIu32 ":%" PRIu32 " ",
+                         comm->global_admin, comm->local_1, comm->local_2);
   }
-  fputs("\n", stdout);
+  parsebgp_sink_puts(sink, "\n");
 }
 
 parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
@@ -501,6 +849,7 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
   uint8_t flags_tmp, type_tmp;
   uint16_t len_tmp;
   parsebgp_error_t err = PARSEBGP_OK;
+  const uint8_t *as_path_buf = NULL, *as4_path_buf = NULL;
 
   path_attrs->attrs_cnt = 0;
 
@@ -516,6 +865,7 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
   }
   PARSEBGP_ASSERT(nread + path_attrs->len <= remain);
   remain = nread + path_attrs->len; // remaining within path attributes
+  path_attrs->raw = buf;
 
   // read until we run out of attributes
   while (nread < remain) {
@@ -529,12 +879,13 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
          single minimum-sized path attribute, and should be considered as
          "treat-as-withdraw" (https://tools.ietf.org/html/rfc7606#section-4).
        */
+      opts->diag._attr_type = 0;
       PARSEBGP_SKIP_INVALID_MSG(opts, buf, nread, 0,
         "Path attribute requires at least 3-4 bytes, but only %d bytes remain.",
         (int)(remain - nread));
       // If we pass the above macro, the user wants us to struggle on.
-      *lenp = remain;
-      return PARSEBGP_OK;
+      nread = remain;
+      break;
     }
 
     /* Optimization: since the length was already checked above, we can skip
@@ -561,10 +912,14 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
         "Path attribute (type %d) has length %d, but only %d bytes remain.",
         type_tmp, len_tmp, (int)(remain - nread));
       // If we pass the above macro, the user wants us to struggle on.
-      *lenp = remain;
-      return PARSEBGP_OK;
+      nread = remain;
+      break;
     }
 
+    opts->diag._attr_type = type_tmp;
+    PARSEBGP_STATS_ADD(opts, path_attrs[type_tmp].cnt, 1);
+    PARSEBGP_STATS_ADD(opts, path_attrs[type_tmp].bytes, len_tmp);
+
     // if this type is beyond the max type that we understand, skip it now
     if (type_tmp >= PARSEBGP_BGP_PATH_ATTRS_LEN) {
       PARSEBGP_SKIP_NOT_IMPLEMENTED(
@@ -587,8 +942,9 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
     if (attr->type != 0) {
       assert(attr->type == type_tmp);
 
-      fprintf(stderr, "WARN: Duplicate Path Attribute (%d) found. Skipping\n",
-              type_tmp);
+      PARSEBGP_DIAG(opts, PARSEBGP_DIAG_DUPLICATE_ATTR, 0, opts->silence_invalid,
+                    buf, "Duplicate Path Attribute (%d) found. Skipping",
+                    type_tmp);
       nread += len_tmp;
       buf += len_tmp;
       continue;
@@ -628,12 +984,12 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
     // Type 2:
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH:
       PARSEBGP_MAYBE_MALLOC_ZERO(attr->data.as_path);
-      if ((err = parse_path_attr_as_path_safe(opts->bgp.asn_4_byte,
-                                              attr->data.as_path, buf, &slen,
-                                              attr->len, RAW(opts, attr)))
-                                              != PARSEBGP_OK) {
+      if ((err = parse_path_attr_as_path_safe(
+             opts->bgp.asn_4_byte, attr->data.as_path, buf, &slen, attr->len,
+             RAW(opts, attr), opts->bgp.as_path_summary)) != PARSEBGP_OK) {
         return err;
       }
+      as_path_buf = buf;
       nread += slen;
       buf += slen;
       break;
@@ -679,6 +1035,17 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
     // Type 8
     case PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES:
       PARSEBGP_MAYBE_MALLOC_ZERO(attr->data.communities);
+      if ((attr->len % sizeof(uint32_t)) != 0) {
+        // malformed (RFC 7606 section 7.8), so keep the attribute but without
+        // any communities
+        attr->data.communities->communities_cnt = 0;
+        attr->data.communities->raw_len = 0;
+        PARSEBGP_SKIP_INVALID_MSG(
+          opts, buf, nread, attr->len,
+          "COMMUNITIES length (%d) is not a multiple of 4", attr->len);
+        slen = attr->len;
+        break;
+      }
       if ((err = parse_path_attr_communities(attr->data.communities, buf, &slen,
                                              attr->len, RAW(opts, attr)))
                                              != PARSEBGP_OK) {
@@ -749,10 +1116,12 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
       // same as AS_PATH, but force 4-byte AS parsing
       PARSEBGP_MAYBE_MALLOC_ZERO(attr->data.as_path);
       if ((err = parse_path_attr_as_path(1, attr->data.as_path, buf, &slen,
-                                         attr->len, RAW(opts, attr)))
-                                         != PARSEBGP_OK) {
+                                         attr->len, RAW(opts, attr),
+                                         opts->bgp.as_path_summary)) !=
+          PARSEBGP_OK) {
         return err;
       }
+      as4_path_buf = buf;
       nread += slen;
       buf += slen;
       break;
@@ -811,8 +1180,20 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
     // Type 32
     case PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES:
       PARSEBGP_MAYBE_MALLOC_ZERO(attr->data.large_communities);
+      if ((attr->len % LARGE_COMM_LEN) != 0) {
+        // malformed (RFC 8092 section 5), so keep the attribute but without
+        // any communities
+        attr->data.large_communities->communities_cnt = 0;
+        attr->data.large_communities->raw_len = 0;
+        PARSEBGP_SKIP_INVALID_MSG(
+          opts, buf, nread, attr->len,
+          "LARGE_COMMUNITIES length (%d) is not a multiple of 12", attr->len);
+        slen = attr->len;
+        break;
+      }
       if ((err = parse_path_attr_large_communities(attr->data.large_communities,
-                                                   buf, &slen, attr->len)) !=
+                                                   buf, &slen, attr->len,
+                                                   RAW(opts, attr))) !=
           PARSEBGP_OK) {
         return err;
       }
@@ -829,6 +1210,12 @@ parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
     }
     PARSEBGP_ASSERT(slen == attr->len);
   }
+  opts->diag._attr_type = 0;
+
+  if ((err = merge_as_path(opts, path_attrs, as_path_buf, as4_path_buf)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
 
   *lenp = nread;
   return PARSEBGP_OK;
@@ -896,7 +1283,83 @@ void parsebgp_bgp_update_path_attrs_destroy(
     }
   }
 
-  free(msg->attrs_used);
+  PARSEBGP_FREE(msg->attrs_used);
+
+  destroy_attr_as_path(msg->_as_path_merged);
+  msg->_as_path_merged = NULL;
+  msg->as_path = NULL;
+}
+
+/** Path Attribute types that may hold dynamically allocated memory */
+static const uint8_t path_attrs_dynamic_types[] = {
+  PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_CLUSTER_LIST,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_IPV6_EXT_COMMUNITIES,
+  PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES,
+};
+
+size_t parsebgp_bgp_update_path_attrs_memory_usage(
+  const parsebgp_bgp_update_path_attrs_t *msg)
+{
+  size_t usage, i;
+  const parsebgp_bgp_update_path_attr_t *attr;
+  uint8_t type;
+
+  if (msg == NULL) {
+    return 0;
+  }
+
+  usage = sizeof(*msg->attrs_used) * msg->_attrs_used_alloc_cnt +
+          attr_as_path_memory_usage(msg->_as_path_merged);
+
+  // attribute data is kept across clears, so check all attributes that may
+  // have been allocated, not just those in use
+  for (i = 0; i < sizeof(path_attrs_dynamic_types); i++) {
+    type = path_attrs_dynamic_types[i];
+    attr = &msg->attrs[type];
+
+    switch (type) {
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH:
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH:
+      usage += attr_as_path_memory_usage(attr->data.as_path);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES:
+      usage += attr_communities_memory_usage(attr->data.communities);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_CLUSTER_LIST:
+      usage += attr_cluster_list_memory_usage(attr->data.cluster_list);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI:
+      usage += parsebgp_bgp_update_mp_reach_memory_usage(attr->data.mp_reach);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI:
+      usage +=
+        parsebgp_bgp_update_mp_unreach_memory_usage(attr->data.mp_unreach);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES:
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_IPV6_EXT_COMMUNITIES:
+      usage += parsebgp_bgp_update_ext_communities_memory_usage(
+        attr->data.ext_communities);
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES:
+      usage +=
+        attr_large_communities_memory_usage(attr->data.large_communities);
+      break;
+    }
+  }
+
+  return usage;
 }
 
 void parsebgp_bgp_update_path_attrs_clear(parsebgp_bgp_update_path_attrs_t *msg)
@@ -967,15 +1430,24 @@ void parsebgp_bgp_update_path_attrs_clear(parsebgp_bgp_update_path_attrs_t *msg)
   }
 
   msg->attrs_cnt = 0;
+  msg->as_path = NULL;
+  // don't keep pointing into the previous decode buffer
+  msg->raw = NULL;
+  msg->len = 0;
 }
 
 void parsebgp_bgp_update_path_attrs_dump(
-    const parsebgp_bgp_update_path_attrs_t *msg, int depth)
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_path_attrs_t *msg,
+    int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_path_attrs_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_path_attrs_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Length", msg->len);
-  PARSEBGP_DUMP_INT(depth, "Attributes Count", msg->attrs_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Length", msg->len);
+  PARSEBGP_DUMP_INT(sink, depth, "Attributes Count", msg->attrs_cnt);
+  if (msg->as_path != NULL && msg->as_path == msg->_as_path_merged) {
+    PARSEBGP_DUMP_INFO(sink, depth, "Merged AS Path:\n");
+    dump_attr_as_path(sink, msg->as_path, depth + 1);
+  }
 
   depth++;
   int i;
@@ -987,91 +1459,92 @@ void parsebgp_bgp_update_path_attrs_dump(
       continue;
     }
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_path_attr_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_path_attr_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Flags", attr->flags);
-    PARSEBGP_DUMP_INT(depth, "Type", attr->type);
-    PARSEBGP_DUMP_INT(depth, "Length", attr->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Flags", attr->flags);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", attr->type);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", attr->len);
 
     depth++;
     switch (attr->type) {
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN:
-      PARSEBGP_DUMP_INT(depth, "ORIGIN", attr->data.origin);
+      PARSEBGP_DUMP_INT(sink, depth, "ORIGIN", attr->data.origin);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH:
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_PATH:
-      dump_attr_as_path(attr->data.as_path, depth);
+      dump_attr_as_path(sink, attr->data.as_path, depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP:
-      PARSEBGP_DUMP_IP(depth, "Next Hop", PARSEBGP_BGP_AFI_IPV4,
+      PARSEBGP_DUMP_IP(sink, depth, "Next Hop", PARSEBGP_BGP_AFI_IPV4,
                        attr->data.next_hop);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_MED:
-      PARSEBGP_DUMP_INT(depth, "MED", attr->data.med);
+      PARSEBGP_DUMP_INT(sink, depth, "MED", attr->data.med);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF:
-      PARSEBGP_DUMP_INT(depth, "LOCAL_PREF", attr->data.local_pref);
+      PARSEBGP_DUMP_INT(sink, depth, "LOCAL_PREF", attr->data.local_pref);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_ATOMIC_AGGREGATE:
-      PARSEBGP_DUMP_INFO(depth, "ATOMIC_AGGREGATE\n");
+      PARSEBGP_DUMP_INFO(sink, depth, "ATOMIC_AGGREGATE\n");
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR:
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR:
-      PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_aggregator_t, depth);
-      PARSEBGP_DUMP_INT(depth, "ASN", attr->data.aggregator.asn);
-      PARSEBGP_DUMP_IP(depth, "IP", PARSEBGP_BGP_AFI_IPV4,
+      PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_aggregator_t, depth);
+      PARSEBGP_DUMP_INT(sink, depth, "ASN", attr->data.aggregator.asn);
+      PARSEBGP_DUMP_IP(sink, depth, "IP", PARSEBGP_BGP_AFI_IPV4,
                        attr->data.aggregator.addr);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES:
-      dump_attr_communities(attr->data.communities, depth);
+      dump_attr_communities(sink, attr->data.communities, depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGINATOR_ID:
-      PARSEBGP_DUMP_INT(depth, "ORIGINATOR_ID", attr->data.originator_id);
+      PARSEBGP_DUMP_INT(sink, depth, "ORIGINATOR_ID", attr->data.originator_id);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_CLUSTER_LIST:
-      dump_attr_cluster_list(attr->data.cluster_list, depth);
+      dump_attr_cluster_list(sink, attr->data.cluster_list, depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI:
-      parsebgp_bgp_update_mp_reach_dump(attr->data.mp_reach, depth);
+      parsebgp_bgp_update_mp_reach_dump(sink, attr->data.mp_reach, depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI:
-      parsebgp_bgp_update_mp_unreach_dump(attr->data.mp_unreach, depth);
+      parsebgp_bgp_update_mp_unreach_dump(sink, attr->data.mp_unreach, depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES:
     case PARSEBGP_BGP_PATH_ATTR_TYPE_IPV6_EXT_COMMUNITIES:
-      parsebgp_bgp_update_ext_communities_dump(attr->data.ext_communities,
+      parsebgp_bgp_update_ext_communities_dump(sink, attr->data.ext_communities,
                                                depth);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATHLIMIT:
-      PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_as_pathlimit_t, depth);
-      PARSEBGP_DUMP_INT(depth, "Max # ASNs", attr->data.as_pathlimit.max_asns);
-      PARSEBGP_DUMP_INT(depth, "ASN", attr->data.as_pathlimit.asn);
+      PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_as_pathlimit_t, depth);
+      PARSEBGP_DUMP_INT(sink, depth, "Max # ASNs",
+                        attr->data.as_pathlimit.max_asns);
+      PARSEBGP_DUMP_INT(sink, depth, "ASN", attr->data.as_pathlimit.asn);
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_BGP_LS:
-      PARSEBGP_DUMP_INFO(depth, "BGP-LS Support Not Implemented\n");
+      PARSEBGP_DUMP_INFO(sink, depth, "BGP-LS Support Not Implemented\n");
       break;
 
     case PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES:
-      dump_attr_large_communities(attr->data.large_communities, depth);
+      dump_attr_large_communities(sink, attr->data.large_communities, depth);
       break;
 
     default:
-      PARSEBGP_DUMP_INFO(depth, "Unsupported Attribute\n");
+      PARSEBGP_DUMP_INFO(sink, depth, "Unsupported Attribute\n");
       break;
     }
     depth--;
@@ -1096,6 +1569,11 @@ parsebgp_error_t parsebgp_bgp_update_decode(parsebgp_opts_t *opts,
     return err;
   }
   assert(slen == msg->withdrawn_nlris.len);
+  PARSEBGP_STATS_ADD(
+    opts,
+    nlris_withdrawn[PARSEBGP_STATS_AFI_IDX(PARSEBGP_BGP_AFI_IPV4)]
+                   [PARSEBGP_STATS_SAFI_IDX(PARSEBGP_BGP_SAFI_UNICAST)],
+    msg->withdrawn_nlris.prefixes_cnt);
   nread += slen;
   buf += slen;
 
@@ -1117,6 +1595,11 @@ parsebgp_error_t parsebgp_bgp_update_decode(parsebgp_opts_t *opts,
     return err;
   }
   assert(slen == msg->announced_nlris.len);
+  PARSEBGP_STATS_ADD(
+    opts,
+    nlris_announced[PARSEBGP_STATS_AFI_IDX(PARSEBGP_BGP_AFI_IPV4)]
+                   [PARSEBGP_STATS_SAFI_IDX(PARSEBGP_BGP_SAFI_UNICAST)],
+    msg->announced_nlris.prefixes_cnt);
   nread += slen;
   buf += slen;
 
@@ -1134,7 +1617,7 @@ void parsebgp_bgp_update_destroy(parsebgp_bgp_update_t *msg)
   destroy_nlris(&msg->announced_nlris);
   parsebgp_bgp_update_path_attrs_destroy(&msg->path_attrs);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_update_clear(parsebgp_bgp_update_t *msg)
@@ -1148,16 +1631,27 @@ void parsebgp_bgp_update_clear(parsebgp_bgp_update_t *msg)
   parsebgp_bgp_update_path_attrs_clear(&msg->path_attrs);
 }
 
-void parsebgp_bgp_update_dump(const parsebgp_bgp_update_t *msg, int depth)
+size_t parsebgp_bgp_update_memory_usage(const parsebgp_bgp_update_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + nlris_memory_usage(&msg->withdrawn_nlris) +
+         nlris_memory_usage(&msg->announced_nlris) +
+         parsebgp_bgp_update_path_attrs_memory_usage(&msg->path_attrs);
+}
+
+void parsebgp_bgp_update_dump(parsebgp_sink_t *sink,
+                              const parsebgp_bgp_update_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_t, depth);
 
-  PARSEBGP_DUMP_INFO(depth, "Withdrawn NLRIs:\n");
-  dump_nlris(&msg->withdrawn_nlris, depth + 1);
+  PARSEBGP_DUMP_INFO(sink, depth, "Withdrawn NLRIs:\n");
+  dump_nlris(sink, &msg->withdrawn_nlris, depth + 1);
 
-  PARSEBGP_DUMP_INFO(depth, "Path Attributes:\n");
-  parsebgp_bgp_update_path_attrs_dump(&msg->path_attrs, depth + 1);
+  PARSEBGP_DUMP_INFO(sink, depth, "Path Attributes:\n");
+  parsebgp_bgp_update_path_attrs_dump(sink, &msg->path_attrs, depth + 1);
 
-  PARSEBGP_DUMP_INFO(depth, "Announced NLRIs:\n");
-  dump_nlris(&msg->announced_nlris, depth + 1);
+  PARSEBGP_DUMP_INFO(sink, depth, "Announced NLRIs:\n");
+  dump_nlris(sink, &msg->announced_nlris, depth + 1);
 }
@@ -71,6 +71,10 @@ typedef enum {
 
 } parsebgp_bgp_update_as_path_seg_type_t;
 
+/** AS_TRANS: the 2-byte ASN used in place of 4-byte ASNs by NEW BGP speakers
+    when talking to OLD BGP speakers (RFC6793) */
+#define PARSEBGP_BGP_AS_TRANS 23456
+
 /**
  * AS Path Segment (supports both 2 and 4-byte ASNs)
  */
@@ -95,7 +99,8 @@ typedef struct parsebgp_bgp_update_as_path_seg {
  */
 typedef struct parsebgp_bgp_update_as_path {
 
-  /** Array of AS Path Segments (may be NULL if shallow parsing is enabled) */
+  /** Array of AS Path Segments (may be NULL if shallow parsing is enabled, and
+      is not populated if the bgp.as_path_summary option is set) */
   parsebgp_bgp_update_as_path_seg_t *segs;
 
   /** Number of allocated segments (INTERNAL) */
@@ -108,9 +113,36 @@ typedef struct parsebgp_bgp_update_as_path {
    *
    * Note: this uses the definition in Section 9.1.2.2 of [RFC4271] and Section
    * 5.3 of [RFC5065] which treats AS_SETs as a single ASN, and does not count
-   * CONFED_* segments at all.
+   * CONFED_* segments at all. (Heavily prepended paths may have more than
+   * 255 ASNs, so this is wider than the per-segment count.)
    */
-  uint8_t asns_cnt;
+  uint16_t asns_cnt;
+
+  /** Origin ASN (the last ASN of the last AS_SEQ segment, or 0 if there is no
+      such segment, or if the path was parsed in raw mode) */
+  uint32_t origin_asn;
+
+  /** First ASN (the first ASN of the first AS_SEQ segment, normally the
+      neighbor AS, or 0 if there is no such segment) */
+  uint32_t first_asn;
+
+  /** Does the path contain an AS_SET segment? */
+  uint8_t has_as_set;
+
+  /** Was the path parsed with the bgp.as_path_summary option set? (If so,
+      segs is not populated and only the summary fields are valid.) */
+  uint8_t summary_only;
+
+  /** Hash of the path (segment types and ASNs)
+   *
+   * The hash does not depend on the ASN encoding (2 or 4-byte) or on how long
+   * AS_SEQ segments are split, so paths with equal hashes are very likely to be
+   * identical.
+   */
+  uint64_t path_hash;
+
+  /** Type of the last segment added to the summary (INTERNAL) */
+  uint8_t _summary_last_type;
 
   /** Does the path contain 4-byte ASNs (instead of 2-byte)? */
   uint8_t asn_4_byte;
@@ -156,6 +188,10 @@ typedef struct parsebgp_bgp_update_communities {
   /** Allocated length of the raw data (INTERNAL) */
   int _raw_alloc_len;
 
+  /** Length of the raw communities data (0 if the attribute was not
+      raw-parsed, in which case the communities array is populated) */
+  int raw_len;
+
 } parsebgp_bgp_update_communities_t;
 
 /**
@@ -217,8 +253,68 @@ typedef struct parsebgp_bgp_update_large_communities {
   /** (Inferred) number of communities */
   int communities_cnt;
 
+  /** Pointer to a copy of the raw large communities data */
+  uint8_t *raw;
+
+  /** Allocated length of the raw data (INTERNAL) */
+  int _raw_alloc_len;
+
+  /** Length of the raw large communities data (0 if the attribute was not
+      raw-parsed, in which case the communities array is populated) */
+  int raw_len;
+
 } parsebgp_bgp_update_large_communities_t;
 
+/** Read a big-endian 32-bit value from raw attribute data (INTERNAL) */
+static inline uint32_t parsebgp_bgp_update_raw_uint32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/**
+ * Get a community from a COMMUNITIES attribute
+ *
+ * @param msg           Pointer to the COMMUNITIES attribute
+ * @param idx           Index of the community (< communities_cnt)
+ * @return the community
+ *
+ * Works whether or not the attribute was raw-parsed.
+ */
+static inline uint32_t
+parsebgp_bgp_update_community_get(const parsebgp_bgp_update_communities_t *msg,
+                                  int idx)
+{
+  return msg->raw_len > 0
+           ? parsebgp_bgp_update_raw_uint32(msg->raw + idx * sizeof(uint32_t))
+           : msg->communities[idx];
+}
+
+/**
+ * Get a large community from a LARGE_COMMUNITIES attribute
+ *
+ * @param msg           Pointer to the LARGE_COMMUNITIES attribute
+ * @param idx           Index of the community (< communities_cnt)
+ * @param comm          Pointer to the structure to fill with the community
+ *
+ * Works whether or not the attribute was raw-parsed.
+ */
+static inline void parsebgp_bgp_update_large_community_get(
+  const parsebgp_bgp_update_large_communities_t *msg, int idx,
+  parsebgp_bgp_update_large_community_t *comm)
+{
+  const uint8_t *p;
+
+  if (msg->raw_len == 0) {
+    *comm = msg->communities[idx];
+    return;
+  }
+  p = msg->raw + idx * 12;
+  comm->global_admin = parsebgp_bgp_update_raw_uint32(p);
+  comm->local_1 = parsebgp_bgp_update_raw_uint32(p + 4);
+  comm->local_2 = parsebgp_bgp_update_raw_uint32(p + 8);
+}
+
 typedef enum {
 
   /** ORIGIN (Type Code 1) */
@@ -334,7 +430,9 @@ typedef struct parsebgp_bgp_update_path_attr {
     /** AS_PATH or AS4_PATH
      *
      * An AS4_PATH should be merged with the AS_PATH attribute using the method
-     * outlined in RFC6793 section 4.2.3.
+     * outlined in RFC6793 section 4.2.3. If the bgp.as_path_merge option is
+     * set, the library does this and the result is available in the as_path
+     * field of parsebgp_bgp_update_path_attrs_t.
      */
     parsebgp_bgp_update_as_path_t *as_path;
 
@@ -386,6 +484,14 @@ typedef struct parsebgp_bgp_update_path_attrs {
   /** Length of the (raw) Path Attributes data (in bytes) */
   uint16_t len;
 
+  /** Pointer to the (len bytes of) raw Path Attributes data
+   *
+   * This points into the buffer that the message was decoded from (or into a
+   * copy owned by the message), so it is only valid as long as that buffer
+   * is.
+   */
+  const uint8_t *raw;
+
   /** Array of Path Attributes
    *
    * Attributes are stored at attrs[ATTR_TYPE] to allow access to specific
@@ -405,6 +511,18 @@ typedef struct parsebgp_bgp_update_path_attrs {
   /** Number of populated Path Attributes in the attrs field */
   int attrs_cnt;
 
+  /** Effective AS Path (NULL if there is no AS_PATH attribute)
+   *
+   * If the bgp.as_path_merge option is set, this is the AS_PATH attribute
+   * merged with the AS4_PATH attribute as per RFC6793 section 4.2.3 (or simply
+   * the AS_PATH attribute if no merge is needed). Otherwise this always points
+   * to the AS_PATH attribute.
+   */
+  parsebgp_bgp_update_as_path_t *as_path;
+
+  /** Storage for the merged AS Path (INTERNAL) */
+  parsebgp_bgp_update_as_path_t *_as_path_merged;
+
 } parsebgp_bgp_update_path_attrs_t;
 
 /**
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_bgp_update_community_filter.h"
+#include "parsebgp_utils.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Initial number of slots in a hash set (must be a power of two) */
+#define SET_INIT_SLOTS 16
+
+/** Size (in uint64_t words) of the community ASN bitset */
+#define ASN_BITSET_WORDS (65536 / 64)
+
+#define LARGE_COMM_LEN 12
+
+/** Open-addressed set of 32-bit values. A zero slot is empty, so the zero
+    value itself is tracked separately. */
+typedef struct u32_set {
+  uint32_t *slots;
+  uint32_t mask;
+  uint32_t cnt;
+  int has_zero;
+} u32_set_t;
+
+/** Open-addressed set of large communities (all-zero slot is empty) */
+typedef struct large_set {
+  parsebgp_bgp_update_large_community_t *slots;
+  uint32_t mask;
+  uint32_t cnt;
+  int has_zero;
+} large_set_t;
+
+struct parsebgp_bgp_community_filter {
+
+  /** Exact communities */
+  u32_set_t comms;
+
+  /** Community ASNs (NULL if none have been added) */
+  uint64_t *asns;
+
+  /** Exact large communities */
+  large_set_t large;
+
+  /** Large community Global Administrators */
+  u32_set_t large_asns;
+};
+
+static inline uint32_t hash_u32(uint32_t v)
+{
+  v ^= v >> 16;
+  v *= 0x7FEB352D;
+  v ^= v >> 15;
+  v *= 0x846CA68B;
+  v ^= v >> 16;
+  return v;
+}
+
+static inline uint32_t hash_large(uint32_t ga, uint32_t l1, uint32_t l2)
+{
+  return hash_u32(ga ^ hash_u32(l1 ^ hash_u32(l2)));
+}
+
+static int u32_set_contains(const u32_set_t *set, uint32_t v)
+{
+  uint32_t i;
+  if (v == 0) {
+    return set->has_zero;
+  }
+  if (set->cnt == 0) {
+    return 0;
+  }
+  for (i = hash_u32(v) & set->mask; set->slots[i] != 0;
+       i = (i + 1) & set->mask) {
+    if (set->slots[i] == v) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void u32_set_insert_nogrow(u32_set_t *set, uint32_t v)
+{
+  uint32_t i;
+  for (i = hash_u32(v) & set->mask; set->slots[i] != 0;
+       i = (i + 1) & set->mask) {
+    if (set->slots[i] == v) {
+      return;
+    }
+  }
+  set->slots[i] = v;
+  set->cnt++;
+}
+
+static parsebgp_error_t u32_set_add(u32_set_t *set, uint32_t v)
+{
+  uint32_t *old = set->slots, old_size = set->mask + 1, i;
+
+  if (v == 0) {
+    set->has_zero = 1;
+    return PARSEBGP_OK;
+  }
+
+  // keep the load factor at or below 1/2 so that probe chains stay short
+  if (set->slots == NULL || (set->cnt + 1) * 2 > old_size) {
+    uint32_t new_size = (set->slots == NULL) ? SET_INIT_SLOTS : old_size * 2;
+    if ((set->slots = calloc(new_size, sizeof(uint32_t))) == NULL) {
+      set->slots = old;
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+    set->mask = new_size - 1;
+    set->cnt = 0;
+    for (i = 0; old != NULL && i < old_size; i++) {
+      if (old[i] != 0) {
+        u32_set_insert_nogrow(set, old[i]);
+      }
+    }
+    free(old);
+  }
+
+  u32_set_insert_nogrow(set, v);
+  return PARSEBGP_OK;
+}
+
+static int large_is_zero(const parsebgp_bgp_update_large_community_t *c)
+{
+  return c->global_admin == 0 && c->local_1 == 0 && c->local_2 == 0;
+}
+
+static int large_set_contains(const large_set_t *set, uint32_t ga, uint32_t l1,
+                              uint32_t l2)
+{
+  uint32_t i;
+  const parsebgp_bgp_update_large_community_t *c;
+  if (ga == 0 && l1 == 0 && l2 == 0) {
+    return set->has_zero;
+  }
+  if (set->cnt == 0) {
+    return 0;
+  }
+  for (i = hash_large(ga, l1, l2) & set->mask;
+       !large_is_zero((c = &set->slots[i])); i = (i + 1) & set->mask) {
+    if (c->global_admin == ga && c->local_1 == l1 && c->local_2 == l2) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void
+large_set_insert_nogrow(large_set_t *set,
+                        const parsebgp_bgp_update_large_community_t *v)
+{
+  uint32_t i;
+  parsebgp_bgp_update_large_community_t *c;
+  for (i = hash_large(v->global_admin, v->local_1, v->local_2) & set->mask;
+       !large_is_zero((c = &set->slots[i])); i = (i + 1) & set->mask) {
+    if (c->global_admin == v->global_admin && c->local_1 == v->local_1 &&
+        c->local_2 == v->local_2) {
+      return;
+    }
+  }
+  *c = *v;
+  set->cnt++;
+}
+
+static parsebgp_error_t
+large_set_add(large_set_t *set, const parsebgp_bgp_update_large_community_t *v)
+{
+  parsebgp_bgp_update_large_community_t *old = set->slots;
+  uint32_t old_size = set->mask + 1, i;
+
+  if (large_is_zero(v)) {
+    set->has_zero = 1;
+    return PARSEBGP_OK;
+  }
+
+  if (set->slots == NULL || (set->cnt + 1) * 2 > old_size) {
+    uint32_t new_size = (set->slots == NULL) ? SET_INIT_SLOTS : old_size * 2;
+    if ((set->slots = calloc(new_size, sizeof(*set->slots))) == NULL) {
+      set->slots = old;
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+    set->mask = new_size - 1;
+    set->cnt = 0;
+    for (i = 0; old != NULL && i < old_size; i++) {
+      if (!large_is_zero(&old[i])) {
+        large_set_insert_nogrow(set, &old[i]);
+      }
+    }
+    free(old);
+  }
+
+  large_set_insert_nogrow(set, v);
+  return PARSEBGP_OK;
+}
+
+static inline int comm_matches(const parsebgp_bgp_community_filter_t *filter,
+                               uint32_t comm)
+{
+  uint16_t asn = comm >> 16;
+  if (filter->asns != NULL &&
+      (filter->asns[asn / 64] & ((uint64_t)1 << (asn % 64))) != 0) {
+    return 1;
+  }
+  return u32_set_contains(&filter->comms, comm);
+}
+
+static inline int
+large_matches(const parsebgp_bgp_community_filter_t *filter, uint32_t ga,
+              uint32_t l1, uint32_t l2)
+{
+  return u32_set_contains(&filter->large_asns, ga) ||
+         large_set_contains(&filter->large, ga, l1, l2);
+}
+
+/* -------------------- Public API -------------------- */
+
+parsebgp_bgp_community_filter_t *parsebgp_bgp_community_filter_create(void)
+{
+  return malloc_zero(sizeof(parsebgp_bgp_community_filter_t));
+}
+
+void parsebgp_bgp_community_filter_destroy(
+  parsebgp_bgp_community_filter_t *filter)
+{
+  if (filter == NULL) {
+    return;
+  }
+  free(filter->comms.slots);
+  free(filter->asns);
+  free(filter->large.slots);
+  free(filter->large_asns.slots);
+  free(filter);
+}
+
+parsebgp_error_t
+parsebgp_bgp_community_filter_add(parsebgp_bgp_community_filter_t *filter,
+                                  uint32_t community)
+{
+  return u32_set_add(&filter->comms, community);
+}
+
+parsebgp_error_t
+parsebgp_bgp_community_filter_add_asn(parsebgp_bgp_community_filter_t *filter,
+                                      uint16_t asn)
+{
+  if (filter->asns == NULL &&
+      (filter->asns = calloc(ASN_BITSET_WORDS, sizeof(uint64_t))) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  filter->asns[asn / 64] |= (uint64_t)1 << (asn % 64);
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t
+parsebgp_bgp_community_filter_add_large(parsebgp_bgp_community_filter_t *filter,
+                                        uint32_t global_admin, uint32_t local_1,
+                                        uint32_t local_2)
+{
+  parsebgp_bgp_update_large_community_t c = {global_admin, local_1, local_2};
+  return large_set_add(&filter->large, &c);
+}
+
+parsebgp_error_t parsebgp_bgp_community_filter_add_large_asn(
+  parsebgp_bgp_community_filter_t *filter, uint32_t global_admin)
+{
+  return u32_set_add(&filter->large_asns, global_admin);
+}
+
+int parsebgp_bgp_community_filter_match_raw(
+  const parsebgp_bgp_community_filter_t *filter, const uint8_t *buf,
+  size_t len)
+{
+  const uint8_t *end = buf + (len & ~(size_t)3);
+  for (; buf < end; buf += sizeof(uint32_t)) {
+    if (comm_matches(filter, nptohl(buf))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int parsebgp_bgp_community_filter_match_large_raw(
+  const parsebgp_bgp_community_filter_t *filter, const uint8_t *buf,
+  size_t len)
+{
+  const uint8_t *end = buf + (len - (len % LARGE_COMM_LEN));
+  for (; buf < end; buf += LARGE_COMM_LEN) {
+    if (large_matches(filter, nptohl(buf), nptohl(buf + 4),
+                      nptohl(buf + 8))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int parsebgp_bgp_community_filter_match(
+  const parsebgp_bgp_community_filter_t *filter,
+  const parsebgp_bgp_update_path_attrs_t *path_attrs)
+{
+  const parsebgp_bgp_update_communities_t *comms;
+  const parsebgp_bgp_update_large_communities_t *large;
+  const parsebgp_bgp_update_large_community_t *lc;
+  int i;
+
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES].type ==
+        PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES &&
+      (comms = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES]
+                 .data.communities) != NULL) {
+    if (comms->raw_len > 0) {
+      if (parsebgp_bgp_community_filter_match_raw(filter, comms->raw,
+                                                  comms->raw_len)) {
+        return 1;
+      }
+    } else {
+      for (i = 0; i < comms->communities_cnt; i++) {
+        if (comm_matches(filter, comms->communities[i])) {
+          return 1;
+        }
+      }
+    }
+  }
+
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES].type ==
+        PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES &&
+      (large = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES]
+                 .data.large_communities) != NULL) {
+    if (large->raw_len > 0) {
+      if (parsebgp_bgp_community_filter_match_large_raw(filter, large->raw,
+                                                        large->raw_len)) {
+        return 1;
+      }
+    } else {
+      for (i = 0; i < large->communities_cnt; i++) {
+        lc = &large->communities[i];
+        if (large_matches(filter, lc->global_admin, lc->local_1,
+                          lc->local_2)) {
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+int parsebgp_bgp_communities_raw_contains(const uint8_t *buf, size_t len,
+                                          uint32_t community)
+{
+  // compare in network byte order so that no per-word byte swapping is needed
+  uint32_t needle = htonl(community), word;
+  size_t i, cnt = len / sizeof(uint32_t);
+  int found = 0;
+
+  for (i = 0; i < cnt; i++) {
+    memcpy(&word, buf + i * sizeof(uint32_t), sizeof(word));
+    found |= (word == needle);
+  }
+  return found;
+}
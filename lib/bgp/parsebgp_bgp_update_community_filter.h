@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_BGP_UPDATE_COMMUNITY_FILTER_H
+#define __PARSEBGP_BGP_UPDATE_COMMUNITY_FILTER_H
+
+#include "parsebgp_bgp_update.h"
+#include "parsebgp_error.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Community Filter
+ *
+ * A community filter is compiled from a set of query values (exact
+ * communities, community ASNs, exact large communities, and large community
+ * global administrators) and can then be matched against COMMUNITIES and
+ * LARGE_COMMUNITIES attributes without decoding them. This is most useful
+ * when the attributes are parsed in raw mode (see the path_attr_raw field of
+ * parsebgp_bgp_opts_t), in which case matching is done directly over the
+ * copied wire bytes and never allocates.
+ *
+ * Exact values are stored in small open-addressed hash sets, and community
+ * ASNs in a 65536-bit bitset, so a match costs one lookup per community in
+ * the attribute regardless of the number of query values.
+ */
+typedef struct parsebgp_bgp_community_filter parsebgp_bgp_community_filter_t;
+
+/** Create an empty community filter (that matches nothing) */
+parsebgp_bgp_community_filter_t *parsebgp_bgp_community_filter_create(void);
+
+/** Destroy a community filter */
+void parsebgp_bgp_community_filter_destroy(
+  parsebgp_bgp_community_filter_t *filter);
+
+/**
+ * Add an exact community (e.g., 65535:666 is 0xFFFF029A) to the filter
+ *
+ * @param filter        Pointer to the filter to update
+ * @param community     Community value (ASN in the high 16 bits)
+ * @return PARSEBGP_OK if the value was added, PARSEBGP_MALLOC_FAILURE otherwise
+ */
+parsebgp_error_t
+parsebgp_bgp_community_filter_add(parsebgp_bgp_community_filter_t *filter,
+                                  uint32_t community);
+
+/**
+ * Add a community ASN (i.e., match ASN:*) to the filter
+ *
+ * @param filter        Pointer to the filter to update
+ * @param asn           ASN (high 16 bits of the community) to match
+ * @return PARSEBGP_OK if the value was added, PARSEBGP_MALLOC_FAILURE otherwise
+ */
+parsebgp_error_t
+parsebgp_bgp_community_filter_add_asn(parsebgp_bgp_community_filter_t *filter,
+                                      uint16_t asn);
+
+/**
+ * Add an exact large community to the filter
+ *
+ * @param filter        Pointer to the filter to update
+ * @param global_admin  Global Administrator of the large community
+ * @param local_1       Local Data Part 1 of the large community
+ * @param local_2       Local Data Part 2 of the large community
+ * @return PARSEBGP_OK if the value was added, PARSEBGP_MALLOC_FAILURE otherwise
+ */
+parsebgp_error_t
+parsebgp_bgp_community_filter_add_large(parsebgp_bgp_community_filter_t *filter,
+                                        uint32_t global_admin, uint32_t local_1,
+                                        uint32_t local_2);
+
+/**
+ * Add a large community Global Administrator (i.e., match GA:*:*) to the
+ * filter
+ *
+ * @param filter        Pointer to the filter to update
+ * @param global_admin  Global Administrator to match
+ * @return PARSEBGP_OK if the value was added, PARSEBGP_MALLOC_FAILURE otherwise
+ */
+parsebgp_error_t parsebgp_bgp_community_filter_add_large_asn(
+  parsebgp_bgp_community_filter_t *filter, uint32_t global_admin);
+
+/**
+ * Check if any community in a raw COMMUNITIES attribute matches the filter
+ *
+ * @param filter        Pointer to the filter to match against
+ * @param buf           Pointer to the raw attribute data (wire format)
+ * @param len           Length of the raw attribute data
+ * @return 1 if at least one community matches, 0 otherwise
+ */
+int parsebgp_bgp_community_filter_match_raw(
+  const parsebgp_bgp_community_filter_t *filter, const uint8_t *buf,
+  size_t len);
+
+/**
+ * Check if any large community in a raw LARGE_COMMUNITIES attribute matches
+ * the filter
+ *
+ * @param filter        Pointer to the filter to match against
+ * @param buf           Pointer to the raw attribute data (wire format)
+ * @param len           Length of the raw attribute data
+ * @return 1 if at least one large community matches, 0 otherwise
+ */
+int parsebgp_bgp_community_filter_match_large_raw(
+  const parsebgp_bgp_community_filter_t *filter, const uint8_t *buf,
+  size_t len);
+
+/**
+ * Check if any community or large community in the given Path Attributes
+ * matches the filter
+ *
+ * @param filter        Pointer to the filter to match against
+ * @param path_attrs    Pointer to the parsed Path Attributes
+ * @return 1 if at least one (large) community matches, 0 otherwise
+ *
+ * Raw-parsed attributes are matched over their raw data, otherwise the
+ * decoded arrays are used.
+ */
+int parsebgp_bgp_community_filter_match(
+  const parsebgp_bgp_community_filter_t *filter,
+  const parsebgp_bgp_update_path_attrs_t *path_attrs);
+
+/**
+ * Check if a raw COMMUNITIES attribute contains the given community
+ *
+ * @param buf           Pointer to the raw attribute data (wire format)
+ * @param len           Length of the raw attribute data
+ * @param community     Community value to search for
+ * @return 1 if the community is present, 0 otherwise
+ *
+ * This is a branch-free linear scan that compilers are able to vectorize, and
+ * is usually faster than building a filter when only a single value is of
+ * interest.
+ */
+int parsebgp_bgp_communities_raw_contains(const uint8_t *buf, size_t len,
+                                          uint32_t community);
+
+#endif /* __PARSEBGP_BGP_UPDATE_COMMUNITY_FILTER_H */
@@ -31,6 +31,124 @@
 #include <stdio.h>
 #include <string.h>
 
+#define EXT_COMM_LEN 8
+#define EXT_COMM_IPV6_LEN 20
+
+/** Copy the communities into the flat compact array without decoding them */
+static parsebgp_error_t
+decode_compact(parsebgp_opts_t *opts,
+               parsebgp_bgp_update_ext_communities_t *msg, const uint8_t *buf,
+               size_t *lenp, size_t remain, uint8_t size)
+{
+  size_t len = *lenp, nread = 0;
+
+  msg->communities_cnt = remain / size;
+  msg->compact_size = size;
+
+  PARSEBGP_MAYBE_REALLOC(msg->compact, msg->_compact_alloc_len, remain);
+  PARSEBGP_DESERIALIZE_BYTES(buf, len, nread, msg->compact, remain);
+
+  *lenp = nread;
+  return PARSEBGP_OK;
+}
+
+/** Expand an 8-byte wire-format community (length already checked) */
+static void expand_ext_community(parsebgp_bgp_update_ext_community_t *comm,
+                                 const uint8_t *c)
+{
+  memset(comm, 0, sizeof(*comm));
+  comm->type = parsebgp_bgp_update_ext_community_compact_type(c);
+
+  switch (comm->type) {
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_TWO_OCTET_AS:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_TWO_OCTET_AS:
+    comm->subtype = parsebgp_bgp_update_ext_community_compact_subtype(c);
+    comm->types.two_octet.global_admin =
+      parsebgp_bgp_update_ext_community_compact_two_octet_global(c);
+    comm->types.two_octet.local_admin =
+      parsebgp_bgp_update_ext_community_compact_two_octet_local(c);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV4:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV4:
+    comm->subtype = parsebgp_bgp_update_ext_community_compact_subtype(c);
+    comm->types.ip_addr.global_admin_ip_afi = PARSEBGP_BGP_AFI_IPV4;
+    memcpy(comm->types.ip_addr.global_admin_ip,
+           parsebgp_bgp_update_ext_community_compact_ip_addr(c), 4);
+    comm->types.ip_addr.local_admin =
+      parsebgp_bgp_update_ext_community_compact_ip_local(c, EXT_COMM_LEN);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_FOUR_OCTET_AS:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_FOUR_OCTET_AS:
+    comm->subtype = parsebgp_bgp_update_ext_community_compact_subtype(c);
+    comm->types.four_octet.global_admin =
+      parsebgp_bgp_update_ext_community_compact_four_octet_global(c);
+    comm->types.four_octet.local_admin =
+      parsebgp_bgp_update_ext_community_compact_four_octet_local(c);
+    break;
+
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_OPAQUE:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_OPAQUE:
+    comm->subtype = parsebgp_bgp_update_ext_community_compact_subtype(c);
+    memcpy(comm->types.opaque, c + 2, sizeof(comm->types.opaque));
+    break;
+
+  default:
+    memcpy(comm->types.unknown, c + 1, sizeof(comm->types.unknown));
+    break;
+  }
+}
+
+/** Expand a 20-byte wire-format IPv6 community (length already checked) */
+static void
+expand_ext_community_ipv6(parsebgp_bgp_update_ext_community_t *comm,
+                          const uint8_t *c)
+{
+  memset(comm, 0, sizeof(*comm));
+  comm->type = parsebgp_bgp_update_ext_community_compact_type(c);
+
+  switch (comm->type) {
+  case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV6:
+  case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV6:
+    comm->subtype = parsebgp_bgp_update_ext_community_compact_subtype(c);
+    comm->types.ip_addr.global_admin_ip_afi = PARSEBGP_BGP_AFI_IPV6;
+    memcpy(comm->types.ip_addr.global_admin_ip,
+           parsebgp_bgp_update_ext_community_compact_ip_addr(c), 16);
+    comm->types.ip_addr.local_admin =
+      parsebgp_bgp_update_ext_community_compact_ip_local(c, EXT_COMM_IPV6_LEN);
+    break;
+
+  default:
+    // unknown types are not parsed (see
+    // parsebgp_bgp_update_ext_communities_ipv6_decode)
+    break;
+  }
+}
+
+parsebgp_error_t parsebgp_bgp_update_ext_community_expand(
+  const parsebgp_bgp_update_ext_communities_t *msg, int idx,
+  parsebgp_bgp_update_ext_community_t *comm)
+{
+  const uint8_t *c;
+
+  if (idx < 0 || idx >= msg->communities_cnt) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  if (msg->compact_size == 0) {
+    *comm = msg->communities[idx];
+    return PARSEBGP_OK;
+  }
+
+  c = parsebgp_bgp_update_ext_community_compact_get(msg, idx);
+  if (msg->compact_size == EXT_COMM_IPV6_LEN) {
+    expand_ext_community_ipv6(comm, c);
+  } else {
+    expand_ext_community(comm, c);
+  }
+  return PARSEBGP_OK;
+}
+
 parsebgp_error_t parsebgp_bgp_update_ext_communities_decode(
   parsebgp_opts_t *opts, parsebgp_bgp_update_ext_communities_t *msg,
   const uint8_t *buf, size_t *lenp, size_t remain)
@@ -40,9 +158,14 @@ parsebgp_error_t parsebgp_bgp_update_ext_communities_decode(
   parsebgp_bgp_update_ext_community_t *comm;
 
   // sanity check on the length
-  PARSEBGP_ASSERT(remain % 8 == 0);
+  PARSEBGP_ASSERT(remain % EXT_COMM_LEN == 0);
 
-  msg->communities_cnt = remain / 8;
+  if (opts->bgp.ext_communities_compact) {
+    return decode_compact(opts, msg, buf, lenp, remain, EXT_COMM_LEN);
+  }
+  msg->compact_size = 0;
+
+  msg->communities_cnt = remain / EXT_COMM_LEN;
 
   PARSEBGP_MAYBE_REALLOC(msg->communities,
                          msg->_communities_alloc_cnt, msg->communities_cnt);
@@ -128,11 +251,35 @@ parsebgp_error_t parsebgp_bgp_update_ext_communities_ipv6_decode(
   size_t len = *lenp, nread = 0;
   int i;
   parsebgp_bgp_update_ext_community_t *comm;
+  parsebgp_error_t err;
+  uint8_t type;
+  const uint8_t *skip_buf = buf;
+  size_t skip_nread = 0;
 
   // sanity check on the length
-  PARSEBGP_ASSERT(remain % 20 == 0);
+  PARSEBGP_ASSERT(remain % EXT_COMM_IPV6_LEN == 0);
+
+  if (opts->bgp.ext_communities_compact) {
+    if ((err = decode_compact(opts, msg, buf, lenp, remain,
+                              EXT_COMM_IPV6_LEN)) != PARSEBGP_OK) {
+      return err;
+    }
+    // unknown types are still reported, as in the regular parser
+    for (i = 0; i < msg->communities_cnt; i++) {
+      type = msg->compact[i * EXT_COMM_IPV6_LEN];
+      if (type != PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV6 &&
+          type != PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV6) {
+        PARSEBGP_SKIP_NOT_IMPLEMENTED(opts, skip_buf, skip_nread, 0,
+                                      "Unknown IPv6 Extended Community Type "
+                                      "(%d)",
+                                      type);
+      }
+    }
+    return PARSEBGP_OK;
+  }
+  msg->compact_size = 0;
 
-  msg->communities_cnt = remain / 20;
+  msg->communities_cnt = remain / EXT_COMM_IPV6_LEN;
 
   PARSEBGP_MAYBE_REALLOC(msg->communities,
                          msg->_communities_alloc_cnt, msg->communities_cnt);
@@ -185,31 +332,47 @@ void parsebgp_bgp_update_ext_communities_destroy(
   }
   // currently no types have dynamic memory
 
-  free(msg->communities);
-  free(msg);
+  PARSEBGP_FREE(msg->communities);
+  PARSEBGP_FREE(msg->compact);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_update_ext_communities_clear(
   parsebgp_bgp_update_ext_communities_t *msg)
 {
   msg->communities_cnt = 0;
+  msg->compact_size = 0;
+}
+
+size_t parsebgp_bgp_update_ext_communities_memory_usage(
+  const parsebgp_bgp_update_ext_communities_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         sizeof(*msg->communities) * msg->_communities_alloc_cnt +
+         msg->_compact_alloc_len;
 }
 
-static void dump_ext_community(const parsebgp_bgp_update_ext_community_t *comm,
+static void dump_ext_community(parsebgp_sink_t *sink,
+                               const parsebgp_bgp_update_ext_community_t *comm,
                                int depth)
 {
-  PARSEBGP_DUMP_INT(depth, "Type", comm->type);
-  PARSEBGP_DUMP_INT(depth, "Subtype", comm->subtype);
+  PARSEBGP_DUMP_INT(sink, depth, "Type", comm->type);
+  PARSEBGP_DUMP_INT(sink, depth, "Subtype", comm->subtype);
 
   depth++;
   switch (comm->type) {
   case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_TWO_OCTET_AS:
   case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_TWO_OCTET_AS:
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_ext_community_two_octet_t,
+    PARSEBGP_DUMP_STRUCT_HDR(sink,
+                             parsebgp_bgp_update_ext_community_two_octet_t,
                              depth);
-    PARSEBGP_DUMP_INT(depth, "Global Admin",
+    PARSEBGP_DUMP_INT(sink, depth, "Global Admin",
                       comm->types.two_octet.global_admin);
-    PARSEBGP_DUMP_INT(depth, "Local Admin", comm->types.two_octet.local_admin);
+    PARSEBGP_DUMP_INT(sink, depth, "Local Admin",
+                      comm->types.two_octet.local_admin);
     break;
 
   case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV4:
@@ -218,48 +381,58 @@ static void dump_ext_community(const parsebgp_bgp_update_ext_community_t *comm,
     // case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_IPV6:
     // case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_IPV6:
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_ext_community_ip_addr_t,
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_ext_community_ip_addr_t,
                              depth);
-    PARSEBGP_DUMP_INT(depth, "Global Admin IP AFI",
+    PARSEBGP_DUMP_INT(sink, depth, "Global Admin IP AFI",
                       comm->types.ip_addr.global_admin_ip_afi);
-    PARSEBGP_DUMP_IP(depth, "Global Admin IP",
+    PARSEBGP_DUMP_IP(sink, depth, "Global Admin IP",
                      comm->types.ip_addr.global_admin_ip_afi,
                      comm->types.ip_addr.global_admin_ip);
-    PARSEBGP_DUMP_INT(depth, "Local Admin", comm->types.ip_addr.local_admin);
+    PARSEBGP_DUMP_INT(sink, depth, "Local Admin",
+                      comm->types.ip_addr.local_admin);
     break;
 
   case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_FOUR_OCTET_AS:
   case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_FOUR_OCTET_AS:
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_ext_community_four_octet_t,
+    PARSEBGP_DUMP_STRUCT_HDR(sink,
+                             parsebgp_bgp_update_ext_community_four_octet_t,
                              depth);
-    PARSEBGP_DUMP_INT(depth, "Global Admin",
+    PARSEBGP_DUMP_INT(sink, depth, "Global Admin",
                       comm->types.four_octet.global_admin);
-    PARSEBGP_DUMP_INT(depth, "Local Admin", comm->types.four_octet.local_admin);
+    PARSEBGP_DUMP_INT(sink, depth, "Local Admin",
+                      comm->types.four_octet.local_admin);
     break;
 
   case PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_OPAQUE:
   case PARSEBGP_BGP_EXT_COMM_TYPE_NONTRANS_OPAQUE:
-    PARSEBGP_DUMP_DATA(depth, "Opaque Data", comm->types.opaque,
+    PARSEBGP_DUMP_DATA(sink, depth, "Opaque Data", comm->types.opaque,
                        sizeof(comm->types.opaque));
     break;
 
   default:
-    PARSEBGP_DUMP_INFO(depth, "Unknown Type\n");
-    PARSEBGP_DUMP_DATA(depth, "Data", comm->types.unknown,
+    PARSEBGP_DUMP_INFO(sink, depth, "Unknown Type\n");
+    PARSEBGP_DUMP_DATA(sink, depth, "Data", comm->types.unknown,
                        sizeof(comm->types.unknown));
     break;
   }
 }
 
 void parsebgp_bgp_update_ext_communities_dump(
-  const parsebgp_bgp_update_ext_communities_t *msg, int depth)
+  parsebgp_sink_t *sink, const parsebgp_bgp_update_ext_communities_t *msg,
+  int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_ext_communities_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_ext_communities_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Communities Count", msg->communities_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "Communities Count", msg->communities_cnt);
 
   int i;
+  parsebgp_bgp_update_ext_community_t comm;
   for (i = 0; i < msg->communities_cnt; i++) {
-    dump_ext_community(&msg->communities[i], depth + 1);
+    if (msg->compact_size == 0) {
+      dump_ext_community(sink, &msg->communities[i], depth + 1);
+    } else {
+      parsebgp_bgp_update_ext_community_expand(msg, i, &comm);
+      dump_ext_community(sink, &comm, depth + 1);
+    }
   }
 }
@@ -28,6 +28,7 @@
 #define __PARSEBGP_BGP_UPDATE_EXT_COMMUNITIES_H
 
 #include "parsebgp_bgp_common.h"
+#include "parsebgp_error.h"
 #include <inttypes.h>
 
 /**
@@ -181,7 +182,8 @@ typedef struct parsebgp_bgp_update_ext_community {
  */
 typedef struct parsebgp_bgp_update_ext_communities {
 
-  /** Array of (communities_cnt) EXTENDED COMMUNITIES */
+  /** Array of (communities_cnt) EXTENDED COMMUNITIES (not populated if the
+      bgp.ext_communities_compact option is set) */
   parsebgp_bgp_update_ext_community_t *communities;
 
   /** Number of allocated communities (INTERNAL) */
@@ -190,6 +192,113 @@ typedef struct parsebgp_bgp_update_ext_communities {
   /** (Inferred) number of communities */
   int communities_cnt;
 
+  /** Flat array of (communities_cnt) wire-format communities, each
+      compact_size bytes long (only populated if the
+      bgp.ext_communities_compact option is set) */
+  uint8_t *compact;
+
+  /** Allocated length of the compact array (INTERNAL) */
+  int _compact_alloc_len;
+
+  /** Size of each community in the compact array (8, or 20 for IPv6 Extended
+      Communities), or 0 if the communities are not stored in compact form */
+  uint8_t compact_size;
+
 } parsebgp_bgp_update_ext_communities_t;
 
+/**
+ * Get a pointer to a compact Extended Community
+ *
+ * @param msg           Pointer to the Extended Communities structure
+ * @param idx           Index of the community (< communities_cnt)
+ * @return pointer to the wire-format community
+ *
+ * Only valid if msg->compact_size is non-zero.
+ */
+static inline const uint8_t *parsebgp_bgp_update_ext_community_compact_get(
+  const parsebgp_bgp_update_ext_communities_t *msg, int idx)
+{
+  return msg->compact + (idx * msg->compact_size);
+}
+
+/** Get the Type of a compact Extended Community */
+static inline uint8_t
+parsebgp_bgp_update_ext_community_compact_type(const uint8_t *comm)
+{
+  return comm[0];
+}
+
+/** Get the Sub-Type of a compact Extended Community (only meaningful for the
+    types that have a sub-type) */
+static inline uint8_t
+parsebgp_bgp_update_ext_community_compact_subtype(const uint8_t *comm)
+{
+  return comm[1];
+}
+
+/** Get the Global Administrator of a compact Two-Octet AS-Specific Extended
+    Community */
+static inline uint16_t
+parsebgp_bgp_update_ext_community_compact_two_octet_global(const uint8_t *comm)
+{
+  return (uint16_t)((comm[2] << 8) | comm[3]);
+}
+
+/** Get the Local Administrator of a compact Two-Octet AS-Specific Extended
+    Community */
+static inline uint32_t
+parsebgp_bgp_update_ext_community_compact_two_octet_local(const uint8_t *comm)
+{
+  return ((uint32_t)comm[4] << 24) | ((uint32_t)comm[5] << 16) |
+         ((uint32_t)comm[6] << 8) | comm[7];
+}
+
+/** Get the Global Administrator of a compact Four-Octet AS-Specific Extended
+    Community */
+static inline uint32_t
+parsebgp_bgp_update_ext_community_compact_four_octet_global(const uint8_t *comm)
+{
+  return ((uint32_t)comm[2] << 24) | ((uint32_t)comm[3] << 16) |
+         ((uint32_t)comm[4] << 8) | comm[5];
+}
+
+/** Get the Local Administrator of a compact Four-Octet AS-Specific Extended
+    Community */
+static inline uint16_t
+parsebgp_bgp_update_ext_community_compact_four_octet_local(const uint8_t *comm)
+{
+  return (uint16_t)((comm[6] << 8) | comm[7]);
+}
+
+/** Get a pointer to the Global Administrator IP Address (4 bytes, or 16 if
+    compact_size is 20) of a compact IP Address Specific Extended Community */
+static inline const uint8_t *
+parsebgp_bgp_update_ext_community_compact_ip_addr(const uint8_t *comm)
+{
+  return comm + 2;
+}
+
+/** Get the Local Administrator of a compact IP Address Specific Extended
+    Community */
+static inline uint16_t parsebgp_bgp_update_ext_community_compact_ip_local(
+  const uint8_t *comm, uint8_t compact_size)
+{
+  return (uint16_t)((comm[compact_size - 2] << 8) | comm[compact_size - 1]);
+}
+
+/**
+ * Expand a single community into a full Extended Community structure
+ *
+ * @param msg           Pointer to the Extended Communities structure
+ * @param idx           Index of the community (< communities_cnt)
+ * @param [out] comm    Pointer to the structure to fill
+ * @return PARSEBGP_OK, or PARSEBGP_INVALID_MSG if idx is out of range
+ *
+ * This works regardless of whether the communities are stored in compact form
+ * or not.
+ */
+parsebgp_error_t parsebgp_bgp_update_ext_community_expand(
+  const parsebgp_bgp_update_ext_communities_t *msg, int idx,
+  parsebgp_bgp_update_ext_community_t *comm);
+
 #endif /* __PARSEBGP_BGP_UPDATE_EXT_COMMUNITIES_H */
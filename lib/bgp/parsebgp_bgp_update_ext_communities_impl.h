@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_update_ext_communities.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode an EXTENDED COMMUNITIES message */
@@ -43,8 +44,9 @@ parsebgp_error_t parsebgp_bgp_update_ext_communities_ipv6_decode(
   const uint8_t *buf, size_t *lenp, size_t remain);
 
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed MP_REACH attribute to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -54,7 +56,8 @@ parsebgp_error_t parsebgp_bgp_update_ext_communities_ipv6_decode(
  * to get a sense of their data.
  */
 void parsebgp_bgp_update_ext_communities_dump(
-  const parsebgp_bgp_update_ext_communities_t *msg, int depth);
+  parsebgp_sink_t *sink, const parsebgp_bgp_update_ext_communities_t *msg,
+  int depth);
 
 /** Destroy an EXTENDED COMMUNITIES message */
 void parsebgp_bgp_update_ext_communities_destroy(
@@ -64,4 +67,8 @@ void parsebgp_bgp_update_ext_communities_destroy(
 void parsebgp_bgp_update_ext_communities_clear(
   parsebgp_bgp_update_ext_communities_t *msg);
 
+/** Get the number of bytes allocated for an EXTENDED COMMUNITIES message */
+size_t parsebgp_bgp_update_ext_communities_memory_usage(
+  const parsebgp_bgp_update_ext_communities_t *msg);
+
 #endif /* __PARSEBGP_BGP_UPDATE_EXT_COMMUNITIES_IMPL_H */
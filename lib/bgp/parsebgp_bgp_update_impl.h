@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_update.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode an UPDATE message */
@@ -44,9 +45,13 @@ void parsebgp_bgp_update_destroy(parsebgp_bgp_update_t *msg);
 /** Clear an UPDATE message */
 void parsebgp_bgp_update_clear(parsebgp_bgp_update_t *msg);
 
+/** Get the number of bytes allocated for an UPDATE message */
+size_t parsebgp_bgp_update_memory_usage(const parsebgp_bgp_update_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed UPDATE message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -55,7 +60,8 @@ void parsebgp_bgp_update_clear(parsebgp_bgp_update_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bgp_update_dump(const parsebgp_bgp_update_t *msg, int depth);
+void parsebgp_bgp_update_dump(parsebgp_sink_t *sink,
+                              const parsebgp_bgp_update_t *msg, int depth);
 
 /** Decode PATH ATTRIBUTES */
 parsebgp_error_t parsebgp_bgp_update_path_attrs_decode(
@@ -70,9 +76,15 @@ void parsebgp_bgp_update_path_attrs_destroy(
 void parsebgp_bgp_update_path_attrs_clear(
   parsebgp_bgp_update_path_attrs_t *msg);
 
+/** Get the number of bytes allocated for the attributes of a Path Attributes
+    message (not including the structure itself) */
+size_t parsebgp_bgp_update_path_attrs_memory_usage(
+  const parsebgp_bgp_update_path_attrs_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed Path Attrs message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -82,6 +94,7 @@ void parsebgp_bgp_update_path_attrs_clear(
  * to get a sense of their data.
  */
 void parsebgp_bgp_update_path_attrs_dump(
-    const parsebgp_bgp_update_path_attrs_t *msg, int depth);
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_path_attrs_t *msg,
+    int depth);
 
 #endif /* __PARSEBGP_BGP_UPDATE_IMPL_H */
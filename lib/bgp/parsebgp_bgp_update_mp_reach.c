@@ -112,8 +112,9 @@ static parsebgp_error_t parse_afi_ipv4_ipv6_nlri(
 }
 
 static parsebgp_error_t
-parse_next_hop_afi_ipv4_ipv6(parsebgp_bgp_update_mp_reach_t *msg, const uint8_t *buf,
-                             size_t *lenp, size_t remain)
+parse_next_hop_afi_ipv4_ipv6(parsebgp_opts_t *opts,
+                             parsebgp_bgp_update_mp_reach_t *msg,
+                             const uint8_t *buf, size_t *lenp, size_t remain)
 {
   size_t nread = 0;
   // size of the link-local address (zero if there isn't one)
@@ -126,9 +127,9 @@ parse_next_hop_afi_ipv4_ipv6(parsebgp_bgp_update_mp_reach_t *msg, const uint8_t
   if ((msg->afi == PARSEBGP_BGP_AFI_IPV4 && msg->next_hop_len != 4) ||
       (msg->afi == PARSEBGP_BGP_AFI_IPV6 &&
        (msg->next_hop_len != 16 && msg->next_hop_len != 32))) {
-    fprintf(stderr,
-            "ERROR: Unexpected Next-Hop length of %d for AFI %" PRIu16 "\n",
-            msg->next_hop_len, msg->afi);
+    PARSEBGP_DIAG(opts, PARSEBGP_DIAG_INVALID_MSG, 1, 0, buf,
+                  "Unexpected Next-Hop length of %d for AFI %" PRIu16,
+                  msg->next_hop_len, msg->afi);
     PARSEBGP_RETURN_INVALID_MSG_ERR;
   }
 
@@ -178,8 +179,8 @@ parse_reach_afi_ipv4_ipv6(parsebgp_opts_t *opts,
   case PARSEBGP_BGP_SAFI_UNICAST:
   case PARSEBGP_BGP_SAFI_MULTICAST:
     slen = len - nread;
-    if ((err = parse_next_hop_afi_ipv4_ipv6(msg, buf, &slen, remain - nread)) !=
-        PARSEBGP_OK) {
+    if ((err = parse_next_hop_afi_ipv4_ipv6(opts, msg, buf, &slen,
+                                            remain - nread)) != PARSEBGP_OK) {
       return err;
     }
     nread += slen;
@@ -199,6 +200,10 @@ parse_reach_afi_ipv4_ipv6(parsebgp_opts_t *opts,
            &msg->nlris_cnt, buf, &slen, remain - nread)) != PARSEBGP_OK) {
       return err;
     }
+    PARSEBGP_STATS_ADD(opts,
+                       nlris_announced[PARSEBGP_STATS_AFI_IDX(msg->afi)]
+                                      [PARSEBGP_STATS_SAFI_IDX(msg->safi)],
+                       msg->nlris_cnt);
     nread += slen;
     buf += slen;
     break;
@@ -234,6 +239,10 @@ parse_unreach_afi_ipv4_ipv6(parsebgp_opts_t *opts,
            &slen, remain - nread)) != PARSEBGP_OK) {
       return err;
     }
+    PARSEBGP_STATS_ADD(opts,
+                       nlris_withdrawn[PARSEBGP_STATS_AFI_IDX(msg->afi)]
+                                      [PARSEBGP_STATS_SAFI_IDX(msg->safi)],
+                       msg->withdrawn_nlris_cnt);
     nread += slen;
     buf += slen;
     break;
@@ -312,8 +321,8 @@ void parsebgp_bgp_update_mp_reach_destroy(parsebgp_bgp_update_mp_reach_t *msg)
     return;
   }
 
-  free(msg->nlris);
-  free(msg);
+  PARSEBGP_FREE(msg->nlris);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_update_mp_reach_clear(parsebgp_bgp_update_mp_reach_t *msg)
@@ -321,38 +330,49 @@ void parsebgp_bgp_update_mp_reach_clear(parsebgp_bgp_update_mp_reach_t *msg)
   msg->nlris_cnt = 0;
 }
 
+size_t parsebgp_bgp_update_mp_reach_memory_usage(
+  const parsebgp_bgp_update_mp_reach_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + sizeof(*msg->nlris) * msg->_nlris_alloc_cnt;
+}
+
 void parsebgp_bgp_update_mp_reach_dump(
-    const parsebgp_bgp_update_mp_reach_t *msg, int depth)
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_mp_reach_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_mp_reach_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_mp_reach_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "AFI", msg->afi);
-  PARSEBGP_DUMP_INT(depth, "SAFI", msg->safi);
-  PARSEBGP_DUMP_INT(depth, "Next Hop Length", msg->next_hop_len);
+  PARSEBGP_DUMP_INT(sink, depth, "AFI", msg->afi);
+  PARSEBGP_DUMP_INT(sink, depth, "SAFI", msg->safi);
+  PARSEBGP_DUMP_INT(sink, depth, "Next Hop Length", msg->next_hop_len);
 
   if (msg->safi != PARSEBGP_BGP_SAFI_UNICAST &&
       msg->safi != PARSEBGP_BGP_SAFI_MULTICAST) {
-    PARSEBGP_DUMP_INFO(depth, "MP_REACH SAFI %d Not Supported\n", msg->safi);
+    PARSEBGP_DUMP_INFO(sink, depth, "MP_REACH SAFI %d Not Supported\n",
+                       msg->safi);
     return;
   }
 
   switch (msg->afi) {
   case PARSEBGP_BGP_AFI_IPV4:
   case PARSEBGP_BGP_AFI_IPV6:
-    PARSEBGP_DUMP_IP(depth, "Next Hop", msg->afi, msg->next_hop);
+    PARSEBGP_DUMP_IP(sink, depth, "Next Hop", msg->afi, msg->next_hop);
     if (msg->afi == PARSEBGP_BGP_AFI_IPV6 && msg->next_hop_len == 32) {
-      PARSEBGP_DUMP_IP(depth, "Next Hop Link-Local", msg->afi,
+      PARSEBGP_DUMP_IP(sink, depth, "Next Hop Link-Local", msg->afi,
                        msg->next_hop_ll);
     }
 
-    PARSEBGP_DUMP_INT(depth, "Reserved", msg->reserved);
-    PARSEBGP_DUMP_INT(depth, "NLRIs Count", msg->nlris_cnt);
+    PARSEBGP_DUMP_INT(sink, depth, "Reserved", msg->reserved);
+    PARSEBGP_DUMP_INT(sink, depth, "NLRIs Count", msg->nlris_cnt);
 
-    parsebgp_bgp_prefixes_dump(msg->nlris, msg->nlris_cnt, depth + 1);
+    parsebgp_bgp_prefixes_dump(sink, msg->nlris, msg->nlris_cnt, depth + 1);
     break;
 
   default:
-    PARSEBGP_DUMP_INFO(depth, "MP_REACH AFI %d Not Supported\n", msg->afi);
+    PARSEBGP_DUMP_INFO(sink, depth, "MP_REACH AFI %d Not Supported\n",
+                       msg->afi);
     break;
   }
 }
@@ -400,8 +420,8 @@ void parsebgp_bgp_update_mp_unreach_destroy(
   if (msg == NULL) {
     return;
   }
-  free(msg->withdrawn_nlris);
-  free(msg);
+  PARSEBGP_FREE(msg->withdrawn_nlris);
+  PARSEBGP_FREE(msg);
 }
 
 void parsebgp_bgp_update_mp_unreach_clear(parsebgp_bgp_update_mp_unreach_t *msg)
@@ -409,31 +429,45 @@ void parsebgp_bgp_update_mp_unreach_clear(parsebgp_bgp_update_mp_unreach_t *msg)
   msg->withdrawn_nlris_cnt = 0;
 }
 
+size_t parsebgp_bgp_update_mp_unreach_memory_usage(
+  const parsebgp_bgp_update_mp_unreach_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         sizeof(*msg->withdrawn_nlris) * msg->_withdrawn_nlris_alloc_cnt;
+}
+
 void parsebgp_bgp_update_mp_unreach_dump(
-    const parsebgp_bgp_update_mp_unreach_t *msg, int depth)
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_mp_unreach_t *msg,
+    int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bgp_update_mp_unreach_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bgp_update_mp_unreach_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "AFI", msg->afi);
-  PARSEBGP_DUMP_INT(depth, "SAFI", msg->safi);
+  PARSEBGP_DUMP_INT(sink, depth, "AFI", msg->afi);
+  PARSEBGP_DUMP_INT(sink, depth, "SAFI", msg->safi);
 
   if (msg->safi != PARSEBGP_BGP_SAFI_UNICAST &&
       msg->safi != PARSEBGP_BGP_SAFI_MULTICAST) {
-    PARSEBGP_DUMP_INFO(depth, "MP_UNREACH SAFI %d Not Supported\n", msg->safi);
+    PARSEBGP_DUMP_INFO(sink, depth, "MP_UNREACH SAFI %d Not Supported\n",
+                       msg->safi);
     return;
   }
 
   switch (msg->afi) {
   case PARSEBGP_BGP_AFI_IPV4:
   case PARSEBGP_BGP_AFI_IPV6:
-    PARSEBGP_DUMP_INT(depth, "Withdrawn NLRIs Count", msg->withdrawn_nlris_cnt);
+    PARSEBGP_DUMP_INT(sink, depth, "Withdrawn NLRIs Count",
+                      msg->withdrawn_nlris_cnt);
 
-    parsebgp_bgp_prefixes_dump(msg->withdrawn_nlris, msg->withdrawn_nlris_cnt,
-                               depth + 1);
+    parsebgp_bgp_prefixes_dump(sink, msg->withdrawn_nlris,
+                               msg->withdrawn_nlris_cnt, depth + 1);
     break;
 
   default:
-    PARSEBGP_DUMP_INFO(depth, "MP_UNREACH AFI %d Not Supported\n", msg->afi);
+    PARSEBGP_DUMP_INFO(sink, depth, "MP_UNREACH AFI %d Not Supported\n",
+                       msg->afi);
     break;
   }
 }
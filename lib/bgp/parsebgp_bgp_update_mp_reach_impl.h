@@ -30,6 +30,7 @@
 #include "parsebgp_bgp_update_mp_reach.h"
 #include "parsebgp_error.h"
 #include "parsebgp_opts.h"
+#include "parsebgp_sink.h"
 #include <stddef.h>
 
 /** Decode an MP_REACH message */
@@ -44,9 +45,14 @@ void parsebgp_bgp_update_mp_reach_destroy(parsebgp_bgp_update_mp_reach_t *msg);
 /** Clear an MP_REACH message */
 void parsebgp_bgp_update_mp_reach_clear(parsebgp_bgp_update_mp_reach_t *msg);
 
+/** Get the number of bytes allocated for an MP_REACH message */
+size_t parsebgp_bgp_update_mp_reach_memory_usage(
+  const parsebgp_bgp_update_mp_reach_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed MP_REACH attribute to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -56,7 +62,8 @@ void parsebgp_bgp_update_mp_reach_clear(parsebgp_bgp_update_mp_reach_t *msg);
  * to get a sense of their data.
  */
 void parsebgp_bgp_update_mp_reach_dump(
-    const parsebgp_bgp_update_mp_reach_t *msg, int depth);
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_mp_reach_t *msg,
+    int depth);
 
 /** Decode an MP_UNREACH message */
 parsebgp_error_t parsebgp_bgp_update_mp_unreach_decode(
@@ -71,9 +78,14 @@ void parsebgp_bgp_update_mp_unreach_destroy(
 void parsebgp_bgp_update_mp_unreach_clear(
   parsebgp_bgp_update_mp_unreach_t *msg);
 
+/** Get the number of bytes allocated for an MP_UNREACH message */
+size_t parsebgp_bgp_update_mp_unreach_memory_usage(
+  const parsebgp_bgp_update_mp_unreach_t *msg);
+
 /**
- * Dump a human-readable version of the message to stdout
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed MP_UNREACH attribute to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -83,6 +95,7 @@ void parsebgp_bgp_update_mp_unreach_clear(
  * to get a sense of their data.
  */
 void parsebgp_bgp_update_mp_unreach_dump(
-    const parsebgp_bgp_update_mp_unreach_t *msg, int depth);
+    parsebgp_sink_t *sink, const parsebgp_bgp_update_mp_unreach_t *msg,
+    int depth);
 
 #endif /* __PARSEBGP_BGP_UPDATE_MP_REACH_IMPL_H */
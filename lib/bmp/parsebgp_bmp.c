@@ -84,14 +84,26 @@ static void destroy_info_tlvs(parsebgp_bmp_info_tlv_t **tlvs,
   }
 
   for (i = 0; i < *tlvs_alloc_cnt; i++) {
-    free((*tlvs)[i].info);
+    PARSEBGP_FREE((*tlvs)[i].info);
     (*tlvs)[i].info = NULL;
   }
-  free(*tlvs);
+  PARSEBGP_FREE(*tlvs);
   *tlvs = NULL;
   *tlvs_alloc_cnt = 0;
 }
 
+static size_t info_tlvs_memory_usage(const parsebgp_bmp_info_tlv_t *tlvs,
+                                     int tlvs_alloc_cnt)
+{
+  size_t usage = sizeof(*tlvs) * tlvs_alloc_cnt;
+  int i;
+
+  for (i = 0; i < tlvs_alloc_cnt; i++) {
+    usage += tlvs[i]._info_alloc_len;
+  }
+  return usage;
+}
+
 static void clear_info_tlvs(parsebgp_bmp_info_tlv_t **tlvs, int *tlvs_cnt)
 {
   int i;
@@ -105,7 +117,8 @@ static void clear_info_tlvs(parsebgp_bmp_info_tlv_t **tlvs, int *tlvs_cnt)
   *tlvs_cnt = 0;
 }
 
-static void dump_info_tlvs(const parsebgp_bmp_info_tlv_t *tlvs, int tlvs_cnt,
+static void dump_info_tlvs(parsebgp_sink_t *sink,
+                           const parsebgp_bmp_info_tlv_t *tlvs, int tlvs_cnt,
                            int depth)
 {
   int i;
@@ -113,11 +126,11 @@ static void dump_info_tlvs(const parsebgp_bmp_info_tlv_t *tlvs, int tlvs_cnt,
 
   for (i = 0; i < tlvs_cnt; i++) {
     tlv = &tlvs[i];
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_info_tlv_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_info_tlv_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", tlv->type);
-    PARSEBGP_DUMP_INT(depth, "Length", tlv->len);
-    PARSEBGP_DUMP_INFO(depth, "Value: '%.*s'\n", tlv->len, tlv->info);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", tlv->type);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", tlv->len);
+    PARSEBGP_DUMP_INFO(sink, depth, "Value: '%.*s'\n", tlv->len, tlv->info);
   }
 }
 
@@ -219,8 +232,16 @@ static void destroy_stats_report(parsebgp_bmp_stats_report_t *msg)
   if (msg == NULL) {
     return;
   }
-  free(msg->counters);
-  free(msg);
+  PARSEBGP_FREE(msg->counters);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t stats_report_memory_usage(const parsebgp_bmp_stats_report_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + sizeof(*msg->counters) * msg->_counters_alloc_cnt;
 }
 
 static void clear_stats_report(parsebgp_bmp_stats_report_t *msg)
@@ -231,21 +252,22 @@ static void clear_stats_report(parsebgp_bmp_stats_report_t *msg)
   msg->stats_count = 0;
 }
 
-static void dump_stats_report(const parsebgp_bmp_stats_report_t *msg, int depth)
+static void dump_stats_report(parsebgp_sink_t *sink,
+                              const parsebgp_bmp_stats_report_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_stats_report_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_stats_report_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Stats Count", msg->stats_count);
+  PARSEBGP_DUMP_INT(sink, depth, "Stats Count", msg->stats_count);
 
   depth++;
   parsebgp_bmp_stats_counter_t *sc;
   for (uint32_t i = 0; i < msg->stats_count; i++) {
     sc = &msg->counters[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_stats_counter_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_stats_counter_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", sc->type);
-    PARSEBGP_DUMP_INT(depth, "Length", sc->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", sc->type);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", sc->len);
 
     switch (sc->type) {
     // 32-bit counter types:
@@ -259,33 +281,34 @@ static void dump_stats_report(const parsebgp_bmp_stats_report_t *msg, int depth)
     case PARSEBGP_BMP_STATS_UPD_TREAT_AS_WITHDRAW:
     case PARSEBGP_BMP_STATS_PREFIX_TREAT_AS_WITHDRAW:
     case PARSEBGP_BMP_STATS_DUP_UPD:
-      PARSEBGP_DUMP_INT(depth, "u32", sc->data.counter_u32);
+      PARSEBGP_DUMP_INT(sink, depth, "u32", sc->data.counter_u32);
       break;
 
     // 64-bit gauge types:
     case PARSEBGP_BMP_STATS_ROUTES_ADJ_RIB_IN:
     case PARSEBGP_BMP_STATS_ROUTES_LOC_RIB:
-      PARSEBGP_DUMP_VAL(depth, "u64", PRIu64, sc->data.gauge_u64);
+      PARSEBGP_DUMP_VAL(sink, depth, "u64", PRIu64, sc->data.gauge_u64);
       break;
 
     // AFI/SAFI 64-bit gauge types:
     case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_ADJ_RIB_IN:
     case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_LOC_RIB:
       // AFI
-      PARSEBGP_DUMP_INT(depth, "AFI", sc->data.afi_safi_gauge.afi);
+      PARSEBGP_DUMP_INT(sink, depth, "AFI", sc->data.afi_safi_gauge.afi);
 
       // SAFI
-      PARSEBGP_DUMP_INT(depth, "SAFI", sc->data.afi_safi_gauge.safi);
+      PARSEBGP_DUMP_INT(sink, depth, "SAFI", sc->data.afi_safi_gauge.safi);
 
       // u64 gauge
-      PARSEBGP_DUMP_VAL(depth, "u64", PRIu64, sc->data.afi_safi_gauge.gauge_u64);
+      PARSEBGP_DUMP_VAL(sink, depth, "u64", PRIu64,
+                        sc->data.afi_safi_gauge.gauge_u64);
       break;
 
     default:
       if (sc->len == 4) {
-        PARSEBGP_DUMP_INT(depth, "u32", sc->data.counter_u32);
+        PARSEBGP_DUMP_INT(sink, depth, "u32", sc->data.counter_u32);
       } else if (sc->len == 8) {
-        PARSEBGP_DUMP_VAL(depth, "u64", PRIu64, sc->data.gauge_u64);
+        PARSEBGP_DUMP_VAL(sink, depth, "u64", PRIu64, sc->data.gauge_u64);
       }
     }
   }
@@ -343,7 +366,15 @@ static void destroy_peer_down(parsebgp_bmp_peer_down_t *msg)
     return;
   }
   parsebgp_bgp_destroy_msg(msg->data.notification);
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t peer_down_memory_usage(const parsebgp_bmp_peer_down_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + parsebgp_bgp_msg_memory_usage(msg->data.notification);
 }
 
 static void clear_peer_down(parsebgp_bmp_peer_down_t *msg)
@@ -362,22 +393,23 @@ static void clear_peer_down(parsebgp_bmp_peer_down_t *msg)
   }
 }
 
-static void dump_peer_down(const parsebgp_bmp_peer_down_t *msg, int depth)
+static void dump_peer_down(parsebgp_sink_t *sink,
+                           const parsebgp_bmp_peer_down_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_peer_down_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_peer_down_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Reason", msg->reason);
+  PARSEBGP_DUMP_INT(sink, depth, "Reason", msg->reason);
 
   depth++;
   switch (msg->reason) {
   // Reasons with a BGP NOTIFICATION message
   case PARSEBGP_BMP_PEER_DOWN_LOCAL_CLOSE_WITH_NOTIF:
   case PARSEBGP_BMP_PEER_DOWN_REMOTE_CLOSE_WITH_NOTIF:
-    parsebgp_bgp_dump_msg(msg->data.notification, depth);
+    parsebgp_bgp_dump_msg(sink, msg->data.notification, depth);
     break;
 
   case PARSEBGP_BMP_PEER_DOWN_LOCAL_CLOSE:
-    PARSEBGP_DUMP_INT(depth, "FSM Code", msg->data.fsm_code);
+    PARSEBGP_DUMP_INT(sink, depth, "FSM Code", msg->data.fsm_code);
     break;
 
   default:
@@ -455,7 +487,17 @@ static void destroy_peer_up(parsebgp_bmp_peer_up_t *msg)
   parsebgp_bgp_destroy_msg(msg->sent_open);
   parsebgp_bgp_destroy_msg(msg->recv_open);
   destroy_info_tlvs(&msg->tlvs, &msg->_tlvs_alloc_cnt);
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t peer_up_memory_usage(const parsebgp_bmp_peer_up_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + parsebgp_bgp_msg_memory_usage(msg->sent_open) +
+         parsebgp_bgp_msg_memory_usage(msg->recv_open) +
+         info_tlvs_memory_usage(msg->tlvs, msg->_tlvs_alloc_cnt);
 }
 
 static void clear_peer_up(parsebgp_bmp_peer_up_t *msg)
@@ -465,24 +507,25 @@ static void clear_peer_up(parsebgp_bmp_peer_up_t *msg)
   clear_info_tlvs(&msg->tlvs, &msg->tlvs_cnt);
 }
 
-static void dump_peer_up(const parsebgp_bmp_peer_up_t *msg, int depth)
+static void dump_peer_up(parsebgp_sink_t *sink,
+                         const parsebgp_bmp_peer_up_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_peer_up_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_peer_up_t, depth);
 
-  PARSEBGP_DUMP_IP(depth, "Local IP", msg->local_ip_afi, msg->local_ip);
-  PARSEBGP_DUMP_INT(depth, "Local Port", msg->local_port);
-  PARSEBGP_DUMP_INT(depth, "Remote Port", msg->remote_port);
+  PARSEBGP_DUMP_IP(sink, depth, "Local IP", msg->local_ip_afi, msg->local_ip);
+  PARSEBGP_DUMP_INT(sink, depth, "Local Port", msg->local_port);
+  PARSEBGP_DUMP_INT(sink, depth, "Remote Port", msg->remote_port);
 
-  PARSEBGP_DUMP_INFO(depth, "Sent OPEN:\n");
-  parsebgp_bgp_dump_msg(msg->sent_open, depth + 1);
+  PARSEBGP_DUMP_INFO(sink, depth, "Sent OPEN:\n");
+  parsebgp_bgp_dump_msg(sink, msg->sent_open, depth + 1);
 
-  PARSEBGP_DUMP_INFO(depth, "Received OPEN:\n");
-  parsebgp_bgp_dump_msg(msg->recv_open, depth + 1);
+  PARSEBGP_DUMP_INFO(sink, depth, "Received OPEN:\n");
+  parsebgp_bgp_dump_msg(sink, msg->recv_open, depth + 1);
 
-  PARSEBGP_DUMP_INT(depth, "TLVs Count", msg->tlvs_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "TLVs Count", msg->tlvs_cnt);
 
   if (msg->tlvs_cnt > 0) {
-    dump_info_tlvs(msg->tlvs, msg->tlvs_cnt, depth + 1);
+    dump_info_tlvs(sink, msg->tlvs, msg->tlvs_cnt, depth + 1);
   }
 }
 
@@ -501,7 +544,15 @@ static void destroy_init_msg(parsebgp_bmp_init_msg_t *msg)
     return;
   }
   destroy_info_tlvs(&msg->tlvs, &msg->_tlvs_alloc_cnt);
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t init_msg_memory_usage(const parsebgp_bmp_init_msg_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + info_tlvs_memory_usage(msg->tlvs, msg->_tlvs_alloc_cnt);
 }
 
 static void clear_init_msg(parsebgp_bmp_init_msg_t *msg)
@@ -509,12 +560,13 @@ static void clear_init_msg(parsebgp_bmp_init_msg_t *msg)
   clear_info_tlvs(&msg->tlvs, &msg->tlvs_cnt);
 }
 
-static void dump_init_msg(const parsebgp_bmp_init_msg_t *msg, int depth)
+static void dump_init_msg(parsebgp_sink_t *sink,
+                          const parsebgp_bmp_init_msg_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_init_msg_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_init_msg_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "TLV Count", msg->tlvs_cnt);
-  dump_info_tlvs(msg->tlvs, msg->tlvs_cnt, depth + 1);
+  PARSEBGP_DUMP_INT(sink, depth, "TLV Count", msg->tlvs_cnt);
+  dump_info_tlvs(sink, msg->tlvs, msg->tlvs_cnt, depth + 1);
 }
 
 // Type 5:
@@ -579,13 +631,28 @@ static void destroy_term_msg(parsebgp_bmp_term_msg_t *msg)
   }
 
   for (i = 0; i < msg->_tlvs_alloc_cnt; i++) {
-    free(msg->tlvs[i].info.string);
+    PARSEBGP_FREE(msg->tlvs[i].info.string);
     msg->tlvs[i].info.string = NULL;
   }
-  free(msg->tlvs);
+  PARSEBGP_FREE(msg->tlvs);
   msg->tlvs = NULL;
   msg->_tlvs_alloc_cnt = 0;
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t term_msg_memory_usage(const parsebgp_bmp_term_msg_t *msg)
+{
+  size_t usage;
+  int i;
+
+  if (msg == NULL) {
+    return 0;
+  }
+  usage = sizeof(*msg) + sizeof(*msg->tlvs) * msg->_tlvs_alloc_cnt;
+  for (i = 0; i < msg->_tlvs_alloc_cnt; i++) {
+    usage += msg->tlvs[i].info._string_alloc_len;
+  }
+  return usage;
 }
 
 static void clear_term_msg(parsebgp_bmp_term_msg_t *msg)
@@ -601,11 +668,12 @@ static void clear_term_msg(parsebgp_bmp_term_msg_t *msg)
   msg->tlvs_cnt = 0;
 }
 
-static void dump_term_msg(const parsebgp_bmp_term_msg_t *msg, int depth)
+static void dump_term_msg(parsebgp_sink_t *sink,
+                          const parsebgp_bmp_term_msg_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_term_msg_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_term_msg_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "TLV Count", msg->tlvs_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "TLV Count", msg->tlvs_cnt);
 
   depth++;
   int i;
@@ -613,18 +681,18 @@ static void dump_term_msg(const parsebgp_bmp_term_msg_t *msg, int depth)
   for (i = 0; i < msg->tlvs_cnt; i++) {
     tlv = &msg->tlvs[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_term_tlv_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_term_tlv_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", tlv->type);
-    PARSEBGP_DUMP_INT(depth, "Length", tlv->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", tlv->type);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", tlv->len);
 
     switch (tlv->type) {
     case PARSEBGP_BMP_TERM_INFO_TYPE_STRING:
-      PARSEBGP_DUMP_INFO(depth, "String: '%s'\n", tlv->info.string);
+      PARSEBGP_DUMP_INFO(sink, depth, "String: '%s'\n", tlv->info.string);
       break;
 
     case PARSEBGP_BMP_TERM_INFO_TYPE_REASON:
-      PARSEBGP_DUMP_INT(depth, "Reason", tlv->info.reason);
+      PARSEBGP_DUMP_INT(sink, depth, "Reason", tlv->info.reason);
       break;
 
     default:
@@ -709,10 +777,26 @@ static void destroy_route_mirror_msg(parsebgp_bmp_route_mirror_t *msg)
     parsebgp_bgp_destroy_msg(msg->tlvs[i].values.bgp_msg);
   }
 
-  free(msg->tlvs);
+  PARSEBGP_FREE(msg->tlvs);
   msg->tlvs = NULL;
   msg->_tlvs_alloc_cnt = 0;
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t
+route_mirror_msg_memory_usage(const parsebgp_bmp_route_mirror_t *msg)
+{
+  size_t usage;
+  int i;
+
+  if (msg == NULL) {
+    return 0;
+  }
+  usage = sizeof(*msg) + sizeof(*msg->tlvs) * msg->_tlvs_alloc_cnt;
+  for (i = 0; i < msg->_tlvs_alloc_cnt; i++) {
+    usage += parsebgp_bgp_msg_memory_usage(msg->tlvs[i].values.bgp_msg);
+  }
+  return usage;
 }
 
 static void clear_route_mirror_msg(parsebgp_bmp_route_mirror_t *msg)
@@ -738,12 +822,13 @@ static void clear_route_mirror_msg(parsebgp_bmp_route_mirror_t *msg)
   msg->tlvs_cnt = 0;
 }
 
-static void dump_route_mirror_msg(const parsebgp_bmp_route_mirror_t *msg,
-    int depth)
+static void dump_route_mirror_msg(parsebgp_sink_t *sink,
+                                  const parsebgp_bmp_route_mirror_t *msg,
+                                  int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_route_mirror_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_route_mirror_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "TLVs Count", msg->tlvs_cnt);
+  PARSEBGP_DUMP_INT(sink, depth, "TLVs Count", msg->tlvs_cnt);
 
   depth++;
   int i;
@@ -751,18 +836,18 @@ static void dump_route_mirror_msg(const parsebgp_bmp_route_mirror_t *msg,
 
   for (i = 0; i < msg->tlvs_cnt; i++) {
     tlv = &msg->tlvs[i];
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_route_mirror_tlv_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_route_mirror_tlv_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Type", tlv->type);
-    PARSEBGP_DUMP_INT(depth, "Length", tlv->len);
+    PARSEBGP_DUMP_INT(sink, depth, "Type", tlv->type);
+    PARSEBGP_DUMP_INT(sink, depth, "Length", tlv->len);
 
     switch (tlv->type) {
     case PARSEBGP_BMP_ROUTE_MIRROR_TYPE_BGP_MSG:
-      parsebgp_bgp_dump_msg(tlv->values.bgp_msg, depth + 1);
+      parsebgp_bgp_dump_msg(sink, tlv->values.bgp_msg, depth + 1);
       break;
 
     case PARSEBGP_BMP_ROUTE_MIRROR_TYPE_INFO:
-      PARSEBGP_DUMP_INT(depth, "Code", tlv->values.code);
+      PARSEBGP_DUMP_INT(sink, depth, "Code", tlv->values.code);
       break;
 
     default:
@@ -838,21 +923,22 @@ static parsebgp_error_t parse_peer_hdr(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
-static void dump_peer_hdr(const parsebgp_bmp_peer_hdr_t *hdr, int depth)
+static void dump_peer_hdr(parsebgp_sink_t *sink,
+                          const parsebgp_bmp_peer_hdr_t *hdr, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_peer_hdr_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_peer_hdr_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Type", hdr->type);
-  PARSEBGP_DUMP_INT(depth, "Flags", hdr->flags);
-  PARSEBGP_DUMP_VAL(depth, "Route Distinguisher", PRIu64, hdr->dist_id);
+  PARSEBGP_DUMP_INT(sink, depth, "Type", hdr->type);
+  PARSEBGP_DUMP_INT(sink, depth, "Flags", hdr->flags);
+  PARSEBGP_DUMP_VAL(sink, depth, "Route Distinguisher", PRIu64, hdr->dist_id);
   int afi = (hdr->flags & PARSEBGP_BMP_PEER_FLAG_IPV6) ? PARSEBGP_BGP_AFI_IPV6
                                                        : PARSEBGP_BGP_AFI_IPV4;
-  PARSEBGP_DUMP_IP(depth, "IP", afi, hdr->addr);
-  PARSEBGP_DUMP_INT(depth, "ASN", hdr->asn);
-  PARSEBGP_DUMP_IP(depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4, hdr->bgp_id);
+  PARSEBGP_DUMP_IP(sink, depth, "IP", afi, hdr->addr);
+  PARSEBGP_DUMP_INT(sink, depth, "ASN", hdr->asn);
+  PARSEBGP_DUMP_IP(sink, depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4, hdr->bgp_id);
 
-  PARSEBGP_DUMP_INT(depth, "Time.sec", hdr->ts_sec);
-  PARSEBGP_DUMP_INT(depth, "Time.usec", hdr->ts_usec);
+  PARSEBGP_DUMP_INT(sink, depth, "Time.sec", hdr->ts_sec);
+  PARSEBGP_DUMP_INT(sink, depth, "Time.usec", hdr->ts_usec);
 }
 
 static parsebgp_error_t parse_common_hdr_v2(parsebgp_opts_t *opts,
@@ -891,8 +977,8 @@ static parsebgp_error_t parse_common_hdr_v2(parsebgp_opts_t *opts,
   case PARSEBGP_BMP_TYPE_STATS_REPORT:
     // I'm not sure how to infer the length of this.
     // I'm not even sure how one would parse this data...
-    fprintf(stderr,
-            "ERROR: BMP v1/v2 Stats Report not supported. Cannot continue\n");
+    PARSEBGP_DIAG(opts, PARSEBGP_DIAG_NOT_IMPLEMENTED, 1, 0, buf, "%s",
+                  "BMP v1/v2 Stats Report not supported. Cannot continue");
     return PARSEBGP_NOT_IMPLEMENTED;
     break;
 
@@ -912,8 +998,8 @@ static parsebgp_error_t parse_common_hdr_v2(parsebgp_opts_t *opts,
 
   case PARSEBGP_BMP_TYPE_PEER_UP:
     // TODO: If this is actually found in the wild, then we can implement it
-    fprintf(stderr,
-            "ERROR: BMP v1/v2 Peer-Up not supported. Cannot continue\n");
+    PARSEBGP_DIAG(opts, PARSEBGP_DIAG_NOT_IMPLEMENTED, 1, 0, buf, "%s",
+                  "BMP v1/v2 Peer-Up not supported. Cannot continue");
     return PARSEBGP_NOT_IMPLEMENTED;
     break;
   }
@@ -1012,25 +1098,26 @@ static parsebgp_error_t parse_common_hdr(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
-static void dump_common_hdr(const parsebgp_bmp_msg_t *msg, int depth)
+static void dump_common_hdr(parsebgp_sink_t *sink,
+                            const parsebgp_bmp_msg_t *msg, int depth)
 {
-  PARSEBGP_DUMP_INT(depth, "Version", msg->version);
-  PARSEBGP_DUMP_INT(depth, "Length", msg->len);
-  PARSEBGP_DUMP_INT(depth, "Type", msg->type);
+  PARSEBGP_DUMP_INT(sink, depth, "Version", msg->version);
+  PARSEBGP_DUMP_INT(sink, depth, "Length", msg->len);
+  PARSEBGP_DUMP_INT(sink, depth, "Type", msg->type);
 
   if (msg->type == PARSEBGP_BMP_TYPE_INIT_MSG ||
       msg->type == PARSEBGP_BMP_TYPE_TERM_MSG) {
     return;
   }
 
-  dump_peer_hdr(&msg->peer_hdr, depth + 1);
+  dump_peer_hdr(sink, &msg->peer_hdr, depth + 1);
 }
 
 /* -------------------- Main BMP Parser ----------------------------- */
 
-parsebgp_error_t parsebgp_bmp_decode(parsebgp_opts_t *opts,
-                                     parsebgp_bmp_msg_t *msg, const uint8_t *buf,
-                                     size_t *len)
+static parsebgp_error_t decode_msg(parsebgp_opts_t *opts,
+                                   parsebgp_bmp_msg_t *msg, const uint8_t *buf,
+                                   size_t *len)
 {
   parsebgp_error_t err;
   size_t slen = 0, nread = 0, remain = 0;
@@ -1059,13 +1146,15 @@ parsebgp_error_t parsebgp_bmp_decode(parsebgp_opts_t *opts,
   }
   msg->types_valid = 1;
 
+  slen = remain; // don't let sub-parsers go past the end of the BMP message
   switch (msg->type) {
   case PARSEBGP_BMP_TYPE_ROUTE_MON:
     // TODO: understand if it is sufficient to believe this flag
     opts->bgp.asn_4_byte =
       !(msg->peer_hdr.flags & PARSEBGP_BMP_PEER_FLAG_2_BYTE_AS_PATH);
     PARSEBGP_MAYBE_MALLOC_ZERO(msg->types.route_mon);
-    err = parsebgp_bgp_decode(opts, msg->types.route_mon, buf + nread, &slen);
+    err = parsebgp_bgp_decode_ext(opts, msg->types.route_mon, buf + nread,
+                                  &slen, 1);
     break;
 
   case PARSEBGP_BMP_TYPE_STATS_REPORT:
@@ -1101,6 +1190,16 @@ parsebgp_error_t parsebgp_bmp_decode(parsebgp_opts_t *opts,
                                  &slen, remain);
     break;
   }
+  if (err == PARSEBGP_PARTIAL_MSG) {
+    // the whole BMP message is in the buffer, so the sub-message must be
+    // truncated (and more data won't help)
+    err = PARSEBGP_TRUNCATED_MSG;
+  }
+  if (err == PARSEBGP_TRUNCATED_MSG) {
+    // skip to the end of the BMP message so that the caller can carry on
+    *len = msg->len;
+    return err;
+  }
   if (err != PARSEBGP_OK) {
     // parser failed
     return err;
@@ -1122,6 +1221,29 @@ parsebgp_error_t parsebgp_bmp_decode(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
+parsebgp_error_t parsebgp_bmp_decode(parsebgp_opts_t *opts,
+                                     parsebgp_bmp_msg_t *msg, const uint8_t *buf,
+                                     size_t *len)
+{
+#ifdef PARSEBGP_STATS
+  parsebgp_error_t err;
+  uint64_t start;
+
+  if (opts->stats == NULL) {
+    return decode_msg(opts, msg, buf, len);
+  }
+  start = parsebgp_stats_now();
+  err = decode_msg(opts, msg, buf, len);
+  if ((err == PARSEBGP_OK || err == PARSEBGP_TRUNCATED_MSG) &&
+      msg->type < PARSEBGP_STATS_BMP_TYPES) {
+    PARSEBGP_STATS_MSG(opts, bmp[msg->type], *len, start);
+  }
+  return err;
+#else
+  return decode_msg(opts, msg, buf, len);
+#endif
+}
+
 void parsebgp_bmp_destroy_msg(parsebgp_bmp_msg_t *msg)
 {
   if (msg == NULL) {
@@ -1138,7 +1260,22 @@ void parsebgp_bmp_destroy_msg(parsebgp_bmp_msg_t *msg)
   destroy_term_msg(msg->types.term_msg);
   destroy_route_mirror_msg(msg->types.route_mirror);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+size_t parsebgp_bmp_msg_memory_usage(const parsebgp_bmp_msg_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+
+  return sizeof(*msg) + parsebgp_bgp_msg_memory_usage(msg->types.route_mon) +
+         stats_report_memory_usage(msg->types.stats_report) +
+         peer_down_memory_usage(msg->types.peer_down) +
+         peer_up_memory_usage(msg->types.peer_up) +
+         init_msg_memory_usage(msg->types.init_msg) +
+         term_msg_memory_usage(msg->types.term_msg) +
+         route_mirror_msg_memory_usage(msg->types.route_mirror);
 }
 
 void parsebgp_bmp_clear_msg(parsebgp_bmp_msg_t *msg)
@@ -1179,11 +1316,12 @@ void parsebgp_bmp_clear_msg(parsebgp_bmp_msg_t *msg)
   }
 }
 
-void parsebgp_bmp_dump_msg(const parsebgp_bmp_msg_t *msg, int depth)
+void parsebgp_bmp_dump_msg(parsebgp_sink_t *sink, const parsebgp_bmp_msg_t *msg,
+                           int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_bmp_msg_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_bmp_msg_t, depth);
 
-  dump_common_hdr(msg, depth);
+  dump_common_hdr(sink, msg, depth);
 
   if (!msg->types_valid) {
     return;
@@ -1192,31 +1330,31 @@ void parsebgp_bmp_dump_msg(const parsebgp_bmp_msg_t *msg, int depth)
   depth++;
   switch (msg->type) {
   case PARSEBGP_BMP_TYPE_ROUTE_MON:
-    parsebgp_bgp_dump_msg(msg->types.route_mon, depth);
+    parsebgp_bgp_dump_msg(sink, msg->types.route_mon, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_STATS_REPORT:
-    dump_stats_report(msg->types.stats_report, depth);
+    dump_stats_report(sink, msg->types.stats_report, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_PEER_DOWN:
-    dump_peer_down(msg->types.peer_down, depth);
+    dump_peer_down(sink, msg->types.peer_down, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_PEER_UP:
-    dump_peer_up(msg->types.peer_up, depth);
+    dump_peer_up(sink, msg->types.peer_up, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_INIT_MSG:
-    dump_init_msg(msg->types.init_msg, depth);
+    dump_init_msg(sink, msg->types.init_msg, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_TERM_MSG:
-    dump_term_msg(msg->types.term_msg, depth);
+    dump_term_msg(sink, msg->types.term_msg, depth);
     break;
 
   case PARSEBGP_BMP_TYPE_ROUTE_MIRROR_MSG:
-    dump_route_mirror_msg(msg->types.route_mirror, depth);
+    dump_route_mirror_msg(sink, msg->types.route_mirror, depth);
     break;
   }
 }
@@ -606,8 +606,18 @@ void parsebgp_bmp_destroy_msg(parsebgp_bmp_msg_t *msg);
 void parsebgp_bmp_clear_msg(parsebgp_bmp_msg_t *msg);
 
 /**
- * Dump a human-readable version of the message to stdout
+ * Get the amount of memory allocated for the given BMP message structure
  *
+ * @param msg           Pointer to the message structure
+ * @return the number of bytes allocated (including memory retained for reuse
+ * after the message was cleared)
+ */
+size_t parsebgp_bmp_msg_memory_usage(const parsebgp_bmp_msg_t *msg);
+
+/**
+ * Dump a human-readable version of the message to a sink
+ *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -616,6 +626,7 @@ void parsebgp_bmp_clear_msg(parsebgp_bmp_msg_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_bmp_dump_msg(const parsebgp_bmp_msg_t *msg, int depth);
+void parsebgp_bmp_dump_msg(parsebgp_sink_t *sink, const parsebgp_bmp_msg_t *msg,
+                           int depth);
 
 #endif /* __PARSEBGP_BMP_H */
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_bmp_encode.h"
+#include "parsebgp_bgp_encode.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/** BMP version written by the encoder */
+#define BMP_VERSION 3
+
+/** Write an IP address in the 16-byte BMP format (IPv4 addresses are written
+    into the least-significant bytes) */
+static parsebgp_error_t encode_bmp_ip(parsebgp_bgp_afi_t afi,
+                                      const uint8_t *addr, uint8_t *buf,
+                                      size_t *lenp)
+{
+  if (*lenp < 16) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+  if (afi == PARSEBGP_BGP_AFI_IPV4) {
+    memset(buf, 0, 12);
+    memcpy(buf + 12, addr, 4);
+  } else {
+    memcpy(buf, addr, 16);
+  }
+  *lenp = 16;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t encode_info_tlvs(const parsebgp_bmp_info_tlv_t *tlvs,
+                                         int tlvs_cnt, uint8_t *buf,
+                                         size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  int i;
+
+  for (i = 0; i < tlvs_cnt; i++) {
+    // Type
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, tlvs[i].type);
+
+    // Length
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, tlvs[i].len);
+
+    // Info data
+    if (tlvs[i].len > 0) {
+      PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, tlvs[i].info, tlvs[i].len);
+    }
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+// Type 1:
+static parsebgp_error_t
+encode_stats_report(const parsebgp_bmp_stats_report_t *msg, uint8_t *buf,
+                    size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  const parsebgp_bmp_stats_counter_t *sc;
+  uint32_t i;
+
+  // Stats Count
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->stats_count);
+
+  for (i = 0; i < msg->stats_count; i++) {
+    sc = &msg->counters[i];
+
+    // Type
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, sc->type);
+
+    switch (sc->type) {
+    // 32-bit counter types:
+    case PARSEBGP_BMP_STATS_PREFIX_REJECTS:
+    case PARSEBGP_BMP_STATS_PREFIX_DUPS:
+    case PARSEBGP_BMP_STATS_WITHDRAW_DUP:
+    case PARSEBGP_BMP_STATS_INVALID_CLUSTER_LIST:
+    case PARSEBGP_BMP_STATS_INVALID_AS_PATH_LOOP:
+    case PARSEBGP_BMP_STATS_INVALID_ORIGINATOR_ID:
+    case PARSEBGP_BMP_STATS_INVALID_AS_CONFED_LOOP:
+    case PARSEBGP_BMP_STATS_UPD_TREAT_AS_WITHDRAW:
+    case PARSEBGP_BMP_STATS_PREFIX_TREAT_AS_WITHDRAW:
+    case PARSEBGP_BMP_STATS_DUP_UPD:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 4);
+      PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, sc->data.counter_u32);
+      break;
+
+    // 64-bit gauge types:
+    case PARSEBGP_BMP_STATS_ROUTES_ADJ_RIB_IN:
+    case PARSEBGP_BMP_STATS_ROUTES_LOC_RIB:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 8);
+      PARSEBGP_SERIALIZE_UINT64(buf, len, nwrite, sc->data.gauge_u64);
+      break;
+
+    // AFI/SAFI 64-bit gauge types:
+    case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_ADJ_RIB_IN:
+    case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_LOC_RIB:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 11);
+
+      // AFI
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, sc->data.afi_safi_gauge.afi);
+
+      // SAFI
+      PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, sc->data.afi_safi_gauge.safi);
+
+      // u64 gauge
+      PARSEBGP_SERIALIZE_UINT64(buf, len, nwrite,
+                                sc->data.afi_safi_gauge.gauge_u64);
+      break;
+
+    default:
+      // the decoder only keeps the value of unknown counters if it is 4 or 8
+      // bytes long
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, sc->len);
+      if (sc->len == 8) {
+        PARSEBGP_SERIALIZE_UINT64(buf, len, nwrite, sc->data.gauge_u64);
+      } else if (sc->len == 4) {
+        PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, sc->data.counter_u32);
+      } else {
+        return PARSEBGP_NOT_IMPLEMENTED;
+      }
+      break;
+    }
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+// Type 2:
+static parsebgp_error_t encode_peer_down(parsebgp_opts_t *opts,
+                                         const parsebgp_bmp_peer_down_t *msg,
+                                         uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+
+  // Reason
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->reason);
+
+  switch (msg->reason) {
+  // Reasons with a BGP NOTIFICATION message
+  case PARSEBGP_BMP_PEER_DOWN_LOCAL_CLOSE_WITH_NOTIF:
+  case PARSEBGP_BMP_PEER_DOWN_REMOTE_CLOSE_WITH_NOTIF:
+    slen = len - nwrite;
+    if ((err = parsebgp_bgp_encode(opts, msg->data.notification, buf,
+                                   &slen)) != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+    break;
+
+  case PARSEBGP_BMP_PEER_DOWN_LOCAL_CLOSE:
+    // FSM code
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->data.fsm_code);
+    break;
+
+  default:
+    // no data
+    break;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+// Type 3:
+static parsebgp_error_t encode_peer_up(parsebgp_opts_t *opts,
+                                       const parsebgp_bmp_peer_up_t *msg,
+                                       uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+
+  // Local IP
+  slen = len - nwrite;
+  if ((err = encode_bmp_ip(msg->local_ip_afi, msg->local_ip, buf, &slen)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // Local port
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->local_port);
+
+  // Remote port
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->remote_port);
+
+  // Sent OPEN
+  slen = len - nwrite;
+  if ((err = parsebgp_bgp_encode(opts, msg->sent_open, buf, &slen)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // Received OPEN
+  slen = len - nwrite;
+  if ((err = parsebgp_bgp_encode(opts, msg->recv_open, buf, &slen)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // Information TLVs (optional)
+  slen = len - nwrite;
+  if ((err = encode_info_tlvs(msg->tlvs, msg->tlvs_cnt, buf, &slen)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+// Type 5:
+static parsebgp_error_t encode_term_msg(const parsebgp_bmp_term_msg_t *msg,
+                                        uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  const parsebgp_bmp_term_tlv_t *tlv;
+  int i;
+
+  for (i = 0; i < msg->tlvs_cnt; i++) {
+    tlv = &msg->tlvs[i];
+
+    // Type
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, tlv->type);
+
+    switch (tlv->type) {
+    case PARSEBGP_BMP_TERM_INFO_TYPE_STRING:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, tlv->len);
+      if (tlv->len > 0) {
+        PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, tlv->info.string, tlv->len);
+      }
+      break;
+
+    case PARSEBGP_BMP_TERM_INFO_TYPE_REASON:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, 2);
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, tlv->info.reason);
+      break;
+
+    default:
+      PARSEBGP_RETURN_INVALID_MSG_ERR;
+    }
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t encode_peer_hdr(const parsebgp_bmp_peer_hdr_t *hdr,
+                                        uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+
+  // Type
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, hdr->type);
+
+  // Flags
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, hdr->flags);
+
+  // Route distinguisher (copied as-is by the decoder)
+  PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, hdr->dist_id);
+
+  // IP Address
+  slen = len - nwrite;
+  if ((err = encode_bmp_ip((hdr->flags & PARSEBGP_BMP_PEER_FLAG_IPV6)
+                             ? PARSEBGP_BGP_AFI_IPV6
+                             : PARSEBGP_BGP_AFI_IPV4,
+                           hdr->addr, buf, &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // AS Number
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, hdr->asn);
+
+  // BGP ID
+  PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, hdr->bgp_id);
+
+  // Timestamp (seconds component)
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, hdr->ts_sec);
+
+  // Timestamp (microseconds component)
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, hdr->ts_usec);
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t parsebgp_bmp_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_bmp_msg_t *msg,
+                                     uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  uint8_t *len_buf;
+  parsebgp_opts_t bgp_opts;
+  parsebgp_error_t err;
+
+  if (!msg->types_valid) {
+    // only the headers were decoded
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  // Version
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, BMP_VERSION);
+
+  // Message Length (filled in below)
+  len_buf = buf;
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, 0);
+
+  // Message Type
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->type);
+
+  // Per-Peer Header
+  switch (msg->type) {
+  case PARSEBGP_BMP_TYPE_ROUTE_MON:
+  case PARSEBGP_BMP_TYPE_STATS_REPORT:
+  case PARSEBGP_BMP_TYPE_PEER_UP:
+  case PARSEBGP_BMP_TYPE_PEER_DOWN:
+    slen = len - nwrite;
+    if ((err = encode_peer_hdr(&msg->peer_hdr, buf, &slen)) != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+    break;
+
+  case PARSEBGP_BMP_TYPE_INIT_MSG:
+  case PARSEBGP_BMP_TYPE_TERM_MSG:
+    // no peer header
+    break;
+
+  default:
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  slen = len - nwrite;
+  switch (msg->type) {
+  case PARSEBGP_BMP_TYPE_ROUTE_MON:
+    bgp_opts = *opts;
+    bgp_opts.bgp.asn_4_byte =
+      !(msg->peer_hdr.flags & PARSEBGP_BMP_PEER_FLAG_2_BYTE_AS_PATH);
+    err = parsebgp_bgp_encode(&bgp_opts, msg->types.route_mon, buf, &slen);
+    break;
+
+  case PARSEBGP_BMP_TYPE_STATS_REPORT:
+    err = encode_stats_report(msg->types.stats_report, buf, &slen);
+    break;
+
+  case PARSEBGP_BMP_TYPE_PEER_DOWN:
+    err = encode_peer_down(opts, msg->types.peer_down, buf, &slen);
+    break;
+
+  case PARSEBGP_BMP_TYPE_PEER_UP:
+    err = encode_peer_up(opts, msg->types.peer_up, buf, &slen);
+    break;
+
+  case PARSEBGP_BMP_TYPE_INIT_MSG:
+    err = encode_info_tlvs(msg->types.init_msg->tlvs,
+                           msg->types.init_msg->tlvs_cnt, buf, &slen);
+    break;
+
+  case PARSEBGP_BMP_TYPE_TERM_MSG:
+    err = encode_term_msg(msg->types.term_msg, buf, &slen);
+    break;
+
+  default:
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+  if (err != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+
+  // Message Length (including all headers)
+  if (nwrite > UINT32_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  len_buf[0] = (uint8_t)(nwrite >> 24);
+  len_buf[1] = (uint8_t)(nwrite >> 16);
+  len_buf[2] = (uint8_t)(nwrite >> 8);
+  len_buf[3] = (uint8_t)nwrite;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_BMP_ENCODE_H
+#define __PARSEBGP_BMP_ENCODE_H
+
+#include "parsebgp_bmp.h"
+#include "parsebgp_error.h"
+#include "parsebgp_opts.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Encode a BMP message (including the common and per-peer headers)
+ *
+ * @param [in] opts     Options for the encoder
+ * @param [in] msg      Pointer to the BMP message to encode
+ * @param [in] buf      Buffer to write the message into
+ * @param [in,out] len  Length of the buffer. Updated with the number of bytes
+ *                      written to the buffer.
+ * @return PARSEBGP_OK (0) if the message was encoded successfully,
+ * PARSEBGP_PARTIAL_MSG if the buffer is too small, or another error code
+ * otherwise
+ *
+ * This is the inverse of parsebgp_bmp_decode (see parsebgp_bgp_encode.h for
+ * how the BGP parts of the message are encoded). Messages are always written
+ * in BMP version 3 format (regardless of the version field), and the length
+ * field of the common header is computed. Route Mirroring messages are not
+ * supported (the decoder does not accept them in version 3 either), and
+ * neither are messages that were decoded with the bmp.parse_headers_only
+ * option.
+ */
+parsebgp_error_t parsebgp_bmp_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_bmp_msg_t *msg,
+                                     uint8_t *buf, size_t *len);
+
+#endif /* __PARSEBGP_BMP_ENCODE_H */
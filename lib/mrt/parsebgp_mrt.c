@@ -111,7 +111,7 @@ static void destroy_table_dump(parsebgp_bgp_afi_t afi,
 
   parsebgp_bgp_update_path_attrs_destroy(&msg->path_attrs);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 }
 
 static void clear_table_dump(parsebgp_bgp_afi_t afi,
@@ -124,19 +124,28 @@ static void clear_table_dump(parsebgp_bgp_afi_t afi,
   parsebgp_bgp_update_path_attrs_clear(&msg->path_attrs);
 }
 
-static void dump_table_dump(parsebgp_bgp_afi_t afi,
+static size_t table_dump_memory_usage(const parsebgp_mrt_table_dump_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         parsebgp_bgp_update_path_attrs_memory_usage(&msg->path_attrs);
+}
+
+static void dump_table_dump(parsebgp_sink_t *sink, parsebgp_bgp_afi_t afi,
                             const parsebgp_mrt_table_dump_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_t, depth);
-  PARSEBGP_DUMP_INT(depth, "View Number", msg->view_number);
-  PARSEBGP_DUMP_INT(depth, "Sequence", msg->sequence);
-  PARSEBGP_DUMP_PFX(depth, "Prefix", afi, msg->prefix, msg->prefix_len);
-  PARSEBGP_DUMP_INT(depth, "Status (unused)", msg->status);
-  PARSEBGP_DUMP_INT(depth, "Originated Time", msg->originated_time);
-  PARSEBGP_DUMP_IP(depth, "Peer IP", afi, msg->peer_ip);
-  PARSEBGP_DUMP_INT(depth, "Peer ASN", msg->peer_asn);
-
-  parsebgp_bgp_update_path_attrs_dump(&msg->path_attrs, depth + 1);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_t, depth);
+  PARSEBGP_DUMP_INT(sink, depth, "View Number", msg->view_number);
+  PARSEBGP_DUMP_INT(sink, depth, "Sequence", msg->sequence);
+  PARSEBGP_DUMP_PFX(sink, depth, "Prefix", afi, msg->prefix, msg->prefix_len);
+  PARSEBGP_DUMP_INT(sink, depth, "Status (unused)", msg->status);
+  PARSEBGP_DUMP_INT(sink, depth, "Originated Time", msg->originated_time);
+  PARSEBGP_DUMP_IP(sink, depth, "Peer IP", afi, msg->peer_ip);
+  PARSEBGP_DUMP_INT(sink, depth, "Peer ASN", msg->peer_asn);
+
+  parsebgp_bgp_update_path_attrs_dump(sink, &msg->path_attrs, depth + 1);
 }
 
 static parsebgp_error_t
@@ -215,11 +224,11 @@ parse_table_dump_v2_peer_index(parsebgp_mrt_table_dump_v2_peer_index_t *msg,
 static void
 destroy_table_dump_v2_peer_index(parsebgp_mrt_table_dump_v2_peer_index_t *msg)
 {
-  free(msg->view_name);
+  PARSEBGP_FREE(msg->view_name);
   msg->view_name = NULL;
   msg->view_name_len = 0;
 
-  free(msg->peer_entries);
+  PARSEBGP_FREE(msg->peer_entries);
   msg->peer_entries = NULL;
   msg->peer_count = 0;
 }
@@ -235,35 +244,389 @@ clear_table_dump_v2_peer_index(parsebgp_mrt_table_dump_v2_peer_index_t *msg)
   msg->peer_count = 0;
 }
 
+static size_t table_dump_v2_peer_index_memory_usage(
+  const parsebgp_mrt_table_dump_v2_peer_index_t *msg)
+{
+  return msg->_view_name_alloc_len +
+         sizeof(*msg->peer_entries) * msg->_peer_entries_alloc_cnt;
+}
+
+/** Immutable copy of a Peer Index Table, shareable between threads */
+struct parsebgp_mrt_peer_index {
+
+  /** Copy of the Peer Index Table (allocated lengths are exact) */
+  parsebgp_mrt_table_dump_v2_peer_index_t table;
+
+};
+
+parsebgp_mrt_peer_index_t *parsebgp_mrt_peer_index_create(
+  const parsebgp_mrt_table_dump_v2_peer_index_t *msg)
+{
+  parsebgp_mrt_peer_index_t *idx;
+  parsebgp_mrt_table_dump_v2_peer_index_t *t;
+
+  if ((idx = malloc_zero(sizeof(*idx))) == NULL) {
+    return NULL;
+  }
+  t = &idx->table;
+
+  memcpy(t->collector_bgp_id, msg->collector_bgp_id,
+         sizeof(t->collector_bgp_id));
+
+  // always allocate a view name so that users can print it unconditionally
+  t->view_name_len = msg->view_name_len;
+  t->_view_name_alloc_len = msg->view_name_len + 1;
+  if ((t->view_name = malloc(t->_view_name_alloc_len)) == NULL) {
+    goto err;
+  }
+  if (msg->view_name_len > 0) {
+    memcpy(t->view_name, msg->view_name, msg->view_name_len);
+  }
+  t->view_name[t->view_name_len] = '\0';
+
+  t->peer_count = msg->peer_count;
+  t->_peer_entries_alloc_cnt = msg->peer_count;
+  if (msg->peer_count > 0) {
+    if ((t->peer_entries = malloc(sizeof(*t->peer_entries) *
+                                  msg->peer_count)) == NULL) {
+      goto err;
+    }
+    memcpy(t->peer_entries, msg->peer_entries,
+           sizeof(*t->peer_entries) * msg->peer_count);
+  }
+
+  return idx;
+
+err:
+  parsebgp_mrt_peer_index_destroy(idx);
+  return NULL;
+}
+
+void parsebgp_mrt_peer_index_destroy(parsebgp_mrt_peer_index_t *idx)
+{
+  if (idx == NULL) {
+    return;
+  }
+  destroy_table_dump_v2_peer_index(&idx->table);
+  PARSEBGP_FREE(idx);
+}
+
+const parsebgp_mrt_table_dump_v2_peer_index_t *
+parsebgp_mrt_peer_index_get_table(const parsebgp_mrt_peer_index_t *idx)
+{
+  return &idx->table;
+}
+
+uint16_t parsebgp_mrt_peer_index_get_peers_cnt(
+  const parsebgp_mrt_peer_index_t *idx)
+{
+  return idx->table.peer_count;
+}
+
+const parsebgp_mrt_table_dump_v2_peer_entry_t *
+parsebgp_mrt_peer_index_get_peer(const parsebgp_mrt_peer_index_t *idx,
+                                 uint16_t peer_index)
+{
+  if (peer_index >= idx->table.peer_count) {
+    return NULL;
+  }
+  return &idx->table.peer_entries[peer_index];
+}
+
 static void
 dump_table_dump_v2_peer_index(
-    const parsebgp_mrt_table_dump_v2_peer_index_t *msg, int depth)
+    parsebgp_sink_t *sink, const parsebgp_mrt_table_dump_v2_peer_index_t *msg,
+    int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_v2_peer_index_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_v2_peer_index_t,
+                           depth);
 
-  PARSEBGP_DUMP_IP(depth, "Collector BGP ID", PARSEBGP_BGP_AFI_IPV4,
+  PARSEBGP_DUMP_IP(sink, depth, "Collector BGP ID", PARSEBGP_BGP_AFI_IPV4,
                    &msg->collector_bgp_id);
-  PARSEBGP_DUMP_INFO(depth, "View Name: %s\n", msg->view_name);
-  PARSEBGP_DUMP_INT(depth, "Peer Count", msg->peer_count);
+  PARSEBGP_DUMP_INFO(sink, depth, "View Name: %s\n", msg->view_name);
+  PARSEBGP_DUMP_INT(sink, depth, "Peer Count", msg->peer_count);
 
   depth++;
   int i;
   parsebgp_mrt_table_dump_v2_peer_entry_t *entry;
   for (i = 0; i < msg->peer_count; i++) {
     entry = &msg->peer_entries[i];
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_v2_peer_entry_t, depth);
-    PARSEBGP_DUMP_INT(depth, "ASN Type", entry->asn_type);
-    PARSEBGP_DUMP_INT(depth, "IP AFI", entry->ip_afi);
-    PARSEBGP_DUMP_IP(depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4, &entry->bgp_id);
-    PARSEBGP_DUMP_IP(depth, "IP", entry->ip_afi, entry->ip);
-    PARSEBGP_DUMP_INT(depth, "ASN", entry->asn);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_v2_peer_entry_t,
+                             depth);
+    PARSEBGP_DUMP_INT(sink, depth, "ASN Type", entry->asn_type);
+    PARSEBGP_DUMP_INT(sink, depth, "IP AFI", entry->ip_afi);
+    PARSEBGP_DUMP_IP(sink, depth, "BGP ID", PARSEBGP_BGP_AFI_IPV4,
+                     &entry->bgp_id);
+    PARSEBGP_DUMP_IP(sink, depth, "IP", entry->ip_afi, entry->ip);
+    PARSEBGP_DUMP_INT(sink, depth, "ASN", entry->asn);
+  }
+}
+
+/** Number of slots in each bucket of the path attribute dedup cache */
+#define PATH_ATTRS_CACHE_WAYS 4
+
+/** A single (decoded) Path Attribute set in the dedup cache */
+typedef struct path_attrs_cache_slot {
+
+  /** Hash of the raw Path Attributes data */
+  uint64_t hash;
+
+  /** Generation (i.e., RIB message) in which this set was last used */
+  uint64_t last_used;
+
+  /** Attribute set ID (zero if the slot is empty) */
+  uint32_t id;
+
+  /** TABLE_DUMP_V2 subtype the set was decoded for (affects MP_REACH) */
+  uint16_t subtype;
+
+  /** Length of the raw Path Attributes data */
+  uint16_t raw_len;
+
+  /** Copy of the raw Path Attributes data */
+  uint8_t *raw;
+
+  /** Allocated length of the raw data */
+  int _raw_alloc_len;
+
+  /** Decoded Path Attributes */
+  parsebgp_bgp_update_path_attrs_t path_attrs;
+
+} path_attrs_cache_slot_t;
+
+/** Set-associative cache of decoded Path Attribute sets */
+struct parsebgp_mrt_path_attrs_cache {
+
+  /** Array of (buckets_mask + 1) * PATH_ATTRS_CACHE_WAYS slots */
+  path_attrs_cache_slot_t *slots;
+
+  /** Number of buckets minus one (number of buckets is a power of two) */
+  uint64_t buckets_mask;
+
+  /** Current generation (incremented for each RIB message) */
+  uint64_t generation;
+
+  /** Next attribute set ID to hand out */
+  uint32_t next_id;
+
+  /** Fingerprint of the options that the cached sets were decoded with */
+  uint64_t opts_hash;
+};
+
+typedef struct parsebgp_mrt_path_attrs_cache path_attrs_cache_t;
+
+static path_attrs_cache_t *path_attrs_cache_create(uint32_t size)
+{
+  path_attrs_cache_t *cache;
+  uint64_t buckets = 1;
+
+  if (size == 0) {
+    size = PARSEBGP_MRT_PATH_ATTRS_DEDUP_CACHE_SIZE_DEFAULT;
+  }
+  while (buckets * PATH_ATTRS_CACHE_WAYS < size) {
+    buckets <<= 1;
+  }
+
+  if ((cache = malloc_zero(sizeof(*cache))) == NULL) {
+    return NULL;
+  }
+  if ((cache->slots = malloc_zero(sizeof(path_attrs_cache_slot_t) * buckets *
+                                  PATH_ATTRS_CACHE_WAYS)) == NULL) {
+    PARSEBGP_FREE(cache);
+    return NULL;
+  }
+  cache->buckets_mask = buckets - 1;
+  cache->next_id = 1;
+  return cache;
+}
+
+static void path_attrs_cache_destroy(path_attrs_cache_t *cache)
+{
+  uint64_t i;
+
+  if (cache == NULL) {
+    return;
+  }
+
+  for (i = 0; i < (cache->buckets_mask + 1) * PATH_ATTRS_CACHE_WAYS; i++) {
+    parsebgp_bgp_update_path_attrs_destroy(&cache->slots[i].path_attrs);
+    PARSEBGP_FREE(cache->slots[i].raw);
+  }
+  PARSEBGP_FREE(cache->slots);
+  PARSEBGP_FREE(cache);
+}
+
+static size_t path_attrs_cache_memory_usage(const path_attrs_cache_t *cache)
+{
+  uint64_t i, slots_cnt;
+  size_t usage;
+
+  if (cache == NULL) {
+    return 0;
+  }
+
+  slots_cnt = (cache->buckets_mask + 1) * PATH_ATTRS_CACHE_WAYS;
+  usage = sizeof(*cache) + sizeof(*cache->slots) * slots_cnt;
+  for (i = 0; i < slots_cnt; i++) {
+    usage += cache->slots[i]._raw_alloc_len +
+             parsebgp_bgp_update_path_attrs_memory_usage(
+               &cache->slots[i].path_attrs);
+  }
+  return usage;
+}
+
+/** Fingerprint the options that change how Path Attributes are decoded */
+static uint64_t path_attrs_cache_opts_hash(const parsebgp_opts_t *opts)
+{
+  uint64_t h = (opts->ignore_not_implemented ? 1 : 0) |
+               (opts->ignore_invalid ? 2 : 0) |
+               (opts->bgp.path_attr_filter_enabled ? 4 : 0) |
+               (opts->bgp.path_attr_raw_enabled ? 8 : 0) |
+               (opts->bgp.as_path_merge ? 16 : 0) |
+               (opts->bgp.as_path_summary ? 32 : 0) |
+               (opts->bgp.ext_communities_compact ? 64 : 0);
+
+  if (opts->bgp.path_attr_filter_enabled) {
+    h = parsebgp_hash_bytes(opts->bgp.path_attr_filter,
+                            sizeof(opts->bgp.path_attr_filter), h);
+  }
+  if (opts->bgp.path_attr_raw_enabled) {
+    h = parsebgp_hash_bytes(opts->bgp.path_attr_raw,
+                            sizeof(opts->bgp.path_attr_raw), h);
+  }
+  return h;
+}
+
+/** Prepare the cache for decoding a new RIB message */
+static void path_attrs_cache_begin(path_attrs_cache_t *cache,
+                                   const parsebgp_opts_t *opts)
+{
+  uint64_t i, opts_hash = path_attrs_cache_opts_hash(opts);
+  path_attrs_cache_slot_t *slot;
+
+  cache->generation++;
+
+  if (opts_hash == cache->opts_hash) {
+    return;
+  }
+  // the options changed since the cached sets were decoded, so flush them
+  for (i = 0; i < (cache->buckets_mask + 1) * PATH_ATTRS_CACHE_WAYS; i++) {
+    slot = &cache->slots[i];
+    if (slot->id != 0) {
+      parsebgp_bgp_update_path_attrs_clear(&slot->path_attrs);
+      slot->id = 0;
+    }
+  }
+  cache->opts_hash = opts_hash;
+}
+
+static uint32_t path_attrs_cache_next_id(path_attrs_cache_t *cache)
+{
+  uint32_t id = cache->next_id++;
+  if (cache->next_id == 0) {
+    cache->next_id = 1;
   }
+  return id;
+}
+
+static parsebgp_error_t
+parse_rib_entry_path_attrs_dedup(parsebgp_opts_t *opts,
+                                 path_attrs_cache_t *cache,
+                                 parsebgp_mrt_table_dump_v2_subtype_t subtype,
+                                 parsebgp_mrt_table_dump_v2_rib_entry_t *entry,
+                                 const uint8_t *buf, size_t *lenp,
+                                 size_t remain)
+{
+  size_t len = *lenp, slen;
+  uint16_t attrs_len;
+  uint64_t hash;
+  path_attrs_cache_slot_t *bucket, *slot, *victim = NULL;
+  int i;
+  parsebgp_error_t err;
+
+  // peek at the Path Attributes Length so that we can hash the raw data (the
+  // same checks are done by parsebgp_bgp_update_path_attrs_decode)
+  if (len < sizeof(attrs_len)) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+  attrs_len = nptohs(buf);
+  if (sizeof(attrs_len) + attrs_len > len) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+  PARSEBGP_ASSERT(sizeof(attrs_len) + attrs_len <= remain);
+
+  hash = parsebgp_hash_bytes(buf + sizeof(attrs_len), attrs_len, subtype);
+  bucket = &cache->slots[(hash & cache->buckets_mask) * PATH_ATTRS_CACHE_WAYS];
+
+  for (i = 0; i < PATH_ATTRS_CACHE_WAYS; i++) {
+    slot = &bucket[i];
+    if (slot->id == 0) {
+      // empty slots are always the best victim
+      victim = slot;
+      continue;
+    }
+    if (slot->hash == hash && slot->subtype == subtype &&
+        slot->raw_len == attrs_len &&
+        memcmp(slot->raw, buf + sizeof(attrs_len), attrs_len) == 0) {
+      // hit
+      slot->last_used = cache->generation;
+      entry->path_attrs_ptr = &slot->path_attrs;
+      entry->path_attrs_id = slot->id;
+      *lenp = sizeof(attrs_len) + attrs_len;
+      return PARSEBGP_OK;
+    }
+    // never evict a set that is referenced by an entry of this message
+    if (slot->last_used != cache->generation &&
+        (victim == NULL ||
+         (victim->id != 0 && slot->last_used < victim->last_used))) {
+      victim = slot;
+    }
+  }
+
+  slen = len;
+  if (victim == NULL) {
+    // every slot in the bucket is in use by this message, so decode into the
+    // entry itself
+    if ((err = parsebgp_bgp_update_path_attrs_decode(
+           opts, &entry->path_attrs, buf, &slen, remain)) != PARSEBGP_OK) {
+      return err;
+    }
+    entry->path_attrs_ptr = &entry->path_attrs;
+    entry->path_attrs_id = path_attrs_cache_next_id(cache);
+    *lenp = slen;
+    return PARSEBGP_OK;
+  }
+
+  // miss: decode into the victim slot
+  if (victim->id != 0) {
+    parsebgp_bgp_update_path_attrs_clear(&victim->path_attrs);
+    victim->id = 0;
+  }
+  if ((err = parsebgp_bgp_update_path_attrs_decode(
+         opts, &victim->path_attrs, buf, &slen, remain)) != PARSEBGP_OK) {
+    parsebgp_bgp_update_path_attrs_clear(&victim->path_attrs);
+    return err;
+  }
+  PARSEBGP_MAYBE_REALLOC(victim->raw, victim->_raw_alloc_len, attrs_len);
+  memcpy(victim->raw, buf + sizeof(attrs_len), attrs_len);
+  // the cached set outlives the buffer, so point it at our copy
+  victim->path_attrs.raw = victim->raw;
+  victim->hash = hash;
+  victim->subtype = subtype;
+  victim->raw_len = attrs_len;
+  victim->last_used = cache->generation;
+  victim->id = path_attrs_cache_next_id(cache);
+
+  entry->path_attrs_ptr = &victim->path_attrs;
+  entry->path_attrs_id = victim->id;
+  *lenp = slen;
+  return PARSEBGP_OK;
 }
 
 static parsebgp_error_t parse_table_dump_v2_rib_entries(
   parsebgp_opts_t *opts, parsebgp_mrt_table_dump_v2_subtype_t subtype,
-  parsebgp_mrt_table_dump_v2_rib_entry_t *entries, uint16_t entry_count,
-  const uint8_t *buf, size_t *lenp, size_t remain)
+  path_attrs_cache_t *cache, parsebgp_mrt_table_dump_v2_rib_entry_t *entries,
+  uint16_t entry_count, const uint8_t *buf, size_t *lenp, size_t remain)
 {
   size_t len = *lenp, nread = 0, slen;
   int i;
@@ -304,15 +667,31 @@ static parsebgp_error_t parse_table_dump_v2_rib_entries(
 
     // Peer Index
     PARSEBGP_DESERIALIZE_UINT16(buf, len, nread, entry->peer_index);
+    if (opts->mrt.peer_index != NULL) {
+      entry->peer = parsebgp_mrt_peer_index_get_peer(opts->mrt.peer_index,
+                                                     entry->peer_index);
+      if (entry->peer == NULL) {
+        PARSEBGP_RETURN_INVALID_MSG_ERR;
+      }
+    } else {
+      entry->peer = NULL;
+    }
 
     // Originated Time
     PARSEBGP_DESERIALIZE_UINT32(buf, len, nread, entry->originated_time);
 
     // Path Attributes
     slen = len - nread;
-    if ((err = parsebgp_bgp_update_path_attrs_decode(
-           opts, &entry->path_attrs, buf, &slen, remain - nread)) !=
-        PARSEBGP_OK) {
+    if (cache != NULL) {
+      err = parse_rib_entry_path_attrs_dedup(opts, cache, subtype, entry, buf,
+                                             &slen, remain - nread);
+    } else {
+      err = parsebgp_bgp_update_path_attrs_decode(opts, &entry->path_attrs, buf,
+                                                  &slen, remain - nread);
+      entry->path_attrs_ptr = &entry->path_attrs;
+      entry->path_attrs_id = 0;
+    }
+    if (err != PARSEBGP_OK) {
       return err;
     }
     nread += slen;
@@ -339,7 +718,7 @@ static void destroy_table_dump_v2_rib_entries(
     parsebgp_bgp_update_path_attrs_destroy(&entry->path_attrs);
   }
 
-  free(entries);
+  PARSEBGP_FREE(entries);
 }
 
 static void
@@ -355,6 +734,7 @@ clear_table_dump_v2_rib_entries(parsebgp_mrt_table_dump_v2_rib_entry_t *entries,
 static parsebgp_error_t
 parse_table_dump_v2_afi_safi_rib(parsebgp_opts_t *opts,
                                  parsebgp_mrt_table_dump_v2_subtype_t subtype,
+                                 path_attrs_cache_t *cache,
                                  parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg,
                                  const uint8_t *buf, size_t *lenp, size_t remain)
 {
@@ -392,8 +772,12 @@ parse_table_dump_v2_afi_safi_rib(parsebgp_opts_t *opts,
   // and then parse the entries
   slen = len - nread;
   if ((err = parse_table_dump_v2_rib_entries(
-         opts, subtype, msg->entries, msg->entry_count, buf, &slen,
+         opts, subtype, cache, msg->entries, msg->entry_count, buf, &slen,
          (remain - nread))) != PARSEBGP_OK) {
+    // the entries may be partly parsed (or left over from an earlier
+    // message), so don't report any of them
+    clear_table_dump_v2_rib_entries(msg->entries, msg->entry_count);
+    msg->entry_count = 0;
     return err;
   }
   nread += slen;
@@ -424,22 +808,36 @@ clear_table_dump_v2_afi_safi_rib(parsebgp_mrt_table_dump_v2_subtype_t subtype,
   msg->entry_count = 0;
 }
 
+static size_t table_dump_v2_afi_safi_rib_memory_usage(
+  const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg)
+{
+  size_t usage = sizeof(*msg->entries) * msg->_entries_alloc_cnt;
+  int i;
+
+  for (i = 0; i < msg->_entries_alloc_cnt; i++) {
+    usage +=
+      parsebgp_bgp_update_path_attrs_memory_usage(&msg->entries[i].path_attrs);
+  }
+  return usage;
+}
+
 static void
 dump_table_dump_v2_afi_safi_rib(
-    parsebgp_mrt_table_dump_v2_subtype_t subtype,
+    parsebgp_sink_t *sink, parsebgp_mrt_table_dump_v2_subtype_t subtype,
     const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg,
     int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_v2_afi_safi_rib_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_v2_afi_safi_rib_t,
+                           depth);
 
   int afi = (subtype == PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST ||
              subtype == PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST)
               ? PARSEBGP_BGP_AFI_IPV4
               : PARSEBGP_BGP_AFI_IPV6;
 
-  PARSEBGP_DUMP_INT(depth, "Sequence", msg->sequence);
-  PARSEBGP_DUMP_PFX(depth, "Prefix", afi, msg->prefix, msg->prefix_len);
-  PARSEBGP_DUMP_INT(depth, "Entry Count", msg->entry_count);
+  PARSEBGP_DUMP_INT(sink, depth, "Sequence", msg->sequence);
+  PARSEBGP_DUMP_PFX(sink, depth, "Prefix", afi, msg->prefix, msg->prefix_len);
+  PARSEBGP_DUMP_INT(sink, depth, "Entry Count", msg->entry_count);
 
   depth++;
   int i;
@@ -447,12 +845,25 @@ dump_table_dump_v2_afi_safi_rib(
   for (i = 0; i < msg->entry_count; i++) {
     entry = &msg->entries[i];
 
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_v2_rib_entry_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_v2_rib_entry_t,
+                             depth);
 
-    PARSEBGP_DUMP_INT(depth, "Peer Index", entry->peer_index);
-    PARSEBGP_DUMP_INT(depth, "Originated Time", entry->originated_time);
+    PARSEBGP_DUMP_INT(sink, depth, "Peer Index", entry->peer_index);
+    if (entry->peer != NULL) {
+      PARSEBGP_DUMP_INT(sink, depth, "Peer ASN", entry->peer->asn);
+      PARSEBGP_DUMP_IP(sink, depth, "Peer IP", entry->peer->ip_afi,
+                       entry->peer->ip);
+    }
+    PARSEBGP_DUMP_INT(sink, depth, "Originated Time", entry->originated_time);
+    if (entry->path_attrs_id != 0) {
+      PARSEBGP_DUMP_VAL(sink, depth, "Path Attrs ID", PRIu32,
+                        entry->path_attrs_id);
+    }
 
-    parsebgp_bgp_update_path_attrs_dump(&entry->path_attrs, depth + 1);
+    parsebgp_bgp_update_path_attrs_dump(sink, entry->path_attrs_ptr != NULL
+                                          ? entry->path_attrs_ptr
+                                          : &entry->path_attrs,
+                                        depth + 1);
   }
 }
 
@@ -472,8 +883,17 @@ static parsebgp_error_t parse_table_dump_v2(
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
-    return parse_table_dump_v2_afi_safi_rib(opts, subtype, &msg->afi_safi_rib,
-                                            buf, lenp, remain);
+    if (opts->mrt.path_attrs_dedup) {
+      if (msg->_path_attrs_cache == NULL &&
+          (msg->_path_attrs_cache = path_attrs_cache_create(
+             opts->mrt.path_attrs_dedup_cache_size)) == NULL) {
+        return PARSEBGP_MALLOC_FAILURE;
+      }
+      path_attrs_cache_begin(msg->_path_attrs_cache, opts);
+    }
+    return parse_table_dump_v2_afi_safi_rib(
+      opts, subtype, opts->mrt.path_attrs_dedup ? msg->_path_attrs_cache : NULL,
+      &msg->afi_safi_rib, buf, lenp, remain);
     break;
 
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_GENERIC:
@@ -502,8 +922,21 @@ static void destroy_table_dump_v2(parsebgp_mrt_table_dump_v2_subtype_t subtype,
 
   destroy_table_dump_v2_peer_index(&msg->peer_index);
   destroy_table_dump_v2_afi_safi_rib(subtype, &msg->afi_safi_rib);
+  path_attrs_cache_destroy(msg->_path_attrs_cache);
+
+  PARSEBGP_FREE(msg);
+}
 
-  free(msg);
+static size_t
+table_dump_v2_memory_usage(const parsebgp_mrt_table_dump_v2_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) +
+         table_dump_v2_peer_index_memory_usage(&msg->peer_index) +
+         table_dump_v2_afi_safi_rib_memory_usage(&msg->afi_safi_rib) +
+         path_attrs_cache_memory_usage(msg->_path_attrs_cache);
 }
 
 static void clear_table_dump_v2(parsebgp_mrt_table_dump_v2_subtype_t subtype,
@@ -533,22 +966,24 @@ static void clear_table_dump_v2(parsebgp_mrt_table_dump_v2_subtype_t subtype,
   }
 }
 
-static void dump_table_dump_v2(parsebgp_mrt_table_dump_v2_subtype_t subtype,
+static void dump_table_dump_v2(parsebgp_sink_t *sink,
+                               parsebgp_mrt_table_dump_v2_subtype_t subtype,
                                const parsebgp_mrt_table_dump_v2_t *msg,
                                int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_table_dump_v2_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_table_dump_v2_t, depth);
 
   switch (subtype) {
   case PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE:
-    dump_table_dump_v2_peer_index(&msg->peer_index, depth + 1);
+    dump_table_dump_v2_peer_index(sink, &msg->peer_index, depth + 1);
     break;
 
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
-    dump_table_dump_v2_afi_safi_rib(subtype, &msg->afi_safi_rib, depth + 1);
+    dump_table_dump_v2_afi_safi_rib(sink, subtype,
+                                    &msg->afi_safi_rib, depth + 1);
     break;
 
   case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_GENERIC:
@@ -765,6 +1200,29 @@ static parsebgp_error_t parse_bgp4mp(parsebgp_opts_t *opts,
   return err;
 }
 
+static void destroy_bgp(parsebgp_mrt_bgp_t *msg)
+{
+  if (msg == NULL) {
+    return;
+  }
+
+  parsebgp_bgp_update_destroy(msg->data.update);
+  parsebgp_bgp_open_destroy(msg->data.open);
+  parsebgp_bgp_notification_destroy(msg->data.notification);
+
+  PARSEBGP_FREE(msg);
+}
+
+static size_t bgp_memory_usage(const parsebgp_mrt_bgp_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + parsebgp_bgp_update_memory_usage(msg->data.update) +
+         parsebgp_bgp_open_memory_usage(msg->data.open) +
+         parsebgp_bgp_notification_memory_usage(msg->data.notification);
+}
+
 static void destroy_bgp4mp(parsebgp_mrt_bgp4mp_subtype_t subtype,
                            parsebgp_mrt_bgp4mp_t *msg)
 {
@@ -774,7 +1232,15 @@ static void destroy_bgp4mp(parsebgp_mrt_bgp4mp_subtype_t subtype,
 
   parsebgp_bgp_destroy_msg(msg->data.bgp_msg);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+static size_t bgp4mp_memory_usage(const parsebgp_mrt_bgp4mp_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+  return sizeof(*msg) + parsebgp_bgp_msg_memory_usage(msg->data.bgp_msg);
 }
 
 static void clear_bgp4mp(parsebgp_mrt_bgp4mp_subtype_t subtype,
@@ -802,33 +1268,36 @@ static void clear_bgp4mp(parsebgp_mrt_bgp4mp_subtype_t subtype,
   }
 }
 
-static void dump_bgp4mp(parsebgp_mrt_bgp4mp_subtype_t subtype,
+static void dump_bgp4mp(parsebgp_sink_t *sink,
+                        parsebgp_mrt_bgp4mp_subtype_t subtype,
                         const parsebgp_mrt_bgp4mp_t *msg, int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_bgp4mp_t, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_bgp4mp_t, depth);
 
-  PARSEBGP_DUMP_INT(depth, "Peer ASN", msg->peer_asn);
-  PARSEBGP_DUMP_INT(depth, "Local ASN", msg->local_asn);
-  PARSEBGP_DUMP_INT(depth, "Interface Index", msg->interface_index);
-  PARSEBGP_DUMP_INT(depth, "AFI", msg->afi);
-  PARSEBGP_DUMP_IP(depth, "Peer IP", msg->afi, msg->peer_ip);
-  PARSEBGP_DUMP_IP(depth, "Local IP", msg->afi, msg->local_ip);
+  PARSEBGP_DUMP_INT(sink, depth, "Peer ASN", msg->peer_asn);
+  PARSEBGP_DUMP_INT(sink, depth, "Local ASN", msg->local_asn);
+  PARSEBGP_DUMP_INT(sink, depth, "Interface Index", msg->interface_index);
+  PARSEBGP_DUMP_INT(sink, depth, "AFI", msg->afi);
+  PARSEBGP_DUMP_IP(sink, depth, "Peer IP", msg->afi, msg->peer_ip);
+  PARSEBGP_DUMP_IP(sink, depth, "Local IP", msg->afi, msg->local_ip);
 
   depth++;
   switch (subtype) {
   case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
   case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
-    PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_bgp4mp_state_change_t, depth);
+    PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_bgp4mp_state_change_t, depth);
 
-    PARSEBGP_DUMP_INT(depth, "Old State", msg->data.state_change.old_state);
-    PARSEBGP_DUMP_INT(depth, "New State", msg->data.state_change.new_state);
+    PARSEBGP_DUMP_INT(sink, depth, "Old State",
+                      msg->data.state_change.old_state);
+    PARSEBGP_DUMP_INT(sink, depth, "New State",
+                      msg->data.state_change.new_state);
     break;
 
   case PARSEBGP_MRT_BGP4MP_MESSAGE:
   case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
   case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
   case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
-    parsebgp_bgp_dump_msg(msg->data.bgp_msg, depth);
+    parsebgp_bgp_dump_msg(sink, msg->data.bgp_msg, depth);
     break;
 
   default:
@@ -885,18 +1354,46 @@ static parsebgp_error_t parse_common_hdr(parsebgp_opts_t *opts,
   return PARSEBGP_OK;
 }
 
-static void dump_common_hdr(const parsebgp_mrt_msg_t *msg, int depth)
+parsebgp_error_t parsebgp_mrt_peek_hdr(const uint8_t *buf, size_t len,
+                                       uint16_t *type, uint16_t *subtype,
+                                       size_t *msg_len)
+{
+  size_t nread = 0;
+  uint32_t ts, mlen;
+
+  // Timestamp (ignored)
+  PARSEBGP_DESERIALIZE_UINT32(buf, len, nread, ts);
+  (void)ts;
+
+  // Type
+  PARSEBGP_DESERIALIZE_UINT16(buf, len, nread, *type);
+
+  // Sub-type
+  PARSEBGP_DESERIALIZE_UINT16(buf, len, nread, *subtype);
+
+  // Length (extended timestamps are included in the message length)
+  PARSEBGP_DESERIALIZE_UINT32(buf, len, nread, mlen);
+  if (mlen > len - nread) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+
+  *msg_len = MRT_HDR_LEN + (size_t)mlen;
+  return PARSEBGP_OK;
+}
+
+static void dump_common_hdr(parsebgp_sink_t *sink,
+                            const parsebgp_mrt_msg_t *msg, int depth)
 {
-  PARSEBGP_DUMP_INT(depth, "Timestamp.sec", msg->timestamp_sec);
-  PARSEBGP_DUMP_INT(depth, "Type", msg->type);
-  PARSEBGP_DUMP_INT(depth, "Subtype", msg->subtype);
-  PARSEBGP_DUMP_INT(depth, "Length", msg->len);
-  PARSEBGP_DUMP_INT(depth, "Timestamp.usec", msg->timestamp_usec);
+  PARSEBGP_DUMP_INT(sink, depth, "Timestamp.sec", msg->timestamp_sec);
+  PARSEBGP_DUMP_INT(sink, depth, "Type", msg->type);
+  PARSEBGP_DUMP_INT(sink, depth, "Subtype", msg->subtype);
+  PARSEBGP_DUMP_INT(sink, depth, "Length", msg->len);
+  PARSEBGP_DUMP_INT(sink, depth, "Timestamp.usec", msg->timestamp_usec);
 }
 
-parsebgp_error_t parsebgp_mrt_decode(parsebgp_opts_t *opts,
-                                     parsebgp_mrt_msg_t *msg, const uint8_t *buf,
-                                     size_t *len)
+static parsebgp_error_t decode_msg(parsebgp_opts_t *opts,
+                                   parsebgp_mrt_msg_t *msg, const uint8_t *buf,
+                                   size_t *len)
 {
   parsebgp_error_t err = PARSEBGP_OK;
   size_t slen = 0, nread = 0, remain = 0;
@@ -968,6 +1465,13 @@ parsebgp_error_t parsebgp_mrt_decode(parsebgp_opts_t *opts,
     // unknown message type
     PARSEBGP_RETURN_INVALID_MSG_ERR;
   }
+  if (err == PARSEBGP_PARTIAL_MSG) {
+    // the whole MRT message is in the buffer, so the sub-message must be
+    // truncated (and more data won't help): skip to the end of the MRT
+    // message so that the caller can carry on
+    *len = MRT_HDR_LEN + msg->len;
+    return PARSEBGP_TRUNCATED_MSG;
+  }
   if (err != PARSEBGP_OK && err != PARSEBGP_TRUNCATED_MSG) {
     return err;
   }
@@ -988,6 +1492,30 @@ parsebgp_error_t parsebgp_mrt_decode(parsebgp_opts_t *opts,
   return err;
 }
 
+parsebgp_error_t parsebgp_mrt_decode(parsebgp_opts_t *opts,
+                                     parsebgp_mrt_msg_t *msg, const uint8_t *buf,
+                                     size_t *len)
+{
+#ifdef PARSEBGP_STATS
+  parsebgp_error_t err;
+  uint64_t start;
+
+  if (opts->stats == NULL) {
+    return decode_msg(opts, msg, buf, len);
+  }
+  start = parsebgp_stats_now();
+  err = decode_msg(opts, msg, buf, len);
+  if ((err == PARSEBGP_OK || err == PARSEBGP_TRUNCATED_MSG) &&
+      msg->type < PARSEBGP_STATS_MRT_TYPES &&
+      msg->subtype < PARSEBGP_STATS_MRT_SUBTYPES) {
+    PARSEBGP_STATS_MSG(opts, mrt[msg->type][msg->subtype], *len, start);
+  }
+  return err;
+#else
+  return decode_msg(opts, msg, buf, len);
+#endif
+}
+
 void parsebgp_mrt_destroy_msg(parsebgp_mrt_msg_t *msg)
 {
   if (msg == NULL) {
@@ -997,15 +1525,28 @@ void parsebgp_mrt_destroy_msg(parsebgp_mrt_msg_t *msg)
   // common header has no dynamically allocated memory
 
   // free per-type memory
+  destroy_bgp(msg->types.bgp);
   destroy_table_dump(msg->subtype, msg->types.table_dump);
   destroy_table_dump_v2(msg->subtype, msg->types.table_dump_v2);
   destroy_bgp4mp(msg->subtype, msg->types.bgp4mp);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
 
   return;
 }
 
+size_t parsebgp_mrt_msg_memory_usage(const parsebgp_mrt_msg_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+
+  return sizeof(*msg) + bgp_memory_usage(msg->types.bgp) +
+         table_dump_memory_usage(msg->types.table_dump) +
+         table_dump_v2_memory_usage(msg->types.table_dump_v2) +
+         bgp4mp_memory_usage(msg->types.bgp4mp);
+}
+
 void parsebgp_mrt_clear_msg(parsebgp_mrt_msg_t *msg)
 {
   if (msg == NULL) {
@@ -1035,23 +1576,24 @@ void parsebgp_mrt_clear_msg(parsebgp_mrt_msg_t *msg)
   }
 }
 
-void parsebgp_mrt_dump_msg(const parsebgp_mrt_msg_t *msg, int depth)
+void parsebgp_mrt_dump_msg(parsebgp_sink_t *sink, const parsebgp_mrt_msg_t *msg,
+                           int depth)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_mrt_msg_t, depth);
-  dump_common_hdr(msg, depth);
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_mrt_msg_t, depth);
+  dump_common_hdr(sink, msg, depth);
 
   switch (msg->type) {
   case PARSEBGP_MRT_TYPE_TABLE_DUMP:
-    dump_table_dump(msg->subtype, msg->types.table_dump, depth + 1);
+    dump_table_dump(sink, msg->subtype, msg->types.table_dump, depth + 1);
     break;
 
   case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
-    dump_table_dump_v2(msg->subtype, msg->types.table_dump_v2, depth + 1);
+    dump_table_dump_v2(sink, msg->subtype, msg->types.table_dump_v2, depth + 1);
     break;
 
   case PARSEBGP_MRT_TYPE_BGP4MP:
   case PARSEBGP_MRT_TYPE_BGP4MP_ET:
-    dump_bgp4mp(msg->subtype, msg->types.bgp4mp, depth + 1);
+    dump_bgp4mp(sink, msg->subtype, msg->types.bgp4mp, depth + 1);
     break;
 
   case PARSEBGP_MRT_TYPE_ISIS:
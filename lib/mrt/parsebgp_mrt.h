@@ -144,9 +144,32 @@ typedef struct parsebgp_mrt_table_dump_v2_rib_entry {
   /** Time prefix was heard (in seconds since the unix epoch) */
   uint32_t originated_time;
 
-  /** Path Attributes */
+  /** Path Attributes (left empty if the mrt.path_attrs_dedup option is set,
+      use path_attrs_ptr instead) */
   parsebgp_bgp_update_path_attrs_t path_attrs;
 
+  /** Pointer to the decoded Path Attributes of this entry
+   *
+   * This points either to the path_attrs field above, or (if the
+   * mrt.path_attrs_dedup option is set) to an attribute set shared with other
+   * entries. Shared sets are owned by the message and remain valid until the
+   * next TABLE_DUMP_V2 RIB message is decoded into it.
+   */
+  const parsebgp_bgp_update_path_attrs_t *path_attrs_ptr;
+
+  /** Path Attribute Set ID (only set if the mrt.path_attrs_dedup option is
+   * set, zero otherwise)
+   *
+   * Entries with the same ID have identical Path Attributes. (The reverse is
+   * not guaranteed: the same attributes may be given a new ID if they were
+   * evicted from the cache.)
+   */
+  uint32_t path_attrs_id;
+
+  /** Peer that this entry was received from (only set if the mrt.peer_index
+      option is set, NULL otherwise). Points into the shared peer index. */
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *peer;
+
 } parsebgp_mrt_table_dump_v2_rib_entry_t;
 
 /**
@@ -214,6 +237,10 @@ typedef struct parsebgp_mrt_table_dump_v2 {
   // TODO: add support for Generic RIB
   // parsebgp_mrt_table_dump_v2_generic_rib_t generic_rib;
 
+  /** Cache of decoded Path Attribute sets (INTERNAL, used when the
+      mrt.path_attrs_dedup option is set) */
+  struct parsebgp_mrt_path_attrs_cache *_path_attrs_cache;
+
 } parsebgp_mrt_table_dump_v2_t;
 
 typedef enum {
@@ -479,6 +506,81 @@ parsebgp_error_t parsebgp_mrt_decode(parsebgp_opts_t *opts,
                                      parsebgp_mrt_msg_t *msg, const uint8_t *buf,
                                      size_t *len);
 
+/**
+ * Read the common header of the MRT message at the start of the given buffer
+ * without decoding the message body
+ *
+ * @param [in] buf      Pointer to the start of a raw MRT message
+ * @param [in] len      Length of the data buffer
+ * @param [out] type    Set to the message type (parsebgp_mrt_msg_type_t)
+ * @param [out] subtype Set to the message sub-type
+ * @param [out] msg_len Set to the total length of the message, INCLUDING the
+ *                      common header
+ * @return PARSEBGP_OK (0) if the header was read, PARSEBGP_PARTIAL_MSG if the
+ * buffer does not hold the full message
+ *
+ * This allows a reader to split a dump into records (e.g., to hand
+ * TABLE_DUMP_V2 RIB records to worker threads) without parsing them.
+ */
+parsebgp_error_t parsebgp_mrt_peek_hdr(const uint8_t *buf, size_t len,
+                                       uint16_t *type, uint16_t *subtype,
+                                       size_t *msg_len);
+
+/**
+ * Opaque structure holding an immutable copy of a TABLE_DUMP_V2 Peer Index
+ * Table
+ */
+typedef struct parsebgp_mrt_peer_index parsebgp_mrt_peer_index_t;
+
+/**
+ * Create a shareable peer index from a decoded Peer Index Table
+ *
+ * @param msg           Pointer to the decoded Peer Index Table to copy
+ * @return pointer to the new peer index, NULL if memory allocation failed
+ *
+ * The peer index is a deep copy, so the message it was created from may be
+ * cleared or reused. Once created, the index is never modified and may be read
+ * concurrently by any number of threads (e.g., by setting it as the
+ * mrt.peer_index option of each worker's parser options).
+ */
+parsebgp_mrt_peer_index_t *parsebgp_mrt_peer_index_create(
+  const parsebgp_mrt_table_dump_v2_peer_index_t *msg);
+
+/** Destroy the given peer index
+ *
+ * @param idx           Pointer to the peer index to destroy
+ */
+void parsebgp_mrt_peer_index_destroy(parsebgp_mrt_peer_index_t *idx);
+
+/**
+ * Get the Peer Index Table that the given peer index was created from
+ *
+ * @param idx           Pointer to the peer index
+ * @return pointer to the (read-only) copy of the Peer Index Table
+ */
+const parsebgp_mrt_table_dump_v2_peer_index_t *
+parsebgp_mrt_peer_index_get_table(const parsebgp_mrt_peer_index_t *idx);
+
+/**
+ * Get the number of peers in the given peer index
+ *
+ * @param idx           Pointer to the peer index
+ * @return the number of peers
+ */
+uint16_t parsebgp_mrt_peer_index_get_peers_cnt(
+  const parsebgp_mrt_peer_index_t *idx);
+
+/**
+ * Look up a peer by its index
+ *
+ * @param idx           Pointer to the peer index
+ * @param peer_index    Index of the peer (as found in a RIB entry)
+ * @return pointer to the peer entry, NULL if the index is out of range
+ */
+const parsebgp_mrt_table_dump_v2_peer_entry_t *
+parsebgp_mrt_peer_index_get_peer(const parsebgp_mrt_peer_index_t *idx,
+                                 uint16_t peer_index);
+
 /** Destroy the given MRT message structure
  *
  * @param msg           Pointer to message structure to destroy
@@ -492,8 +594,18 @@ void parsebgp_mrt_destroy_msg(parsebgp_mrt_msg_t *msg);
 void parsebgp_mrt_clear_msg(parsebgp_mrt_msg_t *msg);
 
 /**
- * Dump a human-readable version of the message to stdout
+ * Get the amount of memory allocated for the given MRT message structure
+ *
+ * @param msg           Pointer to the message structure
+ * @return the number of bytes allocated (including memory retained for reuse
+ * after the message was cleared, and the Path Attribute dedup cache)
+ */
+size_t parsebgp_mrt_msg_memory_usage(const parsebgp_mrt_msg_t *msg);
+
+/**
+ * Dump a human-readable version of the message to a sink
  *
+ * @param sink          Sink to write to (NULL for stdout)
  * @param msg           Pointer to the parsed message to dump
  * @param depth         Depth of the message within the overall message
  *
@@ -502,6 +614,7 @@ void parsebgp_mrt_clear_msg(parsebgp_mrt_msg_t *msg);
  * and sizes of structures. It may be useful to potential users of the library
  * to get a sense of their data.
  */
-void parsebgp_mrt_dump_msg(const parsebgp_mrt_msg_t *msg, int depth);
+void parsebgp_mrt_dump_msg(parsebgp_sink_t *sink, const parsebgp_mrt_msg_t *msg,
+                           int depth);
 
 #endif /* __PARSEBGP_MRT_H */
@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_mrt_encode.h"
+#include "parsebgp_bgp_encode.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Number of bytes in the MRT common header (excluding extended timestamp
+    field) */
+#define MRT_HDR_LEN 12
+
+#define SERIALIZE_IP(afi, buf, len, nwrite, from)                              \
+  do {                                                                         \
+    switch ((afi)) {                                                           \
+    case PARSEBGP_BGP_AFI_IPV4:                                                \
+      PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, (from), 4);                   \
+      break;                                                                   \
+                                                                               \
+    case PARSEBGP_BGP_AFI_IPV6:                                                \
+      PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, from);                          \
+      break;                                                                   \
+                                                                               \
+    default:                                                                   \
+      PARSEBGP_RETURN_INVALID_MSG_ERR;                                         \
+    }                                                                          \
+  } while (0)
+
+static parsebgp_error_t encode_table_dump(parsebgp_opts_t *opts,
+                                          parsebgp_bgp_afi_t afi,
+                                          const parsebgp_mrt_table_dump_t *msg,
+                                          uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_error_t err;
+
+  // View Number
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->view_number);
+
+  // Sequence
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->sequence);
+
+  // Prefix Address
+  SERIALIZE_IP(afi, buf, len, nwrite, msg->prefix);
+
+  // Prefix Length
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->prefix_len);
+
+  // Status (unused)
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->status);
+
+  // Originated Time
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->originated_time);
+
+  // Peer IP address
+  SERIALIZE_IP(afi, buf, len, nwrite, msg->peer_ip);
+
+  // Peer ASN (2-byte only)
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->peer_asn);
+
+  // Path Attributes
+  slen = len - nwrite;
+  if ((err = parsebgp_bgp_update_path_attrs_encode(opts, &msg->path_attrs, buf,
+                                                   &slen)) != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t encode_table_dump_v2_peer_index(
+  const parsebgp_mrt_table_dump_v2_peer_index_t *msg, uint8_t *buf,
+  size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0;
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *pe;
+  int i;
+
+  // Collector BGP ID
+  PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, msg->collector_bgp_id);
+
+  // View Name Length
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->view_name_len);
+
+  // View Name
+  if (msg->view_name_len > 0) {
+    PARSEBGP_SERIALIZE_BYTES(buf, len, nwrite, msg->view_name,
+                             msg->view_name_len);
+  }
+
+  // Peer Count
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->peer_count);
+
+  // Peer Entries
+  for (i = 0; i < msg->peer_count; i++) {
+    pe = &msg->peer_entries[i];
+
+    // Peer Type
+    PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite,
+                             (pe->asn_type << 1) | (pe->ip_afi - 1));
+
+    // Peer BGP ID
+    PARSEBGP_SERIALIZE_VAL(buf, len, nwrite, pe->bgp_id);
+
+    // Peer IP Address
+    SERIALIZE_IP(pe->ip_afi, buf, len, nwrite, pe->ip);
+
+    // Peer ASN
+    switch (pe->asn_type) {
+    case PARSEBGP_MRT_ASN_2_BYTE:
+      PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, pe->asn);
+      break;
+
+    case PARSEBGP_MRT_ASN_4_BYTE:
+      PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, pe->asn);
+      break;
+
+    default:
+      PARSEBGP_RETURN_INVALID_MSG_ERR;
+    }
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t encode_table_dump_v2_afi_safi_rib(
+  parsebgp_opts_t *opts, parsebgp_mrt_table_dump_v2_subtype_t subtype,
+  const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg, uint8_t *buf,
+  size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  size_t max_pfx;
+  const parsebgp_mrt_table_dump_v2_rib_entry_t *entry;
+  parsebgp_opts_t bgp_opts;
+  parsebgp_error_t err;
+  int i;
+
+  // RIB entries use 4-byte ASNs and the "compressed" MP_REACH_NLRI (RFC6396
+  // section 4.3.4). Use a copy of the options so that the caller's are not
+  // changed.
+  bgp_opts = *opts;
+  bgp_opts.bgp.asn_4_byte = 1;
+  bgp_opts.bgp.mp_reach_no_afi_safi_reserved = 1;
+
+  // Sequence Number
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->sequence);
+
+  // Prefix Length
+  PARSEBGP_SERIALIZE_UINT8(buf, len, nwrite, msg->prefix_len);
+
+  // Prefix
+  slen = len - nwrite;
+  max_pfx = (subtype == PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST ||
+             subtype == PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST) ?
+              32 : 128;
+  err = parsebgp_encode_prefix(msg->prefix_len, msg->prefix, buf, &slen,
+                               max_pfx);
+  if (err != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+  buf += slen;
+
+  // Entry Count
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->entry_count);
+
+  // RIB Entries
+  for (i = 0; i < msg->entry_count; i++) {
+    entry = &msg->entries[i];
+
+    // Peer Index
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, entry->peer_index);
+
+    // Originated Time
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, entry->originated_time);
+
+    // Path Attributes (which may be shared with other entries)
+    slen = len - nwrite;
+    if ((err = parsebgp_bgp_update_path_attrs_encode(
+           &bgp_opts,
+           entry->path_attrs_ptr != NULL ? entry->path_attrs_ptr
+                                         : &entry->path_attrs,
+           buf, &slen)) != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+encode_table_dump_v2(parsebgp_opts_t *opts,
+                     parsebgp_mrt_table_dump_v2_subtype_t subtype,
+                     const parsebgp_mrt_table_dump_v2_t *msg, uint8_t *buf,
+                     size_t *lenp)
+{
+  switch (subtype) {
+  case PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE:
+    return encode_table_dump_v2_peer_index(&msg->peer_index, buf, lenp);
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
+    return encode_table_dump_v2_afi_safi_rib(opts, subtype, &msg->afi_safi_rib,
+                                             buf, lenp);
+
+  default:
+    // the decoder doesn't support RIB_GENERIC either
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+}
+
+static parsebgp_error_t encode_bgp4mp(parsebgp_opts_t *opts,
+                                      parsebgp_mrt_bgp4mp_subtype_t subtype,
+                                      const parsebgp_mrt_bgp4mp_t *msg,
+                                      uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  parsebgp_opts_t bgp_opts;
+  parsebgp_error_t err;
+
+  // ASN fields
+  switch (subtype) {
+  // 2-byte ASN subtypes:
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+    // Peer ASN
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->peer_asn);
+
+    // Local ASN
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->local_asn);
+    break;
+
+  // 4-byte ASN subtypes:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+    // Peer ASN
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->peer_asn);
+
+    // Local ASN
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->local_asn);
+    break;
+
+  default:
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+
+  // old Quagga versions omitted these fields, which the decoder signals with
+  // an AFI of zero
+  if (msg->afi != 0) {
+    // Interface Index
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->interface_index);
+
+    // Address Family
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->afi);
+
+    // Peer IP
+    SERIALIZE_IP(msg->afi, buf, len, nwrite, msg->peer_ip);
+
+    // Local IP
+    SERIALIZE_IP(msg->afi, buf, len, nwrite, msg->local_ip);
+  }
+
+  switch (subtype) {
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
+    // Old State
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              msg->data.state_change.old_state);
+
+    // New State
+    PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite,
+                              msg->data.state_change.new_state);
+    break;
+
+  case PARSEBGP_MRT_BGP4MP_MESSAGE:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+    bgp_opts = *opts;
+    if (subtype == PARSEBGP_MRT_BGP4MP_MESSAGE_AS4 ||
+        subtype == PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL) {
+      bgp_opts.bgp.asn_4_byte = 1;
+    }
+    slen = len - nwrite;
+    if ((err = parsebgp_bgp_encode(&bgp_opts, msg->data.bgp_msg, buf,
+                                   &slen)) != PARSEBGP_OK) {
+      return err;
+    }
+    nwrite += slen;
+    buf += slen;
+    break;
+
+  default:
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t parsebgp_mrt_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_mrt_msg_t *msg,
+                                     uint8_t *buf, size_t *lenp)
+{
+  size_t len = *lenp, nwrite = 0, slen;
+  uint8_t *len_buf;
+  parsebgp_error_t err;
+
+  // Timestamp
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->timestamp_sec);
+
+  // Type
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->type);
+
+  // Sub-type
+  PARSEBGP_SERIALIZE_UINT16(buf, len, nwrite, msg->subtype);
+
+  // Length (filled in below)
+  len_buf = buf;
+  PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, 0);
+
+  // Microsecond Timestamp (which is included in the length)
+  if (msg->type == PARSEBGP_MRT_TYPE_BGP4MP_ET) {
+    PARSEBGP_SERIALIZE_UINT32(buf, len, nwrite, msg->timestamp_usec);
+  }
+
+  slen = len - nwrite;
+  switch (msg->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP:
+    err = encode_table_dump(opts, msg->subtype, msg->types.table_dump, buf,
+                            &slen);
+    break;
+
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    err = encode_table_dump_v2(opts, msg->subtype, msg->types.table_dump_v2,
+                               buf, &slen);
+    break;
+
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    err = encode_bgp4mp(opts, msg->subtype, msg->types.bgp4mp, buf, &slen);
+    break;
+
+  default:
+    // the deprecated BGP type, and the types that the decoder skips
+    return PARSEBGP_NOT_IMPLEMENTED;
+  }
+  if (err != PARSEBGP_OK) {
+    return err;
+  }
+  nwrite += slen;
+
+  // Length (excluding the common header)
+  slen = nwrite - MRT_HDR_LEN;
+  if (slen > UINT32_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  len_buf[0] = (uint8_t)(slen >> 24);
+  len_buf[1] = (uint8_t)(slen >> 16);
+  len_buf[2] = (uint8_t)(slen >> 8);
+  len_buf[3] = (uint8_t)slen;
+
+  *lenp = nwrite;
+  return PARSEBGP_OK;
+}
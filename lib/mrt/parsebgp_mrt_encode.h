@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_MRT_ENCODE_H
+#define __PARSEBGP_MRT_ENCODE_H
+
+#include "parsebgp_error.h"
+#include "parsebgp_mrt.h"
+#include "parsebgp_opts.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Encode an MRT message (including the common header)
+ *
+ * @param [in] opts     Options for the encoder
+ * @param [in] msg      Pointer to the MRT message to encode
+ * @param [in] buf      Buffer to write the message into
+ * @param [in,out] len  Length of the buffer. Updated with the number of bytes
+ *                      written to the buffer.
+ * @return PARSEBGP_OK (0) if the message was encoded successfully,
+ * PARSEBGP_PARTIAL_MSG if the buffer is too small, or another error code
+ * otherwise
+ *
+ * This is the inverse of parsebgp_mrt_decode (see parsebgp_bgp_encode.h for
+ * how the BGP parts of the message are encoded). The length field of the
+ * common header is computed, the len field of the message is ignored.
+ *
+ * TABLE_DUMP, TABLE_DUMP_V2 (PEER_INDEX_TABLE and the AFI/SAFI-specific RIB
+ * subtypes), BGP4MP and BGP4MP_ET messages are supported. RIB entries are
+ * written from their path_attrs_ptr (if set), so messages decoded with the
+ * mrt.path_attrs_dedup option are encoded correctly.
+ */
+parsebgp_error_t parsebgp_mrt_encode(parsebgp_opts_t *opts,
+                                     const parsebgp_mrt_msg_t *msg,
+                                     uint8_t *buf, size_t *len);
+
+#endif /* __PARSEBGP_MRT_ENCODE_H */
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_mrt_merge.h"
+#include "parsebgp_mrt.h"
+#include "parsebgp_utils.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of bytes in the MRT common header (excluding extended timestamp
+    field) */
+#define MRT_HDR_LEN 12
+
+/** Size of the stdio buffer of each source */
+#define SOURCE_BUF_LEN (64 * 1024)
+
+/** Initial size of the record buffer of each source */
+#define RECORD_ALLOC_INIT 4096
+
+/** State of a single merge source */
+typedef struct merge_source {
+
+  /** File being read */
+  FILE *fp;
+
+  /** stdio buffer for fp (NULL for stdin) */
+  char *fp_buf;
+
+  /** Buffer holding the current record */
+  uint8_t *rec;
+
+  /** Length of the current record */
+  size_t rec_len;
+
+  /** Allocated length of rec */
+  size_t _rec_alloc_len;
+
+  /** Timestamp of the current record */
+  uint32_t ts_sec;
+  uint32_t ts_usec;
+
+} merge_source_t;
+
+struct parsebgp_mrt_merge {
+
+  /** Array of sources, in order of addition */
+  merge_source_t *sources;
+
+  /** Number of sources */
+  int sources_cnt;
+
+  /** Min-heap of indices of sources with a record ready */
+  int *heap;
+
+  /** Number of sources in the heap */
+  int heap_cnt;
+
+  /** Source whose record was last returned (and must be refilled before the
+      next record can be chosen), -1 if none */
+  int pending;
+
+  /** Number of sources whose first record has been read */
+  int primed;
+
+  /** Set once parsebgp_mrt_merge_next has been called */
+  int started;
+
+};
+
+static void source_close(merge_source_t *src)
+{
+  if (src->fp != NULL && src->fp != stdin) {
+    fclose(src->fp);
+  }
+  src->fp = NULL;
+  free(src->fp_buf);
+  src->fp_buf = NULL;
+  free(src->rec);
+  src->rec = NULL;
+  src->rec_len = 0;
+  src->_rec_alloc_len = 0;
+}
+
+/** Read the next record of the given source. Sets rec_len to zero at EOF. */
+static parsebgp_error_t source_read(merge_source_t *src)
+{
+  size_t nread, body_len;
+  uint16_t type;
+
+  src->rec_len = 0;
+
+  // Common Header
+  nread = fread(src->rec, 1, MRT_HDR_LEN, src->fp);
+  if (nread == 0 && feof(src->fp)) {
+    return PARSEBGP_OK;
+  }
+  if (nread != MRT_HDR_LEN) {
+    return ferror(src->fp) ? PARSEBGP_IO_ERROR : PARSEBGP_PARTIAL_MSG;
+  }
+  type = nptohs(src->rec + 4);
+  body_len = nptohl(src->rec + 8);
+  if (body_len > PARSEBGP_MRT_MERGE_MAX_RECORD_LEN - MRT_HDR_LEN) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  // Message Body
+  PARSEBGP_MAYBE_REALLOC(src->rec, src->_rec_alloc_len, MRT_HDR_LEN + body_len);
+  if (fread(src->rec + MRT_HDR_LEN, 1, body_len, src->fp) != body_len) {
+    return ferror(src->fp) ? PARSEBGP_IO_ERROR : PARSEBGP_PARTIAL_MSG;
+  }
+
+  src->ts_sec = nptohl(src->rec);
+  src->ts_usec = 0;
+  switch (type) {
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+  case PARSEBGP_MRT_TYPE_ISIS_ET:
+  case PARSEBGP_MRT_TYPE_OSPF_V3_ET:
+    if (body_len < sizeof(src->ts_usec)) {
+      PARSEBGP_RETURN_INVALID_MSG_ERR;
+    }
+    src->ts_usec = nptohl(src->rec + MRT_HDR_LEN);
+    break;
+
+  default:
+    break;
+  }
+
+  src->rec_len = MRT_HDR_LEN + body_len;
+  return PARSEBGP_OK;
+}
+
+/** Returns non-zero if the record of source a should be returned before that
+    of source b */
+static int heap_less(const parsebgp_mrt_merge_t *merge, int a, int b)
+{
+  const merge_source_t *sa = &merge->sources[a], *sb = &merge->sources[b];
+  if (sa->ts_sec != sb->ts_sec) {
+    return sa->ts_sec < sb->ts_sec;
+  }
+  if (sa->ts_usec != sb->ts_usec) {
+    return sa->ts_usec < sb->ts_usec;
+  }
+  return a < b;
+}
+
+static void heap_push(parsebgp_mrt_merge_t *merge, int src)
+{
+  int i = merge->heap_cnt++, parent;
+
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!heap_less(merge, src, merge->heap[parent])) {
+      break;
+    }
+    merge->heap[i] = merge->heap[parent];
+    i = parent;
+  }
+  merge->heap[i] = src;
+}
+
+static int heap_pop(parsebgp_mrt_merge_t *merge)
+{
+  int top = merge->heap[0];
+  int last = merge->heap[--merge->heap_cnt];
+  int i = 0, child;
+
+  while ((child = 2 * i + 1) < merge->heap_cnt) {
+    if (child + 1 < merge->heap_cnt &&
+        heap_less(merge, merge->heap[child + 1], merge->heap[child])) {
+      child++;
+    }
+    if (!heap_less(merge, merge->heap[child], last)) {
+      break;
+    }
+    merge->heap[i] = merge->heap[child];
+    i = child;
+  }
+  merge->heap[i] = last;
+
+  return top;
+}
+
+/** Read the next record of the given source and add it to the heap. On error
+    (or EOF) the source is closed. */
+static parsebgp_error_t source_advance(parsebgp_mrt_merge_t *merge, int idx)
+{
+  merge_source_t *src = &merge->sources[idx];
+  parsebgp_error_t err;
+
+  if ((err = source_read(src)) != PARSEBGP_OK || src->rec_len == 0) {
+    source_close(src);
+    return err;
+  }
+  heap_push(merge, idx);
+  return PARSEBGP_OK;
+}
+
+parsebgp_mrt_merge_t *parsebgp_mrt_merge_create(void)
+{
+  parsebgp_mrt_merge_t *merge;
+
+  if ((merge = malloc_zero(sizeof(*merge))) == NULL) {
+    return NULL;
+  }
+  merge->pending = -1;
+
+  return merge;
+}
+
+void parsebgp_mrt_merge_destroy(parsebgp_mrt_merge_t *merge)
+{
+  int i;
+
+  if (merge == NULL) {
+    return;
+  }
+  for (i = 0; i < merge->sources_cnt; i++) {
+    source_close(&merge->sources[i]);
+  }
+  free(merge->sources);
+  free(merge->heap);
+  free(merge);
+}
+
+parsebgp_error_t parsebgp_mrt_merge_add_file(parsebgp_mrt_merge_t *merge,
+                                             const char *path)
+{
+  merge_source_t *sources, *src;
+  int *heap;
+
+  if (merge->started) {
+    return PARSEBGP_INVALID_MSG;
+  }
+
+  if ((sources = realloc(merge->sources, sizeof(*sources) *
+                                           (merge->sources_cnt + 1))) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  merge->sources = sources;
+  if ((heap = realloc(merge->heap, sizeof(*heap) *
+                                     (merge->sources_cnt + 1))) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  merge->heap = heap;
+
+  src = &merge->sources[merge->sources_cnt];
+  memset(src, 0, sizeof(*src));
+
+  if (strcmp(path, "-") == 0) {
+    src->fp = stdin;
+  } else if ((src->fp = fopen(path, "r")) == NULL) {
+    return PARSEBGP_IO_ERROR;
+  }
+  if ((src->rec = malloc(RECORD_ALLOC_INIT)) == NULL) {
+    source_close(src);
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  // stdin is left with its default buffer since it outlives the source (and
+  // its buffer can't be changed once it has been used)
+  if (src->fp != stdin) {
+    if ((src->fp_buf = malloc(SOURCE_BUF_LEN)) == NULL) {
+      source_close(src);
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+    setvbuf(src->fp, src->fp_buf, _IOFBF, SOURCE_BUF_LEN);
+  }
+  src->_rec_alloc_len = RECORD_ALLOC_INIT;
+
+  merge->sources_cnt++;
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t parsebgp_mrt_merge_next(parsebgp_mrt_merge_t *merge,
+                                         const uint8_t **buf, size_t *len,
+                                         int *src)
+{
+  parsebgp_error_t err;
+  int idx;
+
+  *buf = NULL;
+  *len = 0;
+
+  merge->started = 1;
+
+  // prime the heap with the first record of each source
+  while (merge->primed < merge->sources_cnt) {
+    idx = merge->primed++;
+    if ((err = source_advance(merge, idx)) != PARSEBGP_OK) {
+      if (src != NULL) {
+        *src = idx;
+      }
+      return err;
+    }
+  }
+  // refill the source whose record we last returned
+  if ((idx = merge->pending) >= 0) {
+    merge->pending = -1;
+    if ((err = source_advance(merge, idx)) != PARSEBGP_OK) {
+      if (src != NULL) {
+        *src = idx;
+      }
+      return err;
+    }
+  }
+
+  if (merge->heap_cnt == 0) {
+    // all sources have been read
+    return PARSEBGP_OK;
+  }
+
+  idx = heap_pop(merge);
+  merge->pending = idx;
+
+  *buf = merge->sources[idx].rec;
+  *len = merge->sources[idx].rec_len;
+  if (src != NULL) {
+    *src = idx;
+  }
+  return PARSEBGP_OK;
+}
+
+int parsebgp_mrt_merge_get_sources_cnt(const parsebgp_mrt_merge_t *merge)
+{
+  return merge->sources_cnt;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_MRT_MERGE_H
+#define __PARSEBGP_MRT_MERGE_H
+
+#include "parsebgp_error.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/** Records longer than this (including the common header) are treated as
+    corrupt */
+#define PARSEBGP_MRT_MERGE_MAX_RECORD_LEN (16 * 1024 * 1024)
+
+/**
+ * Timestamp-ordered merge of MRT streams
+ *
+ * A merge reads records from any number of MRT files and returns them in
+ * order of their (timestamp_sec, timestamp_usec) timestamps. Only the common
+ * header of each record is parsed, and only one record per source is held in
+ * memory at a time, so memory use depends on the number of sources rather than
+ * on their length. Records with equal timestamps are returned in the order in
+ * which their sources were added, and records from one source are always
+ * returned in file order (so sources are expected to be time-ordered
+ * themselves, as MRT update dumps are).
+ *
+ * Records are returned raw; decode them with parsebgp_decode (using
+ * PARSEBGP_MSG_TYPE_MRT) or parsebgp_mrt_decode.
+ */
+typedef struct parsebgp_mrt_merge parsebgp_mrt_merge_t;
+
+/**
+ * Create an (empty) merge
+ *
+ * @return pointer to the merge, or NULL if memory allocation failed
+ */
+parsebgp_mrt_merge_t *parsebgp_mrt_merge_create(void);
+
+/** Destroy the given merge (and close all of its sources) */
+void parsebgp_mrt_merge_destroy(parsebgp_mrt_merge_t *merge);
+
+/**
+ * Add an MRT file to the merge
+ *
+ * @param merge         Pointer to the merge
+ * @param path          Path of the file to read ("-" for stdin)
+ * @return PARSEBGP_OK (0) if the source was added, or an error code otherwise
+ *
+ * Sources must be added before the first call to parsebgp_mrt_merge_next.
+ */
+parsebgp_error_t parsebgp_mrt_merge_add_file(parsebgp_mrt_merge_t *merge,
+                                             const char *path);
+
+/**
+ * Get the next record of the merged stream
+ *
+ * @param [in] merge    Pointer to the merge
+ * @param [out] buf     Set to point to the raw record (including the common
+ *                      header), valid until the next call
+ * @param [out] len     Set to the length of the record, or zero once all
+ *                      sources have been read
+ * @param [out] src     If not NULL, set to the index (in order of addition) of
+ *                      the source that the record (or error) belongs to
+ * @return PARSEBGP_OK (0) if a record was returned (or the end was reached), or
+ * an error code otherwise
+ *
+ * If a source fails (i.e., it cannot be read, ends in the middle of a record,
+ * or contains a record longer than PARSEBGP_MRT_MERGE_MAX_RECORD_LEN), the
+ * error is returned and the source is dropped from the merge; calling this
+ * function again continues with the remaining sources.
+ */
+parsebgp_error_t parsebgp_mrt_merge_next(parsebgp_mrt_merge_t *merge,
+                                         const uint8_t **buf, size_t *len,
+                                         int *src);
+
+/**
+ * Get the number of sources in the merge
+ *
+ * @param merge         Pointer to the merge
+ * @return the number of sources added to the merge
+ */
+int parsebgp_mrt_merge_get_sources_cnt(const parsebgp_mrt_merge_t *merge);
+
+#endif /* __PARSEBGP_MRT_MERGE_H */
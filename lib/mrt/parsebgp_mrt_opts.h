@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PARSEBGP_MRT_OPTS_H
+#define __PARSEBGP_MRT_OPTS_H
+
+#include <inttypes.h>
+
+/** Default number of slots in the TABLE_DUMP_V2 path attribute dedup cache */
+#define PARSEBGP_MRT_PATH_ATTRS_DEDUP_CACHE_SIZE_DEFAULT 4096
+
+struct parsebgp_mrt_peer_index;
+
+/**
+ * MRT Parsing Options
+ */
+typedef struct parsebgp_mrt_opts {
+
+  /**
+   * Deduplicate TABLE_DUMP_V2 RIB entry Path Attributes
+   *
+   * If this is set, the raw Path Attributes data of each TABLE_DUMP_V2 RIB
+   * entry is hashed and looked up in a cache of previously decoded attribute
+   * sets. On a hit, the shared (already decoded) attributes are reused instead
+   * of decoding the data again. Each RIB entry is given an attribute set ID
+   * (path_attrs_id) and a pointer to the decoded attributes (path_attrs_ptr);
+   * the path_attrs field of the entry is left empty.
+   *
+   * The cache is owned by the MRT message structure and survives calls to
+   * parsebgp_clear_msg, so the same message structure should be reused for all
+   * messages of a dump to get any benefit.
+   */
+  int path_attrs_dedup;
+
+  /**
+   * Number of attribute sets to keep in the dedup cache
+   *
+   * If zero, PARSEBGP_MRT_PATH_ATTRS_DEDUP_CACHE_SIZE_DEFAULT is used. The
+   * value is rounded up to a power of two. This option is only read when the
+   * cache is first created.
+   */
+  uint32_t path_attrs_dedup_cache_size;
+
+  /**
+   * Shared TABLE_DUMP_V2 Peer Index (see parsebgp_mrt_peer_index_create)
+   *
+   * If set, the peer_index of each TABLE_DUMP_V2 RIB entry is resolved against
+   * this (read-only) peer index, and the entry's peer field is set to point at
+   * the matching peer. An out-of-range peer index is treated as an invalid
+   * message. The index is never modified by the parser, so one index may be
+   * shared by several threads, each decoding RIB records into its own message
+   * structure.
+   */
+  const struct parsebgp_mrt_peer_index *peer_index;
+
+} parsebgp_mrt_opts_t;
+
+/**
+ * Initialize parser options to default values
+ *
+ * @param opts          pointer to an opts structure to initialize
+ */
+void parsebgp_mrt_opts_init(parsebgp_mrt_opts_t *opts);
+
+#endif /* __PARSEBGP_MRT_OPTS_H */
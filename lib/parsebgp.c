@@ -32,26 +32,27 @@
 #include <assert.h>
 #include <stdio.h>
 
-parsebgp_error_t parsebgp_decode(parsebgp_opts_t opts, parsebgp_msg_type_t type,
-                                 parsebgp_msg_t *msg, const uint8_t *buffer,
-                                 size_t *len)
+static parsebgp_error_t decode_msg(parsebgp_opts_t *opts,
+                                   parsebgp_msg_type_t type,
+                                   parsebgp_msg_t *msg, const uint8_t *buffer,
+                                   size_t *len)
 {
   msg->type = type;
 
   switch (type) {
   case PARSEBGP_MSG_TYPE_BMP:
     PARSEBGP_MAYBE_MALLOC_ZERO(msg->types.bmp);
-    return parsebgp_bmp_decode(&opts, msg->types.bmp, buffer, len);
+    return parsebgp_bmp_decode(opts, msg->types.bmp, buffer, len);
     break;
 
   case PARSEBGP_MSG_TYPE_MRT:
     PARSEBGP_MAYBE_MALLOC_ZERO(msg->types.mrt);
-    return parsebgp_mrt_decode(&opts, msg->types.mrt, buffer, len);
+    return parsebgp_mrt_decode(opts, msg->types.mrt, buffer, len);
     break;
 
   case PARSEBGP_MSG_TYPE_BGP:
     PARSEBGP_MAYBE_MALLOC_ZERO(msg->types.bgp);
-    return parsebgp_bgp_decode(&opts, msg->types.bgp, buffer, len);
+    return parsebgp_bgp_decode(opts, msg->types.bgp, buffer, len);
     break;
 
   default:
@@ -60,6 +61,51 @@ parsebgp_error_t parsebgp_decode(parsebgp_opts_t opts, parsebgp_msg_type_t type,
   assert(0);
 }
 
+parsebgp_error_t parsebgp_decode(parsebgp_opts_t opts, parsebgp_msg_type_t type,
+                                 parsebgp_msg_t *msg, const uint8_t *buffer,
+                                 size_t *len)
+{
+  // remember where the message starts so that diagnostics can report offsets
+  opts.diag._msg_buf = buffer;
+  opts.diag._msg_type = type;
+  opts.diag._attr_type = 0;
+
+#ifdef PARSEBGP_STATS
+  parsebgp_error_t err;
+  uint64_t reallocs = parsebgp_stats_reallocs;
+
+  err = decode_msg(&opts, type, msg, buffer, len);
+  if (opts.stats != NULL) {
+    opts.stats->reallocs_cnt += parsebgp_stats_reallocs - reallocs;
+    if (err < PARSEBGP_OK && err > PARSEBGP_N_ERR) {
+      opts.stats->errors_cnt[-err]++;
+    }
+  }
+  return err;
+#else
+  return decode_msg(&opts, type, msg, buffer, len);
+#endif
+}
+
+parsebgp_error_t parsebgp_encode(parsebgp_opts_t opts, parsebgp_msg_type_t type,
+                                 const parsebgp_msg_t *msg, uint8_t *buffer,
+                                 size_t *len)
+{
+  switch (type) {
+  case PARSEBGP_MSG_TYPE_BGP:
+    return parsebgp_bgp_encode(&opts, msg->types.bgp, buffer, len);
+
+  case PARSEBGP_MSG_TYPE_BMP:
+    return parsebgp_bmp_encode(&opts, msg->types.bmp, buffer, len);
+
+  case PARSEBGP_MSG_TYPE_MRT:
+    return parsebgp_mrt_encode(&opts, msg->types.mrt, buffer, len);
+
+  default:
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+}
+
 parsebgp_msg_t *parsebgp_create_msg(void)
 {
   parsebgp_msg_t *msg = NULL;
@@ -106,31 +152,47 @@ void parsebgp_destroy_msg(parsebgp_msg_t *msg)
   parsebgp_bmp_destroy_msg(msg->types.bmp);
   parsebgp_bgp_destroy_msg(msg->types.bgp);
 
-  free(msg);
+  PARSEBGP_FREE(msg);
+}
+
+size_t parsebgp_msg_memory_usage(const parsebgp_msg_t *msg)
+{
+  if (msg == NULL) {
+    return 0;
+  }
+
+  return sizeof(*msg) + parsebgp_mrt_msg_memory_usage(msg->types.mrt) +
+         parsebgp_bmp_msg_memory_usage(msg->types.bmp) +
+         parsebgp_bgp_msg_memory_usage(msg->types.bgp);
 }
 
 void parsebgp_dump_msg(const parsebgp_msg_t *msg)
 {
-  PARSEBGP_DUMP_STRUCT_HDR(parsebgp_msg_t, 0);
-  PARSEBGP_DUMP_INT(0, "Type", msg->type);
+  parsebgp_dump_msg_sink(NULL, msg);
+}
+
+void parsebgp_dump_msg_sink(parsebgp_sink_t *sink, const parsebgp_msg_t *msg)
+{
+  PARSEBGP_DUMP_STRUCT_HDR(sink, parsebgp_msg_t, 0);
+  PARSEBGP_DUMP_INT(sink, 0, "Type", msg->type);
 
   switch (msg->type) {
   case PARSEBGP_MSG_TYPE_MRT:
-    parsebgp_mrt_dump_msg(msg->types.mrt, 1);
+    parsebgp_mrt_dump_msg(sink, msg->types.mrt, 1);
     break;
 
   case PARSEBGP_MSG_TYPE_BMP:
-    parsebgp_bmp_dump_msg(msg->types.bmp, 1);
+    parsebgp_bmp_dump_msg(sink, msg->types.bmp, 1);
     break;
 
   case PARSEBGP_MSG_TYPE_BGP:
-    parsebgp_bgp_dump_msg(msg->types.bgp, 1);
+    parsebgp_bgp_dump_msg(sink, msg->types.bgp, 1);
     break;
 
   default:
-    PARSEBGP_DUMP_INFO(0, "UNKNOWN MESSAGE TYPE\n");
+    PARSEBGP_DUMP_INFO(sink, 0, "UNKNOWN MESSAGE TYPE\n");
     break;
   }
 
-  fputs("\n", stdout);
+  parsebgp_sink_puts(sink, "\n");
 }
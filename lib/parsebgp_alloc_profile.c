@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include "parsebgp_alloc_profile.h"
+#include "parsebgp_utils.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PARSEBGP_ALLOC_PROFILE
+
+/** Number of allocation sites that can be tracked (must be a power of two,
+    and comfortably more than the number of sites in the library) */
+#define SITES_CNT 1024
+
+/** Kinds of allocator calls */
+enum {
+  KIND_MALLOC,
+  KIND_REALLOC,
+  KIND_FREE,
+};
+
+static const char *kind_names[] = {"malloc", "realloc", "free"};
+
+/** Counters for a single allocation site */
+typedef struct site {
+
+  /** Source file of the site (NULL if the slot is unused) */
+  const char *file;
+
+  /** Source line of the site */
+  int line;
+
+  /** Kind of call made at the site */
+  int kind;
+
+  /** Function the site is in */
+  const char *func;
+
+  /** Expression being allocated or freed */
+  const char *what;
+
+  /** Number of calls */
+  uint64_t calls;
+
+  /** Number of calls that grew an existing (non-empty) allocation */
+  uint64_t growths;
+
+  /** Total number of bytes requested */
+  uint64_t bytes;
+
+  /** Largest single request (in bytes) */
+  uint64_t max_bytes;
+
+} site_t;
+
+/** Open-addressed table of sites, keyed by file and line */
+static site_t sites[SITES_CNT];
+
+/** Number of sites in use */
+static int sites_used = 0;
+
+/** Number of calls that could not be attributed because the table was full */
+static uint64_t dropped = 0;
+
+static site_t *find_site(const char *file, int line, int kind,
+                         const char *func, const char *what)
+{
+  // __FILE__ expands to the same string literal throughout a translation
+  // unit, so the pointer is enough to tell files apart
+  uint64_t h = parsebgp_hash_bytes((const uint8_t *)&file, sizeof(file), line);
+  size_t i = h & (SITES_CNT - 1);
+  site_t *s;
+
+  for (;;) {
+    s = &sites[i];
+    if (s->file == NULL) {
+      break;
+    }
+    if (s->file == file && s->line == line) {
+      return s;
+    }
+    i = (i + 1) & (SITES_CNT - 1);
+  }
+
+  // keep at least one slot free so that lookups terminate
+  if (sites_used == SITES_CNT - 1) {
+    return NULL;
+  }
+  sites_used++;
+  s->file = file;
+  s->line = line;
+  s->kind = kind;
+  s->func = func;
+  s->what = what;
+  return s;
+}
+
+static void record(const char *file, int line, int kind, const char *func,
+                   const char *what, size_t old_size, size_t new_size)
+{
+  site_t *s;
+
+  if ((s = find_site(file, line, kind, func, what)) == NULL) {
+    dropped++;
+    return;
+  }
+  s->calls++;
+  if (old_size > 0) {
+    s->growths++;
+  }
+  s->bytes += new_size;
+  if (new_size > s->max_bytes) {
+    s->max_bytes = new_size;
+  }
+}
+
+void *parsebgp_alloc_profile_malloc_zero(size_t size, const char *file,
+                                         int line, const char *func,
+                                         const char *what)
+{
+  void *ptr;
+
+  // (parenthesized to get the function rather than the profiling macro)
+  if ((ptr = (malloc_zero)(size)) != NULL) {
+    record(file, line, KIND_MALLOC, func, what, 0, size);
+  }
+  return ptr;
+}
+
+void parsebgp_alloc_profile_realloc(size_t old_size, size_t new_size,
+                                    const char *file, int line,
+                                    const char *func, const char *what)
+{
+  record(file, line, KIND_REALLOC, func, what, old_size, new_size);
+}
+
+void parsebgp_alloc_profile_free(const char *file, int line, const char *func,
+                                 const char *what)
+{
+  record(file, line, KIND_FREE, func, what, 0, 0);
+}
+
+static int site_cmp(const void *a, const void *b)
+{
+  const site_t *sa = *(const site_t *const *)a;
+  const site_t *sb = *(const site_t *const *)b;
+
+  if (sa->calls != sb->calls) {
+    return sa->calls < sb->calls ? 1 : -1;
+  }
+  if (sa->bytes != sb->bytes) {
+    return sa->bytes < sb->bytes ? 1 : -1;
+  }
+  if (sa->line != sb->line) {
+    return sa->line < sb->line ? -1 : 1;
+  }
+  return strcmp(sa->file, sb->file);
+}
+
+#endif
+
+int parsebgp_alloc_profile_enabled(void)
+{
+#ifdef PARSEBGP_ALLOC_PROFILE
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void parsebgp_alloc_profile_clear(void)
+{
+#ifdef PARSEBGP_ALLOC_PROFILE
+  memset(sites, 0, sizeof(sites));
+  sites_used = 0;
+  dropped = 0;
+#endif
+}
+
+void parsebgp_alloc_profile_dump(parsebgp_sink_t *sink)
+{
+#ifdef PARSEBGP_ALLOC_PROFILE
+  site_t *sorted[SITES_CNT];
+  site_t *s;
+  int i, cnt = 0;
+
+  for (i = 0; i < SITES_CNT; i++) {
+    if (sites[i].file != NULL && sites[i].calls > 0) {
+      sorted[cnt++] = &sites[i];
+    }
+  }
+  qsort(sorted, cnt, sizeof(*sorted), site_cmp);
+
+  parsebgp_sink_printf(sink, "# site|kind|calls|growths|bytes|max_bytes|"
+                             "function|expression\n");
+  for (i = 0; i < cnt; i++) {
+    s = sorted[i];
+    parsebgp_sink_printf(sink,
+                         "%s:%d|%s|%" PRIu64 "|%" PRIu64 "|%" PRIu64
+                         "|%" PRIu64 "|%s|%s\n",
+                         s->file, s->line, kind_names[s->kind], s->calls,
+                         s->growths, s->bytes, s->max_bytes, s->func,
+                         s->what);
+  }
+  if (dropped > 0) {
+    parsebgp_sink_printf(sink,
+                         "# %" PRIu64 " calls not attributed (site table "
+                         "full)\n",
+                         dropped);
+  }
+#else
+  (void)sink;
+#endif
+}
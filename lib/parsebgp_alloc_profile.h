@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#ifndef __PARSEBGP_ALLOC_PROFILE_H
+#define __PARSEBGP_ALLOC_PROFILE_H
+
+#include "parsebgp_sink.h"
+
+/**
+ * Allocation profiler
+ *
+ * When the library is configured with --enable-alloc-profile, every
+ * allocation, growth and free made by the decoders (malloc_zero,
+ * PARSEBGP_MAYBE_MALLOC_ZERO, PARSEBGP_MAYBE_REALLOC and the frees in the
+ * destroy functions) is attributed to its source site, and the per-site
+ * counts can be dumped after a run to find the arrays that churn the most.
+ *
+ * The profile is global to the process and is not synchronized, so it should
+ * only be used from a single decoding thread.
+ */
+
+/**
+ * Check whether the library was built with the allocation profiler
+ *
+ * @return 1 if allocations are profiled, 0 otherwise
+ */
+int parsebgp_alloc_profile_enabled(void);
+
+/**
+ * Reset all allocation profile counters
+ */
+void parsebgp_alloc_profile_clear(void);
+
+/**
+ * Dump the allocation profile to a sink
+ *
+ * One line is printed per allocation site (most frequently hit first), giving
+ * the site, the kind of call, the number of calls, how many of those grew an
+ * existing allocation, the total and maximum number of bytes requested, the
+ * function the site is in and the allocated expression.
+ *
+ * @param sink          sink to write to (NULL for stdout)
+ */
+void parsebgp_alloc_profile_dump(parsebgp_sink_t *sink);
+
+#endif /* __PARSEBGP_ALLOC_PROFILE_H */
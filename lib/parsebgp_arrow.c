@@ -0,0 +1,1048 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_arrow.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/** Check whether the given path attribute is present */
+#define HAS_ATTR(attrs, attr_type) ((attrs)->attrs[(attr_type)].type == (attr_type))
+
+/** Initial allocation for each column buffer */
+#define BUF_LEN_INIT 4096
+
+/** Upper bound on the size of the flatbuffer metadata of a message (the
+    schema, or a record batch header) */
+#define META_LEN_MAX 8192
+
+/** Round x up to a multiple of align (which must be a power of two) */
+#define ALIGN_UP(x, align) (((x) + (align)-1) & ~((size_t)(align)-1))
+
+/** Arrow IPC continuation marker that precedes each message */
+#define IPC_CONTINUATION 0xFFFFFFFF
+
+/* Values from the Arrow flatbuffer schema (Schema.fbs and Message.fbs) */
+#define FB_METADATA_V5 4
+#define FB_ENDIANNESS_LITTLE 0
+#define FB_ENDIANNESS_BIG 1
+#define FB_HEADER_SCHEMA 1
+#define FB_HEADER_RECORD_BATCH 3
+#define FB_TYPE_INT 2
+#define FB_TYPE_LIST 12
+#define FB_TYPE_FIXED_SIZE_BINARY 15
+
+/** Column types */
+typedef enum col_type {
+
+  /** Fixed width unsigned integer (of the given width) */
+  COL_TYPE_UINT,
+
+  /** Fixed size binary of 16 bytes (IP address) */
+  COL_TYPE_ADDR,
+
+  /** List of uint32 */
+  COL_TYPE_LIST_UINT32,
+
+} col_type_t;
+
+/** Columns (in schema order) */
+typedef enum col {
+  COL_TIMESTAMP,
+  COL_TIMESTAMP_USEC,
+  COL_ACTION,
+  COL_PEER_AFI,
+  COL_PEER_IP,
+  COL_PEER_ASN,
+  COL_PREFIX_AFI,
+  COL_PREFIX,
+  COL_PREFIX_LEN,
+  COL_ORIGIN,
+  COL_AS_PATH,
+  COL_COMMUNITIES,
+  COLS_CNT,
+} col_t;
+
+static const struct col_spec {
+
+  /** Name of the column */
+  const char *name;
+
+  /** Type of the column */
+  col_type_t type;
+
+  /** Width of a value in bytes (width of list items for list columns) */
+  uint8_t width;
+
+} col_specs[COLS_CNT] = {
+  {"timestamp", COL_TYPE_UINT, 4},        // COL_TIMESTAMP
+  {"timestamp_usec", COL_TYPE_UINT, 4},   // COL_TIMESTAMP_USEC
+  {"action", COL_TYPE_UINT, 1},           // COL_ACTION
+  {"peer_afi", COL_TYPE_UINT, 1},         // COL_PEER_AFI
+  {"peer_ip", COL_TYPE_ADDR, 16},         // COL_PEER_IP
+  {"peer_asn", COL_TYPE_UINT, 4},         // COL_PEER_ASN
+  {"prefix_afi", COL_TYPE_UINT, 1},       // COL_PREFIX_AFI
+  {"prefix", COL_TYPE_ADDR, 16},          // COL_PREFIX
+  {"prefix_len", COL_TYPE_UINT, 1},       // COL_PREFIX_LEN
+  {"origin", COL_TYPE_UINT, 1},           // COL_ORIGIN
+  {"as_path", COL_TYPE_LIST_UINT32, 4},   // COL_AS_PATH
+  {"communities", COL_TYPE_LIST_UINT32, 4}, // COL_COMMUNITIES
+};
+
+/** Upper bound on the number of body buffers of a record batch (list columns
+    have four: validity and offsets of the list, validity and values of the
+    items) */
+#define BODY_BUFS_MAX (COLS_CNT * 4)
+
+/** Growable byte buffer */
+typedef struct buf {
+
+  /** Buffer data */
+  uint8_t *data;
+
+  /** Number of bytes used */
+  size_t len;
+
+  /** Number of bytes allocated */
+  size_t _alloc_len;
+
+} buf_t;
+
+struct parsebgp_arrow_batch {
+
+  /** Number of rows in the batch */
+  uint32_t rows_cnt;
+
+  /** Column values (for list columns, the int32 offsets of each list) */
+  buf_t cols[COLS_CNT];
+
+  /** List items (for list columns) */
+  buf_t items[COLS_CNT];
+
+  /** Copy of the most recent TABLE_DUMP_V2 peer index table */
+  parsebgp_mrt_peer_index_t *peers;
+};
+
+/** Flatbuffer under construction. Unlike the reference builder, objects are
+    written front to back: each object is written after the object that
+    refers to it, and the reference is patched once the object's position is
+    known. */
+typedef struct fb {
+
+  /** Flatbuffer data */
+  uint8_t buf[META_LEN_MAX];
+
+  /** Number of bytes used */
+  size_t len;
+
+} fb_t;
+
+struct parsebgp_arrow_writer {
+
+  /** File descriptor to write to */
+  int fd;
+
+  /** Has the schema been written? */
+  int schema_written;
+
+  /** Scratch space for message metadata */
+  fb_t fb;
+
+  /** First error encountered while writing */
+  parsebgp_error_t err;
+};
+
+/* -------------------- Buffers -------------------- */
+
+static int buf_reserve(buf_t *b, size_t len)
+{
+  size_t new_len;
+  uint8_t *data;
+
+  if (b->_alloc_len - b->len >= len) {
+    return 0;
+  }
+  new_len = b->_alloc_len == 0 ? BUF_LEN_INIT : b->_alloc_len;
+  while (new_len - b->len < len) {
+    new_len *= 2;
+  }
+  if ((data = realloc(b->data, new_len)) == NULL) {
+    return -1;
+  }
+  b->data = data;
+  b->_alloc_len = new_len;
+  return 0;
+}
+
+static inline int buf_append(buf_t *b, const void *data, size_t len)
+{
+  if (buf_reserve(b, len) != 0) {
+    return -1;
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return 0;
+}
+
+/* -------------------- Flatbuffers -------------------- */
+
+/* flatbuffers are always little-endian */
+
+static void fb_put8(fb_t *fb, size_t off, uint8_t val)
+{
+  fb->buf[off] = val;
+}
+
+static void fb_put16(fb_t *fb, size_t off, uint16_t val)
+{
+  fb->buf[off] = val & 0xFF;
+  fb->buf[off + 1] = val >> 8;
+}
+
+static void fb_put32(fb_t *fb, size_t off, uint32_t val)
+{
+  fb_put16(fb, off, val & 0xFFFF);
+  fb_put16(fb, off + 2, val >> 16);
+}
+
+static void fb_put64(fb_t *fb, size_t off, uint64_t val)
+{
+  fb_put32(fb, off, val & 0xFFFFFFFF);
+  fb_put32(fb, off + 4, val >> 32);
+}
+
+/** Allocate len zeroed bytes at the given alignment */
+static size_t fb_alloc(fb_t *fb, size_t len, size_t align)
+{
+  size_t off = ALIGN_UP(fb->len, align);
+
+  assert(off + len <= META_LEN_MAX);
+  memset(fb->buf + fb->len, 0, off + len - fb->len);
+  fb->len = off + len;
+  return off;
+}
+
+/** Point the offset field at the given position to the given object (which
+    must follow it) */
+static void fb_set_offset(fb_t *fb, size_t field, size_t obj)
+{
+  assert(obj > field);
+  fb_put32(fb, field, obj - field);
+}
+
+/** Write a table (preceded by its vtable)
+ *
+ * @param fields_cnt    Number of fields in the vtable
+ * @param sizes         Size of each field (0 if the field is absent)
+ * @param [out] fields  Set to the position of each (present) field
+ * @return the position of the table
+ */
+static size_t fb_table(fb_t *fb, int fields_cnt, const uint8_t *sizes,
+                       size_t *fields)
+{
+  uint16_t rel[8];
+  size_t vt, t, len = 4; // soffset to the vtable
+  int i;
+
+  assert(fields_cnt <= 8);
+
+  // lay out the fields, each at its natural alignment (tables are 8-byte
+  // aligned)
+  for (i = 0; i < fields_cnt; i++) {
+    if (sizes[i] == 0) {
+      rel[i] = 0;
+      continue;
+    }
+    len = ALIGN_UP(len, sizes[i]);
+    rel[i] = len;
+    len += sizes[i];
+  }
+
+  vt = fb_alloc(fb, 4 + 2 * fields_cnt, 2);
+  t = fb_alloc(fb, len, 8);
+
+  fb_put16(fb, vt, 4 + 2 * fields_cnt);
+  fb_put16(fb, vt + 2, len);
+  for (i = 0; i < fields_cnt; i++) {
+    fb_put16(fb, vt + 4 + 2 * i, rel[i]);
+    fields[i] = t + rel[i];
+  }
+  // the vtable is at (table - soffset)
+  fb_put32(fb, t, t - vt);
+
+  return t;
+}
+
+/** Write a vector (the elements follow the returned position) */
+static size_t fb_vector(fb_t *fb, uint32_t cnt, size_t elem_len, size_t align)
+{
+  size_t vec;
+
+  // the elements must be aligned, and are preceded by the 4-byte length
+  if (align < 4) {
+    align = 4;
+  }
+  vec = ALIGN_UP(fb->len + 4, align) - 4;
+  fb_alloc(fb, vec - fb->len, 1);
+  fb_alloc(fb, 4 + cnt * elem_len, 1);
+  fb_put32(fb, vec, cnt);
+  return vec;
+}
+
+static size_t fb_string(fb_t *fb, const char *str)
+{
+  size_t len = strlen(str);
+  size_t s = fb_vector(fb, len + 1, 1, 4); // including the nul
+
+  fb_put32(fb, s, len);
+  memcpy(fb->buf + s + 4, str, len);
+  return s;
+}
+
+/** Start a Message, and return the position of its header field */
+static size_t fb_message(fb_t *fb, uint8_t header_type, uint64_t body_len)
+{
+  // version, header_type, header, bodyLength
+  static const uint8_t sizes[] = {2, 1, 4, 8};
+  size_t fields[4];
+  size_t root, msg;
+
+  fb->len = 0;
+  root = fb_alloc(fb, 4, 4);
+  msg = fb_table(fb, 4, sizes, fields);
+  fb_set_offset(fb, root, msg);
+
+  fb_put16(fb, fields[0], FB_METADATA_V5);
+  fb_put8(fb, fields[1], header_type);
+  fb_put64(fb, fields[3], body_len);
+
+  return fields[2];
+}
+
+static size_t fb_int_type(fb_t *fb, uint8_t width)
+{
+  // bitWidth, is_signed
+  static const uint8_t sizes[] = {4, 1};
+  size_t fields[2];
+  size_t t = fb_table(fb, 2, sizes, fields);
+
+  fb_put32(fb, fields[0], width * 8);
+  fb_put8(fb, fields[1], 0);
+  return t;
+}
+
+static size_t fb_fixed_size_binary_type(fb_t *fb, uint8_t width)
+{
+  // byteWidth
+  static const uint8_t sizes[] = {4};
+  size_t fields[1];
+  size_t t = fb_table(fb, 1, sizes, fields);
+
+  fb_put32(fb, fields[0], width);
+  return t;
+}
+
+static size_t fb_field(fb_t *fb, const char *name, col_type_t type,
+                       uint8_t width)
+{
+  // name, nullable, type_type, type, dictionary, children
+  static const uint8_t sizes[] = {4, 1, 1, 4, 0, 4};
+  size_t fields[6];
+  size_t f, children;
+
+  f = fb_table(fb, 6, sizes, fields);
+  fb_set_offset(fb, fields[0], fb_string(fb, name));
+  fb_put8(fb, fields[1], 0); // no nulls
+
+  switch (type) {
+  case COL_TYPE_UINT:
+    fb_put8(fb, fields[2], FB_TYPE_INT);
+    fb_set_offset(fb, fields[3], fb_int_type(fb, width));
+    children = fb_vector(fb, 0, 4, 4);
+    break;
+
+  case COL_TYPE_ADDR:
+    fb_put8(fb, fields[2], FB_TYPE_FIXED_SIZE_BINARY);
+    fb_set_offset(fb, fields[3], fb_fixed_size_binary_type(fb, width));
+    children = fb_vector(fb, 0, 4, 4);
+    break;
+
+  case COL_TYPE_LIST_UINT32:
+  default:
+    fb_put8(fb, fields[2], FB_TYPE_LIST);
+    fb_set_offset(fb, fields[3], fb_table(fb, 0, NULL, NULL));
+    children = fb_vector(fb, 1, 4, 4);
+    fb_set_offset(fb, children + 4, fb_field(fb, "item", COL_TYPE_UINT, width));
+    break;
+  }
+  fb_set_offset(fb, fields[5], children);
+
+  return f;
+}
+
+static void fb_schema(fb_t *fb)
+{
+  // endianness, fields
+  static const uint8_t sizes[] = {2, 4};
+  static const uint16_t one = 1;
+  size_t fields[2];
+  size_t hdr, s, vec;
+  int i;
+
+  hdr = fb_message(fb, FB_HEADER_SCHEMA, 0);
+  s = fb_table(fb, 2, sizes, fields);
+  fb_set_offset(fb, hdr, s);
+
+  // column data is written in host byte order
+  fb_put16(fb, fields[0], *(const uint8_t *)&one == 1 ? FB_ENDIANNESS_LITTLE
+                                                      : FB_ENDIANNESS_BIG);
+
+  vec = fb_vector(fb, COLS_CNT, 4, 4);
+  fb_set_offset(fb, fields[1], vec);
+  for (i = 0; i < COLS_CNT; i++) {
+    fb_set_offset(fb, vec + 4 + 4 * i,
+                  fb_field(fb, col_specs[i].name, col_specs[i].type,
+                           col_specs[i].width));
+  }
+}
+
+/** Body buffer of a record batch */
+typedef struct body_buf {
+
+  /** Buffer data (may be NULL if len is 0) */
+  const uint8_t *data;
+
+  /** Length of the data */
+  size_t len;
+
+} body_buf_t;
+
+/** Write the metadata of a record batch, and fill bufs with its body buffers
+    (in the order of the flattened schema fields) */
+static int fb_record_batch(fb_t *fb, const parsebgp_arrow_batch_t *batch,
+                           body_buf_t *bufs)
+{
+  // length, nodes, buffers
+  static const uint8_t sizes[] = {8, 4, 4};
+  uint64_t nodes[COLS_CNT * 2];
+  size_t fields[3];
+  size_t hdr, rb, vec;
+  uint64_t body_len = 0;
+  int nodes_cnt = 0, bufs_cnt = 0, i;
+
+  for (i = 0; i < COLS_CNT; i++) {
+    // no column has nulls, so the validity buffers are empty
+    nodes[nodes_cnt++] = batch->rows_cnt;
+    bufs[bufs_cnt].data = NULL;
+    bufs[bufs_cnt++].len = 0;
+    bufs[bufs_cnt].data = batch->cols[i].data;
+    bufs[bufs_cnt++].len = batch->cols[i].len;
+
+    if (col_specs[i].type == COL_TYPE_LIST_UINT32) {
+      nodes[nodes_cnt++] = batch->items[i].len / col_specs[i].width;
+      bufs[bufs_cnt].data = NULL;
+      bufs[bufs_cnt++].len = 0;
+      bufs[bufs_cnt].data = batch->items[i].data;
+      bufs[bufs_cnt++].len = batch->items[i].len;
+    }
+  }
+  for (i = 0; i < bufs_cnt; i++) {
+    body_len += ALIGN_UP(bufs[i].len, 8);
+  }
+
+  hdr = fb_message(fb, FB_HEADER_RECORD_BATCH, body_len);
+  rb = fb_table(fb, 3, sizes, fields);
+  fb_set_offset(fb, hdr, rb);
+  fb_put64(fb, fields[0], batch->rows_cnt);
+
+  // FieldNode structs (length, null_count)
+  vec = fb_vector(fb, nodes_cnt, 16, 8);
+  fb_set_offset(fb, fields[1], vec);
+  for (i = 0; i < nodes_cnt; i++) {
+    fb_put64(fb, vec + 4 + 16 * i, nodes[i]);
+    fb_put64(fb, vec + 4 + 16 * i + 8, 0);
+  }
+
+  // Buffer structs (offset in the body, length)
+  vec = fb_vector(fb, bufs_cnt, 16, 8);
+  fb_set_offset(fb, fields[2], vec);
+  body_len = 0;
+  for (i = 0; i < bufs_cnt; i++) {
+    fb_put64(fb, vec + 4 + 16 * i, body_len);
+    fb_put64(fb, vec + 4 + 16 * i + 8, bufs[i].len);
+    body_len += ALIGN_UP(bufs[i].len, 8);
+  }
+
+  return bufs_cnt;
+}
+
+/* -------------------- Writer -------------------- */
+
+static void write_iov(parsebgp_arrow_writer_t *w, struct iovec *iov, int cnt)
+{
+  ssize_t rc;
+
+  while (cnt > 0) {
+    if ((rc = writev(w->fd, iov, cnt)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      w->err = PARSEBGP_IO_ERROR;
+      return;
+    }
+    // skip over what was written
+    while (cnt > 0 && (size_t)rc >= iov->iov_len) {
+      rc -= iov->iov_len;
+      iov++;
+      cnt--;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (uint8_t *)iov->iov_base + rc;
+      iov->iov_len -= rc;
+    }
+  }
+}
+
+/** Write the encapsulated message held in the metadata scratch space,
+    followed by the given body buffers */
+static void write_msg(parsebgp_arrow_writer_t *w, const body_buf_t *bufs,
+                      int bufs_cnt)
+{
+  static const uint8_t padding[8] = {0};
+  struct iovec iov[2 + 2 * BODY_BUFS_MAX];
+  uint8_t prefix[8];
+  size_t meta_len;
+  int iov_cnt = 0, i;
+
+  if (w->err != PARSEBGP_OK) {
+    return;
+  }
+
+  // the body must start on an 8-byte boundary
+  fb_alloc(&w->fb, ALIGN_UP(w->fb.len, 8) - w->fb.len, 1);
+  meta_len = w->fb.len;
+
+  // continuation marker and metadata length (both little-endian)
+  memset(prefix, 0xFF, 4);
+  prefix[4] = meta_len & 0xFF;
+  prefix[5] = (meta_len >> 8) & 0xFF;
+  prefix[6] = (meta_len >> 16) & 0xFF;
+  prefix[7] = (meta_len >> 24) & 0xFF;
+
+  iov[iov_cnt].iov_base = prefix;
+  iov[iov_cnt++].iov_len = sizeof(prefix);
+  iov[iov_cnt].iov_base = w->fb.buf;
+  iov[iov_cnt++].iov_len = meta_len;
+  for (i = 0; i < bufs_cnt; i++) {
+    if (bufs[i].len == 0) {
+      continue;
+    }
+    iov[iov_cnt].iov_base = (void *)bufs[i].data;
+    iov[iov_cnt++].iov_len = bufs[i].len;
+    if (ALIGN_UP(bufs[i].len, 8) != bufs[i].len) {
+      iov[iov_cnt].iov_base = (void *)padding;
+      iov[iov_cnt++].iov_len = ALIGN_UP(bufs[i].len, 8) - bufs[i].len;
+    }
+  }
+
+  write_iov(w, iov, iov_cnt);
+}
+
+static void write_schema(parsebgp_arrow_writer_t *w)
+{
+  fb_schema(&w->fb);
+  write_msg(w, NULL, 0);
+  w->schema_written = 1;
+}
+
+parsebgp_arrow_writer_t *parsebgp_arrow_writer_create(int fd)
+{
+  parsebgp_arrow_writer_t *w;
+
+  if ((w = malloc_zero(sizeof(*w))) == NULL) {
+    return NULL;
+  }
+  w->fd = fd;
+  w->err = PARSEBGP_OK;
+
+  return w;
+}
+
+parsebgp_error_t parsebgp_arrow_writer_destroy(parsebgp_arrow_writer_t *writer)
+{
+  // end-of-stream marker: continuation followed by a zero length
+  uint8_t eos[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+  struct iovec iov = {eos, sizeof(eos)};
+  parsebgp_error_t err;
+
+  if (writer == NULL) {
+    return PARSEBGP_OK;
+  }
+
+  if (!writer->schema_written) {
+    write_schema(writer);
+  }
+  if (writer->err == PARSEBGP_OK) {
+    write_iov(writer, &iov, 1);
+  }
+  err = writer->err;
+
+  free(writer);
+
+  return err;
+}
+
+parsebgp_error_t parsebgp_arrow_writer_write_batch(
+  parsebgp_arrow_writer_t *writer, const parsebgp_arrow_batch_t *batch)
+{
+  body_buf_t bufs[BODY_BUFS_MAX];
+  int bufs_cnt;
+
+  if (!writer->schema_written) {
+    write_schema(writer);
+  }
+  if (batch->rows_cnt == 0) {
+    return writer->err;
+  }
+
+  bufs_cnt = fb_record_batch(&writer->fb, batch, bufs);
+  write_msg(writer, bufs, bufs_cnt);
+
+  return writer->err;
+}
+
+/* -------------------- Batches -------------------- */
+
+/** Row context shared by all routes of a message */
+typedef struct row_ctx {
+
+  /** Timestamp (seconds) */
+  uint32_t ts_sec;
+
+  /** Timestamp (microseconds) */
+  uint32_t ts_usec;
+
+  /** AFI of the peer address */
+  uint8_t peer_afi;
+
+  /** Peer address (NULL if unknown) */
+  const uint8_t *peer_ip;
+
+  /** Peer ASN */
+  uint32_t peer_asn;
+
+} row_ctx_t;
+
+/** Append to a buffer that has already been reserved */
+static inline void put(buf_t *b, const void *data, size_t len)
+{
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+static inline void put_addr(buf_t *b, int afi, const uint8_t *addr)
+{
+  uint8_t *p = b->data + b->len;
+
+  if (addr == NULL) {
+    memset(p, 0, 16);
+  } else if (afi == PARSEBGP_BGP_AFI_IPV4) {
+    memcpy(p, addr, 4);
+    memset(p + 4, 0, 12);
+  } else {
+    memcpy(p, addr, 16);
+  }
+  b->len += 16;
+}
+
+/** Append a list end offset */
+static inline void put_list_end(buf_t *offsets, const buf_t *items)
+{
+  int32_t end = items->len / sizeof(uint32_t);
+  put(offsets, &end, sizeof(end));
+}
+
+static parsebgp_error_t add_row(parsebgp_arrow_batch_t *b,
+                                const row_ctx_t *ctx, uint8_t action,
+                                uint8_t afi, const uint8_t *pfx,
+                                uint8_t pfx_len,
+                                const parsebgp_bgp_update_path_attrs_t *attrs)
+{
+  const parsebgp_bgp_update_as_path_t *ap = NULL;
+  const parsebgp_bgp_update_communities_t *comms = NULL;
+  uint8_t origin = UINT8_MAX;
+  size_t asns_cnt = 0;
+  uint32_t comm;
+  int i;
+
+  if (attrs != NULL) {
+    if ((ap = attrs->as_path) != NULL && ap->summary_only) {
+      // the as_path column needs the ASNs, which were not parsed
+      return PARSEBGP_NOT_IMPLEMENTED;
+    }
+    if (ap != NULL) {
+      for (i = 0; i < ap->segs_cnt; i++) {
+        asns_cnt += ap->segs[i].asns_cnt;
+      }
+    }
+    if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES)) {
+      comms = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES]
+                .data.communities;
+    }
+    if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN)) {
+      origin = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN].data.origin;
+    }
+  }
+
+  // reserve space in every column first so that a failure leaves the batch
+  // unchanged
+  for (i = 0; i < COLS_CNT; i++) {
+    if (buf_reserve(&b->cols[i], col_specs[i].type == COL_TYPE_LIST_UINT32
+                                   ? sizeof(int32_t)
+                                   : col_specs[i].width) != 0) {
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+  }
+  if (buf_reserve(&b->items[COL_AS_PATH], asns_cnt * sizeof(uint32_t)) != 0 ||
+      (comms != NULL &&
+       buf_reserve(&b->items[COL_COMMUNITIES],
+                   comms->communities_cnt * sizeof(uint32_t)) != 0)) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+
+  put(&b->cols[COL_TIMESTAMP], &ctx->ts_sec, sizeof(uint32_t));
+  put(&b->cols[COL_TIMESTAMP_USEC], &ctx->ts_usec, sizeof(uint32_t));
+  put(&b->cols[COL_ACTION], &action, sizeof(uint8_t));
+  put(&b->cols[COL_PEER_AFI], &ctx->peer_afi, sizeof(uint8_t));
+  put_addr(&b->cols[COL_PEER_IP], ctx->peer_afi, ctx->peer_ip);
+  put(&b->cols[COL_PEER_ASN], &ctx->peer_asn, sizeof(uint32_t));
+  put(&b->cols[COL_PREFIX_AFI], &afi, sizeof(uint8_t));
+  put_addr(&b->cols[COL_PREFIX], afi, pfx);
+  put(&b->cols[COL_PREFIX_LEN], &pfx_len, sizeof(uint8_t));
+  put(&b->cols[COL_ORIGIN], &origin, sizeof(uint8_t));
+
+  if (ap != NULL) {
+    for (i = 0; i < ap->segs_cnt; i++) {
+      put(&b->items[COL_AS_PATH], ap->segs[i].asns,
+          ap->segs[i].asns_cnt * sizeof(uint32_t));
+    }
+  }
+  put_list_end(&b->cols[COL_AS_PATH], &b->items[COL_AS_PATH]);
+
+  if (comms != NULL && comms->raw_len > 0) {
+    // raw-parsed, so convert each community from network byte order
+    for (i = 0; i < comms->communities_cnt; i++) {
+      comm = parsebgp_bgp_update_community_get(comms, i);
+      put(&b->items[COL_COMMUNITIES], &comm, sizeof(comm));
+    }
+  } else if (comms != NULL && comms->communities_cnt > 0) {
+    put(&b->items[COL_COMMUNITIES], comms->communities,
+        comms->communities_cnt * sizeof(uint32_t));
+  }
+  put_list_end(&b->cols[COL_COMMUNITIES], &b->items[COL_COMMUNITIES]);
+
+  b->rows_cnt++;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t add_prefixes(parsebgp_arrow_batch_t *b,
+                                     const row_ctx_t *ctx, uint8_t action,
+                                     const parsebgp_bgp_prefix_t *pfxs,
+                                     int pfxs_cnt,
+                                     const parsebgp_bgp_update_path_attrs_t *attrs)
+{
+  parsebgp_error_t err;
+  int i;
+
+  for (i = 0; i < pfxs_cnt; i++) {
+    if ((err = add_row(b, ctx, action, pfxs[i].afi, pfxs[i].addr, pfxs[i].len,
+                       attrs)) != PARSEBGP_OK) {
+      return err;
+    }
+  }
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t add_bgp(parsebgp_arrow_batch_t *b,
+                                const row_ctx_t *ctx,
+                                const parsebgp_bgp_msg_t *bgp)
+{
+  const parsebgp_bgp_update_t *update;
+  const parsebgp_bgp_update_path_attrs_t *attrs;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach;
+  const parsebgp_bgp_update_mp_unreach_t *mp_unreach;
+  parsebgp_error_t err;
+
+  if (bgp == NULL || bgp->type != PARSEBGP_BGP_TYPE_UPDATE ||
+      (update = bgp->types.update) == NULL) {
+    return PARSEBGP_OK;
+  }
+  attrs = &update->path_attrs;
+
+  if ((err = add_prefixes(b, ctx, PARSEBGP_ARROW_ACTION_WITHDRAW,
+                          update->withdrawn_nlris.prefixes,
+                          update->withdrawn_nlris.prefixes_cnt, NULL)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI)) {
+    mp_unreach = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+                   .data.mp_unreach;
+    if ((err = add_prefixes(b, ctx, PARSEBGP_ARROW_ACTION_WITHDRAW,
+                            mp_unreach->withdrawn_nlris,
+                            mp_unreach->withdrawn_nlris_cnt, NULL)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+  }
+
+  if ((err = add_prefixes(b, ctx, PARSEBGP_ARROW_ACTION_ANNOUNCE,
+                          update->announced_nlris.prefixes,
+                          update->announced_nlris.prefixes_cnt, attrs)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)) {
+    mp_reach =
+      attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].data.mp_reach;
+    if ((err = add_prefixes(b, ctx, PARSEBGP_ARROW_ACTION_ANNOUNCE,
+                            mp_reach->nlris, mp_reach->nlris_cnt, attrs)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+  }
+
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t add_table_dump_v2(parsebgp_arrow_batch_t *b,
+                                          const parsebgp_mrt_msg_t *mrt,
+                                          row_ctx_t *ctx)
+{
+  const parsebgp_mrt_table_dump_v2_t *td = mrt->types.table_dump_v2;
+  const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *rib = &td->afi_safi_rib;
+  const parsebgp_mrt_table_dump_v2_rib_entry_t *entry;
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *peer;
+  parsebgp_error_t err;
+  uint8_t afi;
+  int i;
+
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE:
+    parsebgp_mrt_peer_index_destroy(b->peers);
+    if ((b->peers = parsebgp_mrt_peer_index_create(&td->peer_index)) ==
+        NULL) {
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+    return PARSEBGP_OK;
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
+    afi = PARSEBGP_BGP_AFI_IPV4;
+    break;
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
+    afi = PARSEBGP_BGP_AFI_IPV6;
+    break;
+
+  default:
+    // generic RIBs are not supported by the parser
+    return PARSEBGP_OK;
+  }
+
+  for (i = 0; i < rib->entry_count; i++) {
+    entry = &rib->entries[i];
+    if ((peer = entry->peer) == NULL && b->peers != NULL) {
+      peer = parsebgp_mrt_peer_index_get_peer(b->peers, entry->peer_index);
+    }
+    if (peer != NULL) {
+      ctx->peer_afi = peer->ip_afi;
+      ctx->peer_ip = peer->ip;
+      ctx->peer_asn = peer->asn;
+    } else {
+      ctx->peer_afi = 0;
+      ctx->peer_ip = NULL;
+      ctx->peer_asn = 0;
+    }
+    if ((err = add_row(b, ctx, PARSEBGP_ARROW_ACTION_RIB, afi, rib->prefix,
+                       rib->prefix_len,
+                       entry->path_attrs_ptr != NULL ? entry->path_attrs_ptr
+                                                     : &entry->path_attrs)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+  }
+
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t add_mrt(parsebgp_arrow_batch_t *b,
+                                const parsebgp_mrt_msg_t *mrt)
+{
+  const parsebgp_mrt_table_dump_t *td;
+  const parsebgp_mrt_bgp4mp_t *bgp4mp;
+  row_ctx_t ctx = {mrt->timestamp_sec, 0, 0, NULL, 0};
+
+  switch (mrt->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP:
+    if ((td = mrt->types.table_dump) == NULL) {
+      break;
+    }
+    ctx.peer_afi = mrt->subtype; // subtype is the AFI
+    ctx.peer_ip = td->peer_ip;
+    ctx.peer_asn = td->peer_asn;
+    return add_row(b, &ctx, PARSEBGP_ARROW_ACTION_RIB, mrt->subtype,
+                   td->prefix, td->prefix_len, &td->path_attrs);
+
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    if (mrt->types.table_dump_v2 == NULL) {
+      break;
+    }
+    return add_table_dump_v2(b, mrt, &ctx);
+
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    ctx.ts_usec = mrt->timestamp_usec;
+    // FALL THROUGH
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+    if ((bgp4mp = mrt->types.bgp4mp) == NULL) {
+      break;
+    }
+    switch (mrt->subtype) {
+    case PARSEBGP_MRT_BGP4MP_MESSAGE:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+      ctx.peer_afi = bgp4mp->afi;
+      ctx.peer_ip = bgp4mp->peer_ip;
+      ctx.peer_asn = bgp4mp->peer_asn;
+      return add_bgp(b, &ctx, bgp4mp->data.bgp_msg);
+
+    default:
+      break;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return PARSEBGP_OK;
+}
+
+parsebgp_arrow_batch_t *parsebgp_arrow_batch_create(void)
+{
+  parsebgp_arrow_batch_t *batch;
+  int32_t zero = 0;
+  int i;
+
+  if ((batch = malloc_zero(sizeof(*batch))) == NULL) {
+    return NULL;
+  }
+  // list offsets always start with a zero
+  for (i = 0; i < COLS_CNT; i++) {
+    if (col_specs[i].type == COL_TYPE_LIST_UINT32 &&
+        buf_append(&batch->cols[i], &zero, sizeof(zero)) != 0) {
+      parsebgp_arrow_batch_destroy(batch);
+      return NULL;
+    }
+  }
+
+  return batch;
+}
+
+void parsebgp_arrow_batch_destroy(parsebgp_arrow_batch_t *batch)
+{
+  int i;
+
+  if (batch == NULL) {
+    return;
+  }
+  for (i = 0; i < COLS_CNT; i++) {
+    free(batch->cols[i].data);
+    free(batch->items[i].data);
+  }
+  parsebgp_mrt_peer_index_destroy(batch->peers);
+  free(batch);
+}
+
+void parsebgp_arrow_batch_clear(parsebgp_arrow_batch_t *batch)
+{
+  int i;
+
+  for (i = 0; i < COLS_CNT; i++) {
+    // keep the leading zero offset of list columns
+    batch->cols[i].len =
+      col_specs[i].type == COL_TYPE_LIST_UINT32 ? sizeof(int32_t) : 0;
+    batch->items[i].len = 0;
+  }
+  batch->rows_cnt = 0;
+}
+
+uint32_t parsebgp_arrow_batch_get_rows_cnt(const parsebgp_arrow_batch_t *batch)
+{
+  return batch->rows_cnt;
+}
+
+parsebgp_error_t parsebgp_arrow_batch_add_msg(parsebgp_arrow_batch_t *batch,
+                                              const parsebgp_msg_t *msg)
+{
+  const parsebgp_bmp_msg_t *bmp;
+  row_ctx_t ctx = {0, 0, 0, NULL, 0};
+
+  switch (msg->type) {
+  case PARSEBGP_MSG_TYPE_BGP:
+    return add_bgp(batch, &ctx, msg->types.bgp);
+
+  case PARSEBGP_MSG_TYPE_BMP:
+    if ((bmp = msg->types.bmp) == NULL || !bmp->types_valid ||
+        bmp->type != PARSEBGP_BMP_TYPE_ROUTE_MON) {
+      break;
+    }
+    ctx.ts_sec = bmp->peer_hdr.ts_sec;
+    ctx.ts_usec = bmp->peer_hdr.ts_usec;
+    ctx.peer_afi = bmp->peer_hdr.afi;
+    ctx.peer_ip = bmp->peer_hdr.addr;
+    ctx.peer_asn = bmp->peer_hdr.asn;
+    return add_bgp(batch, &ctx, bmp->types.route_mon);
+
+  case PARSEBGP_MSG_TYPE_MRT:
+    if (msg->types.mrt != NULL) {
+      return add_mrt(batch, msg->types.mrt);
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return PARSEBGP_OK;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_ARROW_H
+#define __PARSEBGP_ARROW_H
+
+#include "parsebgp.h"
+#include <inttypes.h>
+
+/**
+ * Columnar route export in the Apache Arrow IPC stream format
+ *
+ * Routes are accumulated into column batches (parsebgp_arrow_batch_t) which
+ * are then written as Arrow record batches by a stream writer
+ * (parsebgp_arrow_writer_t). Each row is one route, with the columns:
+ *
+ *  - timestamp (uint32): seconds since the epoch (0 for raw BGP messages)
+ *  - timestamp_usec (uint32): microseconds (BGP4MP_ET and BMP only)
+ *  - action (uint8): parsebgp_arrow_action_t
+ *  - peer_afi (uint8): AFI of peer_ip (0 if the peer is not known)
+ *  - peer_ip (fixed_size_binary[16]): peer address in network byte order
+ *  - peer_asn (uint32)
+ *  - prefix_afi (uint8)
+ *  - prefix (fixed_size_binary[16]): prefix address in network byte order
+ *  - prefix_len (uint8)
+ *  - origin (uint8): ORIGIN attribute (255 if not present)
+ *  - as_path (list<uint32>): ASNs of all AS_PATH segments in order
+ *  - communities (list<uint32>): COMMUNITIES attribute values
+ *
+ * Numeric columns use the byte order of the host, which is recorded in the
+ * stream schema.
+ *
+ * Batches are independent of each other and of the writer, so each worker
+ * thread can fill its own batch concurrently, and hand full batches (e.g.,
+ * using a parsebgp_ring_t) to the thread that owns the writer.
+ */
+
+/** Suggested number of rows per batch */
+#define PARSEBGP_ARROW_BATCH_ROWS 65536
+
+/** Route actions (the "action" column) */
+typedef enum parsebgp_arrow_action {
+
+  /** Entry from a RIB dump (TABLE_DUMP or TABLE_DUMP_V2) */
+  PARSEBGP_ARROW_ACTION_RIB = 0,
+
+  /** Announcement from an UPDATE message */
+  PARSEBGP_ARROW_ACTION_ANNOUNCE = 1,
+
+  /** Withdrawal from an UPDATE message */
+  PARSEBGP_ARROW_ACTION_WITHDRAW = 2,
+
+} parsebgp_arrow_action_t;
+
+/** Opaque structure holding the columns of a batch of routes */
+typedef struct parsebgp_arrow_batch parsebgp_arrow_batch_t;
+
+/** Opaque structure representing an Arrow IPC stream writer */
+typedef struct parsebgp_arrow_writer parsebgp_arrow_writer_t;
+
+/**
+ * Create an empty batch
+ *
+ * @return pointer to the batch, or NULL if memory allocation failed
+ */
+parsebgp_arrow_batch_t *parsebgp_arrow_batch_create(void);
+
+/** Destroy the given batch
+ *
+ * @param batch         Pointer to the batch to destroy
+ */
+void parsebgp_arrow_batch_destroy(parsebgp_arrow_batch_t *batch);
+
+/** Remove all rows from the given batch (allocated memory is kept for reuse)
+ *
+ * @param batch         Pointer to the batch to clear
+ */
+void parsebgp_arrow_batch_clear(parsebgp_arrow_batch_t *batch);
+
+/**
+ * Get the number of rows in the given batch
+ *
+ * @param batch         Pointer to the batch
+ * @return the number of rows
+ */
+uint32_t parsebgp_arrow_batch_get_rows_cnt(const parsebgp_arrow_batch_t *batch);
+
+/**
+ * Add the routes carried by a decoded message to the given batch
+ *
+ * @param batch         Pointer to the batch to add rows to
+ * @param msg           Pointer to the decoded message
+ * @return PARSEBGP_OK if successful, or an error code otherwise
+ *
+ * Messages without routes are ignored, except for TABLE_DUMP_V2 Peer Index
+ * Tables, of which the batch keeps a copy to resolve the peers of later RIB
+ * entries. RIB entries with peers resolved by the parser (see the
+ * mrt.peer_index option) do not need the table.
+ *
+ * Messages decoded with the bgp.as_path_summary option cannot be added, since
+ * the as_path column needs the full path (PARSEBGP_NOT_IMPLEMENTED is
+ * returned).
+ */
+parsebgp_error_t parsebgp_arrow_batch_add_msg(parsebgp_arrow_batch_t *batch,
+                                              const parsebgp_msg_t *msg);
+
+/**
+ * Create an Arrow IPC stream writer
+ *
+ * @param fd            File descriptor to write the stream to
+ * @return pointer to the writer, or NULL if memory allocation failed
+ *
+ * The stream schema is written before the first batch (or when the writer is
+ * destroyed, if no batches were written).
+ */
+parsebgp_arrow_writer_t *parsebgp_arrow_writer_create(int fd);
+
+/**
+ * Finish the stream and destroy the given writer
+ *
+ * @param writer        Pointer to the writer to destroy
+ * @return PARSEBGP_OK if the stream was completely written, or an error code
+ * otherwise (e.g., PARSEBGP_IO_ERROR if any write failed)
+ */
+parsebgp_error_t parsebgp_arrow_writer_destroy(parsebgp_arrow_writer_t *writer);
+
+/**
+ * Write a batch to the stream as a record batch
+ *
+ * @param writer        Pointer to the writer
+ * @param batch         Pointer to the batch to write (not modified)
+ * @return PARSEBGP_OK if successful, or an error code otherwise
+ *
+ * The writer is not thread-safe: only one thread may write batches to a given
+ * writer.
+ */
+parsebgp_error_t parsebgp_arrow_writer_write_batch(
+  parsebgp_arrow_writer_t *writer, const parsebgp_arrow_batch_t *batch);
+
+#endif /* __PARSEBGP_ARROW_H */
@@ -0,0 +1,703 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_bgpdump.h"
+#include "parsebgp_format.h"
+#include "parsebgp_utils.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Minimum size of the output buffer (must comfortably hold a line header) */
+#define BUFLEN_MIN 4096
+
+/** Upper bound on the length of a line header (type, timestamp, action, peer
+    IP and peer ASN, including separators) */
+#define HDR_LEN_MAX 128
+
+/** Upper bound on the length of the fixed-size fields of an attribute tail
+    (origin, next-hop, local pref, MED, atomic aggregate, aggregator and
+    separators) */
+#define TAIL_FIXED_LEN_MAX 192
+
+/** Copy a string literal to p and advance p */
+#define PUT_LIT(p, lit)                                                        \
+  do {                                                                         \
+    memcpy((p), (lit), sizeof(lit) - 1);                                       \
+    (p) += sizeof(lit) - 1;                                                    \
+  } while (0)
+
+/** Check whether the given path attribute is present */
+#define HAS_ATTR(attrs, attr_type) ((attrs)->attrs[(attr_type)].type == (attr_type))
+
+struct parsebgp_bgpdump {
+
+  /** File descriptor to write to */
+  int fd;
+
+  /** Output buffer */
+  char *buf;
+
+  /** Number of bytes used in the output buffer */
+  size_t buf_len;
+
+  /** Size of the output buffer */
+  size_t buf_size;
+
+  /** Formatted attribute tail ("path|origin|next-hop|...|\n") shared by all
+      lines that use the same attributes */
+  char *tail;
+
+  /** Length of the formatted tail */
+  size_t tail_len;
+
+  /** Allocated length of the tail buffer */
+  size_t _tail_alloc_len;
+
+  /** Attributes (and prefix AFI) that the tail was formatted for */
+  const parsebgp_bgp_update_path_attrs_t *tail_attrs;
+  int tail_afi;
+
+  /** Copy of the most recent TABLE_DUMP_V2 peer index table */
+  parsebgp_mrt_peer_index_t *peers;
+
+  /** First error encountered while writing */
+  parsebgp_error_t err;
+};
+
+static void flush_buf(parsebgp_bgpdump_t *w)
+{
+  size_t off = 0;
+  ssize_t rc;
+
+  while (off < w->buf_len) {
+    if ((rc = write(w->fd, w->buf + off, w->buf_len - off)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // the rest of the buffer is dropped
+      w->err = PARSEBGP_IO_ERROR;
+      break;
+    }
+    off += rc;
+  }
+  w->buf_len = 0;
+}
+
+/** Get a pointer to at least len free bytes in the output buffer (the caller
+    must update buf_len) */
+static inline char *out_reserve(parsebgp_bgpdump_t *w, size_t len)
+{
+  if (w->buf_size - w->buf_len < len) {
+    flush_buf(w);
+  }
+  return w->buf + w->buf_len;
+}
+
+/** Copy an arbitrary amount of data to the output buffer */
+static void out_write(parsebgp_bgpdump_t *w, const char *data, size_t len)
+{
+  size_t chunk;
+
+  while (len > 0) {
+    if (w->buf_len == w->buf_size) {
+      flush_buf(w);
+    }
+    chunk = w->buf_size - w->buf_len;
+    if (chunk > len) {
+      chunk = len;
+    }
+    memcpy(w->buf + w->buf_len, data, chunk);
+    w->buf_len += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+/** Format "TYPE|timestamp|ACTION|peer-ip|peer-asn|" into hdr */
+static size_t format_hdr(char *hdr, const char *type, size_t type_len,
+                         const parsebgp_mrt_msg_t *mrt, const char *action,
+                         size_t action_len, int peer_afi,
+                         const uint8_t *peer_ip, uint32_t peer_asn)
+{
+  char usec[PARSEBGP_FORMAT_UINT64_LEN];
+  char *p = hdr;
+  size_t n;
+
+  memcpy(p, type, type_len);
+  p += type_len;
+  *(p++) = '|';
+  p += parsebgp_format_uint32(p, mrt->timestamp_sec);
+  if (mrt->type == PARSEBGP_MRT_TYPE_BGP4MP_ET) {
+    // microseconds are zero-padded to 6 digits
+    *(p++) = '.';
+    n = parsebgp_format_uint32(usec, mrt->timestamp_usec % 1000000);
+    memset(p, '0', 6 - n);
+    p += 6 - n;
+    memcpy(p, usec, n);
+    p += n;
+  }
+  *(p++) = '|';
+  memcpy(p, action, action_len);
+  p += action_len;
+  *(p++) = '|';
+  p += parsebgp_format_ip(p, peer_afi, peer_ip);
+  *(p++) = '|';
+  p += parsebgp_format_uint32(p, peer_asn);
+  *(p++) = '|';
+
+  return p - hdr;
+}
+
+static char *format_as_path(char *p, const parsebgp_bgp_update_as_path_t *ap)
+{
+  const parsebgp_bgp_update_as_path_seg_t *seg;
+  char open, close, sep;
+  int i, j;
+
+  for (i = 0; i < ap->segs_cnt; i++) {
+    seg = &ap->segs[i];
+    if (i != 0) {
+      *(p++) = ' ';
+    }
+
+    switch (seg->type) {
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SET:
+      open = '{';
+      close = '}';
+      sep = ',';
+      break;
+
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_CONFED_SEQ:
+      open = '(';
+      close = ')';
+      sep = ' ';
+      break;
+
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_CONFED_SET:
+      open = '[';
+      close = ']';
+      sep = ' ';
+      break;
+
+    case PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ:
+    default:
+      open = close = '\0';
+      sep = ' ';
+      break;
+    }
+
+    if (open != '\0') {
+      *(p++) = open;
+    }
+    for (j = 0; j < seg->asns_cnt; j++) {
+      if (j != 0) {
+        *(p++) = sep;
+      }
+      p += parsebgp_format_uint32(p, seg->asns[j]);
+    }
+    if (close != '\0') {
+      *(p++) = close;
+    }
+  }
+
+  return p;
+}
+
+static char *format_next_hop(char *p,
+                             const parsebgp_bgp_update_path_attrs_t *attrs,
+                             int afi)
+{
+  const parsebgp_bgp_update_mp_reach_t *mp_reach;
+
+  if (afi == PARSEBGP_BGP_AFI_IPV4 &&
+      HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP)) {
+    return p + parsebgp_format_ipv4(
+                 p, attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP]
+                      .data.next_hop);
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)) {
+    mp_reach =
+      attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].data.mp_reach;
+    return p + parsebgp_format_ip(p, mp_reach->afi, mp_reach->next_hop);
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP)) {
+    return p + parsebgp_format_ipv4(
+                 p, attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP]
+                      .data.next_hop);
+  }
+  return p;
+}
+
+/** Format "path|origin|next-hop|local-pref|med|communities|AG|aggregator|\n"
+    into the tail buffer (unless it already holds the tail for these
+    attributes) */
+static void format_tail(parsebgp_bgpdump_t *w,
+                        const parsebgp_bgp_update_path_attrs_t *attrs, int afi)
+{
+  const parsebgp_bgp_update_as_path_t *ap = attrs->as_path;
+  const parsebgp_bgp_update_communities_t *comms = NULL;
+  const parsebgp_bgp_update_large_communities_t *lcomms = NULL;
+  parsebgp_bgp_update_large_community_t lcomm;
+  const parsebgp_bgp_update_aggregator_t *agg;
+  size_t len = TAIL_FIXED_LEN_MAX;
+  uint32_t comm;
+  char *p;
+  int i;
+
+  if (w->tail_attrs == attrs && w->tail_afi == afi) {
+    return;
+  }
+
+  if (ap != NULL && ap->summary_only) {
+    // only the summary of the path was parsed, and the bgpdump format has no
+    // way to show that
+    w->err = PARSEBGP_NOT_IMPLEMENTED;
+    w->tail_len = 0;
+    w->tail_attrs = NULL;
+    return;
+  }
+
+  // work out how much space the variable-length fields may need
+  if (ap != NULL) {
+    for (i = 0; i < ap->segs_cnt; i++) {
+      len += 3 + (size_t)ap->segs[i].asns_cnt * 11;
+    }
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES)) {
+    comms = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES]
+              .data.communities;
+    len += (size_t)comms->communities_cnt * 12;
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES)) {
+    lcomms = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES]
+               .data.large_communities;
+    len += (size_t)lcomms->communities_cnt * 34;
+  }
+  if (len > w->_tail_alloc_len) {
+    if ((p = realloc(w->tail, len)) == NULL) {
+      w->err = PARSEBGP_MALLOC_FAILURE;
+      w->tail_len = 0;
+      w->tail_attrs = NULL;
+      return;
+    }
+    w->tail = p;
+    w->_tail_alloc_len = len;
+  }
+  p = w->tail;
+
+  // AS Path
+  if (ap != NULL) {
+    p = format_as_path(p, ap);
+  }
+  *(p++) = '|';
+
+  // Origin
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN)) {
+    switch (attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN].data.origin) {
+    case PARSEBGP_BGP_UPDATE_ORIGIN_IGP:
+      PUT_LIT(p, "IGP");
+      break;
+
+    case PARSEBGP_BGP_UPDATE_ORIGIN_EGP:
+      PUT_LIT(p, "EGP");
+      break;
+
+    default:
+      PUT_LIT(p, "INCOMPLETE");
+      break;
+    }
+  }
+  *(p++) = '|';
+
+  // Next Hop
+  p = format_next_hop(p, attrs, afi);
+  *(p++) = '|';
+
+  // Local Pref and MED (zero if not present)
+  p += parsebgp_format_uint32(
+    p, HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF)
+         ? attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF].data.local_pref
+         : 0);
+  *(p++) = '|';
+  p += parsebgp_format_uint32(
+    p, HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MED)
+         ? attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MED].data.med
+         : 0);
+  *(p++) = '|';
+
+  // Communities, followed by Large Communities
+  if (comms != NULL) {
+    for (i = 0; i < comms->communities_cnt; i++) {
+      if (i != 0) {
+        *(p++) = ' ';
+      }
+      comm = parsebgp_bgp_update_community_get(comms, i);
+      p += parsebgp_format_uint32(p, comm >> 16);
+      *(p++) = ':';
+      p += parsebgp_format_uint32(p, comm & 0xFFFF);
+    }
+  }
+  if (lcomms != NULL) {
+    for (i = 0; i < lcomms->communities_cnt; i++) {
+      if (i != 0 || (comms != NULL && comms->communities_cnt != 0)) {
+        *(p++) = ' ';
+      }
+      parsebgp_bgp_update_large_community_get(lcomms, i, &lcomm);
+      p += parsebgp_format_uint32(p, lcomm.global_admin);
+      *(p++) = ':';
+      p += parsebgp_format_uint32(p, lcomm.local_1);
+      *(p++) = ':';
+      p += parsebgp_format_uint32(p, lcomm.local_2);
+    }
+  }
+  *(p++) = '|';
+
+  // Atomic Aggregate
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_ATOMIC_AGGREGATE)) {
+    PUT_LIT(p, "AG|");
+  } else {
+    PUT_LIT(p, "NAG|");
+  }
+
+  // Aggregator (preferring AS4_AGGREGATOR if AGGREGATOR has AS_TRANS)
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR)) {
+    agg = &attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR].data.aggregator;
+    if (agg->asn == PARSEBGP_BGP_AS_TRANS &&
+        HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR)) {
+      agg = &attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR]
+               .data.aggregator;
+    }
+    p += parsebgp_format_uint32(p, agg->asn);
+    *(p++) = ' ';
+    p += parsebgp_format_ipv4(p, agg->addr);
+  }
+  PUT_LIT(p, "|\n");
+
+  w->tail_len = p - w->tail;
+  w->tail_attrs = attrs;
+  w->tail_afi = afi;
+}
+
+/** Write "<hdr><prefix>" followed by the current tail, or by a newline if
+    with_tail is not set */
+static void write_route(parsebgp_bgpdump_t *w, const char *hdr, size_t hdr_len,
+                        const char *pfx, size_t pfx_len, int with_tail)
+{
+  char *p;
+
+  if (w->err != PARSEBGP_OK) {
+    // don't write a line without (or with a stale) tail
+    return;
+  }
+  p = out_reserve(w, hdr_len + pfx_len + 2);
+
+  memcpy(p, hdr, hdr_len);
+  p += hdr_len;
+  memcpy(p, pfx, pfx_len);
+  p += pfx_len;
+  if (!with_tail) {
+    *(p++) = '\n';
+    w->buf_len = p - w->buf;
+    return;
+  }
+  *(p++) = '|';
+  w->buf_len = p - w->buf;
+  out_write(w, w->tail, w->tail_len);
+}
+
+static void write_prefixes(parsebgp_bgpdump_t *w, const char *hdr,
+                           size_t hdr_len, const parsebgp_bgp_prefix_t *pfxs,
+                           int pfxs_cnt,
+                           const parsebgp_bgp_update_path_attrs_t *attrs)
+{
+  char pfx[PARSEBGP_FORMAT_PFX_LEN];
+  size_t pfx_len;
+  int i;
+
+  for (i = 0; i < pfxs_cnt; i++) {
+    pfx_len = parsebgp_format_pfx(pfx, pfxs[i].afi, pfxs[i].addr, pfxs[i].len);
+    if (attrs != NULL) {
+      format_tail(w, attrs, pfxs[i].afi);
+    }
+    write_route(w, hdr, hdr_len, pfx, pfx_len, attrs != NULL);
+  }
+}
+
+static void write_table_dump(parsebgp_bgpdump_t *w,
+                             const parsebgp_mrt_msg_t *mrt)
+{
+  const parsebgp_mrt_table_dump_t *td = mrt->types.table_dump;
+  char hdr[HDR_LEN_MAX], pfx[PARSEBGP_FORMAT_PFX_LEN];
+  size_t hdr_len, pfx_len;
+  int afi = mrt->subtype; // subtype is the AFI
+
+  if (td == NULL) {
+    return;
+  }
+
+  hdr_len = format_hdr(hdr, "TABLE_DUMP", sizeof("TABLE_DUMP") - 1, mrt, "B",
+                       1, afi, td->peer_ip, td->peer_asn);
+  pfx_len = parsebgp_format_pfx(pfx, afi, td->prefix, td->prefix_len);
+  format_tail(w, &td->path_attrs, afi);
+  write_route(w, hdr, hdr_len, pfx, pfx_len, 1);
+}
+
+static void write_table_dump_v2(parsebgp_bgpdump_t *w,
+                                const parsebgp_mrt_msg_t *mrt)
+{
+  const parsebgp_mrt_table_dump_v2_t *td = mrt->types.table_dump_v2;
+  const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *rib;
+  const parsebgp_mrt_table_dump_v2_rib_entry_t *entry;
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *peer;
+  const parsebgp_bgp_update_path_attrs_t *attrs;
+  char hdr[HDR_LEN_MAX], pfx[PARSEBGP_FORMAT_PFX_LEN];
+  size_t hdr_len, pfx_len;
+  int afi, i;
+
+  if (td == NULL) {
+    return;
+  }
+
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE:
+    parsebgp_mrt_peer_index_destroy(w->peers);
+    if ((w->peers = parsebgp_mrt_peer_index_create(&td->peer_index)) ==
+        NULL) {
+      w->err = PARSEBGP_MALLOC_FAILURE;
+    }
+    return;
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
+    afi = PARSEBGP_BGP_AFI_IPV4;
+    break;
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
+    afi = PARSEBGP_BGP_AFI_IPV6;
+    break;
+
+  default:
+    // generic RIBs are not supported by the parser
+    return;
+  }
+
+  rib = &td->afi_safi_rib;
+  pfx_len = parsebgp_format_pfx(pfx, afi, rib->prefix, rib->prefix_len);
+
+  for (i = 0; i < rib->entry_count; i++) {
+    entry = &rib->entries[i];
+    if ((peer = entry->peer) == NULL &&
+        (w->peers == NULL ||
+         (peer = parsebgp_mrt_peer_index_get_peer(w->peers,
+                                                  entry->peer_index)) ==
+           NULL)) {
+      // no peer index table (yet), nothing sensible to print
+      continue;
+    }
+    attrs = entry->path_attrs_ptr != NULL ? entry->path_attrs_ptr
+                                          : &entry->path_attrs;
+
+    hdr_len = format_hdr(hdr, "TABLE_DUMP2", sizeof("TABLE_DUMP2") - 1, mrt,
+                         "B", 1, peer->ip_afi, peer->ip, peer->asn);
+    format_tail(w, attrs, afi);
+    write_route(w, hdr, hdr_len, pfx, pfx_len, 1);
+  }
+}
+
+static void write_bgp4mp(parsebgp_bgpdump_t *w, const parsebgp_mrt_msg_t *mrt)
+{
+  const parsebgp_mrt_bgp4mp_t *b = mrt->types.bgp4mp;
+  const parsebgp_bgp_update_t *update;
+  const parsebgp_bgp_update_path_attrs_t *attrs;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach;
+  const parsebgp_bgp_update_mp_unreach_t *mp_unreach;
+  const char *type = "BGP4MP";
+  size_t type_len = sizeof("BGP4MP") - 1;
+  char hdr[HDR_LEN_MAX];
+  size_t hdr_len;
+  char *p;
+
+  if (b == NULL) {
+    return;
+  }
+  if (mrt->type == PARSEBGP_MRT_TYPE_BGP4MP_ET) {
+    type = "BGP4MP_ET";
+    type_len = sizeof("BGP4MP_ET") - 1;
+  }
+
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
+    hdr_len = format_hdr(hdr, type, type_len, mrt, "STATE", 5, b->afi,
+                         b->peer_ip, b->peer_asn);
+    p = out_reserve(w, hdr_len + 2 * PARSEBGP_FORMAT_UINT64_LEN + 2);
+    memcpy(p, hdr, hdr_len);
+    p += hdr_len;
+    p += parsebgp_format_uint32(p, b->data.state_change.old_state);
+    *(p++) = '|';
+    p += parsebgp_format_uint32(p, b->data.state_change.new_state);
+    *(p++) = '\n';
+    w->buf_len = p - w->buf;
+    return;
+
+  case PARSEBGP_MRT_BGP4MP_MESSAGE:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+    break;
+
+  default:
+    return;
+  }
+
+  if (b->data.bgp_msg == NULL ||
+      b->data.bgp_msg->type != PARSEBGP_BGP_TYPE_UPDATE ||
+      (update = b->data.bgp_msg->types.update) == NULL) {
+    return;
+  }
+  attrs = &update->path_attrs;
+
+  // Withdrawals first (as bgpdump does)
+  mp_unreach =
+    HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI)
+      ? attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+          .data.mp_unreach
+      : NULL;
+  if (update->withdrawn_nlris.prefixes_cnt != 0 ||
+      (mp_unreach != NULL && mp_unreach->withdrawn_nlris_cnt != 0)) {
+    hdr_len = format_hdr(hdr, type, type_len, mrt, "W", 1, b->afi, b->peer_ip,
+                         b->peer_asn);
+    write_prefixes(w, hdr, hdr_len, update->withdrawn_nlris.prefixes,
+                   update->withdrawn_nlris.prefixes_cnt, NULL);
+    if (mp_unreach != NULL) {
+      write_prefixes(w, hdr, hdr_len, mp_unreach->withdrawn_nlris,
+                     mp_unreach->withdrawn_nlris_cnt, NULL);
+    }
+  }
+
+  // Then announcements
+  mp_reach = HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)
+               ? attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI]
+                   .data.mp_reach
+               : NULL;
+  if (update->announced_nlris.prefixes_cnt != 0 ||
+      (mp_reach != NULL && mp_reach->nlris_cnt != 0)) {
+    hdr_len = format_hdr(hdr, type, type_len, mrt, "A", 1, b->afi, b->peer_ip,
+                         b->peer_asn);
+    write_prefixes(w, hdr, hdr_len, update->announced_nlris.prefixes,
+                   update->announced_nlris.prefixes_cnt, attrs);
+    if (mp_reach != NULL) {
+      write_prefixes(w, hdr, hdr_len, mp_reach->nlris, mp_reach->nlris_cnt,
+                     attrs);
+    }
+  }
+}
+
+parsebgp_bgpdump_t *parsebgp_bgpdump_create(int fd, size_t buflen)
+{
+  parsebgp_bgpdump_t *w;
+
+  if ((w = malloc_zero(sizeof(*w))) == NULL) {
+    return NULL;
+  }
+  if (buflen == 0) {
+    buflen = PARSEBGP_BGPDUMP_BUFLEN;
+  } else if (buflen < BUFLEN_MIN) {
+    buflen = BUFLEN_MIN;
+  }
+  if ((w->buf = malloc(buflen)) == NULL) {
+    free(w);
+    return NULL;
+  }
+  w->fd = fd;
+  w->buf_size = buflen;
+  w->err = PARSEBGP_OK;
+
+  return w;
+}
+
+parsebgp_error_t parsebgp_bgpdump_destroy(parsebgp_bgpdump_t *writer)
+{
+  parsebgp_error_t err;
+
+  if (writer == NULL) {
+    return PARSEBGP_OK;
+  }
+
+  err = parsebgp_bgpdump_flush(writer);
+
+  parsebgp_mrt_peer_index_destroy(writer->peers);
+  free(writer->tail);
+  free(writer->buf);
+  free(writer);
+
+  return err;
+}
+
+parsebgp_error_t parsebgp_bgpdump_write_msg(parsebgp_bgpdump_t *writer,
+                                            const parsebgp_msg_t *msg)
+{
+  const parsebgp_mrt_msg_t *mrt;
+
+  if (msg->type != PARSEBGP_MSG_TYPE_MRT || (mrt = msg->types.mrt) == NULL) {
+    // only MRT data has a bgpdump representation
+    return writer->err;
+  }
+
+  // the attributes of the previous message may have been cleared (and their
+  // memory reused) since the tail was formatted
+  writer->tail_attrs = NULL;
+
+  switch (mrt->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP:
+    write_table_dump(writer, mrt);
+    break;
+
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    write_table_dump_v2(writer, mrt);
+    break;
+
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    write_bgp4mp(writer, mrt);
+    break;
+
+  default:
+    break;
+  }
+
+  return writer->err;
+}
+
+parsebgp_error_t parsebgp_bgpdump_flush(parsebgp_bgpdump_t *writer)
+{
+  flush_buf(writer);
+  return writer->err;
+}
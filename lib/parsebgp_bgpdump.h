@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_BGPDUMP_H
+#define __PARSEBGP_BGPDUMP_H
+
+#include "parsebgp.h"
+#include <stddef.h>
+
+/** Default size of the output buffer of a bgpdump writer */
+#define PARSEBGP_BGPDUMP_BUFLEN (4 * 1024 * 1024)
+
+/**
+ * bgpdump-compatible Line Writer
+ *
+ * Writes decoded MRT messages in the one-line-per-route format produced by
+ * "bgpdump -m", e.g.:
+ *
+ * TABLE_DUMP2|1500000000|B|192.0.2.1|64496|198.51.100.0/24|64496 64511|IGP|
+ *   192.0.2.1|0|0|64496:1|NAG||
+ *
+ * TABLE_DUMP, TABLE_DUMP_V2 and BGP4MP/BGP4MP_ET (UPDATE and STATE_CHANGE)
+ * messages are written, all other messages are ignored. Lines are formatted
+ * into a large buffer that is written to the output file descriptor with a
+ * single write call whenever it fills up.
+ *
+ * The writer keeps a copy of the most recent TABLE_DUMP_V2 PEER_INDEX_TABLE,
+ * so RIB messages must be passed to the same writer as their peer index
+ * table (or decoded with the mrt.peer_index option set). A writer is not
+ * thread-safe.
+ *
+ * Messages must be decoded without the bgp.as_path_summary option, since the
+ * full AS path is written (PARSEBGP_NOT_IMPLEMENTED is returned otherwise).
+ */
+typedef struct parsebgp_bgpdump parsebgp_bgpdump_t;
+
+/**
+ * Create a bgpdump writer
+ *
+ * @param fd            file descriptor to write to (not closed by the writer)
+ * @param buflen        size of the output buffer (0 for
+ *                      PARSEBGP_BGPDUMP_BUFLEN)
+ * @return pointer to the writer, or NULL if memory allocation failed
+ */
+parsebgp_bgpdump_t *parsebgp_bgpdump_create(int fd, size_t buflen);
+
+/**
+ * Flush and destroy the given writer
+ *
+ * @param writer        pointer to the writer to destroy
+ * @return PARSEBGP_OK if the final flush succeeded, or PARSEBGP_IO_ERROR
+ */
+parsebgp_error_t parsebgp_bgpdump_destroy(parsebgp_bgpdump_t *writer);
+
+/**
+ * Write the lines for a decoded message
+ *
+ * @param writer        pointer to the writer
+ * @param msg           pointer to the decoded message
+ * @return PARSEBGP_OK if successful, or an error code otherwise
+ *
+ * Output may remain buffered until the buffer fills up, or until
+ * parsebgp_bgpdump_flush or parsebgp_bgpdump_destroy is called.
+ */
+parsebgp_error_t parsebgp_bgpdump_write_msg(parsebgp_bgpdump_t *writer,
+                                            const parsebgp_msg_t *msg);
+
+/**
+ * Write any buffered output
+ *
+ * @param writer        pointer to the writer
+ * @return PARSEBGP_OK if successful, or PARSEBGP_IO_ERROR
+ */
+parsebgp_error_t parsebgp_bgpdump_flush(parsebgp_bgpdump_t *writer);
+
+#endif /* __PARSEBGP_BGPDUMP_H */
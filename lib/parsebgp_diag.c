@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_diag.h"
+#include "parsebgp_opts.h"
+#include "parsebgp_utils.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/** Maximum length of a formatted diagnostic message */
+#define DIAG_MSG_LEN 1024
+
+static const char *code_strs[] = {
+  "NOT_IMPLEMENTED", // PARSEBGP_DIAG_NOT_IMPLEMENTED
+  "INVALID_MSG",     // PARSEBGP_DIAG_INVALID_MSG
+  "DUPLICATE_ATTR",  // PARSEBGP_DIAG_DUPLICATE_ATTR
+};
+
+const char *parsebgp_diag_code_str(parsebgp_diag_code_t code)
+{
+  if (code < 0 || code >= PARSEBGP_DIAG_CODES_CNT) {
+    return "UNKNOWN";
+  }
+  return code_strs[code];
+}
+
+void parsebgp_diag_state_clear(parsebgp_diag_state_t *state)
+{
+  memset(state, 0, sizeof(*state));
+}
+
+void parsebgp_diag_report(parsebgp_opts_t *opts, int code, int fatal,
+                          int silenced, const uint8_t *ptr, const char *file,
+                          int line, const char *fmt, ...)
+{
+  parsebgp_diag_opts_t *dopts = &opts->diag;
+  parsebgp_diag_state_t *state = dopts->state;
+  parsebgp_diag_t diag;
+  char msg[DIAG_MSG_LEN];
+  va_list ap;
+  uint64_t now;
+
+  if (state != NULL) {
+    state->events_cnt[code]++;
+  }
+  if (silenced) {
+    return;
+  }
+
+  if (state != NULL && dopts->rate_limit != 0) {
+    now = (uint64_t)time(NULL);
+    if (now != state->_window_start) {
+      state->_window_start = now;
+      memset(state->_window_cnt, 0, sizeof(state->_window_cnt));
+    }
+    if (state->_window_cnt[code] >= dopts->rate_limit) {
+      state->suppressed_cnt[code]++;
+      state->_pending_cnt[code]++;
+      return;
+    }
+    state->_window_cnt[code]++;
+  }
+
+  va_start(ap, fmt);
+  vsnprintf(msg, sizeof(msg), fmt, ap);
+  va_end(ap);
+
+  diag.code = code;
+  diag.fatal = fatal;
+  diag.msg_type = dopts->_msg_type;
+  diag.attr_type = dopts->_attr_type;
+  diag.offset = (dopts->_msg_buf != NULL && ptr != NULL)
+                  ? (int64_t)(ptr - dopts->_msg_buf)
+                  : -1;
+  diag.suppressed_cnt = 0;
+  if (state != NULL) {
+    diag.suppressed_cnt = state->_pending_cnt[code];
+    state->_pending_cnt[code] = 0;
+  }
+  diag.msg = msg;
+  diag.file = file;
+  diag.line = line;
+
+  if (dopts->cb != NULL) {
+    dopts->cb(&diag, dopts->cb_user);
+    return;
+  }
+
+  if (diag.suppressed_cnt != 0) {
+    fprintf(stderr, "WARN: %s: %" PRIu64 " similar messages suppressed\n",
+            code_strs[code], diag.suppressed_cnt);
+  }
+  fprintf(stderr, "%s: %s: %s (%s:%d)\n", fatal ? "ERROR" : "WARN",
+          code_strs[code], msg, file, line);
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_DIAG_H
+#define __PARSEBGP_DIAG_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Diagnostic Codes
+ */
+typedef enum {
+
+  /** An unsupported message feature was found */
+  PARSEBGP_DIAG_NOT_IMPLEMENTED = 0,
+
+  /** A malformed message feature was found */
+  PARSEBGP_DIAG_INVALID_MSG = 1,
+
+  /** A path attribute was found more than once in an UPDATE message (all but
+      the first occurrence are skipped) */
+  PARSEBGP_DIAG_DUPLICATE_ATTR = 2
+
+} parsebgp_diag_code_t;
+
+/** Number of diagnostic codes */
+#define PARSEBGP_DIAG_CODES_CNT 3
+
+/**
+ * Diagnostic Event
+ */
+typedef struct parsebgp_diag {
+
+  /** Diagnostic code */
+  parsebgp_diag_code_t code;
+
+  /** Set if the parser gave up on the message because of this event (i.e.,
+      the decode call will return an error) */
+  int fatal;
+
+  /** Type of the top-level message being decoded (parsebgp_msg_type_t), or 0
+      if unknown */
+  int msg_type;
+
+  /** Type of the path attribute being decoded, or 0 if the event is not
+      associated with a path attribute */
+  int attr_type;
+
+  /** Offset of the event from the start of the top-level message, or -1 if
+      unknown */
+  int64_t offset;
+
+  /** Number of events with this code that were suppressed by rate limiting
+      since the previous report */
+  uint64_t suppressed_cnt;
+
+  /** Human-readable description of the event */
+  const char *msg;
+
+  /** Source file and line that raised the event */
+  const char *file;
+  int line;
+
+} parsebgp_diag_t;
+
+/**
+ * Diagnostics Callback
+ *
+ * @param diag          pointer to the event (only valid during the call)
+ * @param user          user pointer from the diagnostics options
+ */
+typedef void(parsebgp_diag_cb_t)(const parsebgp_diag_t *diag, void *user);
+
+/**
+ * Diagnostics State
+ *
+ * Caller-owned counters (and rate limiting state) that are updated for every
+ * diagnostic event, including those that are not reported. The state is not
+ * synchronized, so each decoding thread should use its own.
+ */
+typedef struct parsebgp_diag_state {
+
+  /** Number of events, per code */
+  uint64_t events_cnt[PARSEBGP_DIAG_CODES_CNT];
+
+  /** Number of events that were not reported because of rate limiting, per
+      code */
+  uint64_t suppressed_cnt[PARSEBGP_DIAG_CODES_CNT];
+
+  /** INTERNAL: Start (in seconds) of the current rate limiting window */
+  uint64_t _window_start;
+
+  /** INTERNAL: Number of events reported in the current window, per code */
+  uint32_t _window_cnt[PARSEBGP_DIAG_CODES_CNT];
+
+  /** INTERNAL: Number of events suppressed since the last report, per code */
+  uint64_t _pending_cnt[PARSEBGP_DIAG_CODES_CNT];
+
+} parsebgp_diag_state_t;
+
+/**
+ * Diagnostics Options
+ *
+ * By default (i.e., with no callback and no state) every diagnostic event is
+ * written to stderr as it happens, unless it is a non-fatal event that has
+ * been silenced using the silence_not_implemented/silence_invalid options.
+ * Setting the silence options along with a state pointer routes everything to
+ * counters without any formatting cost.
+ */
+typedef struct parsebgp_diag_opts {
+
+  /** Function to receive diagnostic reports instead of stderr (or NULL) */
+  parsebgp_diag_cb_t *cb;
+
+  /** User pointer passed to the callback */
+  void *cb_user;
+
+  /** Caller-owned state to count events in (or NULL). Required for rate
+      limiting. */
+  parsebgp_diag_state_t *state;
+
+  /** Maximum number of reports per code per second (0 for no limit) */
+  uint32_t rate_limit;
+
+  /** INTERNAL: Start of the top-level message being decoded */
+  const uint8_t *_msg_buf;
+
+  /** INTERNAL: Type of the top-level message being decoded */
+  int _msg_type;
+
+  /** INTERNAL: Type of the path attribute being decoded */
+  int _attr_type;
+
+} parsebgp_diag_opts_t;
+
+/**
+ * Get a string representation of a diagnostic code
+ *
+ * @param code          diagnostic code to convert
+ * @return borrowed pointer to a static string
+ */
+const char *parsebgp_diag_code_str(parsebgp_diag_code_t code);
+
+/**
+ * Reset the counters and rate limiting state
+ *
+ * @param state         pointer to the state to clear
+ */
+void parsebgp_diag_state_clear(parsebgp_diag_state_t *state);
+
+#endif /* __PARSEBGP_DIAG_H */
@@ -34,6 +34,7 @@ static const char *err_strings[] = {
   "Not Implemented",    // PARSEBGP_NOT_IMPLEMENTED
   "Malloc Failure",     // PARSEBGP_MALLOC_FAILURE
   "Truncated Message",  // PARSEBGP_TRUNCATED_MSG
+  "I/O Error",          // PARSEBGP_IO_ERROR
 };
 
 const char *parsebgp_strerror(parsebgp_error_t err)
@@ -53,7 +53,10 @@ typedef enum parsebgp_error {
   /** Message does not contain an entire sub-message */
   PARSEBGP_TRUNCATED_MSG = -5,
 
-  PARSEBGP_N_ERR = -6,
+  /** Failed to read or write a file */
+  PARSEBGP_IO_ERROR = -6,
+
+  PARSEBGP_N_ERR = -7,
 
 } parsebgp_error_t;
 
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_format.h"
+#include <string.h>
+
+/** Two-digit decimal strings for 00-99 */
+static const char digits2[] =
+  "00010203040506070809101112131415161718192021222324"
+  "25262728293031323334353637383940414243444546474849"
+  "50515253545556575859606162636465666768697071727374"
+  "75767778798081828384858687888990919293949596979899";
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/** Decimal strings for each IPv4 octet (padded to 4 bytes so that they can be
+    copied with a fixed-size memcpy) */
+static const char octet_strs[256][4] = {
+  "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13",
+  "14", "15", "16", "17", "18", "19", "20", "21", "22", "23", "24", "25", "26",
+  "27", "28", "29", "30", "31", "32", "33", "34", "35", "36", "37", "38", "39",
+  "40", "41", "42", "43", "44", "45", "46", "47", "48", "49", "50", "51", "52",
+  "53", "54", "55", "56", "57", "58", "59", "60", "61", "62", "63", "64", "65",
+  "66", "67", "68", "69", "70", "71", "72", "73", "74", "75", "76", "77", "78",
+  "79", "80", "81", "82", "83", "84", "85", "86", "87", "88", "89", "90", "91",
+  "92", "93", "94", "95", "96", "97", "98", "99", "100", "101", "102", "103",
+  "104", "105", "106", "107", "108", "109", "110", "111", "112", "113", "114",
+  "115", "116", "117", "118", "119", "120", "121", "122", "123", "124", "125",
+  "126", "127", "128", "129", "130", "131", "132", "133", "134", "135", "136",
+  "137", "138", "139", "140", "141", "142", "143", "144", "145", "146", "147",
+  "148", "149", "150", "151", "152", "153", "154", "155", "156", "157", "158",
+  "159", "160", "161", "162", "163", "164", "165", "166", "167", "168", "169",
+  "170", "171", "172", "173", "174", "175", "176", "177", "178", "179", "180",
+  "181", "182", "183", "184", "185", "186", "187", "188", "189", "190", "191",
+  "192", "193", "194", "195", "196", "197", "198", "199", "200", "201", "202",
+  "203", "204", "205", "206", "207", "208", "209", "210", "211", "212", "213",
+  "214", "215", "216", "217", "218", "219", "220", "221", "222", "223", "224",
+  "225", "226", "227", "228", "229", "230", "231", "232", "233", "234", "235",
+  "236", "237", "238", "239", "240", "241", "242", "243", "244", "245", "246",
+  "247", "248", "249", "250", "251", "252", "253", "254", "255",
+};
+
+static const char invalid_ip[] = "[invalid IP]";
+
+size_t parsebgp_format_uint32(char *buf, uint32_t val)
+{
+  char tmp[10];
+  char *p = tmp + sizeof(tmp);
+  size_t len;
+  uint32_t i;
+
+  // two digits at a time, from the right
+  while (val >= 100) {
+    i = (val % 100) * 2;
+    val /= 100;
+    p -= 2;
+    p[0] = digits2[i];
+    p[1] = digits2[i + 1];
+  }
+  if (val >= 10) {
+    p -= 2;
+    p[0] = digits2[val * 2];
+    p[1] = digits2[val * 2 + 1];
+  } else {
+    *(--p) = '0' + val;
+  }
+
+  len = tmp + sizeof(tmp) - p;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
+  return len;
+}
+
+size_t parsebgp_format_uint64(char *buf, uint64_t val)
+{
+  char tmp[20];
+  char *p = tmp + sizeof(tmp);
+  size_t len;
+  uint64_t i;
+
+  if (val <= UINT32_MAX) {
+    return parsebgp_format_uint32(buf, (uint32_t)val);
+  }
+
+  while (val >= 100) {
+    i = (val % 100) * 2;
+    val /= 100;
+    p -= 2;
+    p[0] = digits2[i];
+    p[1] = digits2[i + 1];
+  }
+  if (val >= 10) {
+    p -= 2;
+    p[0] = digits2[val * 2];
+    p[1] = digits2[val * 2 + 1];
+  } else {
+    *(--p) = '0' + val;
+  }
+
+  len = tmp + sizeof(tmp) - p;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
+  return len;
+}
+
+/* Octet lengths are derived from the value rather than stored, which keeps the
+   table to 1KB */
+#define OCTET_LEN(o) (1 + ((o) >= 10) + ((o) >= 100))
+
+size_t parsebgp_format_ipv4(char *buf, const uint8_t *addr)
+{
+  char *p = buf;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    memcpy(p, octet_strs[addr[i]], 4);
+    p += OCTET_LEN(addr[i]);
+    *(p++) = '.';
+  }
+  memcpy(p, octet_strs[addr[3]], 4);
+  p += OCTET_LEN(addr[3]);
+  *p = '\0';
+
+  return p - buf;
+}
+
+static inline char *format_hex16(char *p, uint16_t w)
+{
+  // no leading zeros (RFC 5952 section 4.1)
+  if (w >= 0x1000) {
+    *(p++) = hex_digits[w >> 12];
+  }
+  if (w >= 0x100) {
+    *(p++) = hex_digits[(w >> 8) & 0xF];
+  }
+  if (w >= 0x10) {
+    *(p++) = hex_digits[(w >> 4) & 0xF];
+  }
+  *(p++) = hex_digits[w & 0xF];
+  return p;
+}
+
+size_t parsebgp_format_ipv6(char *buf, const uint8_t *addr)
+{
+  uint16_t words[8];
+  int best_base = -1, best_len = 0, cur_base = -1, cur_len = 0;
+  char *p = buf;
+  int i;
+
+  // find the longest run of zero words (the first one if there is a tie)
+  for (i = 0; i < 8; i++) {
+    words[i] = ((uint16_t)addr[i * 2] << 8) | addr[i * 2 + 1];
+    if (words[i] == 0) {
+      if (cur_base == -1) {
+        cur_base = i;
+        cur_len = 0;
+      }
+      cur_len++;
+    } else if (cur_base != -1) {
+      if (cur_len > best_len) {
+        best_base = cur_base;
+        best_len = cur_len;
+      }
+      cur_base = -1;
+    }
+  }
+  if (cur_base != -1 && cur_len > best_len) {
+    best_base = cur_base;
+    best_len = cur_len;
+  }
+  // a single zero word is not compressed (RFC 5952 section 4.2.2)
+  if (best_len < 2) {
+    best_base = -1;
+  }
+
+  for (i = 0; i < 8; i++) {
+    if (best_base != -1 && i >= best_base && i < best_base + best_len) {
+      if (i == best_base) {
+        *(p++) = ':';
+      }
+      continue;
+    }
+    if (i != 0) {
+      *(p++) = ':';
+    }
+    // IPv4-compatible and IPv4-mapped addresses use mixed notation
+    if (i == 6 && best_base == 0 &&
+        (best_len == 6 || (best_len == 5 && words[5] == 0xFFFF))) {
+      p += parsebgp_format_ipv4(p, addr + 12);
+      return p - buf;
+    }
+    p = format_hex16(p, words[i]);
+  }
+  if (best_base != -1 && best_base + best_len == 8) {
+    *(p++) = ':';
+  }
+  *p = '\0';
+
+  return p - buf;
+}
+
+size_t parsebgp_format_ip(char *buf, int afi, const uint8_t *addr)
+{
+  switch (afi) {
+  case 1: // PARSEBGP_BGP_AFI_IPV4
+    return parsebgp_format_ipv4(buf, addr);
+
+  case 2: // PARSEBGP_BGP_AFI_IPV6
+    return parsebgp_format_ipv6(buf, addr);
+
+  default:
+    memcpy(buf, invalid_ip, sizeof(invalid_ip));
+    return sizeof(invalid_ip) - 1;
+  }
+}
+
+size_t parsebgp_format_pfx(char *buf, int afi, const uint8_t *addr,
+                           uint8_t len)
+{
+  size_t n = parsebgp_format_ip(buf, afi, addr);
+  buf[n++] = '/';
+  return n + parsebgp_format_uint32(buf + n, len);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_FORMAT_H
+#define __PARSEBGP_FORMAT_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/** Buffer size required to format any unsigned 64-bit integer (including the
+    terminating NUL) */
+#define PARSEBGP_FORMAT_UINT64_LEN 21
+
+/** Buffer size required to format an IPv4 address */
+#define PARSEBGP_FORMAT_IPV4_LEN 16
+
+/** Buffer size required to format any IP address (same as
+    INET6_ADDRSTRLEN) */
+#define PARSEBGP_FORMAT_IP_LEN 46
+
+/** Buffer size required to format any prefix */
+#define PARSEBGP_FORMAT_PFX_LEN 50
+
+/**
+ * Format an unsigned 32-bit integer in decimal
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_UINT64_LEN bytes)
+ * @param val           value to format
+ * @return the number of characters written (excluding the terminating NUL)
+ */
+size_t parsebgp_format_uint32(char *buf, uint32_t val);
+
+/**
+ * Format an unsigned 64-bit integer in decimal
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_UINT64_LEN bytes)
+ * @param val           value to format
+ * @return the number of characters written (excluding the terminating NUL)
+ */
+size_t parsebgp_format_uint64(char *buf, uint64_t val);
+
+/**
+ * Format an IPv4 address in dotted-quad notation
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_IPV4_LEN bytes)
+ * @param addr          pointer to the 4-byte address (network byte order)
+ * @return the number of characters written (excluding the terminating NUL)
+ */
+size_t parsebgp_format_ipv4(char *buf, const uint8_t *addr);
+
+/**
+ * Format an IPv6 address as recommended by RFC 5952
+ *
+ * The output is identical to that of inet_ntop, including the mixed notation
+ * used for IPv4-mapped and IPv4-compatible addresses.
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_IP_LEN bytes)
+ * @param addr          pointer to the 16-byte address (network byte order)
+ * @return the number of characters written (excluding the terminating NUL)
+ */
+size_t parsebgp_format_ipv6(char *buf, const uint8_t *addr);
+
+/**
+ * Format an IPv4 or IPv6 address
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_IP_LEN bytes)
+ * @param afi           address family (parsebgp_bgp_afi_t) of the address
+ * @param addr          pointer to the address (network byte order)
+ * @return the number of characters written (excluding the terminating NUL).
+ * "[invalid IP]" is written if the AFI is not IPv4 or IPv6.
+ */
+size_t parsebgp_format_ip(char *buf, int afi, const uint8_t *addr);
+
+/**
+ * Format an IPv4 or IPv6 prefix as address/length
+ *
+ * @param buf           buffer to write into (at least
+ *                      PARSEBGP_FORMAT_PFX_LEN bytes)
+ * @param afi           address family (parsebgp_bgp_afi_t) of the prefix
+ * @param addr          pointer to the prefix address (network byte order)
+ * @param len           prefix length
+ * @return the number of characters written (excluding the terminating NUL)
+ */
+size_t parsebgp_format_pfx(char *buf, int afi, const uint8_t *addr,
+                           uint8_t len);
+
+#endif /* __PARSEBGP_FORMAT_H */
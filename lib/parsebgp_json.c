@@ -0,0 +1,938 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_json.h"
+#include "parsebgp_format.h"
+#include "parsebgp_utils.h"
+#include <string.h>
+
+/** Append a string literal (typically a pre-formatted key) to the output */
+#define PUT_LIT(o, lit) put_bytes((o), (lit), sizeof(lit) - 1)
+
+/** Check whether the given path attribute is present */
+#define HAS_ATTR(attrs, attr_type) ((attrs)->attrs[(attr_type)].type == (attr_type))
+
+/** Output state for a single call to parsebgp_msg_to_json */
+typedef struct json_out {
+
+  /** Next byte to write */
+  char *p;
+
+  /** End of the output buffer */
+  char *end;
+
+  /** Set once a write did not fit (all further writes are ignored) */
+  int full;
+
+} json_out_t;
+
+/** Get a pointer to at least len free bytes in the output buffer (the caller
+    must advance o->p), or NULL if the buffer is full */
+static inline char *out_reserve(json_out_t *o, size_t len)
+{
+  if (o->full || (size_t)(o->end - o->p) < len) {
+    o->full = 1;
+    return NULL;
+  }
+  return o->p;
+}
+
+static inline void put_bytes(json_out_t *o, const char *data, size_t len)
+{
+  if (out_reserve(o, len) != NULL) {
+    memcpy(o->p, data, len);
+    o->p += len;
+  }
+}
+
+static inline void put_char(json_out_t *o, char c)
+{
+  if (out_reserve(o, 1) != NULL) {
+    *(o->p++) = c;
+  }
+}
+
+static inline void put_uint32(json_out_t *o, uint32_t val)
+{
+  if (out_reserve(o, PARSEBGP_FORMAT_UINT64_LEN) != NULL) {
+    o->p += parsebgp_format_uint32(o->p, val);
+  }
+}
+
+static inline void put_uint64(json_out_t *o, uint64_t val)
+{
+  if (out_reserve(o, PARSEBGP_FORMAT_UINT64_LEN) != NULL) {
+    o->p += parsebgp_format_uint64(o->p, val);
+  }
+}
+
+/** Append a quoted IP address */
+static inline void put_ip(json_out_t *o, int afi, const uint8_t *addr)
+{
+  char *p;
+
+  if ((p = out_reserve(o, PARSEBGP_FORMAT_IP_LEN + 2)) != NULL) {
+    *(p++) = '"';
+    p += parsebgp_format_ip(p, afi, addr);
+    *(p++) = '"';
+    o->p = p;
+  }
+}
+
+/** Append a quoted IPv4 address */
+static inline void put_ipv4(json_out_t *o, const uint8_t *addr)
+{
+  char *p;
+
+  if ((p = out_reserve(o, PARSEBGP_FORMAT_IPV4_LEN + 2)) != NULL) {
+    *(p++) = '"';
+    p += parsebgp_format_ipv4(p, addr);
+    *(p++) = '"';
+    o->p = p;
+  }
+}
+
+/** Append a quoted prefix */
+static inline void put_pfx(json_out_t *o, int afi, const uint8_t *addr,
+                           uint8_t len)
+{
+  char *p;
+
+  if ((p = out_reserve(o, PARSEBGP_FORMAT_PFX_LEN + 2)) != NULL) {
+    *(p++) = '"';
+    p += parsebgp_format_pfx(p, afi, addr, len);
+    *(p++) = '"';
+    o->p = p;
+  }
+}
+
+/** Append a quoted, escaped string. Bytes outside of printable ASCII are
+    escaped individually, so the output is valid JSON regardless of the
+    encoding of the source data */
+static void put_str(json_out_t *o, const uint8_t *str, size_t len)
+{
+  static const char hex[] = "0123456789abcdef";
+  char *p;
+  size_t i;
+  uint8_t c;
+
+  if ((p = out_reserve(o, len + 2)) == NULL) {
+    return;
+  }
+  *(p++) = '"';
+  for (i = 0; i < len; i++) {
+    c = str[i];
+    if (c >= 0x20 && c < 0x7F && c != '"' && c != '\\') {
+      *(p++) = c;
+      continue;
+    }
+    // an escape sequence takes up to 5 more bytes than the raw character
+    o->p = p;
+    if ((p = out_reserve(o, (len - i) + 6)) == NULL) {
+      return;
+    }
+    *(p++) = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+      *(p++) = c;
+      break;
+
+    case '\n':
+      *(p++) = 'n';
+      break;
+
+    case '\r':
+      *(p++) = 'r';
+      break;
+
+    case '\t':
+      *(p++) = 't';
+      break;
+
+    default:
+      memcpy(p, "u00", 3);
+      p += 3;
+      *(p++) = hex[c >> 4];
+      *(p++) = hex[c & 0xF];
+      break;
+    }
+  }
+  *(p++) = '"';
+  o->p = p;
+}
+
+/** Append the AS Path as an array of ASNs, with AS_SET and AS_CONFED_SET
+    segments as nested arrays */
+static void put_as_path(json_out_t *o, const parsebgp_bgp_update_as_path_t *ap)
+{
+  const parsebgp_bgp_update_as_path_seg_t *seg;
+  int first = 1, is_set, i, j;
+
+  put_char(o, '[');
+  for (i = 0; i < ap->segs_cnt; i++) {
+    seg = &ap->segs[i];
+    is_set = seg->type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SET ||
+             seg->type == PARSEBGP_BGP_UPDATE_AS_PATH_SEG_CONFED_SET;
+    if (is_set) {
+      if (!first) {
+        put_char(o, ',');
+      }
+      put_char(o, '[');
+      first = 1;
+    }
+    for (j = 0; j < seg->asns_cnt; j++) {
+      if (!first) {
+        put_char(o, ',');
+      }
+      put_uint32(o, seg->asns[j]);
+      first = 0;
+    }
+    if (is_set) {
+      put_char(o, ']');
+      first = 0;
+    }
+  }
+  put_char(o, ']');
+}
+
+static void put_attrs(json_out_t *o,
+                      const parsebgp_bgp_update_path_attrs_t *attrs, int afi)
+{
+  const parsebgp_bgp_update_communities_t *comms;
+  const parsebgp_bgp_update_large_communities_t *lcomms;
+  parsebgp_bgp_update_large_community_t lcomm;
+  const parsebgp_bgp_update_aggregator_t *agg;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach;
+  uint32_t comm;
+  int i;
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN)) {
+    switch (attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN].data.origin) {
+    case PARSEBGP_BGP_UPDATE_ORIGIN_IGP:
+      PUT_LIT(o, ",\"origin\":\"IGP\"");
+      break;
+
+    case PARSEBGP_BGP_UPDATE_ORIGIN_EGP:
+      PUT_LIT(o, ",\"origin\":\"EGP\"");
+      break;
+
+    default:
+      PUT_LIT(o, ",\"origin\":\"INCOMPLETE\"");
+      break;
+    }
+  }
+
+  if (attrs->as_path != NULL && attrs->as_path->summary_only) {
+    // the segments were not parsed, so only the summary can be written
+    PUT_LIT(o, ",\"as_path_len\":");
+    put_uint32(o, attrs->as_path->asns_cnt);
+    PUT_LIT(o, ",\"first_asn\":");
+    put_uint32(o, attrs->as_path->first_asn);
+    PUT_LIT(o, ",\"origin_asn\":");
+    put_uint32(o, attrs->as_path->origin_asn);
+    if (attrs->as_path->has_as_set) {
+      PUT_LIT(o, ",\"as_path_has_set\":true");
+    }
+  } else if (attrs->as_path != NULL) {
+    PUT_LIT(o, ",\"as_path\":");
+    put_as_path(o, attrs->as_path);
+  }
+
+  // the IPv4 NEXT_HOP applies to IPv4 prefixes, MP_REACH to the others
+  mp_reach = HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)
+               ? attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI]
+                   .data.mp_reach
+               : NULL;
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP) &&
+      (afi == PARSEBGP_BGP_AFI_IPV4 || mp_reach == NULL)) {
+    PUT_LIT(o, ",\"next_hop\":");
+    put_ipv4(o, attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP]
+                  .data.next_hop);
+  } else if (mp_reach != NULL) {
+    PUT_LIT(o, ",\"next_hop\":");
+    put_ip(o, mp_reach->afi, mp_reach->next_hop);
+  }
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF)) {
+    PUT_LIT(o, ",\"local_pref\":");
+    put_uint32(
+      o, attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LOCAL_PREF].data.local_pref);
+  }
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MED)) {
+    PUT_LIT(o, ",\"med\":");
+    put_uint32(o, attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MED].data.med);
+  }
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES)) {
+    comms =
+      attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES].data.communities;
+    PUT_LIT(o, ",\"communities\":[");
+    for (i = 0; i < comms->communities_cnt; i++) {
+      if (i != 0) {
+        put_char(o, ',');
+      }
+      put_char(o, '"');
+      comm = parsebgp_bgp_update_community_get(comms, i);
+      put_uint32(o, comm >> 16);
+      put_char(o, ':');
+      put_uint32(o, comm & 0xFFFF);
+      put_char(o, '"');
+    }
+    put_char(o, ']');
+  }
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES)) {
+    lcomms = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_LARGE_COMMUNITIES]
+               .data.large_communities;
+    PUT_LIT(o, ",\"large_communities\":[");
+    for (i = 0; i < lcomms->communities_cnt; i++) {
+      if (i != 0) {
+        put_char(o, ',');
+      }
+      put_char(o, '"');
+      parsebgp_bgp_update_large_community_get(lcomms, i, &lcomm);
+      put_uint32(o, lcomm.global_admin);
+      put_char(o, ':');
+      put_uint32(o, lcomm.local_1);
+      put_char(o, ':');
+      put_uint32(o, lcomm.local_2);
+      put_char(o, '"');
+    }
+    put_char(o, ']');
+  }
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_ATOMIC_AGGREGATE)) {
+    PUT_LIT(o, ",\"atomic_aggregate\":true");
+  }
+
+  // prefer AS4_AGGREGATOR if AGGREGATOR has AS_TRANS
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR)) {
+    agg = &attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AGGREGATOR].data.aggregator;
+    if (agg->asn == PARSEBGP_BGP_AS_TRANS &&
+        HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR)) {
+      agg = &attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS4_AGGREGATOR]
+               .data.aggregator;
+    }
+    PUT_LIT(o, ",\"aggregator\":{\"asn\":");
+    put_uint32(o, agg->asn);
+    PUT_LIT(o, ",\"ip\":");
+    put_ipv4(o, agg->addr);
+    put_char(o, '}');
+  }
+}
+
+static void put_peer(json_out_t *o, int afi, const uint8_t *ip, uint32_t asn)
+{
+  PUT_LIT(o, ",\"peer_ip\":");
+  put_ip(o, afi, ip);
+  PUT_LIT(o, ",\"peer_asn\":");
+  put_uint32(o, asn);
+}
+
+/* -------------------- BGP -------------------- */
+
+static uint32_t update_routes_cnt(const parsebgp_bgp_msg_t *bgp)
+{
+  const parsebgp_bgp_update_t *update;
+  const parsebgp_bgp_update_path_attrs_t *attrs;
+  uint32_t cnt;
+
+  if (bgp == NULL || bgp->type != PARSEBGP_BGP_TYPE_UPDATE ||
+      (update = bgp->types.update) == NULL) {
+    return 0;
+  }
+  attrs = &update->path_attrs;
+
+  cnt = update->withdrawn_nlris.prefixes_cnt +
+        update->announced_nlris.prefixes_cnt;
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI)) {
+    cnt += attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+             .data.mp_unreach->withdrawn_nlris_cnt;
+  }
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)) {
+    cnt += attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI]
+             .data.mp_reach->nlris_cnt;
+  }
+  return cnt;
+}
+
+static void put_route(json_out_t *o, const parsebgp_bgp_prefix_t *pfx,
+                      const parsebgp_bgp_update_path_attrs_t *attrs)
+{
+  if (attrs != NULL) {
+    PUT_LIT(o, ",\"action\":\"announce\",\"prefix\":");
+  } else {
+    PUT_LIT(o, ",\"action\":\"withdraw\",\"prefix\":");
+  }
+  put_pfx(o, pfx->afi, pfx->addr, pfx->len);
+  if (attrs != NULL) {
+    put_attrs(o, attrs, pfx->afi);
+  }
+}
+
+/** Write the idx'th route of an UPDATE (withdrawals first, then
+    announcements) */
+static void put_update(json_out_t *o, const parsebgp_bgp_update_t *update,
+                       uint32_t idx)
+{
+  const parsebgp_bgp_update_path_attrs_t *attrs = &update->path_attrs;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach;
+  const parsebgp_bgp_update_mp_unreach_t *mp_unreach;
+  uint32_t cnt;
+
+  cnt = update->withdrawn_nlris.prefixes_cnt;
+  if (idx < cnt) {
+    put_route(o, &update->withdrawn_nlris.prefixes[idx], NULL);
+    return;
+  }
+  idx -= cnt;
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI)) {
+    mp_unreach = attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+                   .data.mp_unreach;
+    if (idx < (uint32_t)mp_unreach->withdrawn_nlris_cnt) {
+      put_route(o, &mp_unreach->withdrawn_nlris[idx], NULL);
+      return;
+    }
+    idx -= mp_unreach->withdrawn_nlris_cnt;
+  }
+
+  cnt = update->announced_nlris.prefixes_cnt;
+  if (idx < cnt) {
+    put_route(o, &update->announced_nlris.prefixes[idx], attrs);
+    return;
+  }
+  idx -= cnt;
+
+  if (HAS_ATTR(attrs, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI)) {
+    mp_reach =
+      attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].data.mp_reach;
+    if (idx < (uint32_t)mp_reach->nlris_cnt) {
+      put_route(o, &mp_reach->nlris[idx], attrs);
+    }
+  }
+}
+
+/** Write the fields of a BGP message (idx is the index of the route to write
+    for UPDATE messages that carry routes) */
+static void put_bgp(json_out_t *o, const parsebgp_bgp_msg_t *bgp, uint32_t idx)
+{
+  const parsebgp_bgp_open_t *open;
+  const parsebgp_bgp_notification_t *notif;
+
+  PUT_LIT(o, ",\"bgp_type\":");
+  put_uint32(o, bgp->type);
+
+  switch (bgp->type) {
+  case PARSEBGP_BGP_TYPE_OPEN:
+    if ((open = bgp->types.open) == NULL) {
+      break;
+    }
+    PUT_LIT(o, ",\"version\":");
+    put_uint32(o, open->version);
+    PUT_LIT(o, ",\"asn\":");
+    put_uint32(o, open->asn);
+    PUT_LIT(o, ",\"hold_time\":");
+    put_uint32(o, open->hold_time);
+    PUT_LIT(o, ",\"bgp_id\":");
+    put_ipv4(o, open->bgp_id);
+    break;
+
+  case PARSEBGP_BGP_TYPE_UPDATE:
+    if (update_routes_cnt(bgp) != 0) {
+      put_update(o, bgp->types.update, idx);
+    }
+    break;
+
+  case PARSEBGP_BGP_TYPE_NOTIFICATION:
+    if ((notif = bgp->types.notification) == NULL) {
+      break;
+    }
+    PUT_LIT(o, ",\"code\":");
+    put_uint32(o, notif->code);
+    PUT_LIT(o, ",\"subcode\":");
+    put_uint32(o, notif->subcode);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/* -------------------- MRT -------------------- */
+
+/** Get the BGP message carried by a BGP4MP message (if any) */
+static const parsebgp_bgp_msg_t *mrt_bgp_msg(const parsebgp_mrt_msg_t *mrt)
+{
+  if ((mrt->type != PARSEBGP_MRT_TYPE_BGP4MP &&
+       mrt->type != PARSEBGP_MRT_TYPE_BGP4MP_ET) ||
+      mrt->types.bgp4mp == NULL) {
+    return NULL;
+  }
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_BGP4MP_MESSAGE:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_LOCAL:
+  case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4_LOCAL:
+    return mrt->types.bgp4mp->data.bgp_msg;
+
+  default:
+    return NULL;
+  }
+}
+
+/** Get the number of RIB entries in a TABLE_DUMP_V2 message */
+static uint32_t mrt_rib_entries_cnt(const parsebgp_mrt_msg_t *mrt)
+{
+  if (mrt->type != PARSEBGP_MRT_TYPE_TABLE_DUMP_V2 ||
+      mrt->types.table_dump_v2 == NULL) {
+    return 0;
+  }
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_MULTICAST:
+    return mrt->types.table_dump_v2->afi_safi_rib.entry_count;
+
+  default:
+    return 0;
+  }
+}
+
+static void put_table_dump(json_out_t *o, const parsebgp_mrt_msg_t *mrt)
+{
+  const parsebgp_mrt_table_dump_t *td = mrt->types.table_dump;
+  int afi = mrt->subtype; // subtype is the AFI
+
+  put_peer(o, afi, td->peer_ip, td->peer_asn);
+  PUT_LIT(o, ",\"action\":\"rib\",\"prefix\":");
+  put_pfx(o, afi, td->prefix, td->prefix_len);
+  PUT_LIT(o, ",\"originated\":");
+  put_uint32(o, td->originated_time);
+  put_attrs(o, &td->path_attrs, afi);
+}
+
+static void put_peer_index(json_out_t *o,
+                           const parsebgp_mrt_table_dump_v2_peer_index_t *pi)
+{
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *pe;
+  int i;
+
+  PUT_LIT(o, ",\"collector_bgp_id\":");
+  put_ipv4(o, pi->collector_bgp_id);
+  PUT_LIT(o, ",\"view_name\":");
+  put_str(o, (const uint8_t *)pi->view_name,
+          pi->view_name != NULL ? pi->view_name_len : 0);
+  PUT_LIT(o, ",\"peers\":[");
+  for (i = 0; i < pi->peer_count; i++) {
+    pe = &pi->peer_entries[i];
+    if (i != 0) {
+      put_char(o, ',');
+    }
+    PUT_LIT(o, "{\"bgp_id\":");
+    put_ipv4(o, pe->bgp_id);
+    PUT_LIT(o, ",\"ip\":");
+    put_ip(o, pe->ip_afi, pe->ip);
+    PUT_LIT(o, ",\"asn\":");
+    put_uint32(o, pe->asn);
+    put_char(o, '}');
+  }
+  put_char(o, ']');
+}
+
+static void put_table_dump_v2(json_out_t *o, const parsebgp_mrt_msg_t *mrt,
+                              uint32_t idx)
+{
+  const parsebgp_mrt_table_dump_v2_t *td = mrt->types.table_dump_v2;
+  const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *rib = &td->afi_safi_rib;
+  const parsebgp_mrt_table_dump_v2_rib_entry_t *entry;
+  int afi;
+
+  if (mrt->subtype == PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE) {
+    put_peer_index(o, &td->peer_index);
+    return;
+  }
+  if (idx >= mrt_rib_entries_cnt(mrt)) {
+    // generic or empty RIB
+    return;
+  }
+  afi = mrt->subtype <= PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_MULTICAST
+          ? PARSEBGP_BGP_AFI_IPV4
+          : PARSEBGP_BGP_AFI_IPV6;
+  entry = &rib->entries[idx];
+
+  PUT_LIT(o, ",\"sequence\":");
+  put_uint32(o, rib->sequence);
+  PUT_LIT(o, ",\"peer_index\":");
+  put_uint32(o, entry->peer_index);
+  if (entry->peer != NULL) {
+    put_peer(o, entry->peer->ip_afi, entry->peer->ip, entry->peer->asn);
+  }
+  PUT_LIT(o, ",\"action\":\"rib\",\"prefix\":");
+  put_pfx(o, afi, rib->prefix, rib->prefix_len);
+  PUT_LIT(o, ",\"originated\":");
+  put_uint32(o, entry->originated_time);
+  put_attrs(o,
+            entry->path_attrs_ptr != NULL ? entry->path_attrs_ptr
+                                          : &entry->path_attrs,
+            afi);
+}
+
+static void put_bgp4mp(json_out_t *o, const parsebgp_mrt_msg_t *mrt,
+                       uint32_t idx)
+{
+  const parsebgp_mrt_bgp4mp_t *b = mrt->types.bgp4mp;
+  const parsebgp_bgp_msg_t *bgp;
+
+  put_peer(o, b->afi, b->peer_ip, b->peer_asn);
+  PUT_LIT(o, ",\"local_ip\":");
+  put_ip(o, b->afi, b->local_ip);
+  PUT_LIT(o, ",\"local_asn\":");
+  put_uint32(o, b->local_asn);
+
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
+  case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
+    PUT_LIT(o, ",\"old_state\":");
+    put_uint32(o, b->data.state_change.old_state);
+    PUT_LIT(o, ",\"new_state\":");
+    put_uint32(o, b->data.state_change.new_state);
+    break;
+
+  default:
+    if ((bgp = mrt_bgp_msg(mrt)) != NULL) {
+      put_bgp(o, bgp, idx);
+    }
+    break;
+  }
+}
+
+static void put_mrt(json_out_t *o, const parsebgp_mrt_msg_t *mrt,
+                    uint32_t idx)
+{
+  PUT_LIT(o, "{\"source\":\"mrt\",\"timestamp\":");
+  put_uint32(o, mrt->timestamp_sec);
+  if (mrt->type == PARSEBGP_MRT_TYPE_BGP4MP_ET) {
+    PUT_LIT(o, ",\"timestamp_usec\":");
+    put_uint32(o, mrt->timestamp_usec);
+  }
+  PUT_LIT(o, ",\"mrt_type\":");
+  put_uint32(o, mrt->type);
+  PUT_LIT(o, ",\"mrt_subtype\":");
+  put_uint32(o, mrt->subtype);
+
+  switch (mrt->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP:
+    if (mrt->types.table_dump != NULL) {
+      put_table_dump(o, mrt);
+    }
+    break;
+
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    if (mrt->types.table_dump_v2 != NULL) {
+      put_table_dump_v2(o, mrt, idx);
+    }
+    break;
+
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    if (mrt->types.bgp4mp != NULL) {
+      put_bgp4mp(o, mrt, idx);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/* -------------------- BMP -------------------- */
+
+static void put_info_tlvs(json_out_t *o, const parsebgp_bmp_info_tlv_t *tlvs,
+                          int tlvs_cnt)
+{
+  int i;
+
+  PUT_LIT(o, ",\"info\":[");
+  for (i = 0; i < tlvs_cnt; i++) {
+    if (i != 0) {
+      put_char(o, ',');
+    }
+    PUT_LIT(o, "{\"type\":");
+    put_uint32(o, tlvs[i].type);
+    PUT_LIT(o, ",\"value\":");
+    put_str(o, tlvs[i].info, tlvs[i].info != NULL ? tlvs[i].len : 0);
+    put_char(o, '}');
+  }
+  put_char(o, ']');
+}
+
+static void put_stats_report(json_out_t *o,
+                             const parsebgp_bmp_stats_report_t *stats)
+{
+  const parsebgp_bmp_stats_counter_t *sc;
+  uint32_t i;
+
+  PUT_LIT(o, ",\"stats\":[");
+  for (i = 0; i < stats->stats_count; i++) {
+    sc = &stats->counters[i];
+    if (i != 0) {
+      put_char(o, ',');
+    }
+    PUT_LIT(o, "{\"type\":");
+    put_uint32(o, sc->type);
+    switch (sc->type) {
+    case PARSEBGP_BMP_STATS_ROUTES_ADJ_RIB_IN:
+    case PARSEBGP_BMP_STATS_ROUTES_LOC_RIB:
+      PUT_LIT(o, ",\"value\":");
+      put_uint64(o, sc->data.gauge_u64);
+      break;
+
+    case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_ADJ_RIB_IN:
+    case PARSEBGP_BMP_STATS_ROUTES_PER_AFI_SAFI_LOC_RIB:
+      PUT_LIT(o, ",\"afi\":");
+      put_uint32(o, sc->data.afi_safi_gauge.afi);
+      PUT_LIT(o, ",\"safi\":");
+      put_uint32(o, sc->data.afi_safi_gauge.safi);
+      PUT_LIT(o, ",\"value\":");
+      put_uint64(o, sc->data.afi_safi_gauge.gauge_u64);
+      break;
+
+    default:
+      // unknown types are stored according to their length
+      PUT_LIT(o, ",\"value\":");
+      if (sc->len == sizeof(sc->data.gauge_u64)) {
+        put_uint64(o, sc->data.gauge_u64);
+      } else {
+        put_uint32(o, sc->data.counter_u32);
+      }
+      break;
+    }
+    put_char(o, '}');
+  }
+  put_char(o, ']');
+}
+
+static void put_term_msg(json_out_t *o, const parsebgp_bmp_term_msg_t *term)
+{
+  const parsebgp_bmp_term_tlv_t *tlv;
+  int i;
+
+  PUT_LIT(o, ",\"info\":[");
+  for (i = 0; i < term->tlvs_cnt; i++) {
+    tlv = &term->tlvs[i];
+    if (i != 0) {
+      put_char(o, ',');
+    }
+    PUT_LIT(o, "{\"type\":");
+    put_uint32(o, tlv->type);
+    PUT_LIT(o, ",\"value\":");
+    if (tlv->type == PARSEBGP_BMP_TERM_INFO_TYPE_REASON) {
+      put_uint32(o, tlv->info.reason);
+    } else if (tlv->info.string != NULL) {
+      put_str(o, (const uint8_t *)tlv->info.string, strlen(tlv->info.string));
+    } else {
+      PUT_LIT(o, "\"\"");
+    }
+    put_char(o, '}');
+  }
+  put_char(o, ']');
+}
+
+static void put_bmp(json_out_t *o, const parsebgp_bmp_msg_t *bmp, uint32_t idx)
+{
+  const parsebgp_bmp_peer_hdr_t *hdr = &bmp->peer_hdr;
+  const parsebgp_bmp_peer_up_t *up;
+
+  PUT_LIT(o, "{\"source\":\"bmp\",\"bmp_type\":");
+  put_uint32(o, bmp->type);
+
+  if (bmp->type != PARSEBGP_BMP_TYPE_INIT_MSG &&
+      bmp->type != PARSEBGP_BMP_TYPE_TERM_MSG) {
+    PUT_LIT(o, ",\"timestamp\":");
+    put_uint32(o, hdr->ts_sec);
+    PUT_LIT(o, ",\"timestamp_usec\":");
+    put_uint32(o, hdr->ts_usec);
+    put_peer(o, hdr->afi, hdr->addr, hdr->asn);
+    PUT_LIT(o, ",\"peer_bgp_id\":");
+    put_ipv4(o, hdr->bgp_id);
+    PUT_LIT(o, ",\"peer_type\":");
+    put_uint32(o, hdr->type);
+    PUT_LIT(o, ",\"peer_flags\":");
+    put_uint32(o, hdr->flags);
+  }
+
+  if (!bmp->types_valid) {
+    return;
+  }
+
+  switch (bmp->type) {
+  case PARSEBGP_BMP_TYPE_ROUTE_MON:
+    if (bmp->types.route_mon != NULL) {
+      put_bgp(o, bmp->types.route_mon, idx);
+    }
+    break;
+
+  case PARSEBGP_BMP_TYPE_STATS_REPORT:
+    if (bmp->types.stats_report != NULL) {
+      put_stats_report(o, bmp->types.stats_report);
+    }
+    break;
+
+  case PARSEBGP_BMP_TYPE_PEER_DOWN:
+    if (bmp->types.peer_down != NULL) {
+      PUT_LIT(o, ",\"reason\":");
+      put_uint32(o, bmp->types.peer_down->reason);
+    }
+    break;
+
+  case PARSEBGP_BMP_TYPE_PEER_UP:
+    if ((up = bmp->types.peer_up) == NULL) {
+      break;
+    }
+    PUT_LIT(o, ",\"local_ip\":");
+    put_ip(o, up->local_ip_afi, up->local_ip);
+    PUT_LIT(o, ",\"local_port\":");
+    put_uint32(o, up->local_port);
+    PUT_LIT(o, ",\"remote_port\":");
+    put_uint32(o, up->remote_port);
+    if (up->tlvs_cnt != 0) {
+      put_info_tlvs(o, up->tlvs, up->tlvs_cnt);
+    }
+    break;
+
+  case PARSEBGP_BMP_TYPE_INIT_MSG:
+    if (bmp->types.init_msg != NULL) {
+      put_info_tlvs(o, bmp->types.init_msg->tlvs,
+                    bmp->types.init_msg->tlvs_cnt);
+    }
+    break;
+
+  case PARSEBGP_BMP_TYPE_TERM_MSG:
+    if (bmp->types.term_msg != NULL) {
+      put_term_msg(o, bmp->types.term_msg);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/* -------------------- Messages -------------------- */
+
+/** Get the number of lines (one per route, or one for the message) that the
+    message is serialized as */
+static uint32_t msg_lines_cnt(const parsebgp_msg_t *msg)
+{
+  uint32_t cnt = 0;
+
+  switch (msg->type) {
+  case PARSEBGP_MSG_TYPE_BGP:
+    cnt = update_routes_cnt(msg->types.bgp);
+    break;
+
+  case PARSEBGP_MSG_TYPE_BMP:
+    if (msg->types.bmp != NULL && msg->types.bmp->types_valid &&
+        msg->types.bmp->type == PARSEBGP_BMP_TYPE_ROUTE_MON) {
+      cnt = update_routes_cnt(msg->types.bmp->types.route_mon);
+    }
+    break;
+
+  case PARSEBGP_MSG_TYPE_MRT:
+    if (msg->types.mrt != NULL) {
+      cnt = mrt_rib_entries_cnt(msg->types.mrt) +
+            update_routes_cnt(mrt_bgp_msg(msg->types.mrt));
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return cnt == 0 ? 1 : cnt;
+}
+
+static void put_line(json_out_t *o, const parsebgp_msg_t *msg, uint32_t idx)
+{
+  switch (msg->type) {
+  case PARSEBGP_MSG_TYPE_BGP:
+    PUT_LIT(o, "{\"source\":\"bgp\"");
+    if (msg->types.bgp != NULL) {
+      put_bgp(o, msg->types.bgp, idx);
+    }
+    break;
+
+  case PARSEBGP_MSG_TYPE_BMP:
+    if (msg->types.bmp != NULL) {
+      put_bmp(o, msg->types.bmp, idx);
+    } else {
+      PUT_LIT(o, "{\"source\":\"bmp\"");
+    }
+    break;
+
+  case PARSEBGP_MSG_TYPE_MRT:
+    if (msg->types.mrt != NULL) {
+      put_mrt(o, msg->types.mrt, idx);
+    } else {
+      PUT_LIT(o, "{\"source\":\"mrt\"");
+    }
+    break;
+
+  default:
+    PUT_LIT(o, "{\"source\":null");
+    break;
+  }
+  PUT_LIT(o, "}\n");
+}
+
+parsebgp_error_t parsebgp_msg_to_json(const parsebgp_msg_t *msg, char *buf,
+                                      size_t cap, size_t *lenp,
+                                      parsebgp_json_cursor_t *cursor)
+{
+  json_out_t o = {buf, buf + cap, 0};
+  uint32_t lines_cnt = msg_lines_cnt(msg);
+  char *line_start;
+
+  while (cursor->line < lines_cnt) {
+    line_start = o.p;
+    put_line(&o, msg, cursor->line);
+    if (o.full) {
+      // roll back the partial line, it will be rewritten by the next call
+      *lenp = line_start - buf;
+      return PARSEBGP_PARTIAL_MSG;
+    }
+    cursor->line++;
+  }
+
+  *lenp = o.p - buf;
+  cursor->line = 0;
+  return PARSEBGP_OK;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_JSON_H
+#define __PARSEBGP_JSON_H
+
+#include "parsebgp.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * JSON Serialization Cursor
+ *
+ * Records how much of a message has been serialized so that
+ * parsebgp_msg_to_json can resume after filling the output buffer. Must be
+ * zeroed before serializing a message; it is reset to zero once the message
+ * has been completely written.
+ */
+typedef struct parsebgp_json_cursor {
+
+  /** Index of the next line to write (INTERNAL) */
+  uint32_t line;
+
+} parsebgp_json_cursor_t;
+
+/**
+ * Serialize a decoded message as NDJSON
+ *
+ * One JSON object (terminated by a newline) is written for each route carried
+ * by the message (UPDATE announcements and withdrawals, TABLE_DUMP and
+ * TABLE_DUMP_V2 RIB entries), or a single object if the message carries no
+ * routes. Each object includes the fields of the enclosing MRT or BMP layer
+ * (e.g., timestamp and peer), so it can be consumed on its own.
+ *
+ * Objects are never split: if the next object does not fit in the remaining
+ * space, PARSEBGP_PARTIAL_MSG is returned and the cursor records where to
+ * resume. The caller should consume the *lenp bytes written and call again
+ * with the same message and cursor. If nothing at all could be written, the
+ * buffer is too small to hold a single object.
+ *
+ * No memory is allocated.
+ *
+ * @param msg           pointer to the decoded message to serialize
+ * @param buf           buffer to write into
+ * @param cap           size of the buffer
+ * @param [out] lenp    set to the number of bytes written
+ * @param cursor        pointer to the cursor of the message (zeroed before
+ *                      the first call for a message)
+ * @return PARSEBGP_OK if the message has been completely written, or
+ * PARSEBGP_PARTIAL_MSG if the buffer is full and the call must be repeated
+ */
+parsebgp_error_t parsebgp_msg_to_json(const parsebgp_msg_t *msg, char *buf,
+                                      size_t cap, size_t *lenp,
+                                      parsebgp_json_cursor_t *cursor);
+
+#endif /* __PARSEBGP_JSON_H */
@@ -29,6 +29,9 @@
 
 #include "parsebgp_bgp_opts.h"
 #include "parsebgp_bmp_opts.h"
+#include "parsebgp_diag.h"
+#include "parsebgp_mrt_opts.h"
+#include "parsebgp_stats.h"
 
 /**
  * Parsing Options
@@ -41,7 +44,8 @@ typedef struct parsebgp_opts {
    * If this is set, the parser will attempt to skip portions of messages that
    * contain unimplemented features. It will emit a warning that includes the
    * file and line number to aid with requesting support be added (see
-   * silence_not_implemented to disable this warning).
+   * silence_not_implemented to disable this warning, and diag to redirect
+   * it).
    *
    * If this is **not** set, the parser will abort if it finds a feature that it
    * does not recognize.
@@ -65,7 +69,7 @@ typedef struct parsebgp_opts {
    * If this is set, the parser will attempt to skip portions of messages that
    * contain invalid features. It will emit a warning that includes the file and
    * line number to aid with debugging malformed data (see silence_invalid to
-   * disable this warning).
+   * disable this warning, and diag to redirect it).
    *
    * If this is **not** set, the parser will abort if it finds a feature that it
    * determines to be malformed.
@@ -89,6 +93,21 @@ typedef struct parsebgp_opts {
   /** BMP-specific parsing options */
   parsebgp_bmp_opts_t bmp;
 
+  /** MRT-specific parsing options */
+  parsebgp_mrt_opts_t mrt;
+
+  /** Diagnostics (warning and error reporting) options */
+  parsebgp_diag_opts_t diag;
+
+  /**
+   * Decode Statistics
+   *
+   * If set (and the library was configured with --enable-stats), decoding
+   * counters are accumulated into this (caller-owned) block. See
+   * parsebgp_stats_t for details. Defaults to NULL.
+   */
+  parsebgp_stats_t *stats;
+
 } parsebgp_opts_t;
 
 /**
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_pool.h"
+#include "parsebgp_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Initial number of idle message slots */
+#define IDLE_ALLOC_INIT 16
+
+/** An idle message */
+typedef struct pool_idle {
+
+  /** The (cleared) message */
+  parsebgp_msg_t *msg;
+
+  /** Memory retained by the message */
+  size_t bytes;
+
+} pool_idle_t;
+
+struct parsebgp_msg_pool {
+
+  /** Retention policy */
+  parsebgp_msg_pool_opts_t opts;
+
+  /** Stack of idle messages (most recently returned last) */
+  pool_idle_t *idle;
+
+  /** Number of idle messages */
+  uint32_t idle_cnt;
+
+  /** Allocated length of the idle array */
+  uint32_t _idle_alloc_cnt;
+
+  /** Statistics */
+  parsebgp_msg_pool_stats_t stats;
+
+};
+
+void parsebgp_msg_pool_opts_init(parsebgp_msg_pool_opts_t *opts)
+{
+  memset(opts, 0, sizeof(*opts));
+}
+
+parsebgp_msg_pool_t *parsebgp_msg_pool_create(
+  const parsebgp_msg_pool_opts_t *opts)
+{
+  parsebgp_msg_pool_t *pool;
+
+  if ((pool = malloc_zero(sizeof(*pool))) == NULL) {
+    return NULL;
+  }
+  if (opts != NULL) {
+    pool->opts = *opts;
+  } else {
+    parsebgp_msg_pool_opts_init(&pool->opts);
+  }
+
+  return pool;
+}
+
+void parsebgp_msg_pool_destroy(parsebgp_msg_pool_t *pool)
+{
+  if (pool == NULL) {
+    return;
+  }
+  parsebgp_msg_pool_trim(pool);
+  free(pool->idle);
+  free(pool);
+}
+
+parsebgp_msg_t *parsebgp_msg_pool_get(parsebgp_msg_pool_t *pool)
+{
+  parsebgp_msg_t *msg;
+  pool_idle_t *idle;
+
+  if (pool->idle_cnt > 0) {
+    // reuse the most recently returned message (its memory is most likely to
+    // still be in cache)
+    idle = &pool->idle[--pool->idle_cnt];
+    msg = idle->msg;
+    pool->stats.idle_bytes -= idle->bytes;
+  } else {
+    if ((msg = parsebgp_create_msg()) == NULL) {
+      return NULL;
+    }
+    pool->stats.created_cnt++;
+  }
+
+  msg->_pool_uses++;
+  pool->stats.in_use_cnt++;
+  return msg;
+}
+
+void parsebgp_msg_pool_put(parsebgp_msg_pool_t *pool, parsebgp_msg_t *msg)
+{
+  const parsebgp_msg_pool_opts_t *opts = &pool->opts;
+  pool_idle_t *idle;
+  size_t bytes;
+  uint32_t new_alloc;
+
+  if (msg == NULL) {
+    return;
+  }
+  pool->stats.in_use_cnt--;
+
+  parsebgp_clear_msg(msg);
+  bytes = parsebgp_msg_memory_usage(msg);
+
+  if ((opts->msg_max_uses != 0 && msg->_pool_uses >= opts->msg_max_uses) ||
+      (opts->msg_max_bytes != 0 && bytes > opts->msg_max_bytes) ||
+      (opts->idle_max_cnt != 0 && pool->idle_cnt >= opts->idle_max_cnt) ||
+      (opts->idle_max_bytes != 0 &&
+       pool->stats.idle_bytes + bytes > opts->idle_max_bytes)) {
+    goto evict;
+  }
+
+  if (pool->idle_cnt == pool->_idle_alloc_cnt) {
+    new_alloc = pool->_idle_alloc_cnt == 0 ? IDLE_ALLOC_INIT
+                                           : pool->_idle_alloc_cnt * 2;
+    if ((idle = realloc(pool->idle, sizeof(*idle) * new_alloc)) == NULL) {
+      // just drop the message rather than failing
+      goto evict;
+    }
+    pool->idle = idle;
+    pool->_idle_alloc_cnt = new_alloc;
+  }
+
+  idle = &pool->idle[pool->idle_cnt++];
+  idle->msg = msg;
+  idle->bytes = bytes;
+  pool->stats.idle_bytes += bytes;
+  return;
+
+evict:
+  parsebgp_destroy_msg(msg);
+  pool->stats.evicted_cnt++;
+}
+
+void parsebgp_msg_pool_trim(parsebgp_msg_pool_t *pool)
+{
+  uint32_t i;
+
+  for (i = 0; i < pool->idle_cnt; i++) {
+    parsebgp_destroy_msg(pool->idle[i].msg);
+  }
+  pool->idle_cnt = 0;
+  pool->stats.idle_bytes = 0;
+}
+
+void parsebgp_msg_pool_get_stats(const parsebgp_msg_pool_t *pool,
+                                 parsebgp_msg_pool_stats_t *stats)
+{
+  *stats = pool->stats;
+  stats->idle_cnt = pool->idle_cnt;
+}
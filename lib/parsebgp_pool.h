@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_POOL_H
+#define __PARSEBGP_POOL_H
+
+#include "parsebgp.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Message Pool Retention Policy
+ *
+ * Message structures keep the memory allocated while decoding (e.g., the
+ * prefix and AS path arrays) when they are cleared, so that the next message
+ * can reuse it. A single unusually large message therefore inflates the
+ * structure it was decoded into for as long as that structure lives. The
+ * policy bounds how much of this memory a pool keeps: messages that break a
+ * limit when they are returned to the pool are destroyed (and later replaced
+ * by fresh ones) rather than kept for reuse.
+ *
+ * A value of zero disables the corresponding limit.
+ */
+typedef struct parsebgp_msg_pool_opts {
+
+  /** Maximum number of bytes (see parsebgp_msg_memory_usage) that a single
+      idle message may retain */
+  size_t msg_max_bytes;
+
+  /** Maximum number of times a message is handed out before it is replaced
+      (bounds how long a high-water allocation can be kept) */
+  uint32_t msg_max_uses;
+
+  /** Maximum total number of bytes retained by all idle messages */
+  size_t idle_max_bytes;
+
+  /** Maximum number of idle messages */
+  uint32_t idle_max_cnt;
+
+} parsebgp_msg_pool_opts_t;
+
+/**
+ * Message Pool Statistics
+ */
+typedef struct parsebgp_msg_pool_stats {
+
+  /** Number of messages currently handed out */
+  uint32_t in_use_cnt;
+
+  /** Number of idle messages held by the pool */
+  uint32_t idle_cnt;
+
+  /** Number of bytes retained by idle messages */
+  size_t idle_bytes;
+
+  /** Total number of messages created by the pool */
+  uint64_t created_cnt;
+
+  /** Total number of messages destroyed because of the retention policy */
+  uint64_t evicted_cnt;
+
+} parsebgp_msg_pool_stats_t;
+
+/**
+ * Pool of reusable message structures
+ *
+ * A pool is not thread-safe; use one pool per thread (or see
+ * parsebgp_msg_ring_t for handing messages between threads).
+ */
+typedef struct parsebgp_msg_pool parsebgp_msg_pool_t;
+
+/**
+ * Initialize pool options to default values (no limits)
+ *
+ * @param opts          pointer to an opts structure to initialize
+ */
+void parsebgp_msg_pool_opts_init(parsebgp_msg_pool_opts_t *opts);
+
+/**
+ * Create a message pool
+ *
+ * @param opts          Retention policy to use (NULL for the defaults)
+ * @return pointer to the pool, or NULL if memory allocation failed
+ */
+parsebgp_msg_pool_t *parsebgp_msg_pool_create(
+  const parsebgp_msg_pool_opts_t *opts);
+
+/**
+ * Destroy the given pool and all of its idle messages
+ *
+ * @param pool          Pointer to the pool
+ *
+ * Messages that are still handed out are not destroyed; they must be
+ * destroyed with parsebgp_destroy_msg.
+ */
+void parsebgp_msg_pool_destroy(parsebgp_msg_pool_t *pool);
+
+/**
+ * Get an empty message from the pool
+ *
+ * @param pool          Pointer to the pool
+ * @return pointer to an empty message, or NULL if memory allocation failed
+ */
+parsebgp_msg_t *parsebgp_msg_pool_get(parsebgp_msg_pool_t *pool);
+
+/**
+ * Clear a message and return it to the pool
+ *
+ * @param pool          Pointer to the pool
+ * @param msg           Pointer to a message obtained from parsebgp_msg_pool_get
+ *
+ * The message is destroyed instead if keeping it would break the retention
+ * policy.
+ */
+void parsebgp_msg_pool_put(parsebgp_msg_pool_t *pool, parsebgp_msg_t *msg);
+
+/**
+ * Destroy all idle messages held by the pool
+ *
+ * @param pool          Pointer to the pool
+ */
+void parsebgp_msg_pool_trim(parsebgp_msg_pool_t *pool);
+
+/**
+ * Get statistics about the given pool
+ *
+ * @param pool          Pointer to the pool
+ * @param [out] stats   Filled with the statistics
+ */
+void parsebgp_msg_pool_get_stats(const parsebgp_msg_pool_t *pool,
+                                 parsebgp_msg_pool_stats_t *stats);
+
+#endif /* __PARSEBGP_POOL_H */
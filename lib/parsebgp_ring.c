@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_ring.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Assumed size of a cache line */
+#define CACHE_LINE_LEN 64
+
+/** Atomic helpers (GCC/Clang builtins) */
+#define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELAXED(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CAS_RELAXED(p, expp, v)                                                \
+  __atomic_compare_exchange_n((p), (expp), (v), 1, __ATOMIC_RELAXED,           \
+                              __ATOMIC_RELAXED)
+
+/**
+ * Ring slot
+ *
+ * The sequence number of a slot says whose turn it is: it equals the push
+ * position when the slot is free for that push, and the push position + 1
+ * once the pointer has been written (and may be popped).
+ */
+typedef struct ring_slot {
+
+  /** Sequence number */
+  size_t seq;
+
+  /** Stored pointer */
+  void *ptr;
+
+} ring_slot_t;
+
+struct parsebgp_ring {
+
+  /** Array of slots */
+  ring_slot_t *slots;
+
+  /** Number of slots - 1 */
+  size_t mask;
+
+  /** Flags (parsebgp_ring_flags_t) */
+  int flags;
+
+  char _pad0[CACHE_LINE_LEN];
+
+  /** Next push position (written by producers) */
+  size_t head;
+
+  char _pad1[CACHE_LINE_LEN - sizeof(size_t)];
+
+  /** Next pop position (written by consumers) */
+  size_t tail;
+
+  char _pad2[CACHE_LINE_LEN - sizeof(size_t)];
+
+};
+
+struct parsebgp_msg_ring {
+
+  /** Empty messages (pushed by consumers, popped by producers) */
+  parsebgp_ring_t *empty;
+
+  /** Decoded messages (pushed by producers, popped by consumers) */
+  parsebgp_ring_t *full;
+
+  /** All messages owned by the ring */
+  parsebgp_msg_t **msgs;
+
+  /** Number of messages */
+  size_t msgs_cnt;
+
+};
+
+static size_t round_pow2(size_t size)
+{
+  size_t p = 1;
+  while (p < size) {
+    p <<= 1;
+  }
+  return p;
+}
+
+parsebgp_ring_t *parsebgp_ring_create(size_t size, int flags)
+{
+  parsebgp_ring_t *ring;
+  size_t i;
+
+  if ((ring = malloc_zero(sizeof(*ring))) == NULL) {
+    return NULL;
+  }
+  size = round_pow2(size);
+  if ((ring->slots = malloc(sizeof(*ring->slots) * size)) == NULL) {
+    free(ring);
+    return NULL;
+  }
+  for (i = 0; i < size; i++) {
+    ring->slots[i].seq = i;
+    ring->slots[i].ptr = NULL;
+  }
+  ring->mask = size - 1;
+  ring->flags = flags;
+
+  return ring;
+}
+
+void parsebgp_ring_destroy(parsebgp_ring_t *ring)
+{
+  if (ring == NULL) {
+    return;
+  }
+  free(ring->slots);
+  free(ring);
+}
+
+size_t parsebgp_ring_get_size(const parsebgp_ring_t *ring)
+{
+  return ring->mask + 1;
+}
+
+int parsebgp_ring_push(parsebgp_ring_t *ring, void *ptr)
+{
+  ring_slot_t *slot;
+  size_t pos = LOAD_RELAXED(&ring->head), seq;
+  intptr_t dif;
+
+  while (1) {
+    slot = &ring->slots[pos & ring->mask];
+    seq = LOAD_ACQUIRE(&slot->seq);
+    dif = (intptr_t)seq - (intptr_t)pos;
+    if (dif == 0) {
+      // the slot is free, try to claim it
+      if (ring->flags & PARSEBGP_RING_SINGLE_PRODUCER) {
+        STORE_RELAXED(&ring->head, pos + 1);
+        break;
+      }
+      if (CAS_RELAXED(&ring->head, &pos, pos + 1)) {
+        break;
+      }
+      // else: another producer claimed it, and pos has been reloaded
+    } else if (dif < 0) {
+      // the slot still holds a pointer from the previous lap
+      return -1;
+    } else {
+      // another producer got ahead of us
+      pos = LOAD_RELAXED(&ring->head);
+    }
+  }
+
+  slot->ptr = ptr;
+  STORE_RELEASE(&slot->seq, pos + 1);
+  return 0;
+}
+
+void *parsebgp_ring_pop(parsebgp_ring_t *ring)
+{
+  ring_slot_t *slot;
+  size_t pos = LOAD_RELAXED(&ring->tail), seq;
+  intptr_t dif;
+  void *ptr;
+
+  while (1) {
+    slot = &ring->slots[pos & ring->mask];
+    seq = LOAD_ACQUIRE(&slot->seq);
+    dif = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (dif == 0) {
+      // the slot holds a pointer, try to claim it
+      if (ring->flags & PARSEBGP_RING_SINGLE_CONSUMER) {
+        STORE_RELAXED(&ring->tail, pos + 1);
+        break;
+      }
+      if (CAS_RELAXED(&ring->tail, &pos, pos + 1)) {
+        break;
+      }
+    } else if (dif < 0) {
+      // nothing has been pushed to the slot yet
+      return NULL;
+    } else {
+      pos = LOAD_RELAXED(&ring->tail);
+    }
+  }
+
+  ptr = slot->ptr;
+  // free the slot for the push one lap ahead
+  STORE_RELEASE(&slot->seq, pos + ring->mask + 1);
+  return ptr;
+}
+
+parsebgp_msg_ring_t *parsebgp_msg_ring_create(size_t size, int flags)
+{
+  parsebgp_msg_ring_t *ring;
+  int empty_flags = 0;
+  size_t i;
+
+  if ((ring = malloc_zero(sizeof(*ring))) == NULL) {
+    return NULL;
+  }
+  size = round_pow2(size);
+
+  // messages flow the other way through the empty ring
+  if (flags & PARSEBGP_RING_SINGLE_PRODUCER) {
+    empty_flags |= PARSEBGP_RING_SINGLE_CONSUMER;
+  }
+  if (flags & PARSEBGP_RING_SINGLE_CONSUMER) {
+    empty_flags |= PARSEBGP_RING_SINGLE_PRODUCER;
+  }
+  if ((ring->empty = parsebgp_ring_create(size, empty_flags)) == NULL ||
+      (ring->full = parsebgp_ring_create(size, flags)) == NULL ||
+      (ring->msgs = malloc_zero(sizeof(*ring->msgs) * size)) == NULL) {
+    goto err;
+  }
+
+  for (i = 0; i < size; i++) {
+    if ((ring->msgs[i] = parsebgp_create_msg()) == NULL) {
+      goto err;
+    }
+    ring->msgs_cnt++;
+    parsebgp_ring_push(ring->empty, ring->msgs[i]);
+  }
+
+  return ring;
+
+err:
+  parsebgp_msg_ring_destroy(ring);
+  return NULL;
+}
+
+void parsebgp_msg_ring_destroy(parsebgp_msg_ring_t *ring)
+{
+  size_t i;
+
+  if (ring == NULL) {
+    return;
+  }
+  for (i = 0; i < ring->msgs_cnt; i++) {
+    parsebgp_destroy_msg(ring->msgs[i]);
+  }
+  free(ring->msgs);
+  parsebgp_ring_destroy(ring->empty);
+  parsebgp_ring_destroy(ring->full);
+  free(ring);
+}
+
+parsebgp_msg_t *parsebgp_msg_ring_acquire(parsebgp_msg_ring_t *ring)
+{
+  return parsebgp_ring_pop(ring->empty);
+}
+
+void parsebgp_msg_ring_publish(parsebgp_msg_ring_t *ring, parsebgp_msg_t *msg)
+{
+  int ret = parsebgp_ring_push(ring->full, msg);
+  // there are only as many messages as slots, so this cannot fail
+  assert(ret == 0);
+  (void)ret;
+}
+
+parsebgp_msg_t *parsebgp_msg_ring_consume(parsebgp_msg_ring_t *ring)
+{
+  return parsebgp_ring_pop(ring->full);
+}
+
+void parsebgp_msg_ring_release(parsebgp_msg_ring_t *ring, parsebgp_msg_t *msg)
+{
+  int ret;
+
+  parsebgp_clear_msg(msg);
+  ret = parsebgp_ring_push(ring->empty, msg);
+  assert(ret == 0);
+  (void)ret;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_RING_H
+#define __PARSEBGP_RING_H
+
+#include "parsebgp.h"
+#include <stddef.h>
+
+/**
+ * Ring Flags
+ *
+ * By default, rings may be used by any number of producer and consumer
+ * threads. If only one thread will ever push (or pop), setting the
+ * corresponding flag avoids an atomic compare-and-swap per operation.
+ */
+typedef enum parsebgp_ring_flags {
+
+  /** Only one thread pushes to the ring */
+  PARSEBGP_RING_SINGLE_PRODUCER = 0x01,
+
+  /** Only one thread pops from the ring */
+  PARSEBGP_RING_SINGLE_CONSUMER = 0x02,
+
+} parsebgp_ring_flags_t;
+
+/**
+ * Bounded lock-free ring of pointers
+ *
+ * Push and pop never block and never allocate; they fail if the ring is full
+ * (or empty). The producer and consumer positions are kept on separate cache
+ * lines so that producers and consumers do not contend with each other.
+ */
+typedef struct parsebgp_ring parsebgp_ring_t;
+
+/**
+ * Create a ring
+ *
+ * @param size          Number of slots (rounded up to a power of two)
+ * @param flags         Bitwise OR of parsebgp_ring_flags_t values
+ * @return pointer to the ring, or NULL if memory allocation failed
+ */
+parsebgp_ring_t *parsebgp_ring_create(size_t size, int flags);
+
+/** Destroy the given ring (the pointers it holds are not freed) */
+void parsebgp_ring_destroy(parsebgp_ring_t *ring);
+
+/**
+ * Get the number of slots in the given ring
+ *
+ * @param ring          Pointer to the ring
+ * @return the capacity of the ring
+ */
+size_t parsebgp_ring_get_size(const parsebgp_ring_t *ring);
+
+/**
+ * Add a pointer to the ring
+ *
+ * @param ring          Pointer to the ring
+ * @param ptr           Pointer to add
+ * @return 0 if the pointer was added, -1 if the ring is full
+ */
+int parsebgp_ring_push(parsebgp_ring_t *ring, void *ptr);
+
+/**
+ * Remove the oldest pointer from the ring
+ *
+ * @param ring          Pointer to the ring
+ * @return the pointer, or NULL if the ring is empty
+ */
+void *parsebgp_ring_pop(parsebgp_ring_t *ring);
+
+/**
+ * Ring of preallocated messages
+ *
+ * A message ring hands decoded messages from producer (decoder) threads to
+ * consumer threads without any locking or memory allocation. It holds a fixed
+ * set of message structures that cycle between producers and consumers:
+ *
+ *  - a producer takes an empty message (parsebgp_msg_ring_acquire), decodes
+ *    into it, and passes it on (parsebgp_msg_ring_publish);
+ *  - a consumer takes the oldest decoded message (parsebgp_msg_ring_consume),
+ *    uses it, and returns it (parsebgp_msg_ring_release), which also clears
+ *    the message so that the cost of clearing is paid on the consumer side.
+ *
+ * Because each message is reused, buffers allocated while decoding are kept
+ * and reused by later messages.
+ */
+typedef struct parsebgp_msg_ring parsebgp_msg_ring_t;
+
+/**
+ * Create a message ring
+ *
+ * @param size          Number of messages (rounded up to a power of two)
+ * @param flags         Bitwise OR of parsebgp_ring_flags_t values describing
+ *                      the producer and consumer threads
+ * @return pointer to the ring, or NULL if memory allocation failed
+ */
+parsebgp_msg_ring_t *parsebgp_msg_ring_create(size_t size, int flags);
+
+/**
+ * Destroy the given message ring
+ *
+ * @param ring          Pointer to the ring
+ *
+ * All messages are destroyed, so none may still be in use.
+ */
+void parsebgp_msg_ring_destroy(parsebgp_msg_ring_t *ring);
+
+/**
+ * Get an empty message to decode into
+ *
+ * @param ring          Pointer to the ring
+ * @return pointer to an empty message, or NULL if all messages are in use
+ */
+parsebgp_msg_t *parsebgp_msg_ring_acquire(parsebgp_msg_ring_t *ring);
+
+/**
+ * Pass a decoded message on to the consumers
+ *
+ * @param ring          Pointer to the ring
+ * @param msg           Pointer to a message obtained from
+ *                      parsebgp_msg_ring_acquire
+ */
+void parsebgp_msg_ring_publish(parsebgp_msg_ring_t *ring, parsebgp_msg_t *msg);
+
+/**
+ * Get the oldest decoded message
+ *
+ * @param ring          Pointer to the ring
+ * @return pointer to a decoded message, or NULL if there are none
+ */
+parsebgp_msg_t *parsebgp_msg_ring_consume(parsebgp_msg_ring_t *ring);
+
+/**
+ * Clear a consumed message and return it to the producers
+ *
+ * @param ring          Pointer to the ring
+ * @param msg           Pointer to a message obtained from
+ *                      parsebgp_msg_ring_consume
+ */
+void parsebgp_msg_ring_release(parsebgp_msg_ring_t *ring, parsebgp_msg_t *msg);
+
+#endif /* __PARSEBGP_RING_H */
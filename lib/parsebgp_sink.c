@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_sink.h"
+#include "parsebgp_utils.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Initial size of the buffer of a memory sink */
+#define BUFLEN_INIT 4096
+
+struct parsebgp_sink {
+
+  /** Stream to write to (NULL for memory sinks) */
+  FILE *fp;
+
+  /** Buffered output (memory sinks) */
+  char *buf;
+
+  /** Number of bytes buffered */
+  size_t buf_len;
+
+  /** Allocated size of the buffer */
+  size_t _buf_alloc_len;
+
+  /** Callback to pass buffered data to when flushing */
+  parsebgp_sink_write_cb_t *cb;
+
+  /** User data for the callback */
+  void *user;
+
+  /** First error encountered while writing */
+  parsebgp_error_t err;
+};
+
+/** Make room for at least len more bytes in the buffer of a memory sink */
+static int buf_reserve(parsebgp_sink_t *sink, size_t len)
+{
+  size_t new_len;
+  char *buf;
+
+  if (sink->_buf_alloc_len - sink->buf_len >= len) {
+    return 0;
+  }
+  new_len = sink->_buf_alloc_len == 0 ? BUFLEN_INIT : sink->_buf_alloc_len;
+  while (new_len - sink->buf_len < len) {
+    new_len *= 2;
+  }
+  if ((buf = realloc(sink->buf, new_len)) == NULL) {
+    sink->err = PARSEBGP_MALLOC_FAILURE;
+    return -1;
+  }
+  sink->buf = buf;
+  sink->_buf_alloc_len = new_len;
+  return 0;
+}
+
+parsebgp_sink_t *parsebgp_sink_create_file(FILE *fp)
+{
+  parsebgp_sink_t *sink;
+
+  if ((sink = malloc_zero(sizeof(*sink))) == NULL) {
+    return NULL;
+  }
+  sink->fp = fp;
+  sink->err = PARSEBGP_OK;
+
+  return sink;
+}
+
+parsebgp_sink_t *parsebgp_sink_create_buffer(parsebgp_sink_write_cb_t *cb,
+                                             void *user)
+{
+  parsebgp_sink_t *sink;
+
+  if ((sink = malloc_zero(sizeof(*sink))) == NULL) {
+    return NULL;
+  }
+  sink->cb = cb;
+  sink->user = user;
+  sink->err = PARSEBGP_OK;
+  if (buf_reserve(sink, BUFLEN_INIT) != 0) {
+    free(sink);
+    return NULL;
+  }
+
+  return sink;
+}
+
+parsebgp_error_t parsebgp_sink_destroy(parsebgp_sink_t *sink)
+{
+  parsebgp_error_t err;
+
+  if (sink == NULL) {
+    return PARSEBGP_OK;
+  }
+
+  err = parsebgp_sink_flush(sink);
+
+  free(sink->buf);
+  free(sink);
+
+  return err;
+}
+
+parsebgp_error_t parsebgp_sink_flush(parsebgp_sink_t *sink)
+{
+  if (sink == NULL) {
+    return fflush(stdout) != 0 ? PARSEBGP_IO_ERROR : PARSEBGP_OK;
+  }
+  if (sink->fp != NULL) {
+    if (fflush(sink->fp) != 0) {
+      sink->err = PARSEBGP_IO_ERROR;
+    }
+  } else if (sink->cb != NULL && sink->buf_len != 0) {
+    if (sink->cb(sink->buf, sink->buf_len, sink->user) != 0) {
+      sink->err = PARSEBGP_IO_ERROR;
+    }
+    sink->buf_len = 0;
+  }
+
+  return sink->err;
+}
+
+const char *parsebgp_sink_get_buffer(const parsebgp_sink_t *sink,
+                                     size_t *lenp)
+{
+  if (sink == NULL || sink->fp != NULL) {
+    *lenp = 0;
+    return NULL;
+  }
+  *lenp = sink->buf_len;
+  return sink->buf;
+}
+
+void parsebgp_sink_reset(parsebgp_sink_t *sink)
+{
+  if (sink != NULL) {
+    sink->buf_len = 0;
+  }
+}
+
+void parsebgp_sink_write(parsebgp_sink_t *sink, const char *data, size_t len)
+{
+  if (sink == NULL) {
+    fwrite(data, 1, len, stdout);
+  } else if (sink->fp != NULL) {
+    if (fwrite(data, 1, len, sink->fp) != len) {
+      sink->err = PARSEBGP_IO_ERROR;
+    }
+  } else if (buf_reserve(sink, len) == 0) {
+    memcpy(sink->buf + sink->buf_len, data, len);
+    sink->buf_len += len;
+  }
+}
+
+void parsebgp_sink_puts(parsebgp_sink_t *sink, const char *str)
+{
+  parsebgp_sink_write(sink, str, strlen(str));
+}
+
+void parsebgp_sink_printf(parsebgp_sink_t *sink, const char *fmt, ...)
+{
+  va_list ap, ap2;
+  size_t avail;
+  int len;
+
+  va_start(ap, fmt);
+
+  if (sink == NULL) {
+    vprintf(fmt, ap);
+  } else if (sink->fp != NULL) {
+    if (vfprintf(sink->fp, fmt, ap) < 0) {
+      sink->err = PARSEBGP_IO_ERROR;
+    }
+  } else {
+    // format straight into the buffer, and retry if it was too small
+    va_copy(ap2, ap);
+    avail = sink->_buf_alloc_len - sink->buf_len;
+    len = vsnprintf(sink->buf + sink->buf_len, avail, fmt, ap);
+    if (len >= 0 && (size_t)len >= avail &&
+        buf_reserve(sink, (size_t)len + 1) == 0) {
+      len = vsnprintf(sink->buf + sink->buf_len, len + 1, fmt, ap2);
+    }
+    if (len >= 0 && sink->buf_len + len < sink->_buf_alloc_len) {
+      sink->buf_len += len;
+    }
+    va_end(ap2);
+  }
+
+  va_end(ap);
+}
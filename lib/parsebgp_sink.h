@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_SINK_H
+#define __PARSEBGP_SINK_H
+
+#include "parsebgp_error.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Output Sink for the dump functions
+ *
+ * A sink either writes to a stdio stream, or collects output in a growable
+ * memory buffer. Memory sinks let each thread format messages into its own
+ * buffer (without contending on the stdio lock) and hand the finished chunks
+ * to a single writer, either by reading the buffer directly
+ * (parsebgp_sink_get_buffer) or through a write callback that is called by
+ * parsebgp_sink_flush.
+ *
+ * Wherever a sink is expected, NULL may be given to write to stdout.
+ */
+typedef struct parsebgp_sink parsebgp_sink_t;
+
+/**
+ * Memory sink write callback
+ *
+ * @param data          Pointer to the buffered output
+ * @param len           Number of bytes of output
+ * @param user          User data given when the sink was created
+ * @return 0 if the data was consumed, -1 otherwise
+ */
+typedef int(parsebgp_sink_write_cb_t)(const char *data, size_t len,
+                                      void *user);
+
+/**
+ * Create a sink that writes to a stdio stream
+ *
+ * @param fp            Stream to write to (not closed by the sink)
+ * @return pointer to the sink, or NULL if memory allocation failed
+ */
+parsebgp_sink_t *parsebgp_sink_create_file(FILE *fp);
+
+/**
+ * Create a sink that writes to a growable memory buffer
+ *
+ * @param cb            Callback to pass buffered data to when the sink is
+ *                      flushed (may be NULL if the caller reads the buffer
+ *                      directly)
+ * @param user          User data to pass to the callback
+ * @return pointer to the sink, or NULL if memory allocation failed
+ */
+parsebgp_sink_t *parsebgp_sink_create_buffer(parsebgp_sink_write_cb_t *cb,
+                                             void *user);
+
+/**
+ * Flush and destroy the given sink
+ *
+ * @param sink          Pointer to the sink to destroy
+ * @return the result of the final flush
+ */
+parsebgp_error_t parsebgp_sink_destroy(parsebgp_sink_t *sink);
+
+/**
+ * Flush the given sink
+ *
+ * For stream sinks, the stream is flushed. For memory sinks with a callback,
+ * the buffered data is passed to the callback and the buffer is emptied.
+ *
+ * @param sink          Pointer to the sink to flush (NULL for stdout)
+ * @return PARSEBGP_OK if successful, PARSEBGP_IO_ERROR if this or any earlier
+ * write failed, or PARSEBGP_MALLOC_FAILURE if the buffer could not be grown
+ * (in which case some output was lost)
+ */
+parsebgp_error_t parsebgp_sink_flush(parsebgp_sink_t *sink);
+
+/**
+ * Get the data buffered by a memory sink
+ *
+ * @param sink          Pointer to the sink (NULL for stdout)
+ * @param [out] lenp    Set to the number of bytes buffered
+ * @return pointer to the buffered data (valid until the next write), or NULL
+ * if the sink is not a memory sink
+ */
+const char *parsebgp_sink_get_buffer(const parsebgp_sink_t *sink,
+                                     size_t *lenp);
+
+/**
+ * Empty the buffer of a memory sink (without calling the callback)
+ *
+ * @param sink          Pointer to the sink (NULL for stdout)
+ */
+void parsebgp_sink_reset(parsebgp_sink_t *sink);
+
+/**
+ * Write data to a sink
+ *
+ * @param sink          Pointer to the sink (NULL for stdout)
+ * @param data          Pointer to the data to write
+ * @param len           Number of bytes to write
+ */
+void parsebgp_sink_write(parsebgp_sink_t *sink, const char *data, size_t len);
+
+/**
+ * Write a string to a sink
+ *
+ * @param sink          Pointer to the sink (NULL for stdout)
+ * @param str           Nul-terminated string to write
+ */
+void parsebgp_sink_puts(parsebgp_sink_t *sink, const char *str);
+
+/**
+ * Write formatted output to a sink
+ *
+ * @param sink          Pointer to the sink (NULL for stdout)
+ * @param fmt           printf-style format string
+ */
+void parsebgp_sink_printf(parsebgp_sink_t *sink, const char *fmt, ...)
+#if defined(__GNUC__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  ;
+
+#endif /* __PARSEBGP_SINK_H */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_stats.h"
+#include "parsebgp_utils.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// parsebgp_stats_merge treats the block as a flat array of counters
+STATIC_ASSERT(sizeof(parsebgp_stats_t) % sizeof(uint64_t) == 0,
+              stats_block_is_not_a_counter_array);
+
+#ifdef PARSEBGP_STATS
+__thread uint64_t parsebgp_stats_reallocs = 0;
+
+uint64_t parsebgp_stats_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+static const char *afi_names[PARSEBGP_STATS_AFIS] = {"other", "ipv4", "ipv6"};
+
+static const char *safi_names[PARSEBGP_STATS_SAFIS] = {"other", "unicast",
+                                                       "multicast", "mpls-vpn"};
+
+static void dump_msg_stats(parsebgp_sink_t *sink, const char *name, int type,
+                           int subtype, const parsebgp_stats_msg_t *s)
+{
+  if (s->msgs_cnt == 0) {
+    return;
+  }
+  if (subtype < 0) {
+    parsebgp_sink_printf(sink,
+                         "%s %d: %" PRIu64 " msgs, %" PRIu64 " bytes, %" PRIu64
+                         " ns (%" PRIu64 " ns/msg)\n",
+                         name, type, s->msgs_cnt, s->bytes, s->ns,
+                         s->ns / s->msgs_cnt);
+  } else {
+    parsebgp_sink_printf(sink,
+                         "%s %d/%d: %" PRIu64 " msgs, %" PRIu64
+                         " bytes, %" PRIu64 " ns (%" PRIu64 " ns/msg)\n",
+                         name, type, subtype, s->msgs_cnt, s->bytes, s->ns,
+                         s->ns / s->msgs_cnt);
+  }
+}
+
+int parsebgp_stats_enabled(void)
+{
+#ifdef PARSEBGP_STATS
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void parsebgp_stats_clear(parsebgp_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+}
+
+void parsebgp_stats_merge(parsebgp_stats_t *dst, const parsebgp_stats_t *src)
+{
+  uint64_t *d = (uint64_t *)dst;
+  const uint64_t *s = (const uint64_t *)src;
+  size_t i;
+
+  for (i = 0; i < sizeof(*dst) / sizeof(uint64_t); i++) {
+    d[i] += s[i];
+  }
+}
+
+void parsebgp_stats_dump(parsebgp_sink_t *sink, const parsebgp_stats_t *stats)
+{
+  int i, j;
+
+  for (i = 0; i < PARSEBGP_STATS_MRT_TYPES; i++) {
+    for (j = 0; j < PARSEBGP_STATS_MRT_SUBTYPES; j++) {
+      dump_msg_stats(sink, "MRT", i, j, &stats->mrt[i][j]);
+    }
+  }
+
+  for (i = 0; i < PARSEBGP_STATS_BMP_TYPES; i++) {
+    dump_msg_stats(sink, "BMP", i, -1, &stats->bmp[i]);
+  }
+
+  for (i = 0; i < PARSEBGP_STATS_BGP_TYPES; i++) {
+    dump_msg_stats(sink, "BGP", i, -1, &stats->bgp[i]);
+  }
+
+  for (i = 0; i < PARSEBGP_STATS_PATH_ATTR_TYPES; i++) {
+    if (stats->path_attrs[i].cnt == 0) {
+      continue;
+    }
+    parsebgp_sink_printf(sink,
+                         "Path Attribute %d: %" PRIu64 " attrs, %" PRIu64
+                         " bytes\n",
+                         i, stats->path_attrs[i].cnt,
+                         stats->path_attrs[i].bytes);
+  }
+
+  for (i = 0; i < PARSEBGP_STATS_AFIS; i++) {
+    for (j = 0; j < PARSEBGP_STATS_SAFIS; j++) {
+      if (stats->nlris_announced[i][j] == 0 &&
+          stats->nlris_withdrawn[i][j] == 0) {
+        continue;
+      }
+      parsebgp_sink_printf(sink,
+                           "NLRIs %s/%s: %" PRIu64 " announced, %" PRIu64
+                           " withdrawn\n",
+                           afi_names[i], safi_names[j],
+                           stats->nlris_announced[i][j],
+                           stats->nlris_withdrawn[i][j]);
+    }
+  }
+
+  if (stats->reallocs_cnt != 0) {
+    parsebgp_sink_printf(sink, "Reallocations: %" PRIu64 "\n",
+                         stats->reallocs_cnt);
+  }
+  if (stats->not_implemented_cnt != 0) {
+    parsebgp_sink_printf(sink, "Not Implemented: %" PRIu64 "\n",
+                         stats->not_implemented_cnt);
+  }
+  if (stats->invalid_cnt != 0) {
+    parsebgp_sink_printf(sink, "Invalid: %" PRIu64 "\n", stats->invalid_cnt);
+  }
+  for (i = 1; i < -PARSEBGP_N_ERR; i++) {
+    if (stats->errors_cnt[i] == 0) {
+      continue;
+    }
+    parsebgp_sink_printf(sink, "Errors (%s): %" PRIu64 "\n",
+                         parsebgp_strerror(-i), stats->errors_cnt[i]);
+  }
+}
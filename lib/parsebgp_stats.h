@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_STATS_H
+#define __PARSEBGP_STATS_H
+
+#include "parsebgp_error.h"
+#include "parsebgp_sink.h"
+#include <inttypes.h>
+
+/** Number of MRT types that are tracked (larger types are not counted) */
+#define PARSEBGP_STATS_MRT_TYPES 64
+
+/** Number of MRT subtypes that are tracked (larger subtypes are not
+    counted) */
+#define PARSEBGP_STATS_MRT_SUBTYPES 16
+
+/** Number of BMP types that are tracked */
+#define PARSEBGP_STATS_BMP_TYPES 8
+
+/** Number of BGP types that are tracked */
+#define PARSEBGP_STATS_BGP_TYPES 8
+
+/** Number of path attribute types that are tracked (i.e., all of them) */
+#define PARSEBGP_STATS_PATH_ATTR_TYPES 256
+
+/** Number of AFI buckets used for NLRI counts (other, IPv4, IPv6) */
+#define PARSEBGP_STATS_AFIS 3
+
+/** Number of SAFI buckets used for NLRI counts (other, unicast, multicast,
+    MPLS-labeled VPN) */
+#define PARSEBGP_STATS_SAFIS 4
+
+/** Map an AFI to its NLRI bucket */
+#define PARSEBGP_STATS_AFI_IDX(afi) ((afi) == 1 ? 1 : (afi) == 2 ? 2 : 0)
+
+/** Map a SAFI to its NLRI bucket */
+#define PARSEBGP_STATS_SAFI_IDX(safi)                                         \
+  ((safi) == 1 ? 1 : (safi) == 2 ? 2 : (safi) == 128 ? 3 : 0)
+
+/**
+ * Per-Message-Type Statistics
+ */
+typedef struct parsebgp_stats_msg {
+
+  /** Number of messages successfully decoded */
+  uint64_t msgs_cnt;
+
+  /** Number of bytes consumed by these messages */
+  uint64_t bytes;
+
+  /** Number of nanoseconds spent decoding these messages (including any
+      encapsulated messages) */
+  uint64_t ns;
+
+} parsebgp_stats_msg_t;
+
+/**
+ * Per-Path-Attribute-Type Statistics
+ */
+typedef struct parsebgp_stats_path_attr {
+
+  /** Number of attributes of this type */
+  uint64_t cnt;
+
+  /** Number of (value) bytes in these attributes */
+  uint64_t bytes;
+
+} parsebgp_stats_path_attr_t;
+
+/**
+ * Decode Statistics
+ *
+ * A statistics block is attached to the parser using the stats field in
+ * parsebgp_opts_t, and is updated by every decode call that uses those
+ * options. Counters are only collected if the library was configured with
+ * --enable-stats (see parsebgp_stats_enabled), otherwise the block is left
+ * untouched and there is no overhead.
+ *
+ * The block is not synchronized: each decoding thread should use its own
+ * block, which may be read at any time by that thread, and blocks may be
+ * combined using parsebgp_stats_merge.
+ */
+typedef struct parsebgp_stats {
+
+  /** Per MRT type/subtype message statistics */
+  parsebgp_stats_msg_t mrt[PARSEBGP_STATS_MRT_TYPES]
+                          [PARSEBGP_STATS_MRT_SUBTYPES];
+
+  /** Per BMP type message statistics */
+  parsebgp_stats_msg_t bmp[PARSEBGP_STATS_BMP_TYPES];
+
+  /** Per BGP type message statistics (including BGP messages encapsulated in
+      MRT and BMP messages) */
+  parsebgp_stats_msg_t bgp[PARSEBGP_STATS_BGP_TYPES];
+
+  /** Per path attribute type statistics */
+  parsebgp_stats_path_attr_t path_attrs[PARSEBGP_STATS_PATH_ATTR_TYPES];
+
+  /** Number of announced NLRIs, per AFI/SAFI bucket (see
+      PARSEBGP_STATS_AFI_IDX and PARSEBGP_STATS_SAFI_IDX) */
+  uint64_t nlris_announced[PARSEBGP_STATS_AFIS][PARSEBGP_STATS_SAFIS];
+
+  /** Number of withdrawn NLRIs, per AFI/SAFI bucket */
+  uint64_t nlris_withdrawn[PARSEBGP_STATS_AFIS][PARSEBGP_STATS_SAFIS];
+
+  /** Number of times a decode buffer had to be (re)allocated */
+  uint64_t reallocs_cnt;
+
+  /** Number of not-implemented features encountered (whether skipped or
+      not) */
+  uint64_t not_implemented_cnt;
+
+  /** Number of invalid message features encountered (whether skipped or
+      not) */
+  uint64_t invalid_cnt;
+
+  /** Number of failed top-level decodes, indexed by the negated error code */
+  uint64_t errors_cnt[-PARSEBGP_N_ERR];
+
+} parsebgp_stats_t;
+
+/**
+ * Check whether the library was built with statistics support
+ *
+ * @return 1 if statistics are collected, 0 otherwise
+ */
+int parsebgp_stats_enabled(void);
+
+/**
+ * Reset all counters in the given statistics block
+ *
+ * @param stats         pointer to the statistics block to clear
+ */
+void parsebgp_stats_clear(parsebgp_stats_t *stats);
+
+/**
+ * Add the counters of one statistics block to another
+ *
+ * @param dst           pointer to the statistics block to add to
+ * @param src           pointer to the statistics block to add
+ */
+void parsebgp_stats_merge(parsebgp_stats_t *dst, const parsebgp_stats_t *src);
+
+/**
+ * Dump a human-readable version of the statistics to a sink
+ *
+ * Only non-zero counters are printed.
+ *
+ * @param sink          sink to write to (NULL for stdout)
+ * @param stats         pointer to the statistics block to dump
+ */
+void parsebgp_stats_dump(parsebgp_sink_t *sink,
+                         const parsebgp_stats_t *stats);
+
+#endif /* __PARSEBGP_STATS_H */
@@ -62,7 +62,94 @@ parsebgp_error_t parsebgp_decode_prefix(uint8_t pfx_len, uint8_t *dst,
   return PARSEBGP_OK;
 }
 
-void *malloc_zero(const size_t size)
+parsebgp_error_t parsebgp_encode_prefix(uint8_t pfx_len, const uint8_t *src,
+                                        uint8_t *buf, size_t *buf_len,
+                                        size_t max_pfx_len)
+{
+  uint8_t bytes, junk;
+  PARSEBGP_ASSERT(pfx_len <= max_pfx_len);
+  bytes = pfx_len / 8;
+  if ((junk = (pfx_len % 8)) != 0) {
+    bytes++;
+  }
+  if (*buf_len < bytes) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+  memcpy(buf, src, bytes);
+  // don't leak whatever was in the host bits of the last byte
+  if (junk != 0) {
+    junk = 8 - junk;
+    buf[bytes - 1] = buf[bytes - 1] & (0xFF << junk);
+  }
+
+  *buf_len = bytes;
+  return PARSEBGP_OK;
+}
+
+#define HASH_K1 0x9E3779B97F4A7C15ULL
+#define HASH_K2 0xC2B2AE3D27D4EB4FULL
+
+static inline uint64_t hash_rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_mix(uint64_t h)
+{
+  // murmur3 64-bit finalizer
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t parsebgp_hash_bytes(const uint8_t *buf, size_t len, uint64_t seed)
+{
+  uint64_t h = seed ^ (len * HASH_K1);
+  uint64_t k;
+  const uint8_t *end = buf + (len & ~(size_t)7);
+
+  // 8 bytes at a time (memcpy keeps unaligned loads safe, and compiles to a
+  // single load on platforms that support it)
+  for (; buf < end; buf += 8) {
+    memcpy(&k, buf, sizeof(k));
+    k *= HASH_K2;
+    k = hash_rotl(k, 31);
+    k *= HASH_K1;
+    h ^= k;
+    h = hash_rotl(h, 27) * 5 + 0x52DCE729;
+  }
+
+  // and then the tail
+  k = 0;
+  switch (len & 7) {
+  case 7:
+    k |= (uint64_t)buf[6] << 48; // FALL THROUGH
+  case 6:
+    k |= (uint64_t)buf[5] << 40; // FALL THROUGH
+  case 5:
+    k |= (uint64_t)buf[4] << 32; // FALL THROUGH
+  case 4:
+    k |= (uint64_t)buf[3] << 24; // FALL THROUGH
+  case 3:
+    k |= (uint64_t)buf[2] << 16; // FALL THROUGH
+  case 2:
+    k |= (uint64_t)buf[1] << 8; // FALL THROUGH
+  case 1:
+    k |= (uint64_t)buf[0];
+    k *= HASH_K2;
+    k = hash_rotl(k, 31);
+    k *= HASH_K1;
+    h ^= k;
+  }
+
+  return hash_mix(h);
+}
+
+// (parenthesized so that the profiling macro is not expanded)
+void *(malloc_zero)(const size_t size)
 {
   return calloc(size, 1);
 }
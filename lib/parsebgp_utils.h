@@ -28,11 +28,13 @@
 #define __PARSEBGP_UTILS_H
 
 #include "parsebgp_error.h"
+#include "parsebgp_format.h"
+#include "parsebgp_sink.h"
 #include "config.h"
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
-// for inet_ntop:
+// for ntohl:
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -152,21 +154,160 @@
     buf += (n);                                                                \
   } while (0)
 
+/** Convenience macros to serialize a host-order integer into a byte array in
+ * network order (the inverse of the PARSEBGP_DESERIALIZE_UINT* macros).
+ *
+ * @param buf           pointer to the buffer (will be updated)
+ * @param len           total length of the buffer
+ * @param written       the number of bytes already written to the buffer
+ *                      (will be updated)
+ * @param from          the value to serialize
+ */
+#define PARSEBGP_SERIALIZE_UINT8(buf, len, written, from)                      \
+  PARSEBGP_SERIALIZE_INT_HELPER(buf, len, written, from, uint8_t)
+
+#define PARSEBGP_SERIALIZE_UINT16(buf, len, written, from)                     \
+  PARSEBGP_SERIALIZE_INT_HELPER(buf, len, written, from, uint16_t)
+
+#define PARSEBGP_SERIALIZE_UINT32(buf, len, written, from)                     \
+  PARSEBGP_SERIALIZE_INT_HELPER(buf, len, written, from, uint32_t)
+
+#define PARSEBGP_SERIALIZE_UINT64(buf, len, written, from)                     \
+  PARSEBGP_SERIALIZE_INT_HELPER(buf, len, written, from, uint64_t)
+
+#define PARSEBGP_SERIALIZE_INT_HELPER(buf, len, written, from, type)           \
+  do {                                                                         \
+    type _v = (type)(from);                                                    \
+    size_t _i;                                                                 \
+    assert((len) >= (written));                                                \
+    if (((len) - (written)) < sizeof(type)) {                                  \
+      return PARSEBGP_PARTIAL_MSG;                                             \
+    }                                                                          \
+    for (_i = sizeof(type); _i > 0; _i--) {                                    \
+      (buf)[_i - 1] = (uint8_t)(_v & 0xFF);                                    \
+      _v = (type)(_v >> 8);                                                    \
+    }                                                                          \
+    written += sizeof(type);                                                   \
+    buf += sizeof(type);                                                       \
+  } while (0)
+
+/** Convenience macro to serialize raw bytes into a byte array.
+ *
+ * @param buf           pointer to the buffer (will be updated)
+ * @param len           total length of the buffer
+ * @param written       the number of bytes already written to the buffer
+ *                      (will be updated)
+ * @param ptr           pointer to memory to serialize from
+ * @param n             number of bytes to serialize
+ */
+#define PARSEBGP_SERIALIZE_BYTES(buf, len, written, ptr, n)                    \
+  do {                                                                         \
+    assert((len) >= (written));                                                \
+    if (((len) - (written)) < (n)) {                                           \
+      return PARSEBGP_PARTIAL_MSG;                                             \
+    }                                                                          \
+    memcpy((buf), (ptr), (n));                                                 \
+    written += (n);                                                            \
+    buf += (n);                                                                \
+  } while (0)
+
+/** Convenience macro to serialize a simple variable into a byte array.
+ *
+ * @param buf           pointer to the buffer (will be updated)
+ * @param len           total length of the buffer
+ * @param written       the number of bytes already written to the buffer
+ *                      (will be updated)
+ * @param from          the variable to serialize
+ */
+#define PARSEBGP_SERIALIZE_VAL(buf, len, written, from)                        \
+  PARSEBGP_SERIALIZE_BYTES(buf, len, written, &(from), sizeof(from))
+
+
+#ifdef PARSEBGP_STATS
+/** Number of reallocations performed by this thread (PARSEBGP_MAYBE_REALLOC
+    has no access to the options, so parsebgp_decode attributes the delta) */
+extern __thread uint64_t parsebgp_stats_reallocs;
+
+/** Get a monotonic timestamp in nanoseconds */
+uint64_t parsebgp_stats_now(void);
+
+/** Add val to the given counter of the stats block (if any) */
+#define PARSEBGP_STATS_ADD(opts, field, val)                                   \
+  do {                                                                         \
+    if ((opts)->stats != NULL) {                                               \
+      (opts)->stats->field += (val);                                           \
+    }                                                                          \
+  } while (0)
+
+/** Account for a decoded message that started decoding at the given
+    timestamp (the stats block must be set) */
+#define PARSEBGP_STATS_MSG(opts, entry, nbytes, start)                         \
+  do {                                                                         \
+    parsebgp_stats_msg_t *_s = &(opts)->stats->entry;                          \
+    _s->msgs_cnt++;                                                            \
+    _s->bytes += (nbytes);                                                     \
+    _s->ns += parsebgp_stats_now() - (start);                                  \
+  } while (0)
+
+/** Count a realloc event */
+#define PARSEBGP_STATS_REALLOC() parsebgp_stats_reallocs++
+#else
+#define PARSEBGP_STATS_ADD(opts, field, val)                                   \
+  do {                                                                         \
+  } while (0)
+#define PARSEBGP_STATS_REALLOC()                                               \
+  do {                                                                         \
+  } while (0)
+#endif
+
+struct parsebgp_opts;
+
+/**
+ * Count and (unless silenced or rate limited) report a diagnostic event. Use
+ * the PARSEBGP_DIAG macro rather than calling this directly.
+ *
+ * @param opts          pointer to the parsing options
+ * @param code          diagnostic code (parsebgp_diag_code_t)
+ * @param fatal         set if the parser is about to give up on the message
+ * @param silenced      set if the event should only be counted
+ * @param ptr           pointer to the part of the message that caused the
+ *                      event (used to compute the offset), or NULL
+ * @param file          source file that raised the event
+ * @param line          source line that raised the event
+ * @param fmt           printf-style format of the event description
+ */
+void parsebgp_diag_report(struct parsebgp_opts *opts, int code, int fatal,
+                          int silenced, const uint8_t *ptr, const char *file,
+                          int line, const char *fmt, ...)
+#if defined(__GNUC__)
+  __attribute__((format(printf, 8, 9)))
+#endif
+  ;
+
+/** Raise a diagnostic event. Silenced events are only counted, and cost
+    nothing unless a diagnostics state has been configured. */
+#define PARSEBGP_DIAG(opts, code, fatal, silenced, ptr, ...)                   \
+  do {                                                                         \
+    if (!(silenced) || (opts)->diag.state != NULL) {                           \
+      parsebgp_diag_report((opts), (code), (fatal), (silenced), (ptr),         \
+                           __FILE__, __LINE__, __VA_ARGS__);                   \
+    }                                                                          \
+  } while (0)
 
 /** Convenience macro to either abort parsing or skip an unimplemented feature
     depending on run-time configuration */
 #define PARSEBGP_SKIP_NOT_IMPLEMENTED(opts, buf, nread, remain, msg_fmt, ...)  \
   do {                                                                         \
+    PARSEBGP_STATS_ADD(opts, not_implemented_cnt, 1);                          \
     if ((opts)->ignore_not_implemented) {                                      \
+      PARSEBGP_DIAG(opts, PARSEBGP_DIAG_NOT_IMPLEMENTED, 0,                    \
+                    (opts)->silence_not_implemented, buf, msg_fmt,             \
+                    __VA_ARGS__);                                              \
       nread += (remain);                                                       \
       buf += (remain);                                                         \
-      if (!(opts)->silence_not_implemented) {                                  \
-        fprintf(stderr, "WARN: NOT_IMPLEMENTED: " msg_fmt " (%s:%d)\n",        \
-                __VA_ARGS__, __FILE__, __LINE__);                              \
-      }                                                                        \
     } else {                                                                   \
-      fprintf(stderr, "ERROR: NOT_IMPLEMENTED: " msg_fmt " (%s:%d)\n",         \
-              __VA_ARGS__, __FILE__, __LINE__);                                \
+      PARSEBGP_DIAG(opts, PARSEBGP_DIAG_NOT_IMPLEMENTED, 1, 0, buf, msg_fmt,   \
+                    __VA_ARGS__);                                              \
       return PARSEBGP_NOT_IMPLEMENTED;                                         \
     }                                                                          \
   } while (0)
@@ -175,16 +316,15 @@
     path attribute) depending on run-time configuration */
 #define PARSEBGP_SKIP_INVALID_MSG(opts, buf, nread, remain, msg_fmt, ...)      \
   do {                                                                         \
+    PARSEBGP_STATS_ADD(opts, invalid_cnt, 1);                                  \
     if ((opts)->ignore_invalid) {                                              \
+      PARSEBGP_DIAG(opts, PARSEBGP_DIAG_INVALID_MSG, 0,                        \
+                    (opts)->silence_invalid, buf, msg_fmt, __VA_ARGS__);       \
       nread += (remain);                                                       \
       buf += (remain);                                                         \
-      if (!(opts)->silence_invalid) {                                          \
-        fprintf(stderr, "WARN: INVALID_MSG: " msg_fmt " (%s:%d)\n",            \
-                __VA_ARGS__, __FILE__, __LINE__);                              \
-      }                                                                        \
     } else {                                                                   \
-      fprintf(stderr, "ERROR: INVALID_MSG: " msg_fmt " (%s:%d)\n",             \
-              __VA_ARGS__, __FILE__, __LINE__);                                \
+      PARSEBGP_DIAG(opts, PARSEBGP_DIAG_INVALID_MSG, 1, 0, buf, msg_fmt,       \
+                    __VA_ARGS__);                                              \
       return PARSEBGP_INVALID_MSG;                                             \
     }                                                                          \
   } while (0)
@@ -207,27 +347,15 @@
   } while (0)
 
 
-#define PARSEBGP_DUMP_STRUCT_HDR(struct_name, depth)                           \
-  do {                                                                         \
-    int _i;                                                                    \
-    for (_i = 0; _i < (depth); _i++) {                                         \
-      if (_i == depth - 1) {                                                   \
-        fputs(" ", stdout);                                                    \
-      } else {                                                                 \
-        fputs("  ", stdout);                                                   \
-      }                                                                        \
-    }                                                                          \
-    printf(">> " STR(struct_name) " (%ld bytes):\n", sizeof(struct_name));     \
-  } while (0)
+#define PARSEBGP_DUMP_STRUCT_HDR(sink, struct_name, depth)                     \
+  parsebgp_sink_printf((sink), "%*s>> " STR(struct_name) " (%ld bytes):\n",    \
+                       (depth) > 0 ? 2 * (depth) - 1 : 0, "",                  \
+                       sizeof(struct_name))
 
-#define PARSEBGP_DUMP_INFO(depth, ...)                                         \
+#define PARSEBGP_DUMP_INFO(sink, depth, ...)                                   \
   do {                                                                         \
-    int _i;                                                                    \
-    fputs(" ", stdout);                                                        \
-    for (_i = 0; _i < (depth); _i++) {                                         \
-      fputs("  ", stdout);                                                     \
-    }                                                                          \
-    printf(__VA_ARGS__);                                                       \
+    parsebgp_sink_printf((sink), "%*s", 1 + 2 * (depth), "");                  \
+    parsebgp_sink_printf((sink), __VA_ARGS__);                                 \
   } while (0)
 
 #if defined(__GNUC__)
@@ -242,49 +370,47 @@
  #define STATIC_ASSERT(cond, msg) typedef char msg [(cond)?1:-1] UNUSED
 #endif
 
-#define PARSEBGP_DUMP_INT(depth, name, val)                                    \
+#define PARSEBGP_DUMP_INT(sink, depth, name, val)                              \
   do {                                                                         \
     STATIC_ASSERT(sizeof(val) <= sizeof(int), val_is_larger_than_int);         \
-    PARSEBGP_DUMP_INFO(depth, name ": %*d\n", 20 - (int)sizeof(name ":"),      \
-                       (int)val);                                              \
+    PARSEBGP_DUMP_INFO(sink, depth, name ": %*d\n",                            \
+                       20 - (int)sizeof(name ":"), (int)val);                  \
   } while (0)
 
-#define PARSEBGP_DUMP_VAL(depth, name, fmt, val)                               \
-  PARSEBGP_DUMP_INFO(depth, name ": %*" fmt "\n",                              \
+#define PARSEBGP_DUMP_VAL(sink, depth, name, fmt, val)                         \
+  PARSEBGP_DUMP_INFO(sink, depth, name ": %*" fmt "\n",                        \
                      20 - (int)sizeof(name ":"), val)
 
-#define PARSEBGP_DUMP_IP(depth, name, afi, ipaddr)                             \
+#define PARSEBGP_DUMP_IP(sink, depth, name, afi, ipaddr)                       \
   do {                                                                         \
-    int mapping[] = {-1, AF_INET, AF_INET6};                                   \
-    char ip_buf[INET6_ADDRSTRLEN] = "[invalid IP]";                            \
-    inet_ntop(mapping[afi], ipaddr, ip_buf, INET6_ADDRSTRLEN);                 \
-    PARSEBGP_DUMP_INFO(depth, name ": %*s\n", 20 - (int)sizeof(name ":"),      \
-                       ip_buf);                                                \
+    char ip_buf[PARSEBGP_FORMAT_IP_LEN];                                       \
+    parsebgp_format_ip(ip_buf, (afi), (const uint8_t *)(ipaddr));              \
+    PARSEBGP_DUMP_INFO(sink, depth, name ": %*s\n",                            \
+                       20 - (int)sizeof(name ":"), ip_buf);                    \
   } while (0)
 
-#define PARSEBGP_DUMP_PFX(depth, name, afi, ipaddr, len)                       \
+#define PARSEBGP_DUMP_PFX(sink, depth, name, afi, ipaddr, len)                 \
   do {                                                                         \
-    int mapping[] = {-1, AF_INET, AF_INET6};                                   \
-    char ip_buf[INET6_ADDRSTRLEN] = "[invalid IP]";                            \
-    inet_ntop(mapping[afi], ipaddr, ip_buf, INET6_ADDRSTRLEN);                 \
-    PARSEBGP_DUMP_INFO(depth, name ": %*s/%d\n", 20 - (int)sizeof(name ":"),   \
-                       ip_buf, len);                                           \
+    char ip_buf[PARSEBGP_FORMAT_IP_LEN];                                       \
+    parsebgp_format_ip(ip_buf, (afi), (const uint8_t *)(ipaddr));              \
+    PARSEBGP_DUMP_INFO(sink, depth, name ": %*s/%d\n",                         \
+                       20 - (int)sizeof(name ":"), ip_buf, len);               \
   } while (0)
 
-#define PARSEBGP_DUMP_DATA(depth, name, data, len)                             \
+#define PARSEBGP_DUMP_DATA(sink, depth, name, data, len)                       \
   do {                                                                         \
     int _byte;                                                                 \
-    PARSEBGP_DUMP_INFO(depth, name ": ");                                      \
+    PARSEBGP_DUMP_INFO(sink, depth, name ": ");                                \
     if ((len) == 0) {                                                          \
-      fputs("NONE\n", stdout);                                                 \
+      parsebgp_sink_puts((sink), "NONE\n");                                    \
     } else {                                                                   \
       for (_byte = 0; _byte < (len); _byte++) {                                \
         if (_byte != 0) {                                                      \
-          fputs(" ", stdout);                                                  \
+          parsebgp_sink_puts((sink), " ");                                     \
         }                                                                      \
-        printf("%02X", (data)[_byte]);                                         \
+        parsebgp_sink_printf((sink), "%02X", (data)[_byte]);                   \
       }                                                                        \
-      fputs("\n", stdout);                                                     \
+      parsebgp_sink_puts((sink), "\n");                                        \
     }                                                                          \
   } while (0)
 
@@ -308,9 +434,86 @@ parsebgp_error_t parsebgp_decode_prefix(uint8_t pfx_len, uint8_t *dst,
                                         const uint8_t *buf, size_t *buf_len,
                                         size_t max_pfx_len);
 
+/**
+ * Convenience function to write a prefix address into a buffer using variable
+ * length encoding (the inverse of parsebgp_decode_prefix)
+ *
+ * @param pfx_len       Number of bits in the prefix mask
+ * @param src           Prefix address to encode
+ * @param buf           Buffer to write the prefix into
+ * @param buf_len       Total length of the buffer (to prevent overrun). Updated
+ *                      to the number of bytes written to the buffer if
+ *                      successful.
+ * @param max_pfx_len   Maximum allowed pfx_len (32 for IPv4, 128 for IPv6)
+ * @return PARSEBGP_OK if successful, or an error code otherwise. buf_len is
+ * only updated if PARSEBGP_OK is returned.
+ *
+ * Only the pfx_len bits of the address are written, any trailing bits in the
+ * last byte are zeroed. The prefix length itself is not written.
+ */
+parsebgp_error_t parsebgp_encode_prefix(uint8_t pfx_len, const uint8_t *src,
+                                        uint8_t *buf, size_t *buf_len,
+                                        size_t max_pfx_len);
+
+/**
+ * Compute a fast (non-cryptographic) 64-bit hash of a byte buffer
+ *
+ * @param buf           Pointer to the data to hash
+ * @param len           Number of bytes to hash
+ * @param seed          Seed value (allows distinct hashes of the same data)
+ * @return 64-bit hash of the buffer
+ */
+uint64_t parsebgp_hash_bytes(const uint8_t *buf, size_t len, uint64_t seed);
+
 /** Convenience function to allocate and zero memory */
 void *malloc_zero(const size_t size);
 
+#ifdef PARSEBGP_ALLOC_PROFILE
+/** Allocate zeroed memory and attribute it to the given site (use
+    malloc_zero, which is redirected here, rather than calling this) */
+void *parsebgp_alloc_profile_malloc_zero(size_t size, const char *file,
+                                         int line, const char *func,
+                                         const char *what);
+
+/** Attribute a (re)allocation from old_size to new_size bytes to the given
+    site */
+void parsebgp_alloc_profile_realloc(size_t old_size, size_t new_size,
+                                    const char *file, int line,
+                                    const char *func, const char *what);
+
+/** Attribute a free to the given site */
+void parsebgp_alloc_profile_free(const char *file, int line, const char *func,
+                                 const char *what);
+
+/** Allocate zeroed memory, labelling the site with the given expression */
+#define PARSEBGP_MALLOC_ZERO_SITE(size, what)                                  \
+  parsebgp_alloc_profile_malloc_zero((size), __FILE__, __LINE__, __func__,     \
+                                     (what))
+
+#define malloc_zero(size) PARSEBGP_MALLOC_ZERO_SITE(size, #size)
+
+/** Record a (re)allocation of what from old_size to new_size bytes made
+    outside of PARSEBGP_MAYBE_REALLOC */
+#define PARSEBGP_ALLOC_PROFILE_REALLOC(what, old_size, new_size)               \
+  parsebgp_alloc_profile_realloc((old_size), (new_size), __FILE__, __LINE__,   \
+                                 __func__, (what))
+
+/** Free memory allocated by a decoder, recording the free */
+#define PARSEBGP_FREE(ptr)                                                     \
+  do {                                                                         \
+    if ((ptr) != NULL) {                                                       \
+      parsebgp_alloc_profile_free(__FILE__, __LINE__, __func__, #ptr);         \
+    }                                                                          \
+    free(ptr);                                                                 \
+  } while (0)
+#else
+#define PARSEBGP_MALLOC_ZERO_SITE(size, what) malloc_zero(size)
+#define PARSEBGP_ALLOC_PROFILE_REALLOC(what, old_size, new_size)               \
+  do {                                                                         \
+  } while (0)
+#define PARSEBGP_FREE(ptr) free(ptr)
+#endif
+
 /** Conditionally reallocate memory if not enough is currently allocated.
  *
  * Note: Relies on the type of ptr to determine the correct size to allocate.
@@ -318,9 +521,12 @@ void *malloc_zero(const size_t size);
 #define PARSEBGP_MAYBE_REALLOC(ptr, alloc_len, len)                            \
   do {                                                                         \
     if ((alloc_len) < (len)) {                                                 \
+      PARSEBGP_STATS_REALLOC();                                                \
       if (((ptr) = realloc((ptr), sizeof(*(ptr)) * (len))) == NULL) {          \
         return PARSEBGP_MALLOC_FAILURE;                                        \
       }                                                                        \
+      PARSEBGP_ALLOC_PROFILE_REALLOC(#ptr, sizeof(*(ptr)) * (alloc_len),       \
+                                     sizeof(*(ptr)) * (len));                  \
       memset(ptr + alloc_len, 0, sizeof(*(ptr)) * ((len) - (alloc_len)));      \
       alloc_len = len;                                                         \
     }                                                                          \
@@ -328,7 +534,8 @@ void *malloc_zero(const size_t size);
 
 #define PARSEBGP_MAYBE_MALLOC_ZERO(ptr)                                        \
   do {                                                                         \
-    if ((ptr) == NULL && ((ptr) = malloc_zero(sizeof(*(ptr)))) == NULL) {      \
+    if ((ptr) == NULL &&                                                       \
+        ((ptr) = PARSEBGP_MALLOC_ZERO_SITE(sizeof(*(ptr)), #ptr)) == NULL) {   \
       return PARSEBGP_MALLOC_FAILURE;                                          \
     }                                                                          \
   } while (0)
@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_lpm.h"
+#include "parsebgp_error.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of address bits used to index the IPv4 root level */
+#define IPV4_ROOT_BITS 24
+
+/** Number of address bits used to index each further IPv4 level */
+#define IPV4_STRIDE 8
+
+/** Number of address bits used to index the IPv6 root level */
+#define IPV6_ROOT_BITS 16
+
+/** Number of address bits used to index each further IPv6 level (16 entries
+    of 4 bytes fill a 64 byte cache line) */
+#define IPV6_STRIDE 4
+
+/** Flag set on entries that refer to a child node rather than an info ID */
+#define ENT_CHILD 0x80000000U
+
+/** Initial number of child nodes allocated per table */
+#define NODES_ALLOC_INIT 256
+
+/** Initial number of allocated infos */
+#define INFOS_ALLOC_INIT 1024
+
+/** Initial number of prefix hash buckets (must be a power of two, and at least
+    twice INFOS_ALLOC_INIT) */
+#define PREFIX_BUCKETS_INIT 2048
+
+/** Number of addresses resolved together by the batch lookups */
+#define BATCH_SIZE 16
+
+/** Index of the table for the given AFI (-1 if unsupported) */
+#define AFI_IDX(afi)                                                           \
+  ((afi) == PARSEBGP_BGP_AFI_IPV4 ? 0 : ((afi) == PARSEBGP_BGP_AFI_IPV6 ? 1 : -1))
+
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch((addr), 0, 0)
+#else
+#define PREFETCH(addr)
+#endif
+
+/** Multibit trie
+ *
+ * Each entry is either zero (no covering prefix), the ID of the info of the
+ * most specific covering prefix, or ENT_CHILD plus the offset of a child node
+ * in the node pool. A child node has (1 << stride) entries and resolves the
+ * next stride bits of the address.
+ */
+typedef struct lpm_table {
+
+  /** Root level entries (1 << root_bits, NULL until the first insert) */
+  uint32_t *root;
+
+  /** Pool of child node entries */
+  uint32_t *nodes;
+
+  /** Number of allocated child node entries */
+  uint32_t _nodes_alloc_cnt;
+
+  /** Number of child node entries in use */
+  uint32_t nodes_cnt;
+
+  /** Number of prefixes in the table */
+  uint64_t prefixes_cnt;
+
+  /** Number of address bits used by the root level */
+  uint8_t root_bits;
+
+  /** Number of address bits used by each child level */
+  uint8_t stride;
+
+  /** Length of an address (in bytes) */
+  uint8_t addr_len;
+
+} lpm_table_t;
+
+/** Exact-match key of an indexed prefix */
+typedef struct lpm_prefix {
+
+  /** Prefix address (masked to len bits) */
+  uint8_t addr[16];
+
+  /** Prefix length */
+  uint8_t len;
+
+  /** Index of the table the prefix is in */
+  uint8_t afi_idx;
+
+} lpm_prefix_t;
+
+struct parsebgp_lpm {
+
+  /** Tables (IPv4 and IPv6) */
+  lpm_table_t tables[2];
+
+  /** Array of prefix infos (index is the ID, zero is unused) */
+  parsebgp_lpm_info_t *infos;
+
+  /** Number of allocated infos */
+  uint32_t _infos_alloc_cnt;
+
+  /** Number of info IDs handed out (including the unused zero) */
+  uint32_t infos_cnt;
+
+  /** Array of prefix keys (index is the info ID) */
+  lpm_prefix_t *prefixes;
+
+  /** Number of allocated prefix keys */
+  uint32_t _prefixes_alloc_cnt;
+
+  /** Prefix hash table (info ID, zero if empty) used to find prefixes that are
+      already indexed (they may be entirely shadowed by more specifics) */
+  uint32_t *prefix_buckets;
+
+  /** Number of prefix buckets minus one */
+  uint32_t prefix_buckets_mask;
+
+  /** Scratch buffer used to find the origin ASN of a RIB message */
+  uint32_t *origins;
+
+  /** Number of allocated scratch origins */
+  int _origins_alloc_cnt;
+};
+
+/** Extract cnt (at most 24) bits starting at bit pos of an address */
+static inline uint32_t addr_bits(const uint8_t *addr, int addr_len, int pos,
+                                 int cnt)
+{
+  int byte = pos >> 3;
+  uint32_t v = 0;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    v <<= 8;
+    if (byte + i < addr_len) {
+      v |= addr[byte + i];
+    }
+  }
+  return (v << (pos & 7)) >> (32 - cnt);
+}
+
+/** Length of the prefix an entry resolves to (-1 if none) */
+static inline int ent_len(const parsebgp_lpm_t *lpm, uint32_t ent)
+{
+  return ent == 0 ? -1 : lpm->infos[ent].prefix_len;
+}
+
+/** Point the given entries (and their children) at the info with the given ID,
+    unless they already resolve to a more specific prefix */
+static void paint(parsebgp_lpm_t *lpm, lpm_table_t *tbl, uint32_t *ents,
+                  uint32_t cnt, int len, uint32_t id)
+{
+  uint32_t i;
+
+  for (i = 0; i < cnt; i++) {
+    if (ents[i] & ENT_CHILD) {
+      paint(lpm, tbl, &tbl->nodes[ents[i] & ~ENT_CHILD], 1U << tbl->stride,
+            len, id);
+    } else if (ent_len(lpm, ents[i]) < len) {
+      ents[i] = id;
+    }
+  }
+}
+
+static parsebgp_error_t node_alloc(lpm_table_t *tbl, uint32_t ent,
+                                   uint32_t *offp)
+{
+  uint32_t node_cnt = 1U << tbl->stride;
+  uint32_t alloc_cnt;
+  uint32_t i;
+
+  if (tbl->nodes_cnt + node_cnt >= ENT_CHILD) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  if (tbl->nodes_cnt + node_cnt > tbl->_nodes_alloc_cnt) {
+    alloc_cnt = tbl->_nodes_alloc_cnt == 0 ? node_cnt * NODES_ALLOC_INIT
+                                           : tbl->_nodes_alloc_cnt * 2;
+    PARSEBGP_MAYBE_REALLOC(tbl->nodes, tbl->_nodes_alloc_cnt, alloc_cnt);
+  }
+  // a new node inherits the prefix that covered it in its parent
+  for (i = 0; i < node_cnt; i++) {
+    tbl->nodes[tbl->nodes_cnt + i] = ent;
+  }
+  *offp = tbl->nodes_cnt;
+  tbl->nodes_cnt += node_cnt;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t table_insert(parsebgp_lpm_t *lpm, lpm_table_t *tbl,
+                                     const uint8_t *prefix, uint8_t len,
+                                     uint32_t id)
+{
+  uint32_t *ents;
+  uint32_t cur = 0, off, idx, span;
+  int pos = 0, bits = tbl->root_bits;
+  parsebgp_error_t err;
+
+  if (tbl->root == NULL &&
+      (tbl->root = malloc_zero(sizeof(uint32_t) << tbl->root_bits)) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  ents = tbl->root;
+
+  // find (or create) the node that the prefix ends in
+  while (len > pos + bits) {
+    idx = addr_bits(prefix, tbl->addr_len, pos, bits);
+    if ((ents[idx] & ENT_CHILD) == 0) {
+      if ((err = node_alloc(tbl, ents[idx], &off)) != PARSEBGP_OK) {
+        return err;
+      }
+      // the pool may have moved
+      ents = pos == 0 ? tbl->root : &tbl->nodes[cur];
+      ents[idx] = ENT_CHILD | off;
+    }
+    cur = ents[idx] & ~ENT_CHILD;
+    ents = &tbl->nodes[cur];
+    pos += bits;
+    bits = tbl->stride;
+  }
+
+  // and paint all the entries it covers
+  span = pos + bits - len;
+  idx = addr_bits(prefix, tbl->addr_len, pos, bits) & ~((1U << span) - 1);
+  paint(lpm, tbl, &ents[idx], 1U << span, len, id);
+  return PARSEBGP_OK;
+}
+
+static inline uint32_t table_lookup(const lpm_table_t *tbl,
+                                    const uint8_t *addr)
+{
+  uint32_t ent;
+  int pos, bits;
+
+  if (tbl->root == NULL) {
+    return 0;
+  }
+  ent = tbl->root[addr_bits(addr, tbl->addr_len, 0, tbl->root_bits)];
+  pos = tbl->root_bits;
+  bits = tbl->stride;
+  while (ent & ENT_CHILD) {
+    ent = tbl->nodes[(ent & ~ENT_CHILD) +
+                     addr_bits(addr, tbl->addr_len, pos, bits)];
+    pos += bits;
+  }
+  return ent;
+}
+
+static void table_init(lpm_table_t *tbl, uint8_t root_bits, uint8_t stride,
+                       uint8_t addr_len)
+{
+  tbl->root_bits = root_bits;
+  tbl->stride = stride;
+  tbl->addr_len = addr_len;
+}
+
+static void table_destroy(lpm_table_t *tbl)
+{
+  free(tbl->root);
+  free(tbl->nodes);
+}
+
+static inline uint32_t prefix_bucket(const parsebgp_lpm_t *lpm,
+                                     const lpm_prefix_t *key)
+{
+  return (uint32_t)parsebgp_hash_bytes((const uint8_t *)key,
+                                       sizeof(lpm_prefix_t), 0) &
+         lpm->prefix_buckets_mask;
+}
+
+/** Find the bucket of a prefix (or the empty bucket it would go in) */
+static uint32_t prefix_find(const parsebgp_lpm_t *lpm, const lpm_prefix_t *key)
+{
+  uint32_t b = prefix_bucket(lpm, key);
+  uint32_t id;
+
+  while ((id = lpm->prefix_buckets[b]) != 0 &&
+         memcmp(&lpm->prefixes[id], key, sizeof(lpm_prefix_t)) != 0) {
+    b = (b + 1) & lpm->prefix_buckets_mask;
+  }
+  return b;
+}
+
+static parsebgp_error_t prefix_rehash(parsebgp_lpm_t *lpm, uint32_t buckets)
+{
+  uint32_t *new_buckets;
+  uint32_t id;
+
+  if ((new_buckets = malloc_zero(sizeof(uint32_t) * buckets)) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  free(lpm->prefix_buckets);
+  lpm->prefix_buckets = new_buckets;
+  lpm->prefix_buckets_mask = buckets - 1;
+  for (id = 1; id < lpm->infos_cnt; id++) {
+    lpm->prefix_buckets[prefix_find(lpm, &lpm->prefixes[id])] = id;
+  }
+  return PARSEBGP_OK;
+}
+
+static int origin_cmp(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static parsebgp_error_t
+apply_afi_safi_rib(parsebgp_lpm_t *lpm, parsebgp_bgp_afi_t afi,
+                   const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg)
+{
+  const parsebgp_bgp_update_path_attrs_t *path_attrs;
+  const parsebgp_bgp_update_as_path_t *as_path;
+  uint32_t origin = 0;
+  int origins_cnt = 0;
+  int i, run, best = 0;
+
+  PARSEBGP_MAYBE_REALLOC(lpm->origins, lpm->_origins_alloc_cnt,
+                         msg->entry_count);
+  for (i = 0; i < msg->entry_count; i++) {
+    path_attrs = msg->entries[i].path_attrs_ptr;
+    if (path_attrs == NULL) {
+      continue;
+    }
+    as_path = path_attrs->as_path;
+    if (as_path == NULL &&
+        path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH].type ==
+          PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH) {
+      as_path =
+        path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH].data.as_path;
+    }
+    if (as_path != NULL && as_path->origin_asn != 0) {
+      lpm->origins[origins_cnt++] = as_path->origin_asn;
+    }
+  }
+
+  // the origin seen by the most peers (the lowest ASN wins a tie)
+  qsort(lpm->origins, origins_cnt, sizeof(uint32_t), origin_cmp);
+  for (i = 0; i < origins_cnt; i += run) {
+    for (run = 1;
+         i + run < origins_cnt && lpm->origins[i + run] == lpm->origins[i];
+         run++)
+      ;
+    if (run > best) {
+      best = run;
+      origin = lpm->origins[i];
+    }
+  }
+
+  return parsebgp_lpm_insert(lpm, afi, msg->prefix, msg->prefix_len, origin,
+                             msg->entry_count);
+}
+
+/* -------------------- Public API -------------------- */
+
+parsebgp_lpm_t *parsebgp_lpm_create(void)
+{
+  parsebgp_lpm_t *lpm;
+
+  if ((lpm = malloc_zero(sizeof(parsebgp_lpm_t))) == NULL) {
+    return NULL;
+  }
+  if ((lpm->infos = malloc_zero(sizeof(parsebgp_lpm_info_t) *
+                                INFOS_ALLOC_INIT)) == NULL ||
+      (lpm->prefixes =
+         malloc_zero(sizeof(lpm_prefix_t) * INFOS_ALLOC_INIT)) == NULL ||
+      prefix_rehash(lpm, PREFIX_BUCKETS_INIT) != PARSEBGP_OK) {
+    parsebgp_lpm_destroy(lpm);
+    return NULL;
+  }
+  lpm->_infos_alloc_cnt = INFOS_ALLOC_INIT;
+  lpm->_prefixes_alloc_cnt = INFOS_ALLOC_INIT;
+  // ID zero is never used
+  lpm->infos_cnt = 1;
+  table_init(&lpm->tables[0], IPV4_ROOT_BITS, IPV4_STRIDE, 4);
+  table_init(&lpm->tables[1], IPV6_ROOT_BITS, IPV6_STRIDE, 16);
+  return lpm;
+}
+
+void parsebgp_lpm_destroy(parsebgp_lpm_t *lpm)
+{
+  if (lpm == NULL) {
+    return;
+  }
+  table_destroy(&lpm->tables[0]);
+  table_destroy(&lpm->tables[1]);
+  free(lpm->infos);
+  free(lpm->prefixes);
+  free(lpm->prefix_buckets);
+  free(lpm->origins);
+  free(lpm);
+}
+
+parsebgp_error_t parsebgp_lpm_insert(parsebgp_lpm_t *lpm,
+                                     parsebgp_bgp_afi_t afi,
+                                     const uint8_t *prefix, uint8_t prefix_len,
+                                     uint32_t origin_asn, uint16_t peers_cnt)
+{
+  int afi_idx = AFI_IDX(afi);
+  lpm_table_t *tbl;
+  parsebgp_lpm_info_t *info;
+  lpm_prefix_t key;
+  uint32_t id, b, alloc_cnt;
+  parsebgp_error_t err;
+
+  if (afi_idx < 0 || prefix_len > lpm->tables[afi_idx].addr_len * 8) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  tbl = &lpm->tables[afi_idx];
+
+  memset(&key, 0, sizeof(key));
+  memcpy(key.addr, prefix, (prefix_len + 7) / 8);
+  if (prefix_len % 8 != 0) {
+    key.addr[prefix_len / 8] &= 0xFF << (8 - prefix_len % 8);
+  }
+  key.len = prefix_len;
+  key.afi_idx = afi_idx;
+
+  b = prefix_find(lpm, &key);
+  if ((id = lpm->prefix_buckets[b]) != 0) {
+    // already indexed, so the table entries are already right
+    info = &lpm->infos[id];
+    info->origin_asn = origin_asn;
+    info->peers_cnt = peers_cnt;
+    return PARSEBGP_OK;
+  }
+
+  if (lpm->infos_cnt == ENT_CHILD) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  if (lpm->infos_cnt == lpm->_infos_alloc_cnt) {
+    alloc_cnt = lpm->_infos_alloc_cnt * 2;
+    PARSEBGP_MAYBE_REALLOC(lpm->infos, lpm->_infos_alloc_cnt, alloc_cnt);
+    PARSEBGP_MAYBE_REALLOC(lpm->prefixes, lpm->_prefixes_alloc_cnt, alloc_cnt);
+  }
+
+  // the info is filled in first so that painting sees its length
+  id = lpm->infos_cnt;
+  info = &lpm->infos[id];
+  info->origin_asn = origin_asn;
+  info->peers_cnt = peers_cnt;
+  info->prefix_len = prefix_len;
+  lpm->prefixes[id] = key;
+
+  if ((err = table_insert(lpm, tbl, key.addr, prefix_len, id)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  lpm->infos_cnt++;
+  tbl->prefixes_cnt++;
+
+  // keep the load factor at or below one half
+  if (lpm->infos_cnt * 2 > lpm->prefix_buckets_mask + 1) {
+    return prefix_rehash(lpm, (lpm->prefix_buckets_mask + 1) * 2);
+  }
+  lpm->prefix_buckets[b] = id;
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t parsebgp_lpm_apply(parsebgp_lpm_t *lpm,
+                                    const parsebgp_msg_t *msg)
+{
+  const parsebgp_mrt_msg_t *mrt;
+
+  if (msg->type != PARSEBGP_MSG_TYPE_MRT) {
+    return PARSEBGP_OK;
+  }
+  mrt = msg->types.mrt;
+  if (mrt->type != PARSEBGP_MRT_TYPE_TABLE_DUMP_V2) {
+    return PARSEBGP_OK;
+  }
+
+  switch (mrt->subtype) {
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+    return apply_afi_safi_rib(lpm, PARSEBGP_BGP_AFI_IPV4,
+                              &mrt->types.table_dump_v2->afi_safi_rib);
+
+  case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+    return apply_afi_safi_rib(lpm, PARSEBGP_BGP_AFI_IPV6,
+                              &mrt->types.table_dump_v2->afi_safi_rib);
+
+  default:
+    // multicast and generic RIBs are not indexed
+    return PARSEBGP_OK;
+  }
+}
+
+const parsebgp_lpm_info_t *parsebgp_lpm_lookup(const parsebgp_lpm_t *lpm,
+                                              parsebgp_bgp_afi_t afi,
+                                              const uint8_t *addr)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint32_t ent;
+
+  if (afi_idx < 0 || (ent = table_lookup(&lpm->tables[afi_idx], addr)) == 0) {
+    return NULL;
+  }
+  return &lpm->infos[ent];
+}
+
+void parsebgp_lpm_lookup_ipv4_batch(const parsebgp_lpm_t *lpm,
+                                    const uint32_t *addrs, size_t cnt,
+                                    const parsebgp_lpm_info_t **results)
+{
+  const lpm_table_t *tbl = &lpm->tables[0];
+  uint32_t ents[BATCH_SIZE];
+  size_t base, i, n;
+
+  if (tbl->root == NULL) {
+    memset(results, 0, sizeof(*results) * cnt);
+    return;
+  }
+
+  for (base = 0; base < cnt; base += n) {
+    n = cnt - base < BATCH_SIZE ? cnt - base : BATCH_SIZE;
+
+    // issue all the root loads before using any of them
+    for (i = 0; i < n; i++) {
+      PREFETCH(&tbl->root[addrs[base + i] >> (32 - IPV4_ROOT_BITS)]);
+    }
+    for (i = 0; i < n; i++) {
+      ents[i] = tbl->root[addrs[base + i] >> (32 - IPV4_ROOT_BITS)];
+      if (ents[i] & ENT_CHILD) {
+        PREFETCH(&tbl->nodes[(ents[i] & ~ENT_CHILD) +
+                             (addrs[base + i] & ((1U << IPV4_STRIDE) - 1))]);
+      }
+    }
+    // IPV4_ROOT_BITS + IPV4_STRIDE is 32, so there is at most one more level
+    for (i = 0; i < n; i++) {
+      if (ents[i] & ENT_CHILD) {
+        ents[i] = tbl->nodes[(ents[i] & ~ENT_CHILD) +
+                             (addrs[base + i] & ((1U << IPV4_STRIDE) - 1))];
+      }
+      results[base + i] = ents[i] == 0 ? NULL : &lpm->infos[ents[i]];
+    }
+  }
+}
+
+void parsebgp_lpm_lookup_ipv6_batch(const parsebgp_lpm_t *lpm,
+                                    const uint8_t (*addrs)[16], size_t cnt,
+                                    const parsebgp_lpm_info_t **results)
+{
+  const lpm_table_t *tbl = &lpm->tables[1];
+  uint32_t ents[BATCH_SIZE];
+  const uint32_t *next[BATCH_SIZE];
+  size_t base, i, n;
+  int pos, active;
+
+  if (tbl->root == NULL) {
+    memset(results, 0, sizeof(*results) * cnt);
+    return;
+  }
+
+  for (base = 0; base < cnt; base += n) {
+    n = cnt - base < BATCH_SIZE ? cnt - base : BATCH_SIZE;
+
+    for (i = 0; i < n; i++) {
+      next[i] = &tbl->root[addr_bits(addrs[base + i], 16, 0, IPV6_ROOT_BITS)];
+      PREFETCH(next[i]);
+    }
+    for (i = 0; i < n; i++) {
+      ents[i] = *next[i];
+    }
+
+    // walk the whole group down one level at a time
+    for (pos = IPV6_ROOT_BITS;; pos += IPV6_STRIDE) {
+      active = 0;
+      for (i = 0; i < n; i++) {
+        if (ents[i] & ENT_CHILD) {
+          next[i] = &tbl->nodes[(ents[i] & ~ENT_CHILD) +
+                                addr_bits(addrs[base + i], 16, pos,
+                                          IPV6_STRIDE)];
+          PREFETCH(next[i]);
+          active = 1;
+        }
+      }
+      if (active == 0) {
+        break;
+      }
+      for (i = 0; i < n; i++) {
+        if (ents[i] & ENT_CHILD) {
+          ents[i] = *next[i];
+        }
+      }
+    }
+
+    for (i = 0; i < n; i++) {
+      results[base + i] = ents[i] == 0 ? NULL : &lpm->infos[ents[i]];
+    }
+  }
+}
+
+void parsebgp_lpm_get_stats(const parsebgp_lpm_t *lpm,
+                            parsebgp_lpm_stats_t *stats)
+{
+  const lpm_table_t *tbl;
+  int i;
+
+  stats->ipv4_prefixes_cnt = lpm->tables[0].prefixes_cnt;
+  stats->ipv6_prefixes_cnt = lpm->tables[1].prefixes_cnt;
+  stats->bytes =
+    sizeof(parsebgp_lpm_t) +
+    (uint64_t)lpm->_infos_alloc_cnt * sizeof(parsebgp_lpm_info_t) +
+    (uint64_t)lpm->_prefixes_alloc_cnt * sizeof(lpm_prefix_t) +
+    (uint64_t)(lpm->prefix_buckets_mask + 1) * sizeof(uint32_t);
+  for (i = 0; i < 2; i++) {
+    tbl = &lpm->tables[i];
+    if (tbl->root != NULL) {
+      stats->bytes += sizeof(uint32_t) << tbl->root_bits;
+    }
+    stats->bytes += (uint64_t)tbl->_nodes_alloc_cnt * sizeof(uint32_t);
+  }
+}
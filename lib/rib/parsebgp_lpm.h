@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_LPM_H
+#define __PARSEBGP_LPM_H
+
+#include "parsebgp.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * Longest-Prefix-Match Index
+ *
+ * An LPM index maps addresses to the most specific covering prefix, along
+ * with the origin ASN of the prefix and the number of peers that it was
+ * visible to. It is built by streaming TABLE_DUMP_V2 RIB dumps into it (see
+ * parsebgp_lpm_apply), or by inserting prefixes directly.
+ *
+ * IPv4 uses a DIR-24-8 table (one memory access for prefixes up to /24, two
+ * for longer ones), and IPv6 a multibit trie (a 16-bit first level followed
+ * by 4-bit strides).
+ */
+typedef struct parsebgp_lpm parsebgp_lpm_t;
+
+/**
+ * Information about an indexed prefix
+ */
+typedef struct parsebgp_lpm_info {
+
+  /** Origin ASN (the origin seen by the most peers, or 0 if unknown) */
+  uint32_t origin_asn;
+
+  /** Number of peers that the prefix was visible to */
+  uint16_t peers_cnt;
+
+  /** Length of the prefix mask */
+  uint8_t prefix_len;
+
+} parsebgp_lpm_info_t;
+
+/**
+ * LPM index statistics
+ */
+typedef struct parsebgp_lpm_stats {
+
+  /** Number of IPv4 prefixes inserted */
+  uint64_t ipv4_prefixes_cnt;
+
+  /** Number of IPv6 prefixes inserted */
+  uint64_t ipv6_prefixes_cnt;
+
+  /** Memory used by the index (in bytes) */
+  uint64_t bytes;
+
+} parsebgp_lpm_stats_t;
+
+/** Create an empty LPM index */
+parsebgp_lpm_t *parsebgp_lpm_create(void);
+
+/** Destroy an LPM index */
+void parsebgp_lpm_destroy(parsebgp_lpm_t *lpm);
+
+/**
+ * Insert a prefix into the index
+ *
+ * @param lpm           Pointer to the index
+ * @param afi           AFI of the prefix (parsebgp_bgp_afi_t)
+ * @param prefix        Pointer to the prefix address
+ * @param prefix_len    Length of the prefix mask
+ * @param origin_asn    Origin ASN of the prefix
+ * @param peers_cnt     Number of peers that the prefix was visible to
+ * @return PARSEBGP_OK if the prefix was inserted, or an error code otherwise
+ *
+ * If the prefix is already in the index, its information is replaced.
+ */
+parsebgp_error_t parsebgp_lpm_insert(parsebgp_lpm_t *lpm,
+                                     parsebgp_bgp_afi_t afi,
+                                     const uint8_t *prefix, uint8_t prefix_len,
+                                     uint32_t origin_asn, uint16_t peers_cnt);
+
+/**
+ * Insert the prefix of a parsed TABLE_DUMP_V2 RIB message into the index
+ *
+ * @param lpm           Pointer to the index
+ * @param msg           Pointer to the parsed message
+ * @return PARSEBGP_OK if the message was applied (or ignored), or an error code
+ * otherwise
+ *
+ * Only IPv4 and IPv6 unicast RIB messages are used, all other messages are
+ * ignored. The origin ASN is taken from the AS Path summary of each RIB entry
+ * (so AS_PATH must not be raw-parsed, and the bgp.as_path_summary option can
+ * be used to skip the rest of the AS Path parsing), and the visibility is the
+ * number of RIB entries.
+ */
+parsebgp_error_t parsebgp_lpm_apply(parsebgp_lpm_t *lpm,
+                                    const parsebgp_msg_t *msg);
+
+/**
+ * Find the most specific prefix that covers an address
+ *
+ * @param lpm           Pointer to the index
+ * @param afi           AFI of the address (parsebgp_bgp_afi_t)
+ * @param addr          Pointer to the address (4 or 16 bytes)
+ * @return pointer to the information about the prefix, or NULL if no prefix
+ * covers the address. Only valid until the index is next modified.
+ */
+const parsebgp_lpm_info_t *parsebgp_lpm_lookup(const parsebgp_lpm_t *lpm,
+                                              parsebgp_bgp_afi_t afi,
+                                              const uint8_t *addr);
+
+/**
+ * Look up a batch of IPv4 addresses
+ *
+ * @param lpm           Pointer to the index
+ * @param addrs         Array of (cnt) IPv4 addresses (in host byte order)
+ * @param cnt           Number of addresses
+ * @param [out] results Array of (cnt) pointers to fill (see
+ *                      parsebgp_lpm_lookup)
+ *
+ * Table accesses for each group of addresses are prefetched before they are
+ * resolved, so this is much faster than calling parsebgp_lpm_lookup for each
+ * address when the table does not fit in cache.
+ */
+void parsebgp_lpm_lookup_ipv4_batch(const parsebgp_lpm_t *lpm,
+                                    const uint32_t *addrs, size_t cnt,
+                                    const parsebgp_lpm_info_t **results);
+
+/**
+ * Look up a batch of IPv6 addresses
+ *
+ * @param lpm           Pointer to the index
+ * @param addrs         Array of (cnt) IPv6 addresses
+ * @param cnt           Number of addresses
+ * @param [out] results Array of (cnt) pointers to fill (see
+ *                      parsebgp_lpm_lookup)
+ */
+void parsebgp_lpm_lookup_ipv6_batch(const parsebgp_lpm_t *lpm,
+                                    const uint8_t (*addrs)[16], size_t cnt,
+                                    const parsebgp_lpm_info_t **results);
+
+/** Get LPM index statistics */
+void parsebgp_lpm_get_stats(const parsebgp_lpm_t *lpm,
+                            parsebgp_lpm_stats_t *stats);
+
+#endif /* __PARSEBGP_LPM_H */
@@ -0,0 +1,1403 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_rib.h"
+#include "parsebgp_bgp_update_impl.h"
+#include "parsebgp_error.h"
+#include "parsebgp_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Initial number of hash buckets for the interned attribute sets (must be a
+    power of two) */
+#define ATTRS_BUCKETS_INIT 1024
+
+/** Initial number of allocated attribute sets */
+#define ATTRS_ALLOC_INIT 1024
+
+/** Initial number of hash buckets for the peer table (must be a power of
+    two) */
+#define PEER_BUCKETS_INIT 64
+
+/** Initial number of allocated peers */
+#define PEERS_ALLOC_INIT 32
+
+/** Initial number of routes allocated per prefix */
+#define ROUTES_ALLOC_INIT 4
+
+/** Index of the tree for the given AFI (-1 if unsupported) */
+#define AFI_IDX(afi)                                                           \
+  ((afi) == PARSEBGP_BGP_AFI_IPV4 ? 0 : ((afi) == PARSEBGP_BGP_AFI_IPV6 ? 1 : -1))
+
+/** Maximum prefix length for a tree index */
+#define MAX_PFX_LEN(afi_idx) ((afi_idx) == 0 ? 32 : 128)
+
+/** Get bit i (0 is the most-significant bit) of an address */
+#define ADDR_BIT(addr, i) (((addr)[(i) >> 3] >> (7 - ((i)&7))) & 1)
+
+/** Radix tree node */
+typedef struct rib_node {
+
+  /** Prefix address (masked to len bits) */
+  uint8_t prefix[16];
+
+  /** Prefix length */
+  uint8_t len;
+
+  /** Number of routes (zero for internal nodes) */
+  uint16_t routes_cnt;
+
+  /** Number of allocated routes */
+  uint16_t _routes_alloc_cnt;
+
+  /** Children (selected by bit len of the address) */
+  struct rib_node *child[2];
+
+  /** Array of (routes_cnt) routes, sorted by peer index */
+  parsebgp_rib_route_t *routes;
+
+} rib_node_t;
+
+/** Interned Path Attribute set */
+typedef struct rib_attrs {
+
+  /** Total Path Attribute Length followed by the Path Attributes (NULL if the
+      set is unused) */
+  uint8_t *data;
+
+  /** Hash of the data */
+  uint64_t hash;
+
+  /** Next set in the hash chain (or in the free list) */
+  uint32_t next;
+
+  /** Number of routes referencing this set */
+  uint32_t refcnt;
+
+  /** Length of the data */
+  uint32_t len;
+
+  /** Set if the AS_PATH uses 4-byte ASNs */
+  uint8_t asn_4_byte;
+
+} rib_attrs_t;
+
+struct parsebgp_rib {
+
+  /** Radix trees (IPv4 and IPv6) */
+  rib_node_t *trees[2];
+
+  /** Number of prefixes in each tree */
+  uint64_t prefixes_cnt[2];
+
+  /** Number of nodes across both trees */
+  uint64_t nodes_cnt;
+
+  /** Number of routes across both trees */
+  uint64_t routes_cnt;
+
+  /** Array of (peers_cnt) peers */
+  parsebgp_rib_peer_t *peers;
+
+  /** Number of allocated peers */
+  int _peers_alloc_cnt;
+
+  /** Number of peers */
+  int peers_cnt;
+
+  /** Peer hash table (index + 1, zero if empty) */
+  uint32_t *peer_buckets;
+
+  /** Number of peer buckets minus one */
+  uint32_t peer_buckets_mask;
+
+  /** Map from TABLE_DUMP_V2 peer index to RIB peer index */
+  uint16_t *tdv2_peers;
+
+  /** Number of allocated TABLE_DUMP_V2 peer mappings */
+  int _tdv2_peers_alloc_cnt;
+
+  /** Number of TABLE_DUMP_V2 peer mappings */
+  int tdv2_peers_cnt;
+
+  /** Array of interned attribute sets (index is the ID, zero is unused) */
+  rib_attrs_t *attrs;
+
+  /** Number of allocated attribute sets */
+  uint32_t _attrs_alloc_cnt;
+
+  /** Number of attribute set IDs handed out (including the unused zero) */
+  uint32_t attrs_ids_cnt;
+
+  /** Head of the free attribute set list (zero if empty) */
+  uint32_t attrs_free;
+
+  /** Number of attribute sets in use */
+  uint64_t attrs_cnt;
+
+  /** Total length of the attribute sets in use */
+  uint64_t attrs_bytes;
+
+  /** Attribute set hash table (ID, zero if empty) */
+  uint32_t *attrs_buckets;
+
+  /** Number of attribute set buckets minus one */
+  uint32_t attrs_buckets_mask;
+
+  /** Scratch buffer used to build attribute sets */
+  uint8_t *scratch;
+
+  /** Allocated length of the scratch buffer */
+  int _scratch_alloc_len;
+
+  /** Change callback (NULL if disabled) */
+  parsebgp_rib_change_cb_t *change_cb;
+
+  /** User pointer for the change callback */
+  void *change_cb_user;
+};
+
+/** Report a change to the change callback (if set) */
+static void notify(parsebgp_rib_t *rib, parsebgp_rib_change_type_t type,
+                   int afi_idx, const uint8_t *prefix, uint8_t prefix_len,
+                   uint16_t peer_idx, uint32_t attrs_id)
+{
+  parsebgp_rib_change_t change;
+
+  if (rib->change_cb == NULL) {
+    return;
+  }
+  change.type = type;
+  change.afi = afi_idx == 0 ? PARSEBGP_BGP_AFI_IPV4 : PARSEBGP_BGP_AFI_IPV6;
+  change.prefix = prefix;
+  change.prefix_len = prefix_len;
+  change.peer_idx = peer_idx;
+  change.attrs_id = attrs_id;
+  rib->change_cb(&change, rib->change_cb_user);
+}
+
+/* -------------------- Interned Path Attributes -------------------- */
+
+static parsebgp_error_t attrs_rehash(parsebgp_rib_t *rib, uint32_t buckets)
+{
+  uint32_t *new_buckets, id, next;
+  uint64_t i;
+
+  if ((new_buckets = calloc(buckets, sizeof(uint32_t))) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  if (rib->attrs_buckets != NULL) {
+    for (i = 0; i <= rib->attrs_buckets_mask; i++) {
+      for (id = rib->attrs_buckets[i]; id != 0; id = next) {
+        next = rib->attrs[id].next;
+        rib->attrs[id].next = new_buckets[rib->attrs[id].hash & (buckets - 1)];
+        new_buckets[rib->attrs[id].hash & (buckets - 1)] = id;
+      }
+    }
+  }
+  free(rib->attrs_buckets);
+  rib->attrs_buckets = new_buckets;
+  rib->attrs_buckets_mask = buckets - 1;
+  return PARSEBGP_OK;
+}
+
+/** Find or create the attribute set for the given data (returned with its
+    reference count unchanged) */
+static parsebgp_error_t attrs_intern(parsebgp_rib_t *rib, const uint8_t *data,
+                                     uint32_t len, uint8_t asn_4_byte,
+                                     uint32_t *idp)
+{
+  uint64_t hash = parsebgp_hash_bytes(data, len, asn_4_byte);
+  uint32_t *bucket, id, alloc_cnt;
+  rib_attrs_t *attrs;
+  parsebgp_error_t err;
+
+  bucket = &rib->attrs_buckets[hash & rib->attrs_buckets_mask];
+  for (id = *bucket; id != 0; id = rib->attrs[id].next) {
+    attrs = &rib->attrs[id];
+    if (attrs->hash == hash && attrs->len == len &&
+        attrs->asn_4_byte == asn_4_byte && memcmp(attrs->data, data, len) == 0) {
+      *idp = id;
+      return PARSEBGP_OK;
+    }
+  }
+
+  // miss: grab a free ID
+  if (rib->attrs_free != 0) {
+    id = rib->attrs_free;
+    rib->attrs_free = rib->attrs[id].next;
+  } else {
+    if (rib->attrs_ids_cnt == UINT32_MAX) {
+      return PARSEBGP_MALLOC_FAILURE;
+    }
+    if (rib->attrs_ids_cnt == rib->_attrs_alloc_cnt) {
+      alloc_cnt = rib->_attrs_alloc_cnt * 2;
+      if (alloc_cnt < rib->_attrs_alloc_cnt) {
+        alloc_cnt = UINT32_MAX;
+      }
+      PARSEBGP_MAYBE_REALLOC(rib->attrs, rib->_attrs_alloc_cnt, alloc_cnt);
+    }
+    id = rib->attrs_ids_cnt++;
+  }
+
+  attrs = &rib->attrs[id];
+  if ((attrs->data = malloc(len)) == NULL) {
+    attrs->next = rib->attrs_free;
+    rib->attrs_free = id;
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  memcpy(attrs->data, data, len);
+  attrs->hash = hash;
+  attrs->len = len;
+  attrs->asn_4_byte = asn_4_byte;
+  attrs->refcnt = 0;
+  attrs->next = *bucket;
+  *bucket = id;
+
+  rib->attrs_cnt++;
+  rib->attrs_bytes += len;
+  notify(rib, PARSEBGP_RIB_CHANGE_ATTRS_NEW, 0, NULL, 0, 0, id);
+
+  // keep the load factor at or below one
+  if (rib->attrs_cnt > rib->attrs_buckets_mask + 1 &&
+      rib->attrs_buckets_mask < (UINT32_MAX >> 1) &&
+      (err = attrs_rehash(rib, (rib->attrs_buckets_mask + 1) * 2)) !=
+        PARSEBGP_OK) {
+    return err;
+  }
+
+  *idp = id;
+  return PARSEBGP_OK;
+}
+
+/** Free an attribute set if no routes reference it */
+static void attrs_maybe_free(parsebgp_rib_t *rib, uint32_t id)
+{
+  rib_attrs_t *attrs = &rib->attrs[id];
+  uint32_t *link;
+
+  if (attrs->refcnt != 0) {
+    return;
+  }
+
+  for (link = &rib->attrs_buckets[attrs->hash & rib->attrs_buckets_mask];
+       *link != id; link = &rib->attrs[*link].next)
+    ;
+  *link = attrs->next;
+
+  rib->attrs_cnt--;
+  rib->attrs_bytes -= attrs->len;
+
+  free(attrs->data);
+  attrs->data = NULL;
+  attrs->len = 0;
+  attrs->next = rib->attrs_free;
+  rib->attrs_free = id;
+}
+
+static inline void attrs_unref(parsebgp_rib_t *rib, uint32_t id)
+{
+  rib->attrs[id].refcnt--;
+  attrs_maybe_free(rib, id);
+}
+
+/** Build the canonical form of the given Path Attributes in the scratch
+    buffer */
+static parsebgp_error_t
+attrs_build(parsebgp_rib_t *rib,
+            const parsebgp_bgp_update_path_attrs_t *path_attrs, size_t *lenp)
+{
+  const uint8_t *buf = path_attrs->raw, *end = buf + path_attrs->len;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach = NULL;
+  uint8_t *out, flags, type, nh_len;
+  size_t hdr_len, attr_len, nread = sizeof(uint16_t);
+  int mp_reach_done = 0;
+
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].type ==
+      PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI) {
+    mp_reach = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI]
+                 .data.mp_reach;
+  }
+
+  // the canonical MP_REACH attribute (written at most once) takes at most
+  // 3 + 4 + 32 + 1 bytes, which may be more than it took on the wire
+  PARSEBGP_MAYBE_REALLOC(rib->scratch, rib->_scratch_alloc_len,
+                         (int)(sizeof(uint16_t) + path_attrs->len + 40));
+  out = rib->scratch;
+
+  while (end - buf >= 3) {
+    flags = buf[0];
+    type = buf[1];
+    if (flags & PARSEBGP_BGP_PATH_ATTR_FLAG_EXTENDED) {
+      if (end - buf < 4) {
+        break;
+      }
+      hdr_len = 4;
+      attr_len = nptohs(buf + 2);
+    } else {
+      hdr_len = 3;
+      attr_len = buf[2];
+    }
+    if ((size_t)(end - buf) < hdr_len + attr_len) {
+      // the decoder has already complained about this
+      break;
+    }
+
+    switch (type) {
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI:
+      // withdrawals are not part of the route
+      break;
+
+    case PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI:
+      // keep only the next-hop (in the full, non-abbreviated form), and only
+      // once, since the decoder ignores any duplicates
+      if (mp_reach == NULL || mp_reach->next_hop_len > 32 || mp_reach_done) {
+        break;
+      }
+      mp_reach_done = 1;
+      nh_len = mp_reach->next_hop_len;
+      out[nread++] = flags & ~PARSEBGP_BGP_PATH_ATTR_FLAG_EXTENDED;
+      out[nread++] = type;
+      out[nread++] = 2 + 1 + 1 + nh_len + 1;
+      out[nread++] = mp_reach->afi >> 8;
+      out[nread++] = mp_reach->afi & 0xFF;
+      out[nread++] = mp_reach->safi;
+      out[nread++] = nh_len;
+      if (nh_len > 16) {
+        memcpy(out + nread, mp_reach->next_hop, 16);
+        memcpy(out + nread + 16, mp_reach->next_hop_ll, nh_len - 16);
+      } else {
+        memcpy(out + nread, mp_reach->next_hop, nh_len);
+      }
+      nread += nh_len;
+      out[nread++] = 0; // reserved
+      break;
+
+    default:
+      memcpy(out + nread, buf, hdr_len + attr_len);
+      nread += hdr_len + attr_len;
+      break;
+    }
+
+    buf += hdr_len + attr_len;
+  }
+
+  if (nread - sizeof(uint16_t) > UINT16_MAX) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  out[0] = (nread - sizeof(uint16_t)) >> 8;
+  out[1] = (nread - sizeof(uint16_t)) & 0xFF;
+
+  *lenp = nread;
+  return PARSEBGP_OK;
+}
+
+/** Intern the given Path Attributes (returned with its reference count
+    unchanged, so the caller must call attrs_maybe_free when done) */
+static parsebgp_error_t
+attrs_intern_path_attrs(parsebgp_rib_t *rib,
+                        const parsebgp_bgp_update_path_attrs_t *path_attrs,
+                        uint32_t *idp)
+{
+  size_t len;
+  uint8_t asn_4_byte = 1;
+  parsebgp_error_t err;
+
+  if (path_attrs->raw == NULL) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH].type ==
+        PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH &&
+      path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH].data.as_path !=
+        NULL) {
+    asn_4_byte = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH]
+                   .data.as_path->asn_4_byte;
+  }
+
+  if ((err = attrs_build(rib, path_attrs, &len)) != PARSEBGP_OK) {
+    return err;
+  }
+  return attrs_intern(rib, rib->scratch, len, asn_4_byte, idp);
+}
+
+/* -------------------- Radix Tree -------------------- */
+
+static void copy_masked(uint8_t *dst, const uint8_t *src, uint8_t len)
+{
+  int bytes = len / 8;
+  memcpy(dst, src, bytes);
+  memset(dst + bytes, 0, 16 - bytes);
+  if (len % 8 != 0) {
+    dst[bytes] = src[bytes] & (0xFF << (8 - (len % 8)));
+  }
+}
+
+/** Number of leading bits that a and b have in common (at most max_len) */
+static uint8_t common_len(const uint8_t *a, const uint8_t *b, uint8_t max_len)
+{
+  int i;
+  uint8_t x, cpl;
+
+  for (i = 0; i * 8 < max_len; i++) {
+    if ((x = a[i] ^ b[i]) != 0) {
+      cpl = i * 8;
+      while ((x & 0x80) == 0) {
+        x <<= 1;
+        cpl++;
+      }
+      return cpl < max_len ? cpl : max_len;
+    }
+  }
+  return max_len;
+}
+
+static rib_node_t *node_create(parsebgp_rib_t *rib, const uint8_t *prefix,
+                               uint8_t len)
+{
+  rib_node_t *node;
+  if ((node = malloc_zero(sizeof(rib_node_t))) == NULL) {
+    return NULL;
+  }
+  copy_masked(node->prefix, prefix, len);
+  node->len = len;
+  rib->nodes_cnt++;
+  return node;
+}
+
+static void node_destroy(parsebgp_rib_t *rib, rib_node_t *node)
+{
+  free(node->routes);
+  free(node);
+  rib->nodes_cnt--;
+}
+
+/** Find (or create) the node for the given prefix */
+static rib_node_t *tree_insert(parsebgp_rib_t *rib, rib_node_t **link,
+                               const uint8_t *prefix, uint8_t len)
+{
+  rib_node_t *node, *new_node, *glue;
+  uint8_t cpl;
+
+  while ((node = *link) != NULL) {
+    cpl = common_len(node->prefix, prefix, node->len < len ? node->len : len);
+
+    if (cpl < node->len) {
+      // the prefix diverges from (or is covered by) this node
+      if ((new_node = node_create(rib, prefix, len)) == NULL) {
+        return NULL;
+      }
+      if (cpl == len) {
+        // the new node covers this one
+        new_node->child[ADDR_BIT(node->prefix, len)] = node;
+        *link = new_node;
+        return new_node;
+      }
+      // they diverge, so we need an internal node to hold both
+      if ((glue = node_create(rib, prefix, cpl)) == NULL) {
+        node_destroy(rib, new_node);
+        return NULL;
+      }
+      glue->child[ADDR_BIT(prefix, cpl)] = new_node;
+      glue->child[ADDR_BIT(node->prefix, cpl)] = node;
+      *link = glue;
+      return new_node;
+    }
+
+    if (node->len == len) {
+      return node;
+    }
+    link = &node->child[ADDR_BIT(prefix, node->len)];
+  }
+
+  return (*link = node_create(rib, prefix, len));
+}
+
+/** Find the node for the given prefix, filling the stack of links that lead
+    to it (which must be able to hold 130 links) */
+static rib_node_t *tree_find(rib_node_t *const *link, const uint8_t *prefix,
+                             uint8_t len, rib_node_t *const **stack,
+                             int *depthp)
+{
+  const rib_node_t *node;
+  int depth = 0;
+
+  while ((node = *link) != NULL) {
+    if (stack != NULL) {
+      stack[depth++] = link;
+    }
+    if (node->len > len || common_len(node->prefix, prefix, node->len) <
+                             node->len) {
+      return NULL;
+    }
+    if (node->len == len) {
+      if (depthp != NULL) {
+        *depthp = depth;
+      }
+      return *link;
+    }
+    link = &node->child[ADDR_BIT(prefix, node->len)];
+  }
+  return NULL;
+}
+
+/** Remove the node at *link if it is no longer needed, returns 1 if it was
+    removed */
+static int node_maybe_remove(parsebgp_rib_t *rib, rib_node_t **link)
+{
+  rib_node_t *node = *link;
+
+  if (node->routes_cnt != 0 || (node->child[0] != NULL && node->child[1] != NULL)) {
+    return 0;
+  }
+  *link = node->child[0] != NULL ? node->child[0] : node->child[1];
+  node_destroy(rib, node);
+  return 1;
+}
+
+/** Find the index of the route for a peer (or where it should be inserted) */
+static int routes_search(const rib_node_t *node, uint16_t peer_idx, int *found)
+{
+  int lo = 0, hi = node->routes_cnt, mid;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (node->routes[mid].peer_idx < peer_idx) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *found = (lo < node->routes_cnt && node->routes[lo].peer_idx == peer_idx);
+  return lo;
+}
+
+static parsebgp_error_t route_set(parsebgp_rib_t *rib, int afi_idx,
+                                  const uint8_t *prefix, uint8_t len,
+                                  uint16_t peer_idx, uint32_t attrs_id)
+{
+  rib_node_t *node;
+  int idx, found;
+  uint16_t alloc_cnt;
+  parsebgp_rib_route_t *route;
+
+  if ((node = tree_insert(rib, &rib->trees[afi_idx], prefix, len)) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+
+  idx = routes_search(node, peer_idx, &found);
+  if (found) {
+    route = &node->routes[idx];
+    if (route->attrs_id != attrs_id) {
+      rib->attrs[attrs_id].refcnt++;
+      attrs_unref(rib, route->attrs_id);
+      route->attrs_id = attrs_id;
+      notify(rib, PARSEBGP_RIB_CHANGE_ANNOUNCE, afi_idx, node->prefix, len,
+             peer_idx, attrs_id);
+    }
+    return PARSEBGP_OK;
+  }
+
+  if (node->routes_cnt == node->_routes_alloc_cnt) {
+    alloc_cnt = node->_routes_alloc_cnt == 0 ? ROUTES_ALLOC_INIT
+                                             : node->_routes_alloc_cnt * 2;
+    if (alloc_cnt < node->_routes_alloc_cnt) {
+      alloc_cnt = UINT16_MAX;
+    }
+    PARSEBGP_MAYBE_REALLOC(node->routes, node->_routes_alloc_cnt, alloc_cnt);
+  }
+  memmove(&node->routes[idx + 1], &node->routes[idx],
+          sizeof(parsebgp_rib_route_t) * (node->routes_cnt - idx));
+  route = &node->routes[idx];
+  route->peer_idx = peer_idx;
+  route->attrs_id = attrs_id;
+  rib->attrs[attrs_id].refcnt++;
+
+  if (node->routes_cnt++ == 0) {
+    rib->prefixes_cnt[afi_idx]++;
+  }
+  rib->routes_cnt++;
+  rib->peers[peer_idx].routes_cnt++;
+  notify(rib, PARSEBGP_RIB_CHANGE_ANNOUNCE, afi_idx, node->prefix, len,
+         peer_idx, attrs_id);
+  return PARSEBGP_OK;
+}
+
+/** Remove the route at the given index of a node (the node is not removed) */
+static void route_remove_idx(parsebgp_rib_t *rib, int afi_idx,
+                             rib_node_t *node, int idx)
+{
+  uint32_t attrs_id = node->routes[idx].attrs_id;
+
+  rib->peers[node->routes[idx].peer_idx].routes_cnt--;
+  memmove(&node->routes[idx], &node->routes[idx + 1],
+          sizeof(parsebgp_rib_route_t) * (node->routes_cnt - idx - 1));
+  if (--node->routes_cnt == 0) {
+    rib->prefixes_cnt[afi_idx]--;
+  }
+  rib->routes_cnt--;
+  attrs_unref(rib, attrs_id);
+}
+
+static void route_remove(parsebgp_rib_t *rib, int afi_idx,
+                         const uint8_t *prefix, uint8_t len, uint16_t peer_idx)
+{
+  rib_node_t **stack[130];
+  rib_node_t *node;
+  int depth, idx, found;
+
+  if ((node = tree_find(&rib->trees[afi_idx], prefix, len,
+                        (rib_node_t * const **)stack, &depth)) == NULL) {
+    return;
+  }
+  idx = routes_search(node, peer_idx, &found);
+  if (!found) {
+    return;
+  }
+  route_remove_idx(rib, afi_idx, node, idx);
+  notify(rib, PARSEBGP_RIB_CHANGE_WITHDRAW, afi_idx, node->prefix, len,
+         peer_idx, 0);
+
+  // removing a leaf may leave its parent as an internal node with a single
+  // child, which also needs to go
+  if (node_maybe_remove(rib, stack[depth - 1]) && depth > 1) {
+    node_maybe_remove(rib, stack[depth - 2]);
+  }
+}
+
+static void tree_flush_peer(parsebgp_rib_t *rib, int afi_idx,
+                            rib_node_t **link, uint16_t peer_idx)
+{
+  rib_node_t *node = *link;
+  int idx, found;
+
+  if (node == NULL) {
+    return;
+  }
+  tree_flush_peer(rib, afi_idx, &node->child[0], peer_idx);
+  tree_flush_peer(rib, afi_idx, &node->child[1], peer_idx);
+
+  idx = routes_search(node, peer_idx, &found);
+  if (found) {
+    route_remove_idx(rib, afi_idx, node, idx);
+  }
+  node_maybe_remove(rib, link);
+}
+
+static void tree_destroy(parsebgp_rib_t *rib, rib_node_t *node)
+{
+  if (node == NULL) {
+    return;
+  }
+  tree_destroy(rib, node->child[0]);
+  tree_destroy(rib, node->child[1]);
+  node_destroy(rib, node);
+}
+
+static int tree_walk(const rib_node_t *node, parsebgp_rib_walk_cb_t *cb,
+                     void *user)
+{
+  if (node == NULL) {
+    return 0;
+  }
+  if (node->routes_cnt > 0 &&
+      cb(node->prefix, node->len, node->routes, node->routes_cnt, user) != 0) {
+    return 1;
+  }
+  return tree_walk(node->child[0], cb, user) ||
+         tree_walk(node->child[1], cb, user);
+}
+
+/* -------------------- Peers -------------------- */
+
+static uint64_t peer_hash(const parsebgp_rib_peer_t *peer)
+{
+  uint64_t h = parsebgp_hash_bytes(peer->addr, sizeof(peer->addr), peer->afi);
+  return parsebgp_hash_bytes((const uint8_t *)&peer->asn, sizeof(peer->asn),
+                             h ^ peer->dist_id ^ peer->post_policy);
+}
+
+static int peer_eq(const parsebgp_rib_peer_t *a, const parsebgp_rib_peer_t *b)
+{
+  return a->afi == b->afi && a->asn == b->asn && a->dist_id == b->dist_id &&
+         a->post_policy == b->post_policy &&
+         memcmp(a->addr, b->addr, sizeof(a->addr)) == 0;
+}
+
+static parsebgp_error_t peers_rehash(parsebgp_rib_t *rib, uint32_t buckets)
+{
+  uint32_t *new_buckets, b;
+  int i;
+
+  if ((new_buckets = calloc(buckets, sizeof(uint32_t))) == NULL) {
+    return PARSEBGP_MALLOC_FAILURE;
+  }
+  for (i = 0; i < rib->peers_cnt; i++) {
+    for (b = peer_hash(&rib->peers[i]) & (buckets - 1); new_buckets[b] != 0;
+         b = (b + 1) & (buckets - 1))
+      ;
+    new_buckets[b] = i + 1;
+  }
+  free(rib->peer_buckets);
+  rib->peer_buckets = new_buckets;
+  rib->peer_buckets_mask = buckets - 1;
+  return PARSEBGP_OK;
+}
+
+/**
+ * Find the peer with the given key
+ *
+ * @return PARSEBGP_OK if the peer was found (or created), PARSEBGP_INVALID_MSG
+ * if it was not found and create is not set
+ */
+static parsebgp_error_t peer_find(parsebgp_rib_t *rib, uint16_t afi,
+                                  const uint8_t *addr, uint32_t asn,
+                                  uint64_t dist_id, uint8_t post_policy,
+                                  const uint8_t *bgp_id, int create,
+                                  uint16_t *idxp)
+{
+  parsebgp_rib_peer_t key, *peer;
+  uint32_t b;
+  parsebgp_error_t err;
+
+  memset(&key, 0, sizeof(key));
+  key.afi = afi;
+  memcpy(key.addr, addr, afi == PARSEBGP_BGP_AFI_IPV4 ? 4 : 16);
+  key.asn = asn;
+  key.dist_id = dist_id;
+  key.post_policy = post_policy;
+
+  for (b = peer_hash(&key) & rib->peer_buckets_mask; rib->peer_buckets[b] != 0;
+       b = (b + 1) & rib->peer_buckets_mask) {
+    peer = &rib->peers[rib->peer_buckets[b] - 1];
+    if (peer_eq(peer, &key)) {
+      if (bgp_id != NULL) {
+        memcpy(peer->bgp_id, bgp_id, sizeof(peer->bgp_id));
+      }
+      *idxp = rib->peer_buckets[b] - 1;
+      return PARSEBGP_OK;
+    }
+  }
+
+  if (!create) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  if (rib->peers_cnt == PARSEBGP_RIB_PEERS_MAX) {
+    fprintf(stderr, "ERROR: Too many RIB peers (max %d)\n",
+            PARSEBGP_RIB_PEERS_MAX);
+    return PARSEBGP_INVALID_MSG;
+  }
+
+  if (rib->peers_cnt == rib->_peers_alloc_cnt) {
+    PARSEBGP_MAYBE_REALLOC(rib->peers, rib->_peers_alloc_cnt,
+                           rib->_peers_alloc_cnt * 2);
+  }
+  if (bgp_id != NULL) {
+    memcpy(key.bgp_id, bgp_id, sizeof(key.bgp_id));
+  }
+  rib->peers[rib->peers_cnt] = key;
+  rib->peer_buckets[b] = rib->peers_cnt + 1;
+  *idxp = rib->peers_cnt++;
+
+  // keep the load factor at or below 1/2
+  if ((uint32_t)rib->peers_cnt * 2 > rib->peer_buckets_mask + 1 &&
+      (err = peers_rehash(rib, (rib->peer_buckets_mask + 1) * 2)) !=
+        PARSEBGP_OK) {
+    return err;
+  }
+  return PARSEBGP_OK;
+}
+
+/* -------------------- Message Handlers -------------------- */
+
+static parsebgp_error_t apply_prefix(parsebgp_rib_t *rib,
+                                     const parsebgp_bgp_prefix_t *pfx,
+                                     uint16_t peer_idx, uint32_t attrs_id)
+{
+  int afi_idx;
+
+  switch (pfx->type) {
+  case PARSEBGP_BGP_PREFIX_UNICAST_IPV4:
+    afi_idx = 0;
+    break;
+  case PARSEBGP_BGP_PREFIX_UNICAST_IPV6:
+    afi_idx = 1;
+    break;
+  default:
+    // only unicast routes are tracked
+    return PARSEBGP_OK;
+  }
+  if (pfx->len > MAX_PFX_LEN(afi_idx)) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  if (attrs_id == 0) {
+    route_remove(rib, afi_idx, pfx->addr, pfx->len, peer_idx);
+    return PARSEBGP_OK;
+  }
+  return route_set(rib, afi_idx, pfx->addr, pfx->len, peer_idx, attrs_id);
+}
+
+static parsebgp_error_t apply_update(parsebgp_rib_t *rib, uint16_t peer_idx,
+                                     const parsebgp_bgp_update_t *update)
+{
+  const parsebgp_bgp_update_path_attrs_t *path_attrs = &update->path_attrs;
+  const parsebgp_bgp_update_mp_reach_t *mp_reach = NULL;
+  const parsebgp_bgp_update_mp_unreach_t *mp_unreach = NULL;
+  uint32_t attrs_id = 0;
+  int i;
+  parsebgp_error_t err = PARSEBGP_OK;
+
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].type ==
+      PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI) {
+    mp_reach = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI]
+                 .data.mp_reach;
+  }
+  if (path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI].type ==
+      PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI) {
+    mp_unreach = path_attrs->attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+                   .data.mp_unreach;
+  }
+
+  // withdrawals
+  for (i = 0; i < update->withdrawn_nlris.prefixes_cnt; i++) {
+    if ((err = apply_prefix(rib, &update->withdrawn_nlris.prefixes[i], peer_idx,
+                            0)) != PARSEBGP_OK) {
+      return err;
+    }
+  }
+  for (i = 0; mp_unreach != NULL && i < mp_unreach->withdrawn_nlris_cnt; i++) {
+    if ((err = apply_prefix(rib, &mp_unreach->withdrawn_nlris[i], peer_idx,
+                            0)) != PARSEBGP_OK) {
+      return err;
+    }
+  }
+
+  // announcements
+  if (update->announced_nlris.prefixes_cnt == 0 &&
+      (mp_reach == NULL || mp_reach->nlris_cnt == 0)) {
+    return PARSEBGP_OK;
+  }
+  if ((err = attrs_intern_path_attrs(rib, path_attrs, &attrs_id)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  for (i = 0; i < update->announced_nlris.prefixes_cnt; i++) {
+    if ((err = apply_prefix(rib, &update->announced_nlris.prefixes[i], peer_idx,
+                            attrs_id)) != PARSEBGP_OK) {
+      goto done;
+    }
+  }
+  for (i = 0; mp_reach != NULL && i < mp_reach->nlris_cnt; i++) {
+    if ((err = apply_prefix(rib, &mp_reach->nlris[i], peer_idx, attrs_id)) !=
+        PARSEBGP_OK) {
+      goto done;
+    }
+  }
+
+done:
+  attrs_maybe_free(rib, attrs_id);
+  return err;
+}
+
+static parsebgp_error_t apply_table_dump(parsebgp_rib_t *rib,
+                                         parsebgp_bgp_afi_t afi,
+                                         const parsebgp_mrt_table_dump_t *msg)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint16_t peer_idx;
+  uint32_t attrs_id;
+  parsebgp_error_t err;
+
+  if (afi_idx < 0) {
+    return PARSEBGP_OK;
+  }
+  if (msg->prefix_len > MAX_PFX_LEN(afi_idx)) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  if ((err = peer_find(rib, afi, msg->peer_ip, msg->peer_asn, 0, 0, NULL, 1,
+                       &peer_idx)) != PARSEBGP_OK ||
+      (err = attrs_intern_path_attrs(rib, &msg->path_attrs, &attrs_id)) !=
+        PARSEBGP_OK) {
+    return err;
+  }
+  err = route_set(rib, afi_idx, msg->prefix, msg->prefix_len, peer_idx,
+                  attrs_id);
+  attrs_maybe_free(rib, attrs_id);
+  return err;
+}
+
+static parsebgp_error_t
+apply_peer_index(parsebgp_rib_t *rib,
+                 const parsebgp_mrt_table_dump_v2_peer_index_t *msg)
+{
+  const parsebgp_mrt_table_dump_v2_peer_entry_t *pe;
+  parsebgp_error_t err;
+  int i;
+
+  PARSEBGP_MAYBE_REALLOC(rib->tdv2_peers, rib->_tdv2_peers_alloc_cnt,
+                         msg->peer_count);
+  rib->tdv2_peers_cnt = 0;
+  for (i = 0; i < msg->peer_count; i++) {
+    pe = &msg->peer_entries[i];
+    if ((err = peer_find(rib, pe->ip_afi, pe->ip, pe->asn, 0, 0, pe->bgp_id, 1,
+                         &rib->tdv2_peers[i])) != PARSEBGP_OK) {
+      return err;
+    }
+    rib->tdv2_peers_cnt++;
+  }
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t
+apply_afi_safi_rib(parsebgp_rib_t *rib, int afi_idx,
+                   const parsebgp_mrt_table_dump_v2_afi_safi_rib_t *msg)
+{
+  const parsebgp_mrt_table_dump_v2_rib_entry_t *entry;
+  uint32_t attrs_id;
+  int i;
+  parsebgp_error_t err;
+
+  if (msg->prefix_len > MAX_PFX_LEN(afi_idx)) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+
+  for (i = 0; i < msg->entry_count; i++) {
+    entry = &msg->entries[i];
+    if (entry->peer_index >= rib->tdv2_peers_cnt) {
+      fprintf(stderr, "ERROR: RIB entry refers to unknown peer index %d\n",
+              entry->peer_index);
+      PARSEBGP_RETURN_INVALID_MSG_ERR;
+    }
+    if ((err = attrs_intern_path_attrs(rib, entry->path_attrs_ptr,
+                                       &attrs_id)) != PARSEBGP_OK) {
+      return err;
+    }
+    err = route_set(rib, afi_idx, msg->prefix, msg->prefix_len,
+                    rib->tdv2_peers[entry->peer_index], attrs_id);
+    attrs_maybe_free(rib, attrs_id);
+    if (err != PARSEBGP_OK) {
+      return err;
+    }
+  }
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t apply_mrt(parsebgp_rib_t *rib,
+                                  const parsebgp_mrt_msg_t *msg)
+{
+  const parsebgp_mrt_bgp4mp_t *bgp4mp;
+  uint16_t peer_idx;
+  parsebgp_error_t err;
+
+  switch (msg->type) {
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP:
+    return apply_table_dump(rib, msg->subtype, msg->types.table_dump);
+
+  case PARSEBGP_MRT_TYPE_TABLE_DUMP_V2:
+    switch (msg->subtype) {
+    case PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE:
+      return apply_peer_index(rib, &msg->types.table_dump_v2->peer_index);
+
+    case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+      return apply_afi_safi_rib(rib, 0,
+                                &msg->types.table_dump_v2->afi_safi_rib);
+
+    case PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+      return apply_afi_safi_rib(rib, 1,
+                                &msg->types.table_dump_v2->afi_safi_rib);
+
+    default:
+      // multicast and generic RIBs are not tracked
+      return PARSEBGP_OK;
+    }
+
+  case PARSEBGP_MRT_TYPE_BGP4MP:
+  case PARSEBGP_MRT_TYPE_BGP4MP_ET:
+    bgp4mp = msg->types.bgp4mp;
+    switch (msg->subtype) {
+    case PARSEBGP_MRT_BGP4MP_MESSAGE:
+    case PARSEBGP_MRT_BGP4MP_MESSAGE_AS4:
+      if (bgp4mp->data.bgp_msg == NULL ||
+          bgp4mp->data.bgp_msg->type != PARSEBGP_BGP_TYPE_UPDATE) {
+        return PARSEBGP_OK;
+      }
+      if ((err = peer_find(rib, bgp4mp->afi, bgp4mp->peer_ip, bgp4mp->peer_asn,
+                           0, 0, NULL, 1, &peer_idx)) != PARSEBGP_OK) {
+        return err;
+      }
+      return apply_update(rib, peer_idx, bgp4mp->data.bgp_msg->types.update);
+
+    case PARSEBGP_MRT_BGP4MP_STATE_CHANGE:
+    case PARSEBGP_MRT_BGP4MP_STATE_CHANGE_AS4:
+      if (bgp4mp->data.state_change.old_state ==
+            PARSEBGP_MRT_FSM_CODE_ESTABLISHED &&
+          bgp4mp->data.state_change.new_state !=
+            PARSEBGP_MRT_FSM_CODE_ESTABLISHED &&
+          peer_find(rib, bgp4mp->afi, bgp4mp->peer_ip, bgp4mp->peer_asn, 0, 0,
+                    NULL, 0, &peer_idx) == PARSEBGP_OK) {
+        parsebgp_rib_peer_flush(rib, peer_idx);
+      }
+      return PARSEBGP_OK;
+
+    default:
+      // messages sent by the local router are not part of the Adj-RIB-In
+      return PARSEBGP_OK;
+    }
+
+  default:
+    return PARSEBGP_OK;
+  }
+}
+
+static parsebgp_error_t apply_bmp(parsebgp_rib_t *rib,
+                                  const parsebgp_bmp_msg_t *msg)
+{
+  const parsebgp_bmp_peer_hdr_t *hdr = &msg->peer_hdr;
+  uint8_t post_policy = (hdr->flags & PARSEBGP_BMP_PEER_FLAG_POST_POLICY) != 0;
+  uint16_t peer_idx;
+  parsebgp_error_t err;
+
+  if (!msg->types_valid) {
+    return PARSEBGP_OK;
+  }
+
+  switch (msg->type) {
+  case PARSEBGP_BMP_TYPE_ROUTE_MON:
+    if (msg->types.route_mon == NULL ||
+        msg->types.route_mon->type != PARSEBGP_BGP_TYPE_UPDATE) {
+      return PARSEBGP_OK;
+    }
+    if ((err = peer_find(rib, hdr->afi, hdr->addr, hdr->asn, hdr->dist_id,
+                         post_policy, hdr->bgp_id, 1, &peer_idx)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+    return apply_update(rib, peer_idx, msg->types.route_mon->types.update);
+
+  case PARSEBGP_BMP_TYPE_PEER_DOWN:
+    // the session is gone, so both the pre- and post-policy RIBs are too
+    for (post_policy = 0; post_policy <= 1; post_policy++) {
+      if (peer_find(rib, hdr->afi, hdr->addr, hdr->asn, hdr->dist_id,
+                    post_policy, NULL, 0, &peer_idx) == PARSEBGP_OK) {
+        parsebgp_rib_peer_flush(rib, peer_idx);
+      }
+    }
+    return PARSEBGP_OK;
+
+  default:
+    return PARSEBGP_OK;
+  }
+}
+
+/* -------------------- Public API -------------------- */
+
+parsebgp_rib_t *parsebgp_rib_create(void)
+{
+  parsebgp_rib_t *rib;
+
+  if ((rib = malloc_zero(sizeof(parsebgp_rib_t))) == NULL) {
+    return NULL;
+  }
+  // ID zero is never used
+  rib->attrs_ids_cnt = 1;
+  if ((rib->attrs = malloc_zero(sizeof(rib_attrs_t) * ATTRS_ALLOC_INIT)) ==
+        NULL ||
+      attrs_rehash(rib, ATTRS_BUCKETS_INIT) != PARSEBGP_OK ||
+      (rib->peers = malloc_zero(sizeof(parsebgp_rib_peer_t) *
+                                PEERS_ALLOC_INIT)) == NULL ||
+      peers_rehash(rib, PEER_BUCKETS_INIT) != PARSEBGP_OK) {
+    parsebgp_rib_destroy(rib);
+    return NULL;
+  }
+  rib->_attrs_alloc_cnt = ATTRS_ALLOC_INIT;
+  rib->_peers_alloc_cnt = PEERS_ALLOC_INIT;
+  return rib;
+}
+
+void parsebgp_rib_destroy(parsebgp_rib_t *rib)
+{
+  uint32_t id;
+
+  if (rib == NULL) {
+    return;
+  }
+  tree_destroy(rib, rib->trees[0]);
+  tree_destroy(rib, rib->trees[1]);
+  for (id = 1; id < rib->attrs_ids_cnt; id++) {
+    free(rib->attrs[id].data);
+  }
+  free(rib->attrs);
+  free(rib->attrs_buckets);
+  free(rib->peers);
+  free(rib->peer_buckets);
+  free(rib->tdv2_peers);
+  free(rib->scratch);
+  free(rib);
+}
+
+void parsebgp_rib_clear(parsebgp_rib_t *rib)
+{
+  uint32_t id;
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    tree_destroy(rib, rib->trees[i]);
+    rib->trees[i] = NULL;
+    rib->prefixes_cnt[i] = 0;
+  }
+  rib->routes_cnt = 0;
+  for (i = 0; i < rib->peers_cnt; i++) {
+    rib->peers[i].routes_cnt = 0;
+  }
+
+  for (id = 1; id < rib->attrs_ids_cnt; id++) {
+    free(rib->attrs[id].data);
+  }
+  memset(rib->attrs, 0, sizeof(rib_attrs_t) * rib->_attrs_alloc_cnt);
+  memset(rib->attrs_buckets, 0,
+         sizeof(uint32_t) * (rib->attrs_buckets_mask + 1));
+  rib->attrs_ids_cnt = 1;
+  rib->attrs_free = 0;
+  rib->attrs_cnt = 0;
+  rib->attrs_bytes = 0;
+  notify(rib, PARSEBGP_RIB_CHANGE_CLEAR, 0, NULL, 0, 0, 0);
+}
+
+parsebgp_error_t parsebgp_rib_apply(parsebgp_rib_t *rib,
+                                    const parsebgp_msg_t *msg)
+{
+  switch (msg->type) {
+  case PARSEBGP_MSG_TYPE_MRT:
+    return apply_mrt(rib, msg->types.mrt);
+
+  case PARSEBGP_MSG_TYPE_BMP:
+    return apply_bmp(rib, msg->types.bmp);
+
+  default:
+    // raw BGP messages carry no peer information
+    return PARSEBGP_OK;
+  }
+}
+
+void parsebgp_rib_peer_flush(parsebgp_rib_t *rib, uint16_t peer_idx)
+{
+  int i;
+
+  if (peer_idx >= rib->peers_cnt || rib->peers[peer_idx].routes_cnt == 0) {
+    return;
+  }
+  for (i = 0; i < 2; i++) {
+    tree_flush_peer(rib, i, &rib->trees[i], peer_idx);
+  }
+  assert(rib->peers[peer_idx].routes_cnt == 0);
+  notify(rib, PARSEBGP_RIB_CHANGE_PEER_FLUSH, 0, NULL, 0, peer_idx, 0);
+}
+
+void parsebgp_rib_set_change_cb(parsebgp_rib_t *rib,
+                                parsebgp_rib_change_cb_t *cb, void *user)
+{
+  rib->change_cb = cb;
+  rib->change_cb_user = user;
+}
+
+parsebgp_error_t parsebgp_rib_peer_add(parsebgp_rib_t *rib,
+                                       const parsebgp_rib_peer_t *peer,
+                                       uint16_t *peer_idx)
+{
+  if (AFI_IDX(peer->afi) < 0) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  return peer_find(rib, peer->afi, peer->addr, peer->asn, peer->dist_id,
+                   peer->post_policy, peer->bgp_id, 1, peer_idx);
+}
+
+int parsebgp_rib_get_peers_cnt(const parsebgp_rib_t *rib)
+{
+  return rib->peers_cnt;
+}
+
+const parsebgp_rib_peer_t *parsebgp_rib_get_peer(const parsebgp_rib_t *rib,
+                                                 uint16_t peer_idx)
+{
+  if (peer_idx >= rib->peers_cnt) {
+    return NULL;
+  }
+  return &rib->peers[peer_idx];
+}
+
+int parsebgp_rib_lookup(const parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                        const uint8_t *prefix, uint8_t prefix_len,
+                        const parsebgp_rib_route_t **routes)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint8_t masked[16];
+  const rib_node_t *node;
+
+  if (afi_idx < 0 || prefix_len > MAX_PFX_LEN(afi_idx)) {
+    return 0;
+  }
+  copy_masked(masked, prefix, prefix_len);
+  if ((node = tree_find(&rib->trees[afi_idx], masked, prefix_len, NULL,
+                        NULL)) == NULL ||
+      node->routes_cnt == 0) {
+    return 0;
+  }
+  *routes = node->routes;
+  return node->routes_cnt;
+}
+
+int parsebgp_rib_walk(const parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                      parsebgp_rib_walk_cb_t *cb, void *user)
+{
+  int afi_idx = AFI_IDX(afi);
+
+  if (afi_idx < 0) {
+    return 0;
+  }
+  return tree_walk(rib->trees[afi_idx], cb, user);
+}
+
+parsebgp_error_t parsebgp_rib_attrs_get(const parsebgp_rib_t *rib,
+                                        uint32_t attrs_id, const uint8_t **buf,
+                                        size_t *len, int *asn_4_byte)
+{
+  const rib_attrs_t *attrs;
+
+  if (attrs_id == 0 || attrs_id >= rib->attrs_ids_cnt ||
+      (attrs = &rib->attrs[attrs_id])->data == NULL) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  *buf = attrs->data;
+  *len = attrs->len;
+  if (asn_4_byte != NULL) {
+    *asn_4_byte = attrs->asn_4_byte;
+  }
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t
+parsebgp_rib_attrs_decode(const parsebgp_rib_t *rib, uint32_t attrs_id,
+                          parsebgp_opts_t *opts,
+                          parsebgp_bgp_update_path_attrs_t *path_attrs)
+{
+  parsebgp_opts_t decode_opts = *opts;
+  const uint8_t *buf;
+  size_t len;
+  int asn_4_byte;
+  parsebgp_error_t err;
+
+  if ((err = parsebgp_rib_attrs_get(rib, attrs_id, &buf, &len, &asn_4_byte)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+
+  decode_opts.bgp.asn_4_byte = asn_4_byte;
+  decode_opts.bgp.mp_reach_no_afi_safi_reserved = 0;
+
+  parsebgp_bgp_update_path_attrs_clear(path_attrs);
+  return parsebgp_bgp_update_path_attrs_decode(&decode_opts, path_attrs, buf,
+                                               &len, len);
+}
+
+parsebgp_error_t parsebgp_rib_attrs_add(parsebgp_rib_t *rib,
+                                        const uint8_t *buf, size_t len,
+                                        int asn_4_byte, uint32_t *attrs_id)
+{
+  parsebgp_error_t err;
+
+  if (len < sizeof(uint16_t) || len > UINT16_MAX + sizeof(uint16_t) ||
+      (size_t)nptohs(buf) != len - sizeof(uint16_t)) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  if ((err = attrs_intern(rib, buf, len, asn_4_byte != 0, attrs_id)) !=
+      PARSEBGP_OK) {
+    return err;
+  }
+  rib->attrs[*attrs_id].refcnt++;
+  return PARSEBGP_OK;
+}
+
+void parsebgp_rib_attrs_release(parsebgp_rib_t *rib, uint32_t attrs_id)
+{
+  if (attrs_id == 0 || attrs_id >= rib->attrs_ids_cnt ||
+      rib->attrs[attrs_id].data == NULL) {
+    return;
+  }
+  attrs_unref(rib, attrs_id);
+}
+
+parsebgp_error_t parsebgp_rib_route_set(parsebgp_rib_t *rib,
+                                        parsebgp_bgp_afi_t afi,
+                                        const uint8_t *prefix,
+                                        uint8_t prefix_len, uint16_t peer_idx,
+                                        uint32_t attrs_id)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint8_t masked[16];
+
+  if (afi_idx < 0 || prefix_len > MAX_PFX_LEN(afi_idx) ||
+      peer_idx >= rib->peers_cnt || attrs_id == 0 ||
+      attrs_id >= rib->attrs_ids_cnt || rib->attrs[attrs_id].data == NULL) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  copy_masked(masked, prefix, prefix_len);
+  return route_set(rib, afi_idx, masked, prefix_len, peer_idx, attrs_id);
+}
+
+void parsebgp_rib_route_remove(parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                               const uint8_t *prefix, uint8_t prefix_len,
+                               uint16_t peer_idx)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint8_t masked[16];
+
+  if (afi_idx < 0 || prefix_len > MAX_PFX_LEN(afi_idx)) {
+    return;
+  }
+  copy_masked(masked, prefix, prefix_len);
+  route_remove(rib, afi_idx, masked, prefix_len, peer_idx);
+}
+
+void parsebgp_rib_path_attrs_destroy(
+  parsebgp_bgp_update_path_attrs_t *path_attrs)
+{
+  parsebgp_bgp_update_path_attrs_destroy(path_attrs);
+}
+
+void parsebgp_rib_get_stats(const parsebgp_rib_t *rib,
+                            parsebgp_rib_stats_t *stats)
+{
+  stats->ipv4_prefixes_cnt = rib->prefixes_cnt[0];
+  stats->ipv6_prefixes_cnt = rib->prefixes_cnt[1];
+  stats->routes_cnt = rib->routes_cnt;
+  stats->nodes_cnt = rib->nodes_cnt;
+  stats->peers_cnt = rib->peers_cnt;
+  stats->attrs_cnt = rib->attrs_cnt;
+  stats->attrs_bytes = rib->attrs_bytes;
+}
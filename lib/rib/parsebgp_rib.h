@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_RIB_H
+#define __PARSEBGP_RIB_H
+
+#include "parsebgp.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * In-memory RIB
+ *
+ * A RIB holds the per-peer Adj-RIB-In state reconstructed from a stream of
+ * parsed messages. It is fed with the messages produced by parsebgp_decode
+ * (TABLE_DUMP and TABLE_DUMP_V2 snapshots, BGP4MP updates and state changes,
+ * and BMP route monitoring and peer down messages) and applies announcements
+ * and withdrawals (including MP_REACH and MP_UNREACH) incrementally.
+ *
+ * Prefixes are kept in a path-compressed radix tree per AFI (only unicast
+ * routes are tracked), and each prefix holds one route per peer. Routes
+ * reference interned Path Attribute sets, so routes with identical attributes
+ * share a single copy.
+ */
+typedef struct parsebgp_rib parsebgp_rib_t;
+
+/** Maximum number of peers that a RIB can track */
+#define PARSEBGP_RIB_PEERS_MAX UINT16_MAX
+
+/**
+ * RIB Peer
+ *
+ * Peers are identified by address, ASN, BMP Route Distinguisher and BMP
+ * post-policy flag (MRT peers always have the latter two set to zero).
+ */
+typedef struct parsebgp_rib_peer {
+
+  /** Peer IP AFI (parsebgp_bgp_afi_t) */
+  uint16_t afi;
+
+  /** Peer IP Address */
+  uint8_t addr[16];
+
+  /** Peer ASN */
+  uint32_t asn;
+
+  /** Peer Route Distinguisher (BMP only) */
+  uint64_t dist_id;
+
+  /** Set if the routes are post-policy (BMP only) */
+  uint8_t post_policy;
+
+  /** Peer BGP ID (if known) */
+  uint8_t bgp_id[4];
+
+  /** Number of routes currently held for this peer */
+  uint64_t routes_cnt;
+
+} parsebgp_rib_peer_t;
+
+/**
+ * RIB Route (one per peer per prefix)
+ */
+typedef struct parsebgp_rib_route {
+
+  /** ID of the interned Path Attribute set of the route (see
+      parsebgp_rib_attrs_get) */
+  uint32_t attrs_id;
+
+  /** Index of the peer that the route was received from (see
+      parsebgp_rib_get_peer) */
+  uint16_t peer_idx;
+
+} parsebgp_rib_route_t;
+
+/**
+ * RIB statistics
+ */
+typedef struct parsebgp_rib_stats {
+
+  /** Number of IPv4 prefixes */
+  uint64_t ipv4_prefixes_cnt;
+
+  /** Number of IPv6 prefixes */
+  uint64_t ipv6_prefixes_cnt;
+
+  /** Number of routes (across all peers and prefixes) */
+  uint64_t routes_cnt;
+
+  /** Number of radix tree nodes (including internal nodes) */
+  uint64_t nodes_cnt;
+
+  /** Number of peers */
+  int peers_cnt;
+
+  /** Number of interned Path Attribute sets */
+  uint64_t attrs_cnt;
+
+  /** Total size of the interned Path Attribute sets (in bytes) */
+  uint64_t attrs_bytes;
+
+} parsebgp_rib_stats_t;
+
+/**
+ * Callback used by parsebgp_rib_walk
+ *
+ * @param prefix        Pointer to the prefix address (16 bytes)
+ * @param prefix_len    Length of the prefix mask
+ * @param routes        Array of routes for the prefix (sorted by peer index)
+ * @param routes_cnt    Number of routes in the array
+ * @param user          User pointer passed to parsebgp_rib_walk
+ * @return 0 to continue walking, non-zero to stop
+ */
+typedef int(parsebgp_rib_walk_cb_t)(const uint8_t *prefix, uint8_t prefix_len,
+                                    const parsebgp_rib_route_t *routes,
+                                    int routes_cnt, void *user);
+
+/**
+ * Types of RIB changes (see parsebgp_rib_set_change_cb)
+ */
+typedef enum {
+
+  /** A route was added, or its attribute set changed */
+  PARSEBGP_RIB_CHANGE_ANNOUNCE = 1,
+
+  /** A route was removed */
+  PARSEBGP_RIB_CHANGE_WITHDRAW = 2,
+
+  /** All routes of a peer were removed */
+  PARSEBGP_RIB_CHANGE_PEER_FLUSH = 3,
+
+  /** All routes were removed */
+  PARSEBGP_RIB_CHANGE_CLEAR = 4,
+
+  /** An attribute set was created (its ID may previously have been used by a
+      different set that has since been freed) */
+  PARSEBGP_RIB_CHANGE_ATTRS_NEW = 5,
+
+} parsebgp_rib_change_type_t;
+
+/**
+ * RIB change
+ */
+typedef struct parsebgp_rib_change {
+
+  /** Type of change */
+  parsebgp_rib_change_type_t type;
+
+  /** AFI of the prefix (parsebgp_bgp_afi_t, ANNOUNCE and WITHDRAW only) */
+  uint16_t afi;
+
+  /** Pointer to the prefix address (ANNOUNCE and WITHDRAW only) */
+  const uint8_t *prefix;
+
+  /** Length of the prefix mask (ANNOUNCE and WITHDRAW only) */
+  uint8_t prefix_len;
+
+  /** Index of the peer (ANNOUNCE, WITHDRAW and PEER_FLUSH only) */
+  uint16_t peer_idx;
+
+  /** ID of the attribute set (ANNOUNCE and ATTRS_NEW only) */
+  uint32_t attrs_id;
+
+} parsebgp_rib_change_t;
+
+/**
+ * Callback used by parsebgp_rib_set_change_cb
+ *
+ * @param change        Pointer to the change (only valid during the call)
+ * @param user          User pointer passed to parsebgp_rib_set_change_cb
+ *
+ * The RIB must not be modified by the callback.
+ */
+typedef void(parsebgp_rib_change_cb_t)(const parsebgp_rib_change_t *change,
+                                       void *user);
+
+/** Create an empty RIB */
+parsebgp_rib_t *parsebgp_rib_create(void);
+
+/** Destroy a RIB */
+void parsebgp_rib_destroy(parsebgp_rib_t *rib);
+
+/** Remove all routes from a RIB (peers are kept) */
+void parsebgp_rib_clear(parsebgp_rib_t *rib);
+
+/**
+ * Apply a parsed message to the RIB
+ *
+ * @param rib           Pointer to the RIB to update
+ * @param msg           Pointer to the parsed message
+ * @return PARSEBGP_OK (0) if the message was applied successfully (or did not
+ * affect the RIB), or an error code otherwise
+ *
+ * This must be called before the buffer that the message was decoded from is
+ * modified, since the raw Path Attributes are copied from it.
+ *
+ * TABLE_DUMP_V2 snapshots are applied on top of the existing state, so use
+ * parsebgp_rib_clear first if the snapshot is meant to replace it.
+ */
+parsebgp_error_t parsebgp_rib_apply(parsebgp_rib_t *rib,
+                                    const parsebgp_msg_t *msg);
+
+/**
+ * Remove all routes of a peer
+ *
+ * @param rib           Pointer to the RIB to update
+ * @param peer_idx      Index of the peer
+ *
+ * This is done automatically when a BGP4MP state change out of ESTABLISHED or
+ * a BMP peer down message is applied.
+ */
+void parsebgp_rib_peer_flush(parsebgp_rib_t *rib, uint16_t peer_idx);
+
+/**
+ * Set the callback to call for every change made to the RIB
+ *
+ * @param rib           Pointer to the RIB
+ * @param cb            Callback to call (NULL to disable)
+ * @param user          User pointer to pass to the callback
+ *
+ * Changes are reported after they are made. Removing the routes of a peer or
+ * all routes is reported as a single PEER_FLUSH or CLEAR change.
+ */
+void parsebgp_rib_set_change_cb(parsebgp_rib_t *rib,
+                                parsebgp_rib_change_cb_t *cb, void *user);
+
+/**
+ * Find or add a peer
+ *
+ * @param rib           Pointer to the RIB
+ * @param peer          Pointer to the peer to find (routes_cnt is ignored, and
+ *                      bgp_id is updated if the peer is found)
+ * @param [out] peer_idx Set to the index of the peer
+ * @return PARSEBGP_OK, or an error code if the peer could not be added
+ */
+parsebgp_error_t parsebgp_rib_peer_add(parsebgp_rib_t *rib,
+                                       const parsebgp_rib_peer_t *peer,
+                                       uint16_t *peer_idx);
+
+/** Get the number of peers known to the RIB */
+int parsebgp_rib_get_peers_cnt(const parsebgp_rib_t *rib);
+
+/** Get the peer with the given index (or NULL if there is no such peer) */
+const parsebgp_rib_peer_t *parsebgp_rib_get_peer(const parsebgp_rib_t *rib,
+                                                 uint16_t peer_idx);
+
+/**
+ * Get the routes for a prefix
+ *
+ * @param rib           Pointer to the RIB
+ * @param afi           AFI of the prefix (parsebgp_bgp_afi_t)
+ * @param prefix        Pointer to the prefix address
+ * @param prefix_len    Length of the prefix mask
+ * @param [out] routes  Set to the (read-only) array of routes, sorted by peer
+ *                      index. Only valid until the RIB is next modified.
+ * @return the number of routes (0 if the prefix is not in the RIB)
+ */
+int parsebgp_rib_lookup(const parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                        const uint8_t *prefix, uint8_t prefix_len,
+                        const parsebgp_rib_route_t **routes);
+
+/**
+ * Walk all prefixes of an AFI in order
+ *
+ * @param rib           Pointer to the RIB
+ * @param afi           AFI to walk (parsebgp_bgp_afi_t)
+ * @param cb            Callback to call for each prefix
+ * @param user          User pointer to pass to the callback
+ * @return 1 if the walk was stopped by the callback, 0 otherwise
+ *
+ * The RIB must not be modified by the callback.
+ */
+int parsebgp_rib_walk(const parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                      parsebgp_rib_walk_cb_t *cb, void *user);
+
+/**
+ * Get an interned Path Attribute set
+ *
+ * @param rib           Pointer to the RIB
+ * @param attrs_id      ID of the attribute set (from a route)
+ * @param [out] buf     Set to the raw Path Attributes data, prefixed by the
+ *                      2-byte Total Path Attribute Length (as in an UPDATE)
+ * @param [out] len     Set to the length of the data
+ * @param [out] asn_4_byte Set if the AS_PATH uses 4-byte ASNs
+ * @return PARSEBGP_OK, or PARSEBGP_INVALID_MSG if the ID is not valid
+ *
+ * The attributes are stored in wire format, except that MP_UNREACH is removed
+ * and MP_REACH is stored without NLRIs (and always in its full,
+ * non-abbreviated form).
+ */
+parsebgp_error_t parsebgp_rib_attrs_get(const parsebgp_rib_t *rib,
+                                        uint32_t attrs_id, const uint8_t **buf,
+                                        size_t *len, int *asn_4_byte);
+
+/**
+ * Decode an interned Path Attribute set
+ *
+ * @param rib           Pointer to the RIB
+ * @param attrs_id      ID of the attribute set (from a route)
+ * @param opts          Options for the parser
+ * @param path_attrs    Pointer to the (zeroed, or previously used) Path
+ *                      Attributes structure to decode into
+ * @return PARSEBGP_OK (0) if the attributes were decoded successfully, or an
+ * error code otherwise
+ *
+ * The structure should be released with parsebgp_rib_path_attrs_destroy.
+ */
+parsebgp_error_t
+parsebgp_rib_attrs_decode(const parsebgp_rib_t *rib, uint32_t attrs_id,
+                          parsebgp_opts_t *opts,
+                          parsebgp_bgp_update_path_attrs_t *path_attrs);
+
+/**
+ * Find or add an attribute set, and hold a reference to it
+ *
+ * @param rib           Pointer to the RIB
+ * @param buf           Pointer to the attribute set data (in the format
+ *                      returned by parsebgp_rib_attrs_get)
+ * @param len           Length of the data
+ * @param asn_4_byte    Set if the AS_PATH uses 4-byte ASNs
+ * @param [out] attrs_id Set to the ID of the attribute set
+ * @return PARSEBGP_OK, or an error code if the data is not valid or the set
+ * could not be added
+ *
+ * The reference must be released with parsebgp_rib_attrs_release once the set
+ * has been used to add routes (parsebgp_rib_clear drops all references).
+ */
+parsebgp_error_t parsebgp_rib_attrs_add(parsebgp_rib_t *rib,
+                                        const uint8_t *buf, size_t len,
+                                        int asn_4_byte, uint32_t *attrs_id);
+
+/** Release a reference taken by parsebgp_rib_attrs_add (the set is freed if
+    no routes reference it) */
+void parsebgp_rib_attrs_release(parsebgp_rib_t *rib, uint32_t attrs_id);
+
+/**
+ * Add or replace a route
+ *
+ * @param rib           Pointer to the RIB
+ * @param afi           AFI of the prefix (parsebgp_bgp_afi_t)
+ * @param prefix        Pointer to the prefix address
+ * @param prefix_len    Length of the prefix mask
+ * @param peer_idx      Index of the peer
+ * @param attrs_id      ID of the attribute set of the route
+ * @return PARSEBGP_OK, or an error code if the route could not be set
+ */
+parsebgp_error_t parsebgp_rib_route_set(parsebgp_rib_t *rib,
+                                        parsebgp_bgp_afi_t afi,
+                                        const uint8_t *prefix,
+                                        uint8_t prefix_len, uint16_t peer_idx,
+                                        uint32_t attrs_id);
+
+/** Remove a route (if present) */
+void parsebgp_rib_route_remove(parsebgp_rib_t *rib, parsebgp_bgp_afi_t afi,
+                               const uint8_t *prefix, uint8_t prefix_len,
+                               uint16_t peer_idx);
+
+/** Free the memory used by a Path Attributes structure that was filled by
+    parsebgp_rib_attrs_decode (the structure itself is not freed) */
+void parsebgp_rib_path_attrs_destroy(
+  parsebgp_bgp_update_path_attrs_t *path_attrs);
+
+/** Get RIB statistics */
+void parsebgp_rib_get_stats(const parsebgp_rib_t *rib,
+                            parsebgp_rib_stats_t *stats);
+
+#endif /* __PARSEBGP_RIB_H */
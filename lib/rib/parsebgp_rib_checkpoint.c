@@ -0,0 +1,743 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_rib_checkpoint.h"
+#include "parsebgp_error.h"
+#include "parsebgp_rib_snapshot.h"
+#include "parsebgp_utils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Delta log magic */
+#define DELTA_MAGIC "PBGPDLT"
+
+/** Delta log format version */
+#define DELTA_VERSION 1
+
+/** Written in native byte order to detect foreign logs */
+#define DELTA_BYTE_ORDER 0x01020304
+
+/** Size of the delta log write buffer */
+#define DELTA_BUF_LEN (1 << 20)
+
+/** Initial number of allocated attribute set flags */
+#define ATTRS_LOGGED_ALLOC_INIT 1024
+
+/** Length of the longest fixed-size part of a delta record */
+#define DELTA_REC_MAX 64
+
+/** Delta log record types */
+enum {
+
+  /** Peer definition: u16 index, u16 afi, u8 post_policy, u32 asn, u64
+      dist_id, addr[16], bgp_id[4] */
+  DELTA_OP_PEER = 1,
+
+  /** Attribute set definition: u32 ID, u8 asn_4_byte, u32 length, data */
+  DELTA_OP_ATTRS = 2,
+
+  /** Route announcement: u8 afi index, u8 prefix length, u16 peer index, u32
+      attribute set ID, prefix (only the bytes covered by the length) */
+  DELTA_OP_ANNOUNCE = 3,
+
+  /** Route withdrawal: u8 afi index, u8 prefix length, u16 peer index,
+      prefix */
+  DELTA_OP_WITHDRAW = 4,
+
+  /** Peer flush: u16 peer index */
+  DELTA_OP_PEER_FLUSH = 5,
+
+  /** Clear (no fields) */
+  DELTA_OP_CLEAR = 6,
+};
+
+/** Delta log header */
+typedef struct delta_hdr {
+
+  /** DELTA_MAGIC (NUL-terminated) */
+  uint8_t magic[8];
+
+  /** DELTA_VERSION */
+  uint32_t version;
+
+  /** DELTA_BYTE_ORDER */
+  uint32_t byte_order;
+
+  /** Hash of the base that the log applies to */
+  uint64_t base_hash;
+
+} delta_hdr_t;
+
+struct parsebgp_rib_checkpoint {
+
+  /** RIB being checkpointed */
+  parsebgp_rib_t *rib;
+
+  /** Path of the base snapshot */
+  char *base_path;
+
+  /** Path of the delta log */
+  char *delta_path;
+
+  /** Delta log file (NULL if not open) */
+  FILE *delta;
+
+  /** Length of the delta log */
+  uint64_t delta_len;
+
+  /** Number of peers defined in the delta log */
+  int peers_logged;
+
+  /** Flags set for the attribute set IDs defined in the delta log */
+  uint8_t *attrs_logged;
+
+  /** Number of allocated attribute set flags */
+  uint32_t _attrs_logged_alloc_cnt;
+
+  /** First error that caused a change to be lost */
+  parsebgp_error_t err;
+};
+
+/** State used while replaying a delta log */
+typedef struct replay {
+
+  /** RIB being restored */
+  parsebgp_rib_t *rib;
+
+  /** Map from logged peer index to RIB peer index plus one (zero if
+      undefined) */
+  uint32_t *peers;
+
+  /** Number of allocated peer mappings */
+  int _peers_alloc_cnt;
+
+  /** Map from logged attribute set ID to (held) RIB ID (zero if undefined) */
+  uint32_t *attrs;
+
+  /** Number of allocated attribute set mappings */
+  uint32_t _attrs_alloc_cnt;
+
+} replay_t;
+
+/** Append a field to a record */
+#define REC_PUT(rec, n, val)                                                   \
+  do {                                                                         \
+    memcpy((rec) + (n), &(val), sizeof(val));                                  \
+    (n) += sizeof(val);                                                        \
+  } while (0)
+
+/** Read a field from a record (returns from the caller if it is truncated) */
+#define REC_GET(buf, remain, val)                                              \
+  do {                                                                         \
+    if ((remain) < sizeof(val)) {                                              \
+      return PARSEBGP_PARTIAL_MSG;                                             \
+    }                                                                          \
+    memcpy(&(val), (buf), sizeof(val));                                        \
+    (buf) += sizeof(val);                                                      \
+    (remain) -= sizeof(val);                                                   \
+  } while (0)
+
+static char *path_concat(const char *path, const char *suffix)
+{
+  char *p;
+
+  if ((p = malloc(strlen(path) + strlen(suffix) + 1)) != NULL) {
+    strcpy(p, path);
+    strcat(p, suffix);
+  }
+  return p;
+}
+
+/* -------------------- Delta Log Writer -------------------- */
+
+static void log_write(parsebgp_rib_checkpoint_t *cp, const void *buf,
+                      size_t len)
+{
+  if (cp->err != PARSEBGP_OK) {
+    return;
+  }
+  if (cp->delta == NULL || fwrite(buf, 1, len, cp->delta) != len) {
+    cp->err = PARSEBGP_IO_ERROR;
+    return;
+  }
+  cp->delta_len += len;
+}
+
+/** Define all peers up to (and including) the given index */
+static void log_peers(parsebgp_rib_checkpoint_t *cp, uint16_t peer_idx)
+{
+  const parsebgp_rib_peer_t *peer;
+  uint8_t rec[DELTA_REC_MAX], op = DELTA_OP_PEER;
+  uint16_t idx;
+  size_t n;
+
+  for (; cp->peers_logged <= peer_idx; cp->peers_logged++) {
+    idx = cp->peers_logged;
+    peer = parsebgp_rib_get_peer(cp->rib, idx);
+    n = 0;
+    REC_PUT(rec, n, op);
+    REC_PUT(rec, n, idx);
+    REC_PUT(rec, n, peer->afi);
+    REC_PUT(rec, n, peer->post_policy);
+    REC_PUT(rec, n, peer->asn);
+    REC_PUT(rec, n, peer->dist_id);
+    REC_PUT(rec, n, peer->addr);
+    REC_PUT(rec, n, peer->bgp_id);
+    log_write(cp, rec, n);
+  }
+}
+
+/** Define an attribute set (unless it has been since it was created) */
+static void log_attrs(parsebgp_rib_checkpoint_t *cp, uint32_t attrs_id)
+{
+  uint8_t rec[DELTA_REC_MAX], op = DELTA_OP_ATTRS, asn_4_byte, *logged;
+  const uint8_t *buf;
+  size_t len, n = 0;
+  uint32_t alloc_cnt, len32;
+  int flag;
+
+  if (attrs_id >= cp->_attrs_logged_alloc_cnt) {
+    alloc_cnt = cp->_attrs_logged_alloc_cnt;
+    while (alloc_cnt <= attrs_id) {
+      alloc_cnt *= 2;
+    }
+    if ((logged = realloc(cp->attrs_logged, alloc_cnt)) == NULL) {
+      cp->err = PARSEBGP_MALLOC_FAILURE;
+      return;
+    }
+    cp->attrs_logged = logged;
+    memset(cp->attrs_logged + cp->_attrs_logged_alloc_cnt, 0,
+           alloc_cnt - cp->_attrs_logged_alloc_cnt);
+    cp->_attrs_logged_alloc_cnt = alloc_cnt;
+  }
+  if (cp->attrs_logged[attrs_id]) {
+    return;
+  }
+
+  if (parsebgp_rib_attrs_get(cp->rib, attrs_id, &buf, &len, &flag) !=
+      PARSEBGP_OK) {
+    cp->err = PARSEBGP_INVALID_MSG;
+    return;
+  }
+  asn_4_byte = flag;
+  len32 = len;
+  REC_PUT(rec, n, op);
+  REC_PUT(rec, n, attrs_id);
+  REC_PUT(rec, n, asn_4_byte);
+  REC_PUT(rec, n, len32);
+  log_write(cp, rec, n);
+  log_write(cp, buf, len);
+  cp->attrs_logged[attrs_id] = 1;
+}
+
+static void log_change(const parsebgp_rib_change_t *change, void *user)
+{
+  parsebgp_rib_checkpoint_t *cp = user;
+  uint8_t rec[DELTA_REC_MAX], op, afi_idx;
+  size_t n = 0;
+
+  switch (change->type) {
+  case PARSEBGP_RIB_CHANGE_ATTRS_NEW:
+    // the ID may have been defined for a set that has since been freed
+    if (change->attrs_id < cp->_attrs_logged_alloc_cnt) {
+      cp->attrs_logged[change->attrs_id] = 0;
+    }
+    return;
+
+  case PARSEBGP_RIB_CHANGE_ANNOUNCE:
+  case PARSEBGP_RIB_CHANGE_WITHDRAW:
+    log_peers(cp, change->peer_idx);
+    if (change->type == PARSEBGP_RIB_CHANGE_ANNOUNCE) {
+      log_attrs(cp, change->attrs_id);
+      op = DELTA_OP_ANNOUNCE;
+    } else {
+      op = DELTA_OP_WITHDRAW;
+    }
+    afi_idx = change->afi == PARSEBGP_BGP_AFI_IPV4 ? 0 : 1;
+    REC_PUT(rec, n, op);
+    REC_PUT(rec, n, afi_idx);
+    REC_PUT(rec, n, change->prefix_len);
+    REC_PUT(rec, n, change->peer_idx);
+    if (op == DELTA_OP_ANNOUNCE) {
+      REC_PUT(rec, n, change->attrs_id);
+    }
+    memcpy(rec + n, change->prefix, (change->prefix_len + 7) / 8);
+    n += (change->prefix_len + 7) / 8;
+    break;
+
+  case PARSEBGP_RIB_CHANGE_PEER_FLUSH:
+    log_peers(cp, change->peer_idx);
+    op = DELTA_OP_PEER_FLUSH;
+    REC_PUT(rec, n, op);
+    REC_PUT(rec, n, change->peer_idx);
+    break;
+
+  case PARSEBGP_RIB_CHANGE_CLEAR:
+    // all attribute sets are freed
+    memset(cp->attrs_logged, 0, cp->_attrs_logged_alloc_cnt);
+    op = DELTA_OP_CLEAR;
+    REC_PUT(rec, n, op);
+    break;
+
+  default:
+    return;
+  }
+  log_write(cp, rec, n);
+}
+
+/* -------------------- Delta Log Replay -------------------- */
+
+static parsebgp_error_t replay_peer(replay_t *r, const uint8_t **bufp,
+                                    size_t *remain)
+{
+  const uint8_t *buf = *bufp;
+  parsebgp_rib_peer_t peer;
+  uint16_t idx, rib_idx;
+  parsebgp_error_t err;
+
+  memset(&peer, 0, sizeof(peer));
+  REC_GET(buf, *remain, idx);
+  REC_GET(buf, *remain, peer.afi);
+  REC_GET(buf, *remain, peer.post_policy);
+  REC_GET(buf, *remain, peer.asn);
+  REC_GET(buf, *remain, peer.dist_id);
+  REC_GET(buf, *remain, peer.addr);
+  REC_GET(buf, *remain, peer.bgp_id);
+  *bufp = buf;
+
+  if ((err = parsebgp_rib_peer_add(r->rib, &peer, &rib_idx)) != PARSEBGP_OK) {
+    return err;
+  }
+  PARSEBGP_MAYBE_REALLOC(r->peers, r->_peers_alloc_cnt, (int)idx + 1);
+  r->peers[idx] = rib_idx + 1;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t replay_attrs(replay_t *r, const uint8_t **bufp,
+                                     size_t *remain)
+{
+  const uint8_t *buf = *bufp;
+  uint32_t id, len, alloc_cnt;
+  uint8_t asn_4_byte;
+  parsebgp_error_t err;
+
+  REC_GET(buf, *remain, id);
+  REC_GET(buf, *remain, asn_4_byte);
+  REC_GET(buf, *remain, len);
+  if (*remain < len) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+
+  if (id >= r->_attrs_alloc_cnt) {
+    alloc_cnt = r->_attrs_alloc_cnt == 0 ? 1024 : r->_attrs_alloc_cnt;
+    while (alloc_cnt <= id) {
+      alloc_cnt *= 2;
+    }
+    PARSEBGP_MAYBE_REALLOC(r->attrs, r->_attrs_alloc_cnt, alloc_cnt);
+  }
+  if (r->attrs[id] != 0) {
+    parsebgp_rib_attrs_release(r->rib, r->attrs[id]);
+    r->attrs[id] = 0;
+  }
+  if ((err = parsebgp_rib_attrs_add(r->rib, buf, len, asn_4_byte,
+                                    &r->attrs[id])) != PARSEBGP_OK) {
+    return err;
+  }
+  *bufp = buf + len;
+  *remain -= len;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t replay_route(replay_t *r, uint8_t op,
+                                     const uint8_t **bufp, size_t *remain)
+{
+  const uint8_t *buf = *bufp;
+  uint8_t afi_idx, prefix_len, prefix[16];
+  uint16_t peer_idx;
+  uint32_t attrs_id = 0;
+  size_t bytes;
+  parsebgp_bgp_afi_t afi;
+
+  REC_GET(buf, *remain, afi_idx);
+  REC_GET(buf, *remain, prefix_len);
+  REC_GET(buf, *remain, peer_idx);
+  if (op == DELTA_OP_ANNOUNCE) {
+    REC_GET(buf, *remain, attrs_id);
+  }
+  if (afi_idx > 1 || prefix_len > (afi_idx == 0 ? 32 : 128)) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  bytes = (prefix_len + 7) / 8;
+  if (*remain < bytes) {
+    return PARSEBGP_PARTIAL_MSG;
+  }
+  memset(prefix, 0, sizeof(prefix));
+  memcpy(prefix, buf, bytes);
+  *bufp = buf + bytes;
+  *remain -= bytes;
+
+  if (peer_idx >= r->_peers_alloc_cnt || r->peers[peer_idx] == 0) {
+    fprintf(stderr, "ERROR: Delta record refers to unknown peer %d\n",
+            peer_idx);
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  afi = afi_idx == 0 ? PARSEBGP_BGP_AFI_IPV4 : PARSEBGP_BGP_AFI_IPV6;
+  if (op == DELTA_OP_WITHDRAW) {
+    parsebgp_rib_route_remove(r->rib, afi, prefix, prefix_len,
+                              r->peers[peer_idx] - 1);
+    return PARSEBGP_OK;
+  }
+  if (attrs_id >= r->_attrs_alloc_cnt || r->attrs[attrs_id] == 0) {
+    fprintf(stderr, "ERROR: Delta record refers to unknown attribute set %u\n",
+            attrs_id);
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  return parsebgp_rib_route_set(r->rib, afi, prefix, prefix_len,
+                                r->peers[peer_idx] - 1, r->attrs[attrs_id]);
+}
+
+/** Replay one record */
+static parsebgp_error_t replay_rec(replay_t *r, const uint8_t **bufp,
+                                   size_t *remain)
+{
+  const uint8_t *buf = *bufp;
+  uint16_t peer_idx;
+  uint8_t op;
+  parsebgp_error_t err = PARSEBGP_OK;
+
+  REC_GET(buf, *remain, op);
+  switch (op) {
+  case DELTA_OP_PEER:
+    err = replay_peer(r, &buf, remain);
+    break;
+
+  case DELTA_OP_ATTRS:
+    err = replay_attrs(r, &buf, remain);
+    break;
+
+  case DELTA_OP_ANNOUNCE:
+  case DELTA_OP_WITHDRAW:
+    err = replay_route(r, op, &buf, remain);
+    break;
+
+  case DELTA_OP_PEER_FLUSH:
+    REC_GET(buf, *remain, peer_idx);
+    if (peer_idx >= r->_peers_alloc_cnt || r->peers[peer_idx] == 0) {
+      PARSEBGP_RETURN_INVALID_MSG_ERR;
+    }
+    parsebgp_rib_peer_flush(r->rib, r->peers[peer_idx] - 1);
+    break;
+
+  case DELTA_OP_CLEAR:
+    // this drops the references held on the attribute sets
+    parsebgp_rib_clear(r->rib);
+    if (r->attrs != NULL) {
+      memset(r->attrs, 0, sizeof(uint32_t) * r->_attrs_alloc_cnt);
+    }
+    break;
+
+  default:
+    fprintf(stderr, "ERROR: Unknown delta record type %d\n", op);
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  *bufp = buf;
+  return err;
+}
+
+/**
+ * Replay a delta log
+ *
+ * @param [out] valid_len Set to the length of the complete records
+ */
+static parsebgp_error_t replay(parsebgp_rib_t *rib, const uint8_t *buf,
+                               size_t len, size_t *valid_len)
+{
+  const uint8_t *start = buf;
+  replay_t r;
+  size_t remain = len;
+  uint32_t id;
+  parsebgp_error_t err = PARSEBGP_OK;
+
+  memset(&r, 0, sizeof(r));
+  r.rib = rib;
+  *valid_len = 0;
+  while (remain > 0) {
+    if ((err = replay_rec(&r, &buf, &remain)) != PARSEBGP_OK) {
+      break;
+    }
+    *valid_len = buf - start;
+  }
+  if (err == PARSEBGP_PARTIAL_MSG) {
+    // the process stopped part-way through writing the last record
+    fprintf(stderr, "WARNING: Skipping partial record at end of delta log\n");
+    err = PARSEBGP_OK;
+  }
+
+  for (id = 0; id < r._attrs_alloc_cnt; id++) {
+    if (r.attrs[id] != 0) {
+      parsebgp_rib_attrs_release(rib, r.attrs[id]);
+    }
+  }
+  free(r.peers);
+  free(r.attrs);
+  return err;
+}
+
+/**
+ * Restore a RIB from the checkpoint files
+ *
+ * @param [out] delta_len Set to the length of the valid part of the delta log
+ * (zero if there is no usable delta log)
+ */
+static parsebgp_error_t restore(parsebgp_rib_t *rib, const char *base_path,
+                                const char *delta_path, size_t *delta_len)
+{
+  parsebgp_rib_snapshot_t *snap;
+  const delta_hdr_t *hdr;
+  uint64_t base_hash;
+  struct stat st;
+  void *map;
+  int fd;
+  parsebgp_error_t err;
+
+  *delta_len = 0;
+  if ((snap = parsebgp_rib_snapshot_open(base_path)) == NULL) {
+    return PARSEBGP_IO_ERROR;
+  }
+  err = parsebgp_rib_snapshot_load(snap, rib);
+  base_hash = parsebgp_rib_snapshot_get_hash(snap);
+  parsebgp_rib_snapshot_close(snap);
+  if (err != PARSEBGP_OK) {
+    return err;
+  }
+
+  if ((fd = open(delta_path, O_RDONLY)) < 0) {
+    fprintf(stderr, "WARNING: No delta log at %s\n", delta_path);
+    return PARSEBGP_OK;
+  }
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(delta_hdr_t) ||
+      (map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) ==
+        MAP_FAILED) {
+    fprintf(stderr, "WARNING: Ignoring unreadable delta log %s\n", delta_path);
+    close(fd);
+    return PARSEBGP_OK;
+  }
+  close(fd);
+
+  hdr = map;
+  if (memcmp(hdr->magic, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0 ||
+      hdr->version != DELTA_VERSION || hdr->byte_order != DELTA_BYTE_ORDER ||
+      hdr->base_hash != base_hash) {
+    // e.g., the process stopped after replacing the base but before replacing
+    // the delta log (the base already has all of its changes)
+    fprintf(stderr, "WARNING: Ignoring delta log %s (it is not for %s)\n",
+            delta_path, base_path);
+  } else {
+    err = replay(rib, (const uint8_t *)map + sizeof(delta_hdr_t),
+                 st.st_size - sizeof(delta_hdr_t), delta_len);
+    *delta_len += sizeof(delta_hdr_t);
+  }
+  munmap(map, st.st_size);
+  return err;
+}
+
+/* -------------------- Public API -------------------- */
+
+parsebgp_rib_checkpoint_t *parsebgp_rib_checkpoint_create(parsebgp_rib_t *rib,
+                                                          const char *path,
+                                                          int restore_rib)
+{
+  parsebgp_rib_checkpoint_t *cp;
+  size_t delta_len = 0;
+  parsebgp_error_t err;
+
+  if ((cp = malloc_zero(sizeof(parsebgp_rib_checkpoint_t))) == NULL) {
+    return NULL;
+  }
+  cp->rib = rib;
+  if ((cp->base_path = path_concat(path, ".base")) == NULL ||
+      (cp->delta_path = path_concat(path, ".delta")) == NULL ||
+      (cp->attrs_logged = malloc_zero(ATTRS_LOGGED_ALLOC_INIT)) == NULL) {
+    goto err;
+  }
+  cp->_attrs_logged_alloc_cnt = ATTRS_LOGGED_ALLOC_INIT;
+
+  if (restore_rib && access(cp->base_path, F_OK) == 0) {
+    if ((err = restore(rib, cp->base_path, cp->delta_path, &delta_len)) !=
+        PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to restore RIB from %s (%s)\n",
+              cp->base_path, parsebgp_strerror(err));
+      goto err;
+    }
+    // drop any partial record so that new records can be appended
+    if (delta_len > 0 && (truncate(cp->delta_path, delta_len) != 0 ||
+                          (cp->delta = fopen(cp->delta_path, "ab")) == NULL)) {
+      delta_len = 0;
+    }
+  }
+
+  parsebgp_rib_set_change_cb(rib, log_change, cp);
+  if (delta_len > 0) {
+    setvbuf(cp->delta, NULL, _IOFBF, DELTA_BUF_LEN);
+    cp->delta_len = delta_len;
+  } else if (parsebgp_rib_checkpoint_base(cp) != PARSEBGP_OK) {
+    goto err;
+  }
+  return cp;
+
+err:
+  parsebgp_rib_checkpoint_destroy(cp);
+  return NULL;
+}
+
+void parsebgp_rib_checkpoint_destroy(parsebgp_rib_checkpoint_t *cp)
+{
+  if (cp == NULL) {
+    return;
+  }
+  parsebgp_rib_set_change_cb(cp->rib, NULL, NULL);
+  if (cp->delta != NULL) {
+    fclose(cp->delta);
+  }
+  free(cp->base_path);
+  free(cp->delta_path);
+  free(cp->attrs_logged);
+  free(cp);
+}
+
+parsebgp_error_t parsebgp_rib_checkpoint_base(parsebgp_rib_checkpoint_t *cp)
+{
+  parsebgp_rib_snapshot_t *snap;
+  char *base_tmp = NULL, *delta_tmp = NULL;
+  delta_hdr_t hdr;
+  FILE *fh = NULL;
+  parsebgp_error_t err = PARSEBGP_MALLOC_FAILURE;
+
+  if ((base_tmp = path_concat(cp->base_path, ".tmp")) == NULL ||
+      (delta_tmp = path_concat(cp->delta_path, ".tmp")) == NULL) {
+    goto done;
+  }
+
+  // write the new files next to the old ones
+  if ((err = parsebgp_rib_snapshot_write(cp->rib, base_tmp)) != PARSEBGP_OK) {
+    goto done;
+  }
+  if ((snap = parsebgp_rib_snapshot_open(base_tmp)) == NULL) {
+    err = PARSEBGP_IO_ERROR;
+    goto done;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+  hdr.version = DELTA_VERSION;
+  hdr.byte_order = DELTA_BYTE_ORDER;
+  hdr.base_hash = parsebgp_rib_snapshot_get_hash(snap);
+  parsebgp_rib_snapshot_close(snap);
+
+  err = PARSEBGP_IO_ERROR;
+  if ((fh = fopen(delta_tmp, "wb")) == NULL ||
+      fwrite(&hdr, sizeof(hdr), 1, fh) != 1 || fflush(fh) != 0) {
+    goto done;
+  }
+
+  // and then replace them (the base first, since an old log is ignored if it
+  // does not match the base)
+  if (rename(base_tmp, cp->base_path) != 0) {
+    goto done;
+  }
+  if (rename(delta_tmp, cp->delta_path) != 0) {
+    // the new base is in place, but the old log no longer matches it, so any
+    // further changes would be lost: stop logging until a base is written
+    if (cp->delta != NULL) {
+      fclose(cp->delta);
+      cp->delta = NULL;
+    }
+    cp->err = PARSEBGP_IO_ERROR;
+    goto done;
+  }
+  if (cp->delta != NULL) {
+    fclose(cp->delta);
+  }
+  cp->delta = fh;
+  fh = NULL;
+  setvbuf(cp->delta, NULL, _IOFBF, DELTA_BUF_LEN);
+  cp->delta_len = sizeof(hdr);
+  cp->peers_logged = 0;
+  memset(cp->attrs_logged, 0, cp->_attrs_logged_alloc_cnt);
+  cp->err = PARSEBGP_OK;
+  err = PARSEBGP_OK;
+
+done:
+  if (fh != NULL) {
+    fclose(fh);
+  }
+  if (err != PARSEBGP_OK && base_tmp != NULL) {
+    unlink(base_tmp);
+    if (delta_tmp != NULL) {
+      unlink(delta_tmp);
+    }
+  }
+  free(base_tmp);
+  free(delta_tmp);
+  return err;
+}
+
+parsebgp_error_t parsebgp_rib_checkpoint_sync(parsebgp_rib_checkpoint_t *cp)
+{
+  if (cp->err == PARSEBGP_OK &&
+      (cp->delta == NULL || fflush(cp->delta) != 0)) {
+    cp->err = PARSEBGP_IO_ERROR;
+  }
+  return cp->err;
+}
+
+uint64_t
+parsebgp_rib_checkpoint_get_delta_len(const parsebgp_rib_checkpoint_t *cp)
+{
+  return cp->delta_len;
+}
+
+parsebgp_error_t parsebgp_rib_checkpoint_restore(parsebgp_rib_t *rib,
+                                                 const char *path)
+{
+  char *base_path, *delta_path;
+  size_t delta_len;
+  parsebgp_error_t err = PARSEBGP_MALLOC_FAILURE;
+
+  base_path = path_concat(path, ".base");
+  delta_path = path_concat(path, ".delta");
+  if (base_path != NULL && delta_path != NULL) {
+    err = restore(rib, base_path, delta_path, &delta_len);
+  }
+  free(base_path);
+  free(delta_path);
+  return err;
+}
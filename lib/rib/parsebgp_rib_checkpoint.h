@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_RIB_CHECKPOINT_H
+#define __PARSEBGP_RIB_CHECKPOINT_H
+
+#include "parsebgp.h"
+#include "parsebgp_rib.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * RIB Checkpoints
+ *
+ * A checkpoint lets a long-running consumer (e.g., of BMP streams) restart
+ * without waiting for every peer to re-send its full table. It consists of a
+ * base snapshot (<path>.base, see parsebgp_rib_snapshot_write) and an
+ * append-only delta log (<path>.delta) of every RIB change made since the base
+ * was written (route announcements and withdrawals, peer flushes, and the
+ * peers and attribute sets that they refer to).
+ *
+ * Restoring loads the base and replays the delta. A new base should be written
+ * periodically (e.g., once the delta grows to a fraction of the base size) to
+ * bound the restore time.
+ */
+typedef struct parsebgp_rib_checkpoint parsebgp_rib_checkpoint_t;
+
+/**
+ * Start checkpointing a RIB
+ *
+ * @param rib           Pointer to the RIB (which must not be destroyed before
+ *                      the checkpoint)
+ * @param path          Path prefix of the checkpoint files
+ * @param restore       If set, and a checkpoint exists at the path, the RIB
+ *                      (which should be empty) is first restored from it and
+ *                      the existing delta log is appended to
+ * @return pointer to the checkpoint, or NULL if the files could not be written
+ *
+ * If there is no checkpoint to restore, a base is written immediately. The RIB
+ * change callback is used by the checkpoint, so it must not be replaced while
+ * the checkpoint exists.
+ */
+parsebgp_rib_checkpoint_t *parsebgp_rib_checkpoint_create(parsebgp_rib_t *rib,
+                                                          const char *path,
+                                                          int restore);
+
+/** Stop checkpointing (the delta log is flushed, and the files are kept) */
+void parsebgp_rib_checkpoint_destroy(parsebgp_rib_checkpoint_t *cp);
+
+/**
+ * Write a new base and start a new (empty) delta log
+ *
+ * @param cp            Pointer to the checkpoint
+ * @return PARSEBGP_OK (0) if the base was written, or an error code otherwise
+ *
+ * The new files replace the old ones only once they are complete, so a crash
+ * during this call leaves the previous checkpoint intact. If the new base
+ * replaced the old one but the new delta log could not, the checkpoint stops
+ * logging changes (see parsebgp_rib_checkpoint_sync) until a base is written
+ * successfully.
+ */
+parsebgp_error_t parsebgp_rib_checkpoint_base(parsebgp_rib_checkpoint_t *cp);
+
+/**
+ * Flush the delta log to the operating system
+ *
+ * @param cp            Pointer to the checkpoint
+ * @return PARSEBGP_OK (0) if all changes have been written, or the error that
+ * caused a change to be lost
+ */
+parsebgp_error_t parsebgp_rib_checkpoint_sync(parsebgp_rib_checkpoint_t *cp);
+
+/** Get the length of the delta log (in bytes) */
+uint64_t
+parsebgp_rib_checkpoint_get_delta_len(const parsebgp_rib_checkpoint_t *cp);
+
+/**
+ * Restore a RIB from a checkpoint (without continuing to checkpoint it)
+ *
+ * @param rib           Pointer to the (empty) RIB to restore into
+ * @param path          Path prefix of the checkpoint files
+ * @return PARSEBGP_OK (0) if the RIB was restored, or an error code otherwise
+ *
+ * A delta log that does not belong to the base (e.g., because the process
+ * stopped while writing a new base) is ignored, and a partially written record
+ * at the end of the log is skipped.
+ */
+parsebgp_error_t parsebgp_rib_checkpoint_restore(parsebgp_rib_t *rib,
+                                                 const char *path);
+
+#endif /* __PARSEBGP_RIB_CHECKPOINT_H */
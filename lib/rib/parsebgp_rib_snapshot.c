@@ -0,0 +1,864 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp_rib_snapshot.h"
+#include "parsebgp_bgp_update_impl.h"
+#include "parsebgp_error.h"
+#include "parsebgp_utils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Snapshot file magic */
+#define SNAP_MAGIC "PBGPRIB"
+
+/** Snapshot format version */
+#define SNAP_VERSION 1
+
+/** Written in native byte order to detect foreign snapshots */
+#define SNAP_BYTE_ORDER 0x01020304
+
+/** Address length for a table index */
+#define ADDR_LEN(afi_idx) ((afi_idx) == 0 ? 4 : 16)
+
+/** Size of a prefix key (the address, the length, and padding) */
+#define KEY_SIZE(afi_idx) (ADDR_LEN(afi_idx) + 4)
+
+/** Index of the table for the given AFI (-1 if unsupported) */
+#define AFI_IDX(afi)                                                           \
+  ((afi) == PARSEBGP_BGP_AFI_IPV4 ? 0 : ((afi) == PARSEBGP_BGP_AFI_IPV6 ? 1 : -1))
+
+/** Round a file offset up to the section alignment */
+#define ALIGN8(off) (((off) + 7) & ~(uint64_t)7)
+
+/** Snapshot file header (all offsets are from the start of the file) */
+typedef struct snap_hdr {
+
+  /** SNAP_MAGIC (NUL-terminated) */
+  uint8_t magic[8];
+
+  /** SNAP_VERSION */
+  uint32_t version;
+
+  /** SNAP_BYTE_ORDER */
+  uint32_t byte_order;
+
+  /** sizeof(parsebgp_rib_route_t) */
+  uint32_t route_size;
+
+  /** Number of peers */
+  uint32_t peers_cnt;
+
+  /** Number of prefixes in each table */
+  uint64_t prefixes_cnt[2];
+
+  /** Number of routes across both tables */
+  uint64_t routes_cnt;
+
+  /** Number of attribute set IDs (including the unused zero) */
+  uint64_t attrs_cnt;
+
+  /** Total length of the attribute sets */
+  uint64_t attrs_bytes;
+
+  /** Array of (peers_cnt) snap_peer_t */
+  uint64_t peers_off;
+
+  /** Arrays of (prefixes_cnt) prefix keys (KEY_SIZE bytes each, sorted) */
+  uint64_t keys_off[2];
+
+  /** Arrays of (prefixes_cnt + 1) uint64_t indexes into the routes of the
+      first route of each prefix (the last is the end of the table's routes) */
+  uint64_t routes_idx_off[2];
+
+  /** Array of (routes_cnt) parsebgp_rib_route_t */
+  uint64_t routes_off;
+
+  /** Array of (attrs_cnt + 1) uint64_t offsets into the attribute data of the
+      start of each set (the last is the end of the data) */
+  uint64_t attrs_idx_off;
+
+  /** Array of (attrs_cnt) uint8_t AS_PATH 4-byte ASN flags */
+  uint64_t attrs_flags_off;
+
+  /** Attribute set data */
+  uint64_t attrs_data_off;
+
+  /** Total length of the file */
+  uint64_t file_len;
+
+} snap_hdr_t;
+
+/** Snapshot peer record */
+typedef struct snap_peer {
+
+  /** Peer Route Distinguisher */
+  uint64_t dist_id;
+
+  /** Number of routes held for this peer */
+  uint64_t routes_cnt;
+
+  /** Peer ASN */
+  uint32_t asn;
+
+  /** Peer IP AFI */
+  uint16_t afi;
+
+  /** Set if the routes are post-policy */
+  uint8_t post_policy;
+
+  /** Padding (zero) */
+  uint8_t _pad;
+
+  /** Peer IP Address */
+  uint8_t addr[16];
+
+  /** Peer BGP ID */
+  uint8_t bgp_id[4];
+
+  /** Padding (zero) */
+  uint32_t _pad2;
+
+} snap_peer_t;
+
+struct parsebgp_rib_snapshot {
+
+  /** Mapped file */
+  const uint8_t *map;
+
+  /** Length of the mapped file */
+  size_t map_len;
+
+  /** File header */
+  const snap_hdr_t *hdr;
+
+  /** Peer records */
+  const snap_peer_t *peers;
+
+  /** Prefix keys of each table */
+  const uint8_t *keys[2];
+
+  /** Route indexes of each table */
+  const uint64_t *routes_idx[2];
+
+  /** Routes */
+  const parsebgp_rib_route_t *routes;
+
+  /** Attribute set offsets */
+  const uint64_t *attrs_idx;
+
+  /** Attribute set 4-byte ASN flags */
+  const uint8_t *attrs_flags;
+
+  /** Attribute set data */
+  const uint8_t *attrs_data;
+};
+
+/** State used while collecting the RIB contents */
+typedef struct snap_writer {
+
+  /** RIB being written */
+  const parsebgp_rib_t *rib;
+
+  /** Index of the table being walked */
+  int afi_idx;
+
+  /** Prefix keys of each table */
+  uint8_t *keys[2];
+
+  /** Allocated length of each key buffer */
+  uint64_t _keys_alloc_len[2];
+
+  /** Number of prefixes in each table */
+  uint64_t keys_cnt[2];
+
+  /** Route indexes of each table */
+  uint64_t *routes_idx[2];
+
+  /** Number of allocated route indexes of each table */
+  uint64_t _routes_idx_alloc_cnt[2];
+
+  /** Routes */
+  parsebgp_rib_route_t *routes;
+
+  /** Number of allocated routes */
+  uint64_t _routes_alloc_cnt;
+
+  /** Number of routes */
+  uint64_t routes_cnt;
+
+  /** Map from RIB attribute set ID to snapshot ID (zero if not yet seen) */
+  uint32_t *attrs_map;
+
+  /** Number of allocated map entries */
+  uint32_t _attrs_map_alloc_cnt;
+
+  /** Map from snapshot attribute set ID to RIB ID */
+  uint32_t *attrs_ids;
+
+  /** Number of allocated snapshot IDs */
+  uint32_t _attrs_ids_alloc_cnt;
+
+  /** Number of snapshot IDs (including the unused zero) */
+  uint32_t attrs_cnt;
+
+  /** Error that stopped the walk */
+  parsebgp_error_t err;
+
+} snap_writer_t;
+
+/* -------------------- Writer -------------------- */
+
+static parsebgp_error_t writer_add_attrs(snap_writer_t *w, uint32_t rib_id,
+                                         uint32_t *snap_id)
+{
+  uint32_t alloc_cnt;
+
+  if (rib_id >= w->_attrs_map_alloc_cnt) {
+    alloc_cnt = w->_attrs_map_alloc_cnt == 0 ? 1024 : w->_attrs_map_alloc_cnt;
+    while (alloc_cnt <= rib_id) {
+      alloc_cnt *= 2;
+    }
+    PARSEBGP_MAYBE_REALLOC(w->attrs_map, w->_attrs_map_alloc_cnt, alloc_cnt);
+  }
+  if (w->attrs_map[rib_id] == 0) {
+    if (w->attrs_cnt >= w->_attrs_ids_alloc_cnt) {
+      alloc_cnt =
+        w->_attrs_ids_alloc_cnt == 0 ? 1024 : w->_attrs_ids_alloc_cnt * 2;
+      PARSEBGP_MAYBE_REALLOC(w->attrs_ids, w->_attrs_ids_alloc_cnt, alloc_cnt);
+    }
+    w->attrs_ids[w->attrs_cnt] = rib_id;
+    w->attrs_map[rib_id] = w->attrs_cnt++;
+  }
+  *snap_id = w->attrs_map[rib_id];
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t writer_add_prefix(snap_writer_t *w,
+                                          const uint8_t *prefix,
+                                          uint8_t prefix_len,
+                                          const parsebgp_rib_route_t *routes,
+                                          int routes_cnt)
+{
+  int afi_idx = w->afi_idx;
+  uint64_t cnt = w->keys_cnt[afi_idx];
+  uint64_t alloc;
+  uint8_t *key;
+  parsebgp_rib_route_t *route;
+  int i;
+  parsebgp_error_t err;
+
+  if ((cnt + 1) * KEY_SIZE(afi_idx) > w->_keys_alloc_len[afi_idx]) {
+    alloc = w->_keys_alloc_len[afi_idx] == 0
+              ? 1024 * KEY_SIZE(afi_idx)
+              : w->_keys_alloc_len[afi_idx] * 2;
+    PARSEBGP_MAYBE_REALLOC(w->keys[afi_idx], w->_keys_alloc_len[afi_idx],
+                           alloc);
+  }
+  // one extra index for the end of the table
+  if (cnt + 2 > w->_routes_idx_alloc_cnt[afi_idx]) {
+    alloc = w->_routes_idx_alloc_cnt[afi_idx] == 0
+              ? 1024
+              : w->_routes_idx_alloc_cnt[afi_idx] * 2;
+    PARSEBGP_MAYBE_REALLOC(w->routes_idx[afi_idx],
+                           w->_routes_idx_alloc_cnt[afi_idx], alloc);
+  }
+  if (w->routes_cnt + routes_cnt > w->_routes_alloc_cnt) {
+    alloc = w->_routes_alloc_cnt == 0 ? 4096 : w->_routes_alloc_cnt * 2;
+    while (alloc < w->routes_cnt + routes_cnt) {
+      alloc *= 2;
+    }
+    PARSEBGP_MAYBE_REALLOC(w->routes, w->_routes_alloc_cnt, alloc);
+  }
+
+  key = &w->keys[afi_idx][cnt * KEY_SIZE(afi_idx)];
+  memcpy(key, prefix, ADDR_LEN(afi_idx));
+  key[ADDR_LEN(afi_idx)] = prefix_len;
+  // lookups use a binary search, so the walk must be in key order
+  if (cnt > 0 && memcmp(key - KEY_SIZE(afi_idx), key, KEY_SIZE(afi_idx)) >= 0) {
+    PARSEBGP_RETURN_INVALID_MSG_ERR;
+  }
+  w->routes_idx[afi_idx][cnt] = w->routes_cnt;
+
+  for (i = 0; i < routes_cnt; i++) {
+    // the array was zeroed when allocated, so padding is never garbage
+    route = &w->routes[w->routes_cnt++];
+    route->peer_idx = routes[i].peer_idx;
+    if ((err = writer_add_attrs(w, routes[i].attrs_id, &route->attrs_id)) !=
+        PARSEBGP_OK) {
+      return err;
+    }
+  }
+
+  w->keys_cnt[afi_idx]++;
+  w->routes_idx[afi_idx][cnt + 1] = w->routes_cnt;
+  return PARSEBGP_OK;
+}
+
+static int writer_walk_cb(const uint8_t *prefix, uint8_t prefix_len,
+                          const parsebgp_rib_route_t *routes, int routes_cnt,
+                          void *user)
+{
+  snap_writer_t *w = user;
+  w->err = writer_add_prefix(w, prefix, prefix_len, routes, routes_cnt);
+  return w->err != PARSEBGP_OK;
+}
+
+static parsebgp_error_t write_section(FILE *fh, const void *data,
+                                      uint64_t len, uint64_t *off)
+{
+  static const uint8_t zeros[8] = {0};
+  uint64_t pad = ALIGN8(len) - len;
+
+  if ((len > 0 && fwrite(data, 1, len, fh) != len) ||
+      (pad > 0 && fwrite(zeros, 1, pad, fh) != pad)) {
+    return PARSEBGP_IO_ERROR;
+  }
+  *off += len + pad;
+  return PARSEBGP_OK;
+}
+
+static parsebgp_error_t writer_write(snap_writer_t *w, const char *path)
+{
+  snap_hdr_t hdr;
+  snap_peer_t *peers = NULL;
+  const parsebgp_rib_peer_t *peer;
+  uint64_t *attrs_idx = NULL;
+  uint8_t *attrs_flags = NULL;
+  const uint8_t *buf;
+  size_t len;
+  int asn_4_byte;
+  uint64_t off = 0, zero = 0;
+  uint32_t id;
+  FILE *fh = NULL;
+  int i;
+  parsebgp_error_t err = PARSEBGP_MALLOC_FAILURE;
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+  hdr.version = SNAP_VERSION;
+  hdr.byte_order = SNAP_BYTE_ORDER;
+  hdr.route_size = sizeof(parsebgp_rib_route_t);
+  hdr.peers_cnt = parsebgp_rib_get_peers_cnt(w->rib);
+  hdr.routes_cnt = w->routes_cnt;
+  hdr.attrs_cnt = w->attrs_cnt;
+
+  if ((peers = malloc_zero(sizeof(snap_peer_t) * (hdr.peers_cnt + 1))) ==
+        NULL ||
+      (attrs_idx = malloc_zero(sizeof(uint64_t) * (w->attrs_cnt + 1))) ==
+        NULL ||
+      (attrs_flags = malloc_zero(w->attrs_cnt)) == NULL) {
+    goto done;
+  }
+
+  for (i = 0; i < (int)hdr.peers_cnt; i++) {
+    peer = parsebgp_rib_get_peer(w->rib, i);
+    peers[i].dist_id = peer->dist_id;
+    peers[i].routes_cnt = peer->routes_cnt;
+    peers[i].asn = peer->asn;
+    peers[i].afi = peer->afi;
+    peers[i].post_policy = peer->post_policy;
+    memcpy(peers[i].addr, peer->addr, sizeof(peers[i].addr));
+    memcpy(peers[i].bgp_id, peer->bgp_id, sizeof(peers[i].bgp_id));
+  }
+
+  // ID zero is never used
+  for (id = 1; id < w->attrs_cnt; id++) {
+    if ((err = parsebgp_rib_attrs_get(w->rib, w->attrs_ids[id], &buf, &len,
+                                      &asn_4_byte)) != PARSEBGP_OK) {
+      goto done;
+    }
+    attrs_idx[id + 1] = attrs_idx[id] + len;
+    attrs_flags[id] = asn_4_byte;
+  }
+  if (w->attrs_cnt > 0) {
+    hdr.attrs_bytes = attrs_idx[w->attrs_cnt];
+  }
+
+  // lay out the sections
+  off = ALIGN8(sizeof(snap_hdr_t));
+  hdr.peers_off = off;
+  off += ALIGN8(sizeof(snap_peer_t) * hdr.peers_cnt);
+  for (i = 0; i < 2; i++) {
+    hdr.prefixes_cnt[i] = w->keys_cnt[i];
+    hdr.keys_off[i] = off;
+    off += ALIGN8(w->keys_cnt[i] * KEY_SIZE(i));
+    hdr.routes_idx_off[i] = off;
+    off += ALIGN8(sizeof(uint64_t) * (w->keys_cnt[i] + 1));
+  }
+  hdr.routes_off = off;
+  off += ALIGN8(sizeof(parsebgp_rib_route_t) * w->routes_cnt);
+  hdr.attrs_idx_off = off;
+  off += ALIGN8(sizeof(uint64_t) * (hdr.attrs_cnt + 1));
+  hdr.attrs_flags_off = off;
+  off += ALIGN8(hdr.attrs_cnt);
+  hdr.attrs_data_off = off;
+  off += ALIGN8(hdr.attrs_bytes);
+  hdr.file_len = off;
+
+  if ((fh = fopen(path, "wb")) == NULL) {
+    fprintf(stderr, "ERROR: Could not open %s for writing\n", path);
+    err = PARSEBGP_IO_ERROR;
+    goto done;
+  }
+  off = 0;
+  if ((err = write_section(fh, &hdr, sizeof(hdr), &off)) != PARSEBGP_OK ||
+      (err = write_section(fh, peers, sizeof(snap_peer_t) * hdr.peers_cnt,
+                           &off)) != PARSEBGP_OK) {
+    goto done;
+  }
+  for (i = 0; i < 2; i++) {
+    if ((err = write_section(fh, w->keys[i], w->keys_cnt[i] * KEY_SIZE(i),
+                             &off)) != PARSEBGP_OK) {
+      goto done;
+    }
+    // an empty table still has its end index
+    if (w->keys_cnt[i] == 0) {
+      err = write_section(fh, &zero, sizeof(uint64_t), &off);
+    } else {
+      err = write_section(fh, w->routes_idx[i],
+                          sizeof(uint64_t) * (w->keys_cnt[i] + 1), &off);
+    }
+    if (err != PARSEBGP_OK) {
+      goto done;
+    }
+  }
+  if ((err = write_section(fh, w->routes,
+                           sizeof(parsebgp_rib_route_t) * w->routes_cnt,
+                           &off)) != PARSEBGP_OK ||
+      (err = write_section(fh, attrs_idx,
+                           sizeof(uint64_t) * (hdr.attrs_cnt + 1), &off)) !=
+        PARSEBGP_OK ||
+      (err = write_section(fh, attrs_flags, hdr.attrs_cnt, &off)) !=
+        PARSEBGP_OK) {
+    goto done;
+  }
+  for (id = 1; id < w->attrs_cnt; id++) {
+    parsebgp_rib_attrs_get(w->rib, w->attrs_ids[id], &buf, &len, NULL);
+    if (len > 0 && fwrite(buf, 1, len, fh) != len) {
+      err = PARSEBGP_IO_ERROR;
+      goto done;
+    }
+  }
+  if ((len = ALIGN8(hdr.attrs_bytes) - hdr.attrs_bytes) > 0 &&
+      fwrite(&zero, 1, len, fh) != len) {
+    err = PARSEBGP_IO_ERROR;
+    goto done;
+  }
+  err = PARSEBGP_OK;
+
+done:
+  if (fh != NULL && fclose(fh) != 0 && err == PARSEBGP_OK) {
+    err = PARSEBGP_IO_ERROR;
+  }
+  free(peers);
+  free(attrs_idx);
+  free(attrs_flags);
+  return err;
+}
+
+/* -------------------- Reader -------------------- */
+
+/** Check that a section of cnt elements of the given size is in the file */
+static int section_ok(const snap_hdr_t *hdr, uint64_t off, uint64_t cnt,
+                      uint64_t size)
+{
+  return (off % 8) == 0 && off <= hdr->file_len &&
+         (size == 0 || cnt <= (hdr->file_len - off) / size);
+}
+
+static int key_cmp(const uint8_t *a, const uint8_t *b, int afi_idx)
+{
+  return memcmp(a, b, ADDR_LEN(afi_idx) + 1);
+}
+
+/** Get the routes of prefix i of a table (zero if the indexes are corrupt) */
+static int snap_routes(const parsebgp_rib_snapshot_t *snap, int afi_idx,
+                       uint64_t i, const parsebgp_rib_route_t **routes)
+{
+  uint64_t start = snap->routes_idx[afi_idx][i];
+  uint64_t end = snap->routes_idx[afi_idx][i + 1];
+
+  if (start > end || end > snap->hdr->routes_cnt ||
+      end - start > PARSEBGP_RIB_PEERS_MAX) {
+    *routes = NULL;
+    return 0;
+  }
+  *routes = &snap->routes[start];
+  return end - start;
+}
+
+/* -------------------- Public API -------------------- */
+
+parsebgp_error_t parsebgp_rib_snapshot_write(const parsebgp_rib_t *rib,
+                                             const char *path)
+{
+  snap_writer_t w;
+  parsebgp_error_t err;
+  int i;
+
+  memset(&w, 0, sizeof(w));
+  w.rib = rib;
+  // ID zero is never used
+  w.attrs_cnt = 1;
+
+  for (i = 0; i < 2; i++) {
+    w.afi_idx = i;
+    w.err = PARSEBGP_OK;
+    parsebgp_rib_walk(rib, i == 0 ? PARSEBGP_BGP_AFI_IPV4 : PARSEBGP_BGP_AFI_IPV6,
+                      writer_walk_cb, &w);
+    if ((err = w.err) != PARSEBGP_OK) {
+      goto done;
+    }
+  }
+
+  err = writer_write(&w, path);
+
+done:
+  for (i = 0; i < 2; i++) {
+    free(w.keys[i]);
+    free(w.routes_idx[i]);
+  }
+  free(w.routes);
+  free(w.attrs_map);
+  free(w.attrs_ids);
+  return err;
+}
+
+parsebgp_rib_snapshot_t *parsebgp_rib_snapshot_open(const char *path)
+{
+  parsebgp_rib_snapshot_t *snap;
+  const snap_hdr_t *hdr;
+  struct stat st;
+  void *map;
+  int fd, i;
+
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    fprintf(stderr, "ERROR: Could not open snapshot %s\n", path);
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snap_hdr_t)) {
+    fprintf(stderr, "ERROR: Snapshot %s is too short\n", path);
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Could not map snapshot %s\n", path);
+    return NULL;
+  }
+
+  if ((snap = malloc_zero(sizeof(parsebgp_rib_snapshot_t))) == NULL) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  snap->map = map;
+  snap->map_len = st.st_size;
+  snap->hdr = hdr = map;
+
+  if (memcmp(hdr->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0 ||
+      hdr->version != SNAP_VERSION || hdr->byte_order != SNAP_BYTE_ORDER ||
+      hdr->route_size != sizeof(parsebgp_rib_route_t)) {
+    fprintf(stderr, "ERROR: %s is not a compatible RIB snapshot\n", path);
+    goto err;
+  }
+  if (hdr->file_len != snap->map_len ||
+      hdr->peers_cnt > PARSEBGP_RIB_PEERS_MAX ||
+      !section_ok(hdr, hdr->peers_off, hdr->peers_cnt, sizeof(snap_peer_t)) ||
+      !section_ok(hdr, hdr->routes_off, hdr->routes_cnt,
+                  sizeof(parsebgp_rib_route_t)) ||
+      hdr->attrs_cnt == 0 || hdr->attrs_cnt > UINT32_MAX ||
+      !section_ok(hdr, hdr->attrs_idx_off, hdr->attrs_cnt + 1,
+                  sizeof(uint64_t)) ||
+      !section_ok(hdr, hdr->attrs_flags_off, hdr->attrs_cnt, 1) ||
+      !section_ok(hdr, hdr->attrs_data_off, hdr->attrs_bytes, 1)) {
+    goto corrupt;
+  }
+  for (i = 0; i < 2; i++) {
+    if (!section_ok(hdr, hdr->keys_off[i], hdr->prefixes_cnt[i],
+                    KEY_SIZE(i)) ||
+        !section_ok(hdr, hdr->routes_idx_off[i], hdr->prefixes_cnt[i] + 1,
+                    sizeof(uint64_t))) {
+      goto corrupt;
+    }
+    snap->keys[i] = snap->map + hdr->keys_off[i];
+    snap->routes_idx[i] = (const uint64_t *)(snap->map + hdr->routes_idx_off[i]);
+  }
+  snap->peers = (const snap_peer_t *)(snap->map + hdr->peers_off);
+  snap->routes = (const parsebgp_rib_route_t *)(snap->map + hdr->routes_off);
+  snap->attrs_idx = (const uint64_t *)(snap->map + hdr->attrs_idx_off);
+  snap->attrs_flags = snap->map + hdr->attrs_flags_off;
+  snap->attrs_data = snap->map + hdr->attrs_data_off;
+  return snap;
+
+corrupt:
+  fprintf(stderr, "ERROR: RIB snapshot %s is corrupt\n", path);
+err:
+  parsebgp_rib_snapshot_close(snap);
+  return NULL;
+}
+
+void parsebgp_rib_snapshot_close(parsebgp_rib_snapshot_t *snap)
+{
+  if (snap == NULL) {
+    return;
+  }
+  munmap((void *)snap->map, snap->map_len);
+  free(snap);
+}
+
+parsebgp_error_t parsebgp_rib_snapshot_load(const parsebgp_rib_snapshot_t *snap,
+                                            parsebgp_rib_t *rib)
+{
+  const parsebgp_rib_route_t *routes;
+  parsebgp_rib_peer_t peer;
+  uint16_t *peers = NULL;
+  uint32_t *attrs = NULL;
+  const uint8_t *key, *buf;
+  size_t len;
+  uint64_t i;
+  int afi_idx, routes_cnt, asn_4_byte, j;
+  uint32_t id;
+  parsebgp_error_t err = PARSEBGP_MALLOC_FAILURE;
+
+  // map snapshot peers and attribute sets to their RIB equivalents
+  if ((peers = malloc_zero(sizeof(uint16_t) * (snap->hdr->peers_cnt + 1))) ==
+        NULL ||
+      (attrs = malloc_zero(sizeof(uint32_t) * snap->hdr->attrs_cnt)) == NULL) {
+    goto done;
+  }
+  for (j = 0; j < (int)snap->hdr->peers_cnt; j++) {
+    parsebgp_rib_snapshot_get_peer(snap, j, &peer);
+    if ((err = parsebgp_rib_peer_add(rib, &peer, &peers[j])) != PARSEBGP_OK) {
+      goto done;
+    }
+  }
+
+  for (afi_idx = 0; afi_idx < 2; afi_idx++) {
+    for (i = 0; i < snap->hdr->prefixes_cnt[afi_idx]; i++) {
+      key = &snap->keys[afi_idx][i * KEY_SIZE(afi_idx)];
+      routes_cnt = snap_routes(snap, afi_idx, i, &routes);
+      for (j = 0; j < routes_cnt; j++) {
+        id = routes[j].attrs_id;
+        if (routes[j].peer_idx >= snap->hdr->peers_cnt || id == 0 ||
+            id >= snap->hdr->attrs_cnt) {
+          err = PARSEBGP_INVALID_MSG;
+          goto done;
+        }
+        // each set is added (and held) the first time it is used
+        if (attrs[id] == 0 &&
+            ((err = parsebgp_rib_snapshot_attrs_get(snap, id, &buf, &len,
+                                                    &asn_4_byte)) !=
+               PARSEBGP_OK ||
+             (err = parsebgp_rib_attrs_add(rib, buf, len, asn_4_byte,
+                                           &attrs[id])) != PARSEBGP_OK)) {
+          goto done;
+        }
+        if ((err = parsebgp_rib_route_set(
+               rib,
+               afi_idx == 0 ? PARSEBGP_BGP_AFI_IPV4 : PARSEBGP_BGP_AFI_IPV6,
+               key, key[ADDR_LEN(afi_idx)], peers[routes[j].peer_idx],
+               attrs[id])) != PARSEBGP_OK) {
+          goto done;
+        }
+      }
+    }
+  }
+  err = PARSEBGP_OK;
+
+done:
+  if (attrs != NULL) {
+    for (id = 1; id < snap->hdr->attrs_cnt; id++) {
+      if (attrs[id] != 0) {
+        parsebgp_rib_attrs_release(rib, attrs[id]);
+      }
+    }
+  }
+  free(peers);
+  free(attrs);
+  return err;
+}
+
+uint64_t parsebgp_rib_snapshot_get_hash(const parsebgp_rib_snapshot_t *snap)
+{
+  return parsebgp_hash_bytes(snap->map, snap->map_len, SNAP_VERSION);
+}
+
+int parsebgp_rib_snapshot_get_peers_cnt(const parsebgp_rib_snapshot_t *snap)
+{
+  return snap->hdr->peers_cnt;
+}
+
+parsebgp_error_t
+parsebgp_rib_snapshot_get_peer(const parsebgp_rib_snapshot_t *snap,
+                               uint16_t peer_idx, parsebgp_rib_peer_t *peer)
+{
+  const snap_peer_t *sp;
+
+  if (peer_idx >= snap->hdr->peers_cnt) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  sp = &snap->peers[peer_idx];
+  memset(peer, 0, sizeof(*peer));
+  peer->afi = sp->afi;
+  memcpy(peer->addr, sp->addr, sizeof(peer->addr));
+  peer->asn = sp->asn;
+  peer->dist_id = sp->dist_id;
+  peer->post_policy = sp->post_policy;
+  memcpy(peer->bgp_id, sp->bgp_id, sizeof(peer->bgp_id));
+  peer->routes_cnt = sp->routes_cnt;
+  return PARSEBGP_OK;
+}
+
+int parsebgp_rib_snapshot_lookup(const parsebgp_rib_snapshot_t *snap,
+                                 parsebgp_bgp_afi_t afi, const uint8_t *prefix,
+                                 uint8_t prefix_len,
+                                 const parsebgp_rib_route_t **routes)
+{
+  int afi_idx = AFI_IDX(afi);
+  uint8_t key[KEY_SIZE(1)];
+  uint64_t lo, hi, mid;
+  int cmp;
+
+  *routes = NULL;
+  if (afi_idx < 0 || prefix_len > ADDR_LEN(afi_idx) * 8) {
+    return 0;
+  }
+  memset(key, 0, sizeof(key));
+  memcpy(key, prefix, (prefix_len + 7) / 8);
+  if (prefix_len % 8 != 0) {
+    key[prefix_len / 8] &= 0xFF << (8 - prefix_len % 8);
+  }
+  key[ADDR_LEN(afi_idx)] = prefix_len;
+
+  lo = 0;
+  hi = snap->hdr->prefixes_cnt[afi_idx];
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    cmp = key_cmp(&snap->keys[afi_idx][mid * KEY_SIZE(afi_idx)], key, afi_idx);
+    if (cmp == 0) {
+      return snap_routes(snap, afi_idx, mid, routes);
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return 0;
+}
+
+int parsebgp_rib_snapshot_walk(const parsebgp_rib_snapshot_t *snap,
+                               parsebgp_bgp_afi_t afi,
+                               parsebgp_rib_walk_cb_t *cb, void *user)
+{
+  int afi_idx = AFI_IDX(afi);
+  const parsebgp_rib_route_t *routes;
+  const uint8_t *key;
+  uint8_t prefix[16];
+  uint64_t i;
+  int routes_cnt;
+
+  if (afi_idx < 0) {
+    return 0;
+  }
+  memset(prefix, 0, sizeof(prefix));
+  for (i = 0; i < snap->hdr->prefixes_cnt[afi_idx]; i++) {
+    key = &snap->keys[afi_idx][i * KEY_SIZE(afi_idx)];
+    memcpy(prefix, key, ADDR_LEN(afi_idx));
+    routes_cnt = snap_routes(snap, afi_idx, i, &routes);
+    if (cb(prefix, key[ADDR_LEN(afi_idx)], routes, routes_cnt, user) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+parsebgp_error_t
+parsebgp_rib_snapshot_attrs_get(const parsebgp_rib_snapshot_t *snap,
+                                uint32_t attrs_id, const uint8_t **buf,
+                                size_t *len, int *asn_4_byte)
+{
+  uint64_t start, end;
+
+  if (attrs_id == 0 || attrs_id >= snap->hdr->attrs_cnt) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  start = snap->attrs_idx[attrs_id];
+  end = snap->attrs_idx[attrs_id + 1];
+  if (start > end || end > snap->hdr->attrs_bytes) {
+    return PARSEBGP_INVALID_MSG;
+  }
+  *buf = snap->attrs_data + start;
+  *len = end - start;
+  if (asn_4_byte != NULL) {
+    *asn_4_byte = snap->attrs_flags[attrs_id];
+  }
+  return PARSEBGP_OK;
+}
+
+parsebgp_error_t
+parsebgp_rib_snapshot_attrs_decode(const parsebgp_rib_snapshot_t *snap,
+                                   uint32_t attrs_id, parsebgp_opts_t *opts,
+                                   parsebgp_bgp_update_path_attrs_t *path_attrs)
+{
+  parsebgp_opts_t decode_opts = *opts;
+  const uint8_t *buf;
+  size_t len;
+  int asn_4_byte;
+  parsebgp_error_t err;
+
+  if ((err = parsebgp_rib_snapshot_attrs_get(snap, attrs_id, &buf, &len,
+                                             &asn_4_byte)) != PARSEBGP_OK) {
+    return err;
+  }
+
+  decode_opts.bgp.asn_4_byte = asn_4_byte;
+  decode_opts.bgp.mp_reach_no_afi_safi_reserved = 0;
+
+  parsebgp_bgp_update_path_attrs_clear(path_attrs);
+  return parsebgp_bgp_update_path_attrs_decode(&decode_opts, path_attrs, buf,
+                                               &len, len);
+}
+
+void parsebgp_rib_snapshot_get_stats(const parsebgp_rib_snapshot_t *snap,
+                                     parsebgp_rib_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  stats->ipv4_prefixes_cnt = snap->hdr->prefixes_cnt[0];
+  stats->ipv6_prefixes_cnt = snap->hdr->prefixes_cnt[1];
+  stats->routes_cnt = snap->hdr->routes_cnt;
+  stats->peers_cnt = snap->hdr->peers_cnt;
+  // ID zero is never used
+  stats->attrs_cnt = snap->hdr->attrs_cnt - 1;
+  stats->attrs_bytes = snap->hdr->attrs_bytes;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __PARSEBGP_RIB_SNAPSHOT_H
+#define __PARSEBGP_RIB_SNAPSHOT_H
+
+#include "parsebgp.h"
+#include "parsebgp_rib.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * RIB Snapshot
+ *
+ * A snapshot is a RIB written to a file in a pointer-free layout (peer table,
+ * sorted prefix arrays, route arrays, and the interned Path Attribute pool,
+ * all referenced by offsets). Opening a snapshot maps the file into memory and
+ * checks the section bounds, so it can be queried immediately without decoding
+ * the original dump again.
+ *
+ * Snapshots are written in native byte order and can only be opened on a
+ * platform with the same byte order and route structure layout.
+ */
+typedef struct parsebgp_rib_snapshot parsebgp_rib_snapshot_t;
+
+/**
+ * Write a RIB snapshot
+ *
+ * @param rib           Pointer to the RIB to write
+ * @param path          Path of the file to (over)write
+ * @return PARSEBGP_OK (0) if the snapshot was written, or an error code
+ * otherwise
+ *
+ * Peer indices are preserved, but attribute set IDs are renumbered.
+ */
+parsebgp_error_t parsebgp_rib_snapshot_write(const parsebgp_rib_t *rib,
+                                             const char *path);
+
+/**
+ * Open a RIB snapshot
+ *
+ * @param path          Path of the snapshot file
+ * @return pointer to the snapshot, or NULL if the file could not be mapped or
+ * is not a valid snapshot
+ */
+parsebgp_rib_snapshot_t *parsebgp_rib_snapshot_open(const char *path);
+
+/** Close a RIB snapshot */
+void parsebgp_rib_snapshot_close(parsebgp_rib_snapshot_t *snap);
+
+/**
+ * Load the contents of a snapshot into a RIB
+ *
+ * @param snap          Pointer to the snapshot
+ * @param rib           Pointer to the RIB to load into
+ * @return PARSEBGP_OK (0) if the snapshot was loaded, or an error code
+ * otherwise
+ *
+ * Routes are added on top of the existing RIB state. If the RIB is empty, peer
+ * indices are the same as in the snapshot.
+ */
+parsebgp_error_t parsebgp_rib_snapshot_load(const parsebgp_rib_snapshot_t *snap,
+                                            parsebgp_rib_t *rib);
+
+/** Get a hash of the whole snapshot file (used to tie other files to a
+    particular snapshot) */
+uint64_t parsebgp_rib_snapshot_get_hash(const parsebgp_rib_snapshot_t *snap);
+
+/** Get the number of peers in a snapshot */
+int parsebgp_rib_snapshot_get_peers_cnt(const parsebgp_rib_snapshot_t *snap);
+
+/**
+ * Get a peer from a snapshot
+ *
+ * @param snap          Pointer to the snapshot
+ * @param peer_idx      Index of the peer
+ * @param [out] peer    Pointer to the structure to fill
+ * @return PARSEBGP_OK, or PARSEBGP_INVALID_MSG if there is no such peer
+ */
+parsebgp_error_t
+parsebgp_rib_snapshot_get_peer(const parsebgp_rib_snapshot_t *snap,
+                               uint16_t peer_idx, parsebgp_rib_peer_t *peer);
+
+/**
+ * Get the routes for a prefix (see parsebgp_rib_lookup)
+ *
+ * The routes point directly into the mapped file, and remain valid until the
+ * snapshot is closed.
+ */
+int parsebgp_rib_snapshot_lookup(const parsebgp_rib_snapshot_t *snap,
+                                 parsebgp_bgp_afi_t afi, const uint8_t *prefix,
+                                 uint8_t prefix_len,
+                                 const parsebgp_rib_route_t **routes);
+
+/** Walk all prefixes of an AFI in order (see parsebgp_rib_walk) */
+int parsebgp_rib_snapshot_walk(const parsebgp_rib_snapshot_t *snap,
+                               parsebgp_bgp_afi_t afi,
+                               parsebgp_rib_walk_cb_t *cb, void *user);
+
+/** Get a Path Attribute set (see parsebgp_rib_attrs_get) */
+parsebgp_error_t
+parsebgp_rib_snapshot_attrs_get(const parsebgp_rib_snapshot_t *snap,
+                                uint32_t attrs_id, const uint8_t **buf,
+                                size_t *len, int *asn_4_byte);
+
+/**
+ * Decode a Path Attribute set (see parsebgp_rib_attrs_decode)
+ *
+ * The structure should be released with parsebgp_rib_path_attrs_destroy.
+ */
+parsebgp_error_t
+parsebgp_rib_snapshot_attrs_decode(const parsebgp_rib_snapshot_t *snap,
+                                   uint32_t attrs_id, parsebgp_opts_t *opts,
+                                   parsebgp_bgp_update_path_attrs_t *path_attrs);
+
+/** Get snapshot statistics (nodes_cnt is always zero) */
+void parsebgp_rib_snapshot_get_stats(const parsebgp_rib_snapshot_t *snap,
+                                     parsebgp_rib_stats_t *stats);
+
+#endif /* __PARSEBGP_RIB_SNAPSHOT_H */
@@ -25,6 +25,13 @@
  */
 
 #include "parsebgp.h"
+#include "parsebgp_alloc_profile.h"
+#include "parsebgp_arrow.h"
+#include "parsebgp_bgpdump.h"
+#include "parsebgp_json.h"
+#include "parsebgp_mrt_merge.h"
+#include "parsebgp_rib.h"
+#include "parsebgp_rib_snapshot.h"
 #include "config.h"
 #include <assert.h>
 #include <errno.h>
@@ -39,6 +46,9 @@
 // Read 1MB of the file at a time
 #define BUFLEN (1024 * 1024)
 
+// Buffer up to 4MB of JSON output between writes
+#define JSON_BUFLEN (4 * 1024 * 1024)
+
 static const char *type_strs[] = {
   NULL,  // PARSEBGP_MSG_TYPE_INVALID
   "bgp", // PARSEBGP_MSG_TYPE_BGP
@@ -53,6 +63,42 @@ static const char *type_strs[] = {
 // the printfs slowing things down.
 static int silent = 0;
 
+// RIB to apply parsed messages to (only if -r is used)
+static parsebgp_rib_t *rib = NULL;
+
+// if set, write a snapshot of the RIB to this file at exit
+static const char *snapshot_file = NULL;
+
+// if set, MRT files are merged into a single time-ordered stream (only if -M is
+// used)
+static parsebgp_mrt_merge_t *merge = NULL;
+
+// if set, messages are written in "bgpdump -m" format instead of being dumped
+// (only if -o bgpdump is used)
+static parsebgp_bgpdump_t *bgpdump = NULL;
+
+// if set, messages are written as NDJSON instead of being dumped (only if -o
+// json is used)
+static int json = 0;
+static char json_buf[JSON_BUFLEN];
+static size_t json_len = 0;
+
+// the most recent TABLE_DUMP_V2 Peer Index Table (only kept if -o json is
+// used, since the JSON writer resolves RIB entry peers through the
+// mrt.peer_index option rather than keeping its own copy)
+static parsebgp_mrt_peer_index_t *json_peers = NULL;
+
+// if set, routes are written as an Arrow IPC stream instead of being dumped
+// (only if -o arrow is used)
+static parsebgp_arrow_writer_t *arrow = NULL;
+static parsebgp_arrow_batch_t *arrow_batch = NULL;
+
+// decode statistics (only if -S is used)
+static parsebgp_stats_t stats_block;
+
+// if set, the allocation profile is dumped at exit (only if -A is used)
+static int alloc_profile = 0;
+
 static ssize_t refill_buffer(FILE *fp, uint8_t *buf, size_t buflen,
                              size_t remain)
 {
@@ -79,6 +125,109 @@ static ssize_t refill_buffer(FILE *fp, uint8_t *buf, size_t buflen,
   return len;
 }
 
+static int json_flush(void)
+{
+  size_t off = 0;
+  ssize_t rc;
+
+  while (off < json_len) {
+    if ((rc = write(STDOUT_FILENO, json_buf + off, json_len - off)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "ERROR: Failed to write output (%s)\n", strerror(errno));
+      return -1;
+    }
+    off += rc;
+  }
+  json_len = 0;
+  return 0;
+}
+
+static int json_track_peers(parsebgp_opts_t *opts, parsebgp_msg_t *msg)
+{
+  parsebgp_mrt_msg_t *mrt = msg->types.mrt;
+
+  if (!json || msg->type != PARSEBGP_MSG_TYPE_MRT || mrt == NULL ||
+      mrt->type != PARSEBGP_MRT_TYPE_TABLE_DUMP_V2 ||
+      mrt->subtype != PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE) {
+    return 0;
+  }
+
+  parsebgp_mrt_peer_index_destroy(json_peers);
+  if ((json_peers = parsebgp_mrt_peer_index_create(
+         &mrt->types.table_dump_v2->peer_index)) == NULL) {
+    fprintf(stderr, "ERROR: Failed to copy Peer Index Table\n");
+  }
+  opts->mrt.peer_index = json_peers;
+  return json_peers != NULL ? 0 : -1;
+}
+
+static int json_write_msg(parsebgp_msg_t *msg)
+{
+  parsebgp_json_cursor_t cursor = {0};
+  size_t len;
+
+  while (parsebgp_msg_to_json(msg, json_buf + json_len, JSON_BUFLEN - json_len,
+                              &len, &cursor) == PARSEBGP_PARTIAL_MSG) {
+    json_len += len;
+    if (len == 0 && json_len == 0) {
+      fprintf(stderr, "ERROR: JSON record does not fit in output buffer\n");
+      return -1;
+    }
+    if (json_flush() != 0) {
+      return -1;
+    }
+  }
+  json_len += len;
+  return 0;
+}
+
+static int output_msg(parsebgp_msg_t *msg)
+{
+  parsebgp_error_t err;
+
+  if (silent) {
+    return 0;
+  }
+
+  if (bgpdump != NULL) {
+    if ((err = parsebgp_bgpdump_write_msg(bgpdump, msg)) != PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to write message (%d:%s)\n", err,
+              parsebgp_strerror(err));
+      return -1;
+    }
+    return 0;
+  }
+
+  if (json) {
+    return json_write_msg(msg);
+  }
+
+  if (arrow != NULL) {
+    if ((err = parsebgp_arrow_batch_add_msg(arrow_batch, msg)) !=
+        PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to add message to batch (%d:%s)\n", err,
+              parsebgp_strerror(err));
+      return -1;
+    }
+    if (parsebgp_arrow_batch_get_rows_cnt(arrow_batch) >=
+        PARSEBGP_ARROW_BATCH_ROWS) {
+      err = parsebgp_arrow_writer_write_batch(arrow, arrow_batch);
+      parsebgp_arrow_batch_clear(arrow_batch);
+      if (err != PARSEBGP_OK) {
+        fprintf(stderr, "ERROR: Failed to write batch (%d:%s)\n", err,
+                parsebgp_strerror(err));
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+  parsebgp_dump_msg(msg);
+  return 0;
+}
+
 static int parse(parsebgp_opts_t *opts, parsebgp_msg_type_t type, char *fname)
 {
   uint8_t buf[BUFLEN];
@@ -141,12 +290,21 @@ static int parse(parsebgp_opts_t *opts, parsebgp_msg_type_t type, char *fname)
       }
       // else: successful read
       assert(dec_len > 0);
+      if (rib != NULL && err == PARSEBGP_OK &&
+          (err = parsebgp_rib_apply(rib, msg)) != PARSEBGP_OK) {
+        fprintf(stderr, "ERROR: Failed to apply message to RIB (%d:%s)\n", err,
+                parsebgp_strerror(err));
+        goto err;
+      }
+      if (err == PARSEBGP_OK && json_track_peers(opts, msg) != 0) {
+        goto err;
+      }
       ptr += dec_len;
       remain -= dec_len;
       cnt++;
 
-      if (!silent) {
-        parsebgp_dump_msg(msg);
+      if (output_msg(msg) != 0) {
+        goto err;
       }
 
       parsebgp_clear_msg(msg);
@@ -177,6 +335,76 @@ err:
   return -1;
 }
 
+static int parse_merged(parsebgp_opts_t *opts)
+{
+  const uint8_t *buf;
+  size_t len, dec_len;
+  int src;
+
+  parsebgp_msg_t *msg = NULL;
+  parsebgp_error_t err = PARSEBGP_OK;
+
+  uint64_t cnt = 0;
+
+  if ((msg = parsebgp_create_msg()) == NULL) {
+    fprintf(stderr, "ERROR: Failed to create message structure\n");
+    return -1;
+  }
+
+  while (1) {
+    if ((err = parsebgp_mrt_merge_next(merge, &buf, &len, &src)) !=
+        PARSEBGP_OK) {
+      fprintf(stderr, "WARNING: Failed to read MRT file #%d (%s), moving on\n",
+              src, parsebgp_strerror(err));
+      continue;
+    }
+    if (len == 0) {
+      // all files have been read
+      break;
+    }
+
+    dec_len = len;
+    if ((err = parsebgp_decode(*opts, PARSEBGP_MSG_TYPE_MRT, msg, buf,
+                               &dec_len)) != PARSEBGP_OK) {
+      if (err == PARSEBGP_TRUNCATED_MSG && opts->ignore_invalid) {
+        if (!(opts)->silence_invalid) {
+          fprintf(stderr, "WARN: truncated message %" PRIu64 "\n", cnt);
+        }
+      } else {
+        fprintf(stderr, "ERROR: Failed to parse message (%d:%s)\n", err,
+                parsebgp_strerror(err));
+        goto err;
+      }
+    }
+    if (rib != NULL && err == PARSEBGP_OK &&
+        (err = parsebgp_rib_apply(rib, msg)) != PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to apply message to RIB (%d:%s)\n", err,
+              parsebgp_strerror(err));
+      goto err;
+    }
+    if (err == PARSEBGP_OK && json_track_peers(opts, msg) != 0) {
+      goto err;
+    }
+    cnt++;
+
+    if (output_msg(msg) != 0) {
+      goto err;
+    }
+
+    parsebgp_clear_msg(msg);
+  }
+
+  fprintf(stderr, "INFO: Read %" PRIu64 " messages from %d merged files\n",
+          cnt, parsebgp_mrt_merge_get_sources_cnt(merge));
+
+  parsebgp_destroy_msg(msg);
+  return 0;
+
+err:
+  parsebgp_destroy_msg(msg);
+  return -1;
+}
+
 static void usage(void)
 {
   fprintf(
@@ -185,13 +413,28 @@ static void usage(void)
     "         where 'type' is one of 'bmp', 'bgp', or 'mrt'\n"
     "         (only required if using non-standard file extensions)\n"
     "       -4                 Force 4-byte ASN parsing\n"
+    "       -a                 Merge AS4_PATH into AS_PATH (RFC 6793)\n"
+    "       -A                 Print the per-site allocation profile to\n"
+    "                            stdout at exit\n"
     "       -b                 Perform shallow BMP parsing\n"
+    "       -d                 Deduplicate TABLE_DUMP_V2 Path Attributes\n"
     "       -f <attr-type>     Filter to include given Path Attribute\n"
     "       -i                 Ignore invalid messages and attributes\n"
     "                            (use multiple times to silence warnings)\n"
     "       -s                 Skip unknown messages and attributes\n"
     "                            (use multiple times to silence warnings)\n"
     "       -m                 BGP messages do not include the 16-octet marker\n"
+    "       -o <format>        Output format: 'dump' (default), 'bgpdump',\n"
+    "                            'json' or 'arrow' ('bgpdump' writes MRT data\n"
+    "                            like bgpdump -m, 'json' writes one JSON\n"
+    "                            object per route, 'arrow' writes routes as\n"
+    "                            an Arrow IPC stream)\n"
+    "       -M                 Merge MRT files into one time-ordered stream\n"
+    "       -p                 Only extract AS path summaries (origin, length)\n"
+    "       -r                 Reconstruct the RIB and print a summary\n"
+    "       -S                 Print decode statistics to stdout at exit\n"
+    "       -w <file>          Write a snapshot of the RIB to file (implies -r)\n"
+    "       -x                 Store extended communities in compact form\n"
     "       -h                 Show this help message\n"
     "       -q                 Do not dump parsed messages (quiet mode)\n"
     "       -v                 Show version of the libparsebgp library\n",
@@ -207,7 +450,7 @@ int main(int argc, char **argv)
   parsebgp_opts_t opts;
   parsebgp_opts_init(&opts);
 
-  while (prevoptind = optind, (opt = getopt(argc, argv, ":f:t:i4bsmqvh?")) >= 0) {
+  while (prevoptind = optind, (opt = getopt(argc, argv, ":f:o:t:w:i4aAbdsmMpqrSvxh?")) >= 0) {
     if (optind == prevoptind + 2 && (optarg == NULL || *optarg == '-')) {
       opt = ':';
       --optind;
@@ -217,10 +460,18 @@ int main(int argc, char **argv)
       opts.bgp.asn_4_byte = 1;
       break;
 
+    case 'a':
+      opts.bgp.as_path_merge = 1;
+      break;
+
     case 'b':
       opts.bmp.parse_headers_only = 1;
       break;
 
+    case 'd':
+      opts.mrt.path_attrs_dedup = 1;
+      break;
+
     case 'f':
       opts.bgp.path_attr_filter_enabled = 1;
       opts.bgp.path_attr_filter[(uint8_t)atoi(optarg)] = 1;
@@ -248,10 +499,76 @@ int main(int argc, char **argv)
       opts.bgp.marker_omitted = 1;
       break;
 
+    case 'M':
+      if (merge == NULL && (merge = parsebgp_mrt_merge_create()) == NULL) {
+        fprintf(stderr, "ERROR: Failed to create MRT merge\n");
+        return -1;
+      }
+      break;
+
+    case 'o':
+      if (strcmp(optarg, "bgpdump") == 0) {
+        if (bgpdump == NULL &&
+            (bgpdump = parsebgp_bgpdump_create(STDOUT_FILENO, 0)) == NULL) {
+          fprintf(stderr, "ERROR: Failed to create bgpdump writer\n");
+          return -1;
+        }
+      } else if (strcmp(optarg, "json") == 0) {
+        json = 1;
+      } else if (strcmp(optarg, "arrow") == 0) {
+        if (arrow == NULL &&
+            ((arrow = parsebgp_arrow_writer_create(STDOUT_FILENO)) == NULL ||
+             (arrow_batch = parsebgp_arrow_batch_create()) == NULL)) {
+          fprintf(stderr, "ERROR: Failed to create Arrow writer\n");
+          return -1;
+        }
+      } else if (strcmp(optarg, "dump") != 0) {
+        fprintf(stderr, "ERROR: Unknown output format '%s'\n", optarg);
+        usage();
+        return -1;
+      }
+      break;
+
+    case 'p':
+      opts.bgp.as_path_summary = 1;
+      break;
+
+    case 'x':
+      opts.bgp.ext_communities_compact = 1;
+      break;
+
     case 'q':
       silent = 1;
       break;
 
+    case 'w':
+      snapshot_file = optarg;
+      // FALL THROUGH
+    case 'r':
+      if (rib == NULL && (rib = parsebgp_rib_create()) == NULL) {
+        fprintf(stderr, "ERROR: Failed to create RIB\n");
+        return -1;
+      }
+      break;
+
+    case 'A':
+      if (!parsebgp_alloc_profile_enabled()) {
+        fprintf(stderr, "WARNING: libparsebgp was built without allocation "
+                        "profiling (configure with --enable-alloc-profile)\n");
+      }
+      parsebgp_alloc_profile_clear();
+      alloc_profile = 1;
+      break;
+
+    case 'S':
+      if (!parsebgp_stats_enabled()) {
+        fprintf(stderr, "WARNING: libparsebgp was built without statistics "
+                        "support (configure with --enable-stats)\n");
+      }
+      parsebgp_stats_clear(&stats_block);
+      opts.stats = &stats_block;
+      break;
+
     case 'h':
     case '?':
       usage();
@@ -276,6 +593,13 @@ int main(int argc, char **argv)
     return -1;
   }
 
+  if ((bgpdump != NULL || arrow != NULL) && opts.bgp.as_path_summary) {
+    fprintf(stderr, "ERROR: -p cannot be used with -o %s (the format needs "
+                    "the full AS path)\n",
+            bgpdump != NULL ? "bgpdump" : "arrow");
+    return -1;
+  }
+
   int i, j;
   for (i = optind; i < argc; i++) {
     int type = 0; // undefined type
@@ -316,6 +640,17 @@ int main(int argc, char **argv)
       return -1;
     }
 
+    if (merge != NULL && type == PARSEBGP_MSG_TYPE_MRT) {
+      fprintf(stderr, "INFO: Merging %s\n", fname);
+      parsebgp_error_t err = parsebgp_mrt_merge_add_file(merge, fname);
+      if (err != PARSEBGP_OK) {
+        fprintf(stderr, "WARNING: Failed to open %s (%s)%s\n", fname,
+                parsebgp_strerror(err), (i == argc - 1) ? "" : ", moving on");
+      }
+      free(freeme);
+      continue;
+    }
+
     fprintf(stderr, "INFO: Parsing %s (Type: %s)\n", fname, type_strs[type]);
 
     if (parse(&opts, type, fname) != 0) {
@@ -325,5 +660,68 @@ int main(int argc, char **argv)
     free(freeme);
   }
 
+  if (merge != NULL) {
+    if (parse_merged(&opts) != 0) {
+      fprintf(stderr, "WARNING: Failed to parse merged MRT files\n");
+    }
+    parsebgp_mrt_merge_destroy(merge);
+  }
+
+  if (rib != NULL) {
+    parsebgp_rib_stats_t stats;
+    parsebgp_rib_get_stats(rib, &stats);
+    fprintf(stderr,
+            "INFO: RIB: %d peers, %" PRIu64 " IPv4 prefixes, %" PRIu64
+            " IPv6 prefixes, %" PRIu64 " routes, %" PRIu64
+            " attribute sets (%" PRIu64 " bytes)\n",
+            stats.peers_cnt, stats.ipv4_prefixes_cnt, stats.ipv6_prefixes_cnt,
+            stats.routes_cnt, stats.attrs_cnt, stats.attrs_bytes);
+    if (snapshot_file != NULL) {
+      parsebgp_error_t err = parsebgp_rib_snapshot_write(rib, snapshot_file);
+      if (err != PARSEBGP_OK) {
+        fprintf(stderr, "ERROR: Failed to write RIB snapshot to %s (%s)\n",
+                snapshot_file, parsebgp_strerror(err));
+      } else {
+        fprintf(stderr, "INFO: Wrote RIB snapshot to %s\n", snapshot_file);
+      }
+    }
+    parsebgp_rib_destroy(rib);
+  }
+
+  if (bgpdump != NULL) {
+    parsebgp_error_t err = parsebgp_bgpdump_destroy(bgpdump);
+    if (err != PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to write output (%s)\n",
+              parsebgp_strerror(err));
+    }
+  }
+
+  if (json) {
+    json_flush();
+    parsebgp_mrt_peer_index_destroy(json_peers);
+  }
+
+  if (arrow != NULL) {
+    parsebgp_error_t err =
+      parsebgp_arrow_writer_write_batch(arrow, arrow_batch);
+    parsebgp_error_t destroy_err = parsebgp_arrow_writer_destroy(arrow);
+    if (err == PARSEBGP_OK) {
+      err = destroy_err;
+    }
+    if (err != PARSEBGP_OK) {
+      fprintf(stderr, "ERROR: Failed to write output (%s)\n",
+              parsebgp_strerror(err));
+    }
+    parsebgp_arrow_batch_destroy(arrow_batch);
+  }
+
+  if (opts.stats != NULL) {
+    parsebgp_stats_dump(NULL, opts.stats);
+  }
+
+  if (alloc_profile) {
+    parsebgp_alloc_profile_dump(NULL);
+  }
+
   return 0;
 }
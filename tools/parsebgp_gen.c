@@ -0,0 +1,1207 @@
+/*
+ * Copyright (C) 2017 The Regents of the University of California.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parsebgp.h"
+#include "config.h"
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NAME "parsebgp-gen"
+
+// Initial size of the record buffer (grown as needed)
+#define BUFLEN (1024 * 1024)
+
+// Largest record buffer we are willing to allocate
+#define BUFLEN_MAX (256 * 1024 * 1024)
+
+// Upper bound on the AS path length (ASNs in a segment are counted by a byte)
+#define MAX_PATH_LEN 255
+
+// Upper bound on the number of communities per route
+#define MAX_COMMS 4096
+
+// Upper bound on the number of extended communities per route
+#define MAX_EXT_COMMS 1024
+
+// Maximum number of prefixes announced (or withdrawn) by a single UPDATE
+#define MAX_UPDATE_PFXS 8
+
+// Number of transit ASNs that paths are built from (in addition to the peers)
+#define TRANSIT_ASNS_CNT 256
+
+// Upper bound on the number of distinct attribute sets per peer
+#define MAX_ATTR_SETS (1 << 24)
+
+// ASN and addresses used for the collector side of BGP4MP and BMP sessions
+#define COLLECTOR_ASN 65000
+static const uint8_t collector_ip4[4] = {192, 0, 2, 1};
+static const uint8_t collector_ip6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+                                          0,    0,    0,    0,    0, 0, 0, 1};
+
+typedef enum {
+  FORMAT_RIB,
+  FORMAT_UPDATES,
+  FORMAT_BMP,
+} gen_format_t;
+
+static const char *format_strs[] = {
+  "rib",     // FORMAT_RIB
+  "updates", // FORMAT_UPDATES
+  "bmp",     // FORMAT_BMP
+};
+
+/** A simulated BGP peer of the collector */
+typedef struct gen_peer {
+  uint32_t asn;
+  parsebgp_bgp_afi_t afi;
+  uint8_t ip[16];
+  uint8_t bgp_id[4];
+} gen_peer_t;
+
+/** A simulated prefix (and the AS that originates it) */
+typedef struct gen_pfx {
+  parsebgp_bgp_prefix_t pfx;
+  uint32_t origin_asn;
+  int attr_set; // index of the attribute set of its routes (-1 if unshared)
+} gen_pfx_t;
+
+/** Storage for the Path Attributes of one route */
+typedef struct gen_route {
+  parsebgp_bgp_update_path_attrs_t attrs;
+  uint8_t attrs_used[9];
+  parsebgp_bgp_update_as_path_t as_path;
+  parsebgp_bgp_update_as_path_seg_t seg;
+  uint32_t asns[MAX_PATH_LEN];
+  parsebgp_bgp_update_communities_t comms;
+  uint32_t comm_vals[MAX_COMMS];
+  uint8_t comm_raw[sizeof(uint32_t) * 2];
+  parsebgp_bgp_update_ext_communities_t ext_comms;
+  parsebgp_bgp_update_ext_community_t ext_comm_vals[MAX_EXT_COMMS];
+  parsebgp_bgp_update_mp_reach_t mp_reach;
+  parsebgp_bgp_update_mp_unreach_t mp_unreach;
+} gen_route_t;
+
+/** Shape of the generated data */
+typedef struct gen_cfg {
+  gen_format_t format;
+  uint64_t seed;
+  uint32_t timestamp;
+  int prefixes_cnt;
+  int peers_cnt;
+  int updates_cnt;
+  int attr_sets_cnt;
+  double path_len_mean;
+  int path_len_max;
+  double comms_mean;
+  int comms_max;
+  double ext_comms_mean;
+  int ext_comms_max;
+  double ipv6_share;
+  double malformed_share;
+  double truncated_share;
+} gen_cfg_t;
+
+static gen_cfg_t cfg = {
+  FORMAT_RIB, // format
+  1,          // seed
+  1500000000, // timestamp
+  10000,      // prefixes_cnt
+  16,         // peers_cnt
+  10000,      // updates_cnt
+  1000,       // attr_sets_cnt
+  4.5,        // path_len_mean
+  16,         // path_len_max
+  2.0,        // comms_mean
+  32,         // comms_max
+  0.5,        // ext_comms_mean
+  16,         // ext_comms_max
+  0.2,        // ipv6_share
+  0.0,        // malformed_share
+  0.0,        // truncated_share
+};
+
+static FILE *outfile = NULL;
+static uint8_t *buf = NULL;
+static size_t buf_len = 0;
+
+static gen_peer_t *peers = NULL;
+static gen_pfx_t *pfxs[2] = {NULL, NULL}; // IPv4, IPv6
+static int pfxs_cnt[2] = {0, 0};
+static uint32_t transit_asns[TRANSIT_ASNS_CNT];
+static uint32_t *attr_set_origins = NULL; // origin ASN of each attribute set
+static gen_route_t *routes = NULL; // one per peer
+
+static uint32_t now = 0;
+static uint64_t records_cnt = 0, malformed_cnt = 0, truncated_cnt = 0;
+
+/* -------------------- PRNG -------------------- */
+
+// splitmix64: small, fast, and (most importantly) gives the same sequence on
+// every platform, so the output only depends on the seed and the options
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+  uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/** Uniform integer in [0, n) */
+static uint32_t rng_below(uint32_t n)
+{
+  return (uint32_t)(((rng_next() >> 32) * n) >> 32);
+}
+
+/** Uniform double in [0, 1) */
+static double rng_double(void)
+{
+  return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int rng_chance(double p)
+{
+  return p > 0 && rng_double() < p;
+}
+
+/** Poisson-distributed integer with the given mean, capped at max */
+static int rng_poisson(double mean, int max)
+{
+  double l = exp(-mean), p = 1.0;
+  int k = 0;
+
+  if (mean <= 0) {
+    return 0;
+  }
+  do {
+    k++;
+    p *= rng_double();
+  } while (p > l && k <= max);
+  return k - 1 > max ? max : k - 1;
+}
+
+/** Roughly Zipf-distributed integer in [0, n) (small values are the most
+    common) */
+static int rng_zipf(int n)
+{
+  int k = (int)exp(rng_double() * log(n + 1.0)) - 1;
+  return k >= n ? n - 1 : k;
+}
+
+/* -------------------- Topology -------------------- */
+
+/** Random unicast address (only the first four bytes are written for IPv4) */
+static void gen_ip(parsebgp_bgp_afi_t afi, uint8_t *ip)
+{
+  uint64_t r = rng_next();
+  if (afi == PARSEBGP_BGP_AFI_IPV4) {
+    // unicast space, avoiding 0/8, 10/8 and 127/8
+    do {
+      ip[0] = 1 + rng_below(223);
+    } while (ip[0] == 10 || ip[0] == 127);
+    ip[1] = r >> 8;
+    ip[2] = r >> 16;
+    ip[3] = r >> 24;
+  } else {
+    // 2000::/3
+    ip[0] = 0x20 | ((r >> 8) & 0x1F);
+    memcpy(&ip[1], &r, 7);
+    r = rng_next();
+    memcpy(&ip[8], &r, 8);
+  }
+}
+
+static uint32_t gen_asn(void)
+{
+  // mostly 2-byte ASNs, with a realistic share of 4-byte ones
+  if (rng_chance(0.3)) {
+    return 131072 + rng_below(270000);
+  }
+  return 1 + rng_below(64000);
+}
+
+static void mask_pfx(parsebgp_bgp_prefix_t *pfx)
+{
+  int i;
+  for (i = 0; i < 16; i++) {
+    if (i * 8 >= pfx->len) {
+      pfx->addr[i] = 0;
+    } else if ((i + 1) * 8 > pfx->len) {
+      pfx->addr[i] &= 0xFF << (8 - (pfx->len % 8));
+    }
+  }
+}
+
+static void gen_pfx(parsebgp_bgp_afi_t afi, gen_pfx_t *p)
+{
+  uint32_t r = rng_below(100);
+
+  p->pfx.type = afi == PARSEBGP_BGP_AFI_IPV4
+                  ? PARSEBGP_BGP_PREFIX_UNICAST_IPV4
+                  : PARSEBGP_BGP_PREFIX_UNICAST_IPV6;
+  p->pfx.afi = afi;
+  p->pfx.safi = PARSEBGP_BGP_SAFI_UNICAST;
+  gen_ip(afi, p->pfx.addr);
+
+  // roughly the length distribution of the global table
+  if (afi == PARSEBGP_BGP_AFI_IPV4) {
+    p->pfx.len = r < 60 ? 24 : r < 70 ? 22 : r < 80 ? 23 : 16 + rng_below(6);
+  } else {
+    p->pfx.len = r < 50 ? 48 : r < 65 ? 32 : r < 75 ? 44 : 29 + rng_below(36);
+  }
+  mask_pfx(&p->pfx);
+
+  if (cfg.attr_sets_cnt > 0) {
+    // prefixes that share an attribute set share its origin too
+    p->attr_set = rng_zipf(cfg.attr_sets_cnt);
+    p->origin_asn = attr_set_origins[p->attr_set];
+  } else {
+    p->attr_set = -1;
+    p->origin_asn = gen_asn();
+  }
+}
+
+static int gen_topology(void)
+{
+  int i, afi;
+
+  if ((peers = calloc(cfg.peers_cnt, sizeof(gen_peer_t))) == NULL ||
+      (routes = calloc(cfg.peers_cnt, sizeof(gen_route_t))) == NULL) {
+    return -1;
+  }
+
+  for (i = 0; i < cfg.peers_cnt; i++) {
+    peers[i].asn = gen_asn();
+    peers[i].afi = rng_chance(cfg.ipv6_share) ? PARSEBGP_BGP_AFI_IPV6
+                                               : PARSEBGP_BGP_AFI_IPV4;
+    gen_ip(peers[i].afi, peers[i].ip);
+    gen_ip(PARSEBGP_BGP_AFI_IPV4, peers[i].bgp_id);
+  }
+
+  for (i = 0; i < TRANSIT_ASNS_CNT; i++) {
+    transit_asns[i] = gen_asn();
+  }
+
+  if (cfg.attr_sets_cnt > 0) {
+    if ((attr_set_origins = calloc(cfg.attr_sets_cnt, sizeof(uint32_t))) ==
+        NULL) {
+      return -1;
+    }
+    for (i = 0; i < cfg.attr_sets_cnt; i++) {
+      attr_set_origins[i] = gen_asn();
+    }
+  }
+
+  // split the prefixes according to the IPv6 share, making sure that there is
+  // at least one prefix of each family if it may be needed
+  pfxs_cnt[1] = (int)(cfg.prefixes_cnt * cfg.ipv6_share + 0.5);
+  if (pfxs_cnt[1] == 0 && cfg.ipv6_share > 0) {
+    pfxs_cnt[1] = 1;
+  }
+  pfxs_cnt[0] = cfg.prefixes_cnt - pfxs_cnt[1];
+  if (pfxs_cnt[0] == 0 && cfg.ipv6_share < 1) {
+    pfxs_cnt[0] = 1;
+  }
+  for (afi = 0; afi < 2; afi++) {
+    if (pfxs_cnt[afi] == 0) {
+      continue;
+    }
+    if ((pfxs[afi] = calloc(pfxs_cnt[afi], sizeof(gen_pfx_t))) == NULL) {
+      return -1;
+    }
+    for (i = 0; i < pfxs_cnt[afi]; i++) {
+      gen_pfx(afi + 1, &pfxs[afi][i]);
+    }
+  }
+
+  return 0;
+}
+
+/* -------------------- Routes -------------------- */
+
+static void route_add_attr(gen_route_t *r, uint8_t type, uint8_t flags)
+{
+  r->attrs.attrs[type].type = type;
+  r->attrs.attrs[type].flags = flags;
+  r->attrs.attrs_used[r->attrs.attrs_cnt++] = type;
+}
+
+static void route_init(gen_route_t *r)
+{
+  memset(&r->attrs, 0, sizeof(r->attrs));
+  // the attributes are built from the structure, not copied from raw data
+  r->attrs.raw = NULL;
+  r->attrs.attrs_used = r->attrs_used;
+  r->attrs.attrs_cnt = 0;
+}
+
+/**
+ * Build the Path Attributes of a route from the given peer
+ *
+ * If nlris is non-NULL (i.e., for UPDATE messages), IPv6 prefixes are added to
+ * the MP_REACH_NLRI attribute. If malformed is set, the COMMUNITIES attribute
+ * is given a length that is not a multiple of four.
+ *
+ * If the prefix has an attribute set, the attributes are drawn from a random
+ * sequence seeded by the peer, the set and the address family, so all routes
+ * of the peer with that set get the same attributes.
+ */
+static void gen_route(gen_route_t *r, const gen_peer_t *peer,
+                      const gen_pfx_t *p, parsebgp_bgp_prefix_t *nlris,
+                      int nlris_cnt, int malformed)
+{
+  int i, path_len, comms_cnt;
+  parsebgp_bgp_update_path_attr_t *attr;
+  parsebgp_bgp_update_ext_community_t *ec;
+  uint64_t rng_saved = rng_state;
+
+  route_init(r);
+
+  if (p->attr_set >= 0) {
+    rng_state = (cfg.seed * 0xD1B54A32D192ED03ULL) ^
+                ((uint64_t)(peer - peers) << 32) ^
+                ((uint64_t)p->pfx.afi << 28) ^ (uint64_t)p->attr_set;
+  }
+
+  // ORIGIN
+  route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN, 0x40);
+  r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_ORIGIN].data.origin =
+    rng_chance(0.9) ? PARSEBGP_BGP_UPDATE_ORIGIN_IGP
+                    : PARSEBGP_BGP_UPDATE_ORIGIN_INCOMPLETE;
+
+  // AS_PATH: peer, transit ASNs, origin
+  path_len = 1 + rng_poisson(cfg.path_len_mean - 1, cfg.path_len_max - 1);
+  r->asns[0] = peer->asn;
+  for (i = 1; i < path_len - 1; i++) {
+    r->asns[i] = transit_asns[rng_below(TRANSIT_ASNS_CNT)];
+  }
+  if (path_len > 1) {
+    r->asns[path_len - 1] = p->origin_asn;
+  }
+  r->seg.type = PARSEBGP_BGP_UPDATE_AS_PATH_SEG_AS_SEQ;
+  r->seg.asns_cnt = path_len;
+  r->seg.asns = r->asns;
+  memset(&r->as_path, 0, sizeof(r->as_path));
+  r->as_path.segs = &r->seg;
+  r->as_path.segs_cnt = 1;
+  route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH, 0x40);
+  r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_AS_PATH].data.as_path =
+    &r->as_path;
+  r->attrs.as_path = &r->as_path;
+
+  // NEXT_HOP (IPv4 only)
+  if (p->pfx.afi == PARSEBGP_BGP_AFI_IPV4) {
+    attr = &r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP];
+    route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_NEXT_HOP, 0x40);
+    if (peer->afi == PARSEBGP_BGP_AFI_IPV4) {
+      memcpy(attr->data.next_hop, peer->ip, 4);
+    } else {
+      gen_ip(PARSEBGP_BGP_AFI_IPV4, r->mp_reach.next_hop);
+      memcpy(attr->data.next_hop, r->mp_reach.next_hop, 4);
+    }
+  }
+
+  // MULTI_EXIT_DISC (sometimes)
+  if (rng_chance(0.3)) {
+    route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_MED, 0x80);
+    r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MED].data.med = rng_below(1000);
+  }
+
+  // COMMUNITIES
+  comms_cnt = rng_poisson(cfg.comms_mean, cfg.comms_max);
+  if (comms_cnt > 0 || malformed) {
+    memset(&r->comms, 0, sizeof(r->comms));
+    if (malformed) {
+      // a truncated community: the decoder rejects the attribute length
+      for (i = 0; i < (int)sizeof(r->comm_raw); i++) {
+        r->comm_raw[i] = rng_next();
+      }
+      r->comms.raw = r->comm_raw;
+      r->comms.raw_len = sizeof(uint32_t) + 2;
+    } else {
+      for (i = 0; i < comms_cnt; i++) {
+        r->comm_vals[i] =
+          ((r->asns[rng_below(path_len)] & 0xFFFF) << 16) | rng_below(1000);
+      }
+      r->comms.communities = r->comm_vals;
+      r->comms.communities_cnt = comms_cnt;
+    }
+    route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES, 0xC0);
+    r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_COMMUNITIES].data.communities =
+      &r->comms;
+  }
+
+  // MP_REACH_NLRI (IPv6 only)
+  if (p->pfx.afi == PARSEBGP_BGP_AFI_IPV6) {
+    memset(&r->mp_reach, 0, sizeof(r->mp_reach));
+    r->mp_reach.afi = PARSEBGP_BGP_AFI_IPV6;
+    r->mp_reach.safi = PARSEBGP_BGP_SAFI_UNICAST;
+    r->mp_reach.next_hop_len = 16;
+    if (peer->afi == PARSEBGP_BGP_AFI_IPV6) {
+      memcpy(r->mp_reach.next_hop, peer->ip, 16);
+    } else {
+      gen_ip(PARSEBGP_BGP_AFI_IPV6, r->mp_reach.next_hop);
+    }
+    r->mp_reach.nlris = nlris;
+    r->mp_reach.nlris_cnt = nlris_cnt;
+    route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI, 0x80);
+    r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_REACH_NLRI].data.mp_reach =
+      &r->mp_reach;
+  }
+
+  // EXTENDED COMMUNITIES: route targets of the ASes on the path
+  comms_cnt = rng_poisson(cfg.ext_comms_mean, cfg.ext_comms_max);
+  if (comms_cnt > 0) {
+    memset(&r->ext_comms, 0, sizeof(r->ext_comms));
+    for (i = 0; i < comms_cnt; i++) {
+      ec = &r->ext_comm_vals[i];
+      memset(ec, 0, sizeof(*ec));
+      ec->subtype = 0x02; // Route Target
+      if (peer->asn > UINT16_MAX) {
+        ec->type = PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_FOUR_OCTET_AS;
+        ec->types.four_octet.global_admin = peer->asn;
+        ec->types.four_octet.local_admin = rng_below(1000);
+      } else {
+        ec->type = PARSEBGP_BGP_EXT_COMM_TYPE_TRANS_TWO_OCTET_AS;
+        ec->types.two_octet.global_admin = peer->asn;
+        ec->types.two_octet.local_admin = rng_below(100000);
+      }
+    }
+    r->ext_comms.communities = r->ext_comm_vals;
+    r->ext_comms.communities_cnt = comms_cnt;
+    route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES, 0xC0);
+    r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_EXT_COMMUNITIES]
+      .data.ext_communities = &r->ext_comms;
+  }
+
+  if (p->attr_set >= 0) {
+    // carry on with the main sequence
+    rng_state = rng_saved;
+  }
+}
+
+/* -------------------- Output -------------------- */
+
+typedef parsebgp_error_t(encode_func_t)(parsebgp_opts_t *opts, const void *msg,
+                                        uint8_t *buf, size_t *len);
+
+static parsebgp_error_t encode_mrt(parsebgp_opts_t *opts, const void *msg,
+                                   uint8_t *buf, size_t *len)
+{
+  return parsebgp_mrt_encode(opts, msg, buf, len);
+}
+
+static parsebgp_error_t encode_bmp(parsebgp_opts_t *opts, const void *msg,
+                                   uint8_t *buf, size_t *len)
+{
+  return parsebgp_bmp_encode(opts, msg, buf, len);
+}
+
+/**
+ * Encode a record and write it out
+ *
+ * If truncate is set, the tail of the record is cut off and the length field
+ * at len_offset (a 4-byte field holding the record length minus hdr_adj) is
+ * fixed up to match, so that the stream can still be framed.
+ */
+static int write_record(encode_func_t *encode, const void *msg, int truncate,
+                        size_t len_offset, size_t hdr_adj)
+{
+  parsebgp_opts_t opts;
+  parsebgp_error_t err;
+  size_t len, cut;
+  uint32_t rec_len;
+
+  parsebgp_opts_init(&opts);
+  for (;;) {
+    len = buf_len;
+    if ((err = encode(&opts, msg, buf, &len)) == PARSEBGP_OK) {
+      break;
+    }
+    if (err != PARSEBGP_PARTIAL_MSG || buf_len * 2 > BUFLEN_MAX) {
+      fprintf(stderr, "ERROR: Failed to encode record (%s)\n",
+              parsebgp_strerror(err));
+      return -1;
+    }
+    // grow the buffer and try again
+    free(buf);
+    buf_len *= 2;
+    if ((buf = malloc(buf_len)) == NULL) {
+      fprintf(stderr, "ERROR: Could not allocate record buffer\n");
+      return -1;
+    }
+  }
+
+  if (truncate) {
+    // cut up to 16 bytes, but leave the common header (and then some) intact
+    cut = 1 + rng_below(16);
+    if (cut > len - (len_offset + 8)) {
+      cut = len - (len_offset + 8);
+    }
+    len -= cut;
+    rec_len = len - hdr_adj;
+    buf[len_offset] = rec_len >> 24;
+    buf[len_offset + 1] = rec_len >> 16;
+    buf[len_offset + 2] = rec_len >> 8;
+    buf[len_offset + 3] = rec_len;
+    truncated_cnt++;
+  }
+
+  if (fwrite(buf, 1, len, outfile) != len) {
+    fprintf(stderr, "ERROR: Failed to write output (%s)\n", strerror(errno));
+    return -1;
+  }
+  records_cnt++;
+  return 0;
+}
+
+// the MRT length field is at offset 8 and excludes the 12-byte header
+static int write_mrt(const parsebgp_mrt_msg_t *msg, int truncate)
+{
+  return write_record(encode_mrt, msg, truncate, 8, 12);
+}
+
+// the BMP length field is at offset 1 and includes the header
+static int write_bmp(const parsebgp_bmp_msg_t *msg, int truncate)
+{
+  return write_record(encode_bmp, msg, truncate, 1, 0);
+}
+
+/* -------------------- MRT TABLE_DUMP_V2 -------------------- */
+
+static int gen_rib(void)
+{
+  parsebgp_mrt_msg_t msg;
+  parsebgp_mrt_table_dump_v2_t td2;
+  parsebgp_mrt_table_dump_v2_peer_entry_t *pe;
+  parsebgp_mrt_table_dump_v2_rib_entry_t *entries = NULL;
+  parsebgp_mrt_table_dump_v2_afi_safi_rib_t *rib = &td2.afi_safi_rib;
+  int afi, i, j, malformed, bad_entry, ret = -1;
+  uint32_t seq = 0;
+  char view_name[] = "parsebgp-gen";
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&td2, 0, sizeof(td2));
+  msg.timestamp_sec = now;
+  msg.type = PARSEBGP_MRT_TYPE_TABLE_DUMP_V2;
+  msg.types.table_dump_v2 = &td2;
+
+  // PEER_INDEX_TABLE
+  if ((td2.peer_index.peer_entries =
+         calloc(cfg.peers_cnt, sizeof(*td2.peer_index.peer_entries))) ==
+        NULL ||
+      (entries = calloc(cfg.peers_cnt, sizeof(*entries))) == NULL) {
+    goto out;
+  }
+  gen_ip(PARSEBGP_BGP_AFI_IPV4, td2.peer_index.collector_bgp_id);
+  td2.peer_index.view_name = view_name;
+  td2.peer_index.view_name_len = strlen(view_name);
+  td2.peer_index.peer_count = cfg.peers_cnt;
+  for (i = 0; i < cfg.peers_cnt; i++) {
+    pe = &td2.peer_index.peer_entries[i];
+    pe->asn_type = peers[i].asn > UINT16_MAX ? PARSEBGP_MRT_ASN_4_BYTE
+                                             : PARSEBGP_MRT_ASN_2_BYTE;
+    pe->ip_afi = peers[i].afi;
+    memcpy(pe->bgp_id, peers[i].bgp_id, 4);
+    memcpy(pe->ip, peers[i].ip, 16);
+    pe->asn = peers[i].asn;
+  }
+  msg.subtype = PARSEBGP_MRT_TABLE_DUMP_V2_PEER_INDEX_TABLE;
+  if (write_mrt(&msg, 0) != 0) {
+    goto out;
+  }
+
+  // RIB records (all IPv4 prefixes first, like real dumps)
+  for (afi = 0; afi < 2; afi++) {
+    msg.subtype = afi == 0 ? PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV4_UNICAST
+                           : PARSEBGP_MRT_TABLE_DUMP_V2_RIB_IPV6_UNICAST;
+    for (i = 0; i < pfxs_cnt[afi]; i++) {
+      malformed = rng_chance(cfg.malformed_share);
+      bad_entry = malformed ? (int)rng_below(cfg.peers_cnt) : -1;
+
+      rib->sequence = seq++;
+      rib->prefix_len = pfxs[afi][i].pfx.len;
+      memcpy(rib->prefix, pfxs[afi][i].pfx.addr, 16);
+      rib->entry_count = cfg.peers_cnt;
+      rib->entries = entries;
+      for (j = 0; j < cfg.peers_cnt; j++) {
+        gen_route(&routes[j], &peers[j], &pfxs[afi][i], NULL, 0,
+                  j == bad_entry);
+        entries[j].peer_index = j;
+        entries[j].originated_time = now - rng_below(30 * 24 * 3600);
+        entries[j].path_attrs_ptr = &routes[j].attrs;
+      }
+
+      if (write_mrt(&msg, rng_chance(cfg.truncated_share)) != 0) {
+        goto out;
+      }
+      malformed_cnt += malformed;
+    }
+  }
+
+  ret = 0;
+
+out:
+  free(td2.peer_index.peer_entries);
+  free(entries);
+  return ret;
+}
+
+/* -------------------- UPDATE streams -------------------- */
+
+/**
+ * Build a random UPDATE message from the given peer
+ *
+ * Most UPDATEs announce a few consecutive prefixes (sharing the same
+ * attributes), the rest withdraw them.
+ */
+static void gen_update(parsebgp_bgp_msg_t *bgp, parsebgp_bgp_update_t *upd,
+                       const gen_peer_t *peer, gen_route_t *r,
+                       parsebgp_bgp_prefix_t *nlris, int malformed)
+{
+  int afi, i, start, cnt;
+  int withdraw = !malformed && rng_chance(0.15);
+
+  afi = (pfxs_cnt[1] > 0 && (pfxs_cnt[0] == 0 || rng_chance(cfg.ipv6_share)))
+          ? 1
+          : 0;
+  start = rng_below(pfxs_cnt[afi]);
+  cnt = 1 + rng_poisson(0.5, MAX_UPDATE_PFXS - 1);
+  if (cnt > pfxs_cnt[afi]) {
+    cnt = pfxs_cnt[afi];
+  }
+  for (i = 0; i < cnt; i++) {
+    nlris[i] = pfxs[afi][(start + i) % pfxs_cnt[afi]].pfx;
+  }
+
+  memset(bgp, 0, sizeof(*bgp));
+  memset(upd, 0, sizeof(*upd));
+  bgp->type = PARSEBGP_BGP_TYPE_UPDATE;
+  bgp->types.update = upd;
+
+  if (withdraw) {
+    route_init(r);
+    if (afi == 0) {
+      upd->withdrawn_nlris.prefixes = nlris;
+      upd->withdrawn_nlris.prefixes_cnt = cnt;
+    } else {
+      memset(&r->mp_unreach, 0, sizeof(r->mp_unreach));
+      r->mp_unreach.afi = PARSEBGP_BGP_AFI_IPV6;
+      r->mp_unreach.safi = PARSEBGP_BGP_SAFI_UNICAST;
+      r->mp_unreach.withdrawn_nlris = nlris;
+      r->mp_unreach.withdrawn_nlris_cnt = cnt;
+      route_add_attr(r, PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI, 0x80);
+      r->attrs.attrs[PARSEBGP_BGP_PATH_ATTR_TYPE_MP_UNREACH_NLRI]
+        .data.mp_unreach = &r->mp_unreach;
+    }
+  } else if (afi == 0) {
+    gen_route(r, peer, &pfxs[afi][start], NULL, 0, malformed);
+    upd->announced_nlris.prefixes = nlris;
+    upd->announced_nlris.prefixes_cnt = cnt;
+  } else {
+    gen_route(r, peer, &pfxs[afi][start], nlris, cnt, malformed);
+  }
+  upd->path_attrs = r->attrs;
+}
+
+static int gen_updates(void)
+{
+  parsebgp_mrt_msg_t msg;
+  parsebgp_mrt_bgp4mp_t bgp4mp;
+  parsebgp_bgp_msg_t bgp;
+  parsebgp_bgp_update_t upd;
+  parsebgp_bgp_prefix_t nlris[MAX_UPDATE_PFXS];
+  const gen_peer_t *peer;
+  int i, malformed;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.type = PARSEBGP_MRT_TYPE_BGP4MP;
+  msg.subtype = PARSEBGP_MRT_BGP4MP_MESSAGE_AS4;
+  msg.types.bgp4mp = &bgp4mp;
+
+  for (i = 0; i < cfg.updates_cnt; i++) {
+    peer = &peers[rng_below(cfg.peers_cnt)];
+    malformed = rng_chance(cfg.malformed_share);
+
+    memset(&bgp4mp, 0, sizeof(bgp4mp));
+    bgp4mp.peer_asn = peer->asn;
+    bgp4mp.local_asn = COLLECTOR_ASN;
+    bgp4mp.afi = peer->afi;
+    memcpy(bgp4mp.peer_ip, peer->ip, 16);
+    if (peer->afi == PARSEBGP_BGP_AFI_IPV4) {
+      memcpy(bgp4mp.local_ip, collector_ip4, 4);
+    } else {
+      memcpy(bgp4mp.local_ip, collector_ip6, 16);
+    }
+    gen_update(&bgp, &upd, peer, &routes[0], nlris, malformed);
+    bgp4mp.data.bgp_msg = &bgp;
+
+    // a few updates per second
+    now += rng_chance(0.3);
+    msg.timestamp_sec = now;
+
+    if (write_mrt(&msg, rng_chance(cfg.truncated_share)) != 0) {
+      return -1;
+    }
+    malformed_cnt += malformed;
+  }
+
+  return 0;
+}
+
+/* -------------------- BMP streams -------------------- */
+
+static void gen_bmp_peer_hdr(parsebgp_bmp_peer_hdr_t *hdr,
+                             const gen_peer_t *peer)
+{
+  memset(hdr, 0, sizeof(*hdr));
+  hdr->type = 0; // Global Instance Peer
+  hdr->flags = peer->afi == PARSEBGP_BGP_AFI_IPV6 ? PARSEBGP_BMP_PEER_FLAG_IPV6
+                                                   : 0;
+  hdr->afi = peer->afi;
+  memcpy(hdr->addr, peer->ip, 16);
+  hdr->asn = peer->asn;
+  memcpy(hdr->bgp_id, peer->bgp_id, 4);
+  hdr->ts_sec = now;
+  hdr->ts_usec = rng_below(1000000);
+}
+
+static void gen_open(parsebgp_bgp_msg_t *bgp, parsebgp_bgp_open_t *open,
+                     parsebgp_bgp_open_capability_t *caps, uint32_t asn,
+                     const uint8_t *bgp_id)
+{
+  memset(bgp, 0, sizeof(*bgp));
+  memset(open, 0, sizeof(*open));
+  memset(caps, 0, sizeof(*caps) * 3);
+  bgp->type = PARSEBGP_BGP_TYPE_OPEN;
+  bgp->types.open = open;
+
+  open->version = 4;
+  open->asn = asn > UINT16_MAX ? PARSEBGP_BGP_AS_TRANS : asn;
+  open->hold_time = 180;
+  memcpy(open->bgp_id, bgp_id, 4);
+
+  caps[0].code = PARSEBGP_BGP_OPEN_CAPABILITY_MPBGP;
+  caps[0].len = 4;
+  caps[0].values.mpbgp.afi = PARSEBGP_BGP_AFI_IPV4;
+  caps[0].values.mpbgp.safi = PARSEBGP_BGP_SAFI_UNICAST;
+  caps[1].code = PARSEBGP_BGP_OPEN_CAPABILITY_MPBGP;
+  caps[1].len = 4;
+  caps[1].values.mpbgp.afi = PARSEBGP_BGP_AFI_IPV6;
+  caps[1].values.mpbgp.safi = PARSEBGP_BGP_SAFI_UNICAST;
+  caps[2].code = PARSEBGP_BGP_OPEN_CAPABILITY_AS4;
+  caps[2].len = 4;
+  caps[2].values.asn = asn;
+  open->capabilities = caps;
+  open->capabilities_cnt = 3;
+}
+
+static int gen_bmp(void)
+{
+  parsebgp_bmp_msg_t msg;
+  parsebgp_bmp_info_tlv_t tlvs[2];
+  parsebgp_bmp_init_msg_t init;
+  parsebgp_bmp_peer_up_t peer_up;
+  parsebgp_bgp_msg_t sent_open, recv_open, bgp;
+  parsebgp_bgp_open_t sent, recv;
+  parsebgp_bgp_open_capability_t sent_caps[3], recv_caps[3];
+  parsebgp_bgp_update_t upd;
+  parsebgp_bgp_prefix_t nlris[MAX_UPDATE_PFXS];
+  parsebgp_bmp_term_tlv_t term_tlv;
+  parsebgp_bmp_term_msg_t term;
+  char sysname[] = "parsebgp-gen", sysdescr[] = "synthetic BMP stream";
+  int i, malformed;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.version = 3;
+  msg.types_valid = 1;
+
+  // Initiation
+  memset(&init, 0, sizeof(init));
+  memset(tlvs, 0, sizeof(tlvs));
+  tlvs[0].type = PARSEBGP_BMP_INFO_TLV_TYPE_SYSDESCR;
+  tlvs[0].len = strlen(sysdescr);
+  tlvs[0].info = (uint8_t *)sysdescr;
+  tlvs[1].type = PARSEBGP_BMP_INFO_TLV_TYPE_SYSNAME;
+  tlvs[1].len = strlen(sysname);
+  tlvs[1].info = (uint8_t *)sysname;
+  init.tlvs = tlvs;
+  init.tlvs_cnt = 2;
+  msg.type = PARSEBGP_BMP_TYPE_INIT_MSG;
+  msg.types.init_msg = &init;
+  if (write_bmp(&msg, 0) != 0) {
+    return -1;
+  }
+
+  // Peer Up for each peer
+  for (i = 0; i < cfg.peers_cnt; i++) {
+    memset(&peer_up, 0, sizeof(peer_up));
+    peer_up.local_ip_afi = peers[i].afi;
+    if (peers[i].afi == PARSEBGP_BGP_AFI_IPV4) {
+      memcpy(peer_up.local_ip, collector_ip4, 4);
+    } else {
+      memcpy(peer_up.local_ip, collector_ip6, 16);
+    }
+    peer_up.local_port = 179;
+    peer_up.remote_port = 1024 + rng_below(64000);
+    gen_open(&sent_open, &sent, sent_caps, COLLECTOR_ASN, collector_ip4);
+    gen_open(&recv_open, &recv, recv_caps, peers[i].asn, peers[i].bgp_id);
+    peer_up.sent_open = &sent_open;
+    peer_up.recv_open = &recv_open;
+
+    gen_bmp_peer_hdr(&msg.peer_hdr, &peers[i]);
+    msg.type = PARSEBGP_BMP_TYPE_PEER_UP;
+    msg.types.peer_up = &peer_up;
+    if (write_bmp(&msg, 0) != 0) {
+      return -1;
+    }
+  }
+
+  // Route Monitoring
+  msg.type = PARSEBGP_BMP_TYPE_ROUTE_MON;
+  msg.types.route_mon = &bgp;
+  for (i = 0; i < cfg.updates_cnt; i++) {
+    const gen_peer_t *peer = &peers[rng_below(cfg.peers_cnt)];
+    malformed = rng_chance(cfg.malformed_share);
+
+    now += rng_chance(0.3);
+    gen_bmp_peer_hdr(&msg.peer_hdr, peer);
+    gen_update(&bgp, &upd, peer, &routes[0], nlris, malformed);
+
+    if (write_bmp(&msg, rng_chance(cfg.truncated_share)) != 0) {
+      return -1;
+    }
+    malformed_cnt += malformed;
+  }
+
+  // Termination
+  memset(&term, 0, sizeof(term));
+  memset(&term_tlv, 0, sizeof(term_tlv));
+  term_tlv.type = PARSEBGP_BMP_TERM_INFO_TYPE_REASON;
+  term_tlv.len = 2;
+  term_tlv.info.reason = PARSEBGP_BMP_TERM_REASON_ADMIN_CLOSE;
+  term.tlvs = &term_tlv;
+  term.tlvs_cnt = 1;
+  msg.type = PARSEBGP_BMP_TYPE_TERM_MSG;
+  msg.types.term_msg = &term;
+  return write_bmp(&msg, 0);
+}
+
+/* -------------------- Main -------------------- */
+
+static void usage(void)
+{
+  fprintf(
+    stderr,
+    "usage: %s [options]\n"
+    "       -f <format>        Output format: 'rib' (MRT TABLE_DUMP_V2,\n"
+    "                            default), 'updates' (MRT BGP4MP) or 'bmp'\n"
+    "       -o <file>          Write to file (default: stdout)\n"
+    "       -s <seed>          Random seed (default: %" PRIu64 ")\n"
+    "       -T <time>          Timestamp of the first record (default: %" PRIu32
+    ")\n"
+    "       -n <count>         Number of prefixes (default: %d)\n"
+    "       -p <count>         Number of peers (default: %d)\n"
+    "       -u <count>         Number of UPDATEs for 'updates' and 'bmp'\n"
+    "                            (default: %d)\n"
+    "       -a <count>         Distinct attribute sets per peer, or 0 to give\n"
+    "                            every route its own attributes (default: %d)\n"
+    "       -l <mean>[:<max>]  AS path length (default: %.1f:%d)\n"
+    "       -c <mean>[:<max>]  Communities per route (default: %.1f:%d)\n"
+    "       -e <mean>[:<max>]  Extended communities per route\n"
+    "                            (default: %.1f:%d)\n"
+    "       -6 <share>         Share of IPv6 prefixes and peers\n"
+    "                            (default: %.2f)\n"
+    "       -m <share>         Share of malformed records (default: %.2f)\n"
+    "       -t <share>         Share of truncated records (default: %.2f)\n"
+    "       -h                 Show this help message\n"
+    "       -v                 Show version of the libparsebgp library\n"
+    "\n"
+    "Path lengths and community counts are Poisson-distributed with the given\n"
+    "mean. Prefixes are assigned to attribute sets with a Zipf-like skew, and\n"
+    "all routes of a peer for prefixes in the same set share their\n"
+    "attributes. Output only depends on the seed and the options.\n",
+    NAME, cfg.seed, cfg.timestamp, cfg.prefixes_cnt, cfg.peers_cnt,
+    cfg.updates_cnt, cfg.attr_sets_cnt, cfg.path_len_mean, cfg.path_len_max,
+    cfg.comms_mean, cfg.comms_max, cfg.ext_comms_mean, cfg.ext_comms_max,
+    cfg.ipv6_share, cfg.malformed_share, cfg.truncated_share);
+}
+
+/** Parse a "<mean>[:<max>]" option argument */
+static int parse_dist(const char *arg, double *mean, int *max, int max_max)
+{
+  char *end;
+
+  *mean = strtod(arg, &end);
+  if (end == arg || *mean < 0) {
+    return -1;
+  }
+  if (*end == ':') {
+    arg = end + 1;
+    *max = strtol(arg, &end, 10);
+    if (end == arg) {
+      return -1;
+    }
+  }
+  if (*end != '\0' || *max < 0 || *max > max_max) {
+    return -1;
+  }
+  return 0;
+}
+
+static int parse_share(const char *arg, double *share)
+{
+  char *end;
+
+  *share = strtod(arg, &end);
+  if (end == arg || *end != '\0' || *share < 0 || *share > 1) {
+    return -1;
+  }
+  return 0;
+}
+
+static int parse_count(const char *arg, int *cnt, int min, int max)
+{
+  char *end;
+  long l = strtol(arg, &end, 10);
+
+  if (end == arg || *end != '\0' || l < min || l > max) {
+    return -1;
+  }
+  *cnt = l;
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  int prevoptind;
+  int i, ret = -1;
+  const char *outname = NULL;
+  opterr = 0;
+
+  while (prevoptind = optind,
+         (opt = getopt(argc, argv, ":6:a:c:e:f:l:m:n:o:p:s:t:T:u:hv?")) >= 0) {
+    if (optind == prevoptind + 2 && (optarg == NULL || *optarg == '-')) {
+      opt = ':';
+      --optind;
+    }
+    switch (opt) {
+    case '6':
+      if (parse_share(optarg, &cfg.ipv6_share) != 0) {
+        fprintf(stderr, "ERROR: Invalid IPv6 share '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'a':
+      if (parse_count(optarg, &cfg.attr_sets_cnt, 0, MAX_ATTR_SETS) != 0) {
+        fprintf(stderr, "ERROR: Invalid attribute set count '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'c':
+      if (parse_dist(optarg, &cfg.comms_mean, &cfg.comms_max, MAX_COMMS) !=
+          0) {
+        fprintf(stderr, "ERROR: Invalid communities distribution '%s'\n",
+                optarg);
+        return -1;
+      }
+      break;
+
+    case 'e':
+      if (parse_dist(optarg, &cfg.ext_comms_mean, &cfg.ext_comms_max,
+                     MAX_EXT_COMMS) != 0) {
+        fprintf(stderr,
+                "ERROR: Invalid extended communities distribution '%s'\n",
+                optarg);
+        return -1;
+      }
+      break;
+
+    case 'f':
+      for (i = 0; i <= FORMAT_BMP; i++) {
+        if (strcmp(optarg, format_strs[i]) == 0) {
+          break;
+        }
+      }
+      if (i > FORMAT_BMP) {
+        fprintf(stderr, "ERROR: Unknown output format '%s'\n", optarg);
+        usage();
+        return -1;
+      }
+      cfg.format = i;
+      break;
+
+    case 'l':
+      if (parse_dist(optarg, &cfg.path_len_mean, &cfg.path_len_max,
+                     MAX_PATH_LEN) != 0 ||
+          cfg.path_len_mean < 1 || cfg.path_len_max < 1) {
+        fprintf(stderr, "ERROR: Invalid AS path length distribution '%s'\n",
+                optarg);
+        return -1;
+      }
+      break;
+
+    case 'm':
+      if (parse_share(optarg, &cfg.malformed_share) != 0) {
+        fprintf(stderr, "ERROR: Invalid malformed share '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'n':
+      if (parse_count(optarg, &cfg.prefixes_cnt, 1, INT32_MAX) != 0) {
+        fprintf(stderr, "ERROR: Invalid prefix count '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'o':
+      outname = optarg;
+      break;
+
+    case 'p':
+      // TABLE_DUMP_V2 peer indexes are 16-bit
+      if (parse_count(optarg, &cfg.peers_cnt, 1, UINT16_MAX) != 0) {
+        fprintf(stderr, "ERROR: Invalid peer count '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 's':
+      cfg.seed = strtoull(optarg, NULL, 0);
+      break;
+
+    case 't':
+      if (parse_share(optarg, &cfg.truncated_share) != 0) {
+        fprintf(stderr, "ERROR: Invalid truncated share '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'T':
+      cfg.timestamp = strtoul(optarg, NULL, 0);
+      break;
+
+    case 'u':
+      if (parse_count(optarg, &cfg.updates_cnt, 0, INT32_MAX) != 0) {
+        fprintf(stderr, "ERROR: Invalid UPDATE count '%s'\n", optarg);
+        return -1;
+      }
+      break;
+
+    case 'h':
+    case '?':
+      usage();
+      return 0;
+      break;
+
+    case 'v':
+      fprintf(stderr, "libparsebgp version %d.%d.%d\n",
+              LIBPARSEBGP_MAJOR_VERSION, LIBPARSEBGP_MID_VERSION,
+              LIBPARSEBGP_MINOR_VERSION);
+      return 0;
+      break;
+
+    default:
+      usage();
+      return -1;
+      break;
+    }
+  }
+
+  if (optind < argc) {
+    usage();
+    return -1;
+  }
+
+  if (outname == NULL) {
+    outfile = stdout;
+  } else if ((outfile = fopen(outname, "wb")) == NULL) {
+    fprintf(stderr, "ERROR: Could not open %s for writing (%s)\n", outname,
+            strerror(errno));
+    return -1;
+  }
+
+  buf_len = BUFLEN;
+  if ((buf = malloc(buf_len)) == NULL) {
+    fprintf(stderr, "ERROR: Could not allocate record buffer\n");
+    goto out;
+  }
+
+  rng_state = cfg.seed;
+  now = cfg.timestamp;
+  if (gen_topology() != 0) {
+    fprintf(stderr, "ERROR: Could not allocate topology\n");
+    goto out;
+  }
+
+  switch (cfg.format) {
+  case FORMAT_RIB:
+    ret = gen_rib();
+    break;
+
+  case FORMAT_UPDATES:
+    ret = gen_updates();
+    break;
+
+  case FORMAT_BMP:
+    ret = gen_bmp();
+    break;
+  }
+
+  if (ret == 0) {
+    fprintf(stderr,
+            "INFO: Wrote %" PRIu64 " %s records (%" PRIu64
+            " malformed, %" PRIu64 " truncated)\n",
+            records_cnt, format_strs[cfg.format], malformed_cnt,
+            truncated_cnt);
+  }
+
+out:
+  if (outfile != NULL && outfile != stdout && fclose(outfile) != 0) {
+    fprintf(stderr, "ERROR: Failed to write %s (%s)\n", outname,
+            strerror(errno));
+    ret = -1;
+  }
+  free(buf);
+  free(peers);
+  free(routes);
+  free(attr_set_origins);
+  free(pfxs[0]);
+  free(pfxs[1]);
+  return ret;
+}